@@ -0,0 +1,1548 @@
+// Native micro-benchmarks for the platform-independent core library.
+//
+//   framespace_bench [filter] [--json out.json]
+//
+// Only sections whose name contains `filter` are run. With --json, the
+// stress section also writes its results there for comparing commits.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera.h"
+#include "input_queue.h"
+#include "input_trace.h"
+#include "jobs.h"
+#include "math3d.h"
+#include "mesh.h"
+#include "page_stats.h"
+#include "physics.h"
+#include "profiler.h"
+#include "residency.h"
+#include "resolution.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "scene_gen.h"
+#include "snapshot_codec.h"
+#include "world_config.h"
+
+#if defined(FRAMESPACE_BENCH_HAS_PNG)
+#include <png.h>
+#endif
+
+namespace {
+
+uint64_t g_alloc_count = 0;
+uint64_t g_alloc_bytes = 0;
+
+struct BenchResult {
+  double ns_per_op;
+  uint64_t allocs;
+  uint64_t alloc_bytes;
+};
+
+struct Rng {
+  uint32_t state;
+};
+
+float rng_float(Rng& rng, float lo, float hi) {
+  rng.state = rng.state * 1664525u + 1013904223u;
+  return lo + (hi - lo) * static_cast<float>(rng.state >> 8) * (1.0f / 16777216.0f);
+}
+
+template <typename Fn>
+BenchResult run_bench(uint64_t ops_per_iter, Fn&& fn) {
+  using Clock = std::chrono::steady_clock;
+
+  fn();  // warm-up
+
+  int iters = 1;
+  for (;;) {
+    const uint64_t allocs_before = g_alloc_count;
+    const uint64_t bytes_before = g_alloc_bytes;
+    const auto t0 = Clock::now();
+    for (int i = 0; i < iters; ++i) {
+      fn();
+    }
+    const auto t1 = Clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    if (ns > 2.0e8 || iters >= (1 << 24)) {
+      const double ops = static_cast<double>(iters) * static_cast<double>(ops_per_iter);
+      return {ns / ops,
+              (g_alloc_count - allocs_before) / static_cast<uint64_t>(iters),
+              (g_alloc_bytes - bytes_before) / static_cast<uint64_t>(iters)};
+    }
+    iters *= 2;
+  }
+}
+
+void report(const char* name, int n, const BenchResult& r) {
+  std::printf("%-34s n=%-7d %12.2f ns/op %10llu allocs/iter %12llu bytes/iter\n",
+              name,
+              n,
+              r.ns_per_op,
+              static_cast<unsigned long long>(r.allocs),
+              static_cast<unsigned long long>(r.alloc_bytes));
+}
+
+bool section_enabled(const char* filter, const char* name) {
+  return filter == nullptr || std::strstr(name, filter) != nullptr;
+}
+
+volatile float g_sink = 0.0f;
+
+void fill_scene(PhotoScene& scene, int n, Rng& rng) {
+  for (int i = 0; i < n; ++i) {
+    const Vec3 pos{rng_float(rng, -200.0f, 200.0f), rng_float(rng, 0.5f, 3.0f), rng_float(rng, -200.0f, 200.0f)};
+    scene_place_photo(scene, static_cast<uint32_t>(i + 1), pos, rng_float(rng, -3.14f, 3.14f), 1.0f);
+  }
+}
+
+bool check_batch_kernels() {
+  constexpr int kCount = 257;
+  Rng rng{7};
+  std::vector<float> px(kCount), py(kCount), pz(kCount), yaw(kCount), scale(kCount);
+  for (int i = 0; i < kCount; ++i) {
+    px[i] = rng_float(rng, -100.0f, 100.0f);
+    py[i] = rng_float(rng, -5.0f, 5.0f);
+    pz[i] = rng_float(rng, -100.0f, 100.0f);
+    yaw[i] = rng_float(rng, -6.3f, 6.3f);
+    scale[i] = rng_float(rng, 0.1f, 4.0f);
+  }
+
+  std::vector<Mat4> models(kCount);
+  std::vector<Mat4> mvps(kCount);
+  const TrsSoA trs{px.data(), py.data(), pz.data(), yaw.data(), scale.data()};
+  mat4_compose_trs_y_batch(trs, models[0].m, 16, kCount);
+
+  const Mat4 vp = mat4_mul(mat4_perspective_rh_zo(1.0f, 1.6f, 0.1f, 200.0f),
+                           mat4_look_at_rh(Vec3{1.0f, 2.0f, 3.0f}, Vec3{0.0f, 0.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f}));
+  mat4_mul_batch(vp, models[0].m, 16, mvps[0].m, 16, kCount);
+
+  // The same kernels writing into a padded layout, as the instance buffer does.
+  constexpr size_t kStride = 20;
+  std::vector<float> strided_models(kCount * kStride);
+  std::vector<float> strided_mvps(kCount * kStride);
+  mat4_compose_trs_y_batch(trs, strided_models.data(), kStride, kCount);
+  mat4_mul_batch(vp, strided_models.data(), kStride, strided_mvps.data(), kStride, kCount);
+
+  // The batch paths promise the scalar functions' results bit for bit.
+  int mismatches = 0;
+  float max_diff = 0.0f;
+  for (int i = 0; i < kCount; ++i) {
+    const Mat4 ref_model = mat4_mul(mat4_translation(Vec3{px[i], py[i], pz[i]}),
+                                    mat4_mul(mat4_rotation_y(yaw[i]), mat4_scale(scale[i], scale[i], 1.0f)));
+    const Mat4 ref_mvp = mat4_mul(vp, ref_model);
+    const float* strided_model = strided_models.data() + i * kStride;
+    const float* strided_mvp = strided_mvps.data() + i * kStride;
+    for (int k = 0; k < 16; ++k) {
+      mismatches += ref_model.m[k] != models[i].m[k] || ref_mvp.m[k] != mvps[i].m[k] ? 1 : 0;
+      mismatches += ref_model.m[k] != strided_model[k] || ref_mvp.m[k] != strided_mvp[k] ? 1 : 0;
+      max_diff = std::fmax(max_diff, std::fabs(ref_model.m[k] - models[i].m[k]));
+      max_diff = std::fmax(max_diff, std::fabs(ref_mvp.m[k] - mvps[i].m[k]));
+    }
+  }
+
+  std::printf("%-34s n=%-7d %12d mismatched floats (%s kernels)\n", "kernels/batch_parity", kCount, mismatches,
+              math_batch_kernel_name());
+  if (mismatches != 0) {
+    std::fprintf(stderr, "batch kernels disagree with the scalar path (max diff %g)\n", max_diff);
+    return false;
+  }
+  return true;
+}
+
+void bench_math(int n) {
+  Rng rng{1};
+  std::vector<float> px(n), py(n), pz(n), yaw(n), scale(n);
+  for (int i = 0; i < n; ++i) {
+    px[i] = rng_float(rng, -100.0f, 100.0f);
+    py[i] = rng_float(rng, 0.0f, 3.0f);
+    pz[i] = rng_float(rng, -100.0f, 100.0f);
+    yaw[i] = rng_float(rng, -3.14f, 3.14f);
+    scale[i] = 1.0f;
+  }
+  std::vector<Mat4> models(n);
+  std::vector<Mat4> mvps(n);
+  const Mat4 vp = mat4_perspective_rh_zo(1.0f, 1.6f, 0.1f, 200.0f);
+  const TrsSoA trs{px.data(), py.data(), pz.data(), yaw.data(), scale.data()};
+
+  report("math/compose_trs_scalar", n, run_bench(static_cast<uint64_t>(n), [&] {
+           for (int i = 0; i < n; ++i) {
+             const Mat4 t = mat4_translation(Vec3{px[i], py[i], pz[i]});
+             const Mat4 r = mat4_rotation_y(yaw[i]);
+             const Mat4 s = mat4_scale(scale[i], scale[i], 1.0f);
+             models[i] = mat4_mul(t, mat4_mul(r, s));
+           }
+           g_sink = models[n - 1].m[12];
+         }));
+
+  report("math/compose_trs_batch", n, run_bench(static_cast<uint64_t>(n), [&] {
+           mat4_compose_trs_y_batch(trs, models[0].m, 16, static_cast<size_t>(n));
+           g_sink = models[n - 1].m[12];
+         }));
+
+  report("math/mat4_mul_scalar", n, run_bench(static_cast<uint64_t>(n), [&] {
+           for (int i = 0; i < n; ++i) {
+             mvps[i] = mat4_mul(vp, models[i]);
+           }
+           g_sink = mvps[n - 1].m[0];
+         }));
+
+  report("math/mat4_mul_batch", n, run_bench(static_cast<uint64_t>(n), [&] {
+           mat4_mul_batch(vp, models[0].m, 16, mvps[0].m, 16, static_cast<size_t>(n));
+           g_sink = mvps[n - 1].m[0];
+         }));
+}
+
+void bench_placement(int n) {
+  constexpr int kCapacity = 100000;
+  PhotoScene scene{};
+  scene_init(scene, kCapacity);
+  report("scene/place_photo", n, run_bench(static_cast<uint64_t>(n), [&] {
+           scene_clear(scene);
+           Rng rng{3};
+           fill_scene(scene, n, rng);
+         }));
+
+  // Steady-state churn at n live photos: remove a random live photo and
+  // place a new one, as an editing session would.
+  scene_clear(scene);
+  Rng rng{11};
+  fill_scene(scene, n, rng);
+  report("scene/remove_place_churn", n, run_bench(1024, [&] {
+           for (int i = 0; i < 1024; ++i) {
+             const int victim = static_cast<int>(rng_float(rng, 0.0f, static_cast<float>(scene.count) - 1.0f));
+             scene_remove_photo(scene, scene_handle_at(scene, victim));
+             const Vec3 pos{rng_float(rng, -200.0f, 200.0f), 1.5f, rng_float(rng, -200.0f, 200.0f)};
+             scene_place_photo(scene, 1, pos, 0.0f, 1.0f);
+           }
+         }));
+
+  report("scene/iterate_live", n, run_bench(static_cast<uint64_t>(n), [&] {
+           float sum = 0.0f;
+           for (int i = 0; i < scene.count; ++i) {
+             sum += scene.px[i] + scene.pz[i];
+           }
+           g_sink = sum;
+         }));
+}
+
+Mat4 bench_view_projection(Vec3 eye, float yaw) {
+  const Mat4 proj = mat4_perspective_rh_zo(60.0f * 3.14159265f / 180.0f, 16.0f / 9.0f, 0.1f, 200.0f);
+  const Vec3 fwd{std::cos(yaw), 0.0f, std::sin(yaw)};
+  return mat4_mul(proj, mat4_look_at_rh(eye, vec3_add(eye, fwd), Vec3{0.0f, 1.0f, 0.0f}));
+}
+
+Frustum frustum_enclosing_everything() {
+  Frustum f{};
+  const Vec3 normals[6] = {
+      {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+      {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f},
+  };
+  for (int i = 0; i < 6; ++i) {
+    f.planes[i].normal = normals[i];
+    f.planes[i].d = 1.0e6f;
+  }
+  return f;
+}
+
+void bench_scene_prep(int n) {
+  PhotoScene scene{};
+  scene_init(scene, n);
+  Rng rng{5};
+  fill_scene(scene, n, rng);
+  std::vector<InstanceData> instances(static_cast<size_t>(n));
+
+  struct View {
+    const char* name;
+    Frustum frustum;
+  };
+  // A frustum that encloses the whole scene measures the unculled cost;
+  // the camera views measure cost proportional to what is visible.
+  const View views[] = {
+      {"scene/prepare_all_visible", frustum_enclosing_everything()},
+      {"scene/prepare_camera_center", frustum_from_view_projection(bench_view_projection(Vec3{0.0f, 1.5f, 0.0f}, 0.3f))},
+      {"scene/prepare_camera_outward", frustum_from_view_projection(bench_view_projection(Vec3{-199.0f, 1.5f, -199.0f}, 3.5f))},
+  };
+
+  for (const View& view : views) {
+    const BenchResult r = run_bench(1, [&] {
+      const int count = scene_prepare_instances(scene, view.frustum, nullptr, instances.data(), n);
+      g_sink = count > 0 ? instances[static_cast<size_t>(count - 1)].model[12] : 0.0f;
+    });
+    report(view.name, n, r);
+    std::printf("%-34s n=%-7d %12d visible %9d culled %9d nodes visited\n",
+                "",
+                n,
+                scene.last_cull.visible,
+                scene.last_cull.culled,
+                scene.last_cull.nodes_visited);
+  }
+}
+
+// Each frame sees a random window of instances covering about a sixth of the
+// snapshot layers, so the detail pool keeps churning as the camera moves.
+void bench_residency(int n) {
+  constexpr int kLayers = 48;
+  PhotoScene scene{};
+  scene_init(scene, n);
+  Rng rng{17};
+  fill_scene(scene, n, rng);
+  std::vector<InstanceData> instances(static_cast<size_t>(n));
+  SnapshotLayerTable layers{};
+  snapshot_layers_init(layers, kLayers);
+  for (uint32_t shot = 1; shot <= kLayers; ++shot) {
+    snapshot_layer_assign(layers, shot);
+  }
+  for (int i = 0; i < scene.count; ++i) {
+    scene.shot_id[i] = 1 + static_cast<uint32_t>(i % kLayers);
+  }
+  const int count = scene_prepare_instances(scene, frustum_enclosing_everything(), &layers, instances.data(), n);
+  std::sort(instances.begin(), instances.begin() + count,
+            [](const InstanceData& a, const InstanceData& b) { return a.params[0] < b.params[0]; });
+  const int window = count / 6;
+
+  SnapshotResidency residency{};
+  residency_init(residency, kLayers, 3, mip_chain_bytes(60, 40), mip_chain_bytes(480, 320), 16ull * 1024 * 1024);
+  for (int layer = 0; layer < kLayers; ++layer) {
+    residency_set_source_ready(residency, layer, true);
+  }
+
+  uint64_t frame = 0;
+  uint64_t uploads = 0;
+  const BenchResult r = run_bench(static_cast<uint64_t>(window), [&] {
+    frame += 1;
+    InstanceData* visible = instances.data() + static_cast<int>(rng_float(rng, 0.0f, static_cast<float>(count - window)));
+    const Vec3 eye{rng_float(rng, -200.0f, 200.0f), 1.5f, rng_float(rng, -200.0f, 200.0f)};
+    residency_request_visible(residency, visible, window, eye, 1.732f, 720.0f, 320.0f);
+    residency_update(residency, frame);
+    residency_apply(residency, visible, window);
+    uploads += residency.last_stats.uploads;
+  });
+  report("scene/residency_request_update", n, r);
+  std::printf("%-34s n=%-7d %12d slots %7.1f MiB resident %6llu uploads %6llu evictions\n",
+              "",
+              n,
+              residency.slot_count,
+              static_cast<double>(residency.last_stats.bytes_resident) / (1024.0 * 1024.0),
+              static_cast<unsigned long long>(uploads),
+              static_cast<unsigned long long>(residency.total_evictions));
+}
+
+
+void report_ms(const char* name, int n, const BenchResult& r) {
+  std::printf("%-34s n=%-7d %12.3f ms    %10llu allocs/iter %12llu bytes/iter\n",
+              name,
+              n,
+              r.ns_per_op * 1.0e-6,
+              static_cast<unsigned long long>(r.allocs),
+              static_cast<unsigned long long>(r.alloc_bytes));
+}
+
+// Save, then load back through mmap: opening the view is the in-place path,
+// loading into a PhotoScene adds the column copies and the BVH build.
+bool bench_scene_file(int n) {
+  PhotoScene scene{};
+  scene_init(scene, n);
+  Rng rng{23};
+  fill_scene(scene, n, rng);
+
+  std::vector<uint8_t> file;
+  report_ms("scene_file/write", n, run_bench(1, [&] { scene_file_write(scene, nullptr, 0, 1, file); }));
+
+  const char* path = "framespace_bench_scene.fss";
+  FILE* f = std::fopen(path, "wb");
+  if (!f || std::fwrite(file.data(), 1, file.size(), f) != file.size()) {
+    std::fprintf(stderr, "could not write %s\n", path);
+    if (f) std::fclose(f);
+    return false;
+  }
+  std::fclose(f);
+
+  PhotoScene loaded{};
+  scene_init(loaded, n);
+  bool ok = true;
+  report_ms("scene_file/mmap_open", n, run_bench(1, [&] {
+    MappedFile mapped{};
+    SceneFileView view{};
+    ok = ok && mapped_file_open(path, mapped) && scene_file_open(mapped.data, mapped.size, view) &&
+         view.header->photo_count == static_cast<uint32_t>(n);
+    g_sink = ok ? view.px[n - 1] : 0.0f;
+    mapped_file_close(mapped);
+  }));
+  report_ms("scene_file/mmap_load_scene", n, run_bench(1, [&] {
+    MappedFile mapped{};
+    SceneFileView view{};
+    ok = ok && mapped_file_open(path, mapped) && scene_file_open(mapped.data, mapped.size, view) &&
+         scene_load_photos(loaded, view);
+    mapped_file_close(mapped);
+  }));
+  std::remove(path);
+
+  for (int i = 0; ok && i < n; ++i) {
+    ok = loaded.px[i] == scene.px[i] && loaded.shot_id[i] == scene.shot_id[i] &&
+         scene_find_photo(loaded, scene_handle_at(loaded, i)) == i;
+  }
+  const Frustum everything = frustum_enclosing_everything();
+  std::vector<InstanceData> instances(static_cast<size_t>(n));
+  ok = ok && scene_prepare_instances(loaded, everything, nullptr, instances.data(), n) == n;
+  std::printf("%-34s n=%-7d %12.1f KiB file\n", "", n, static_cast<double>(file.size()) / 1024.0);
+  if (!ok) {
+    std::fprintf(stderr, "scene file round trip mismatch\n");
+  }
+  return ok;
+}
+
+// Per-frame cost of the instrumentation the render loop carries, plus a
+// reader thread summarizing concurrently to check records never tear.
+bool bench_profiler() {
+  static Profiler profiler;
+  profiler_init(profiler);
+  uint64_t frame = 0;
+  const BenchResult record = run_bench(1, [&] {
+    profiler_begin_frame(profiler, frame, profiler_now_ms());
+    { ProfileScope scope(profiler, ProfileStage::RecreateSurface); }
+    { ProfileScope scope(profiler, ProfileStage::UpdateCamera); }
+    { ProfileScope scope(profiler, ProfileStage::UpdateViewProjection); }
+    { ProfileScope scope(profiler, ProfileStage::Encode); }
+    { ProfileScope scope(profiler, ProfileStage::Submit); }
+    profiler_end_frame(profiler, profiler_now_ms());
+    if (frame >= 3) profiler_record_gpu(profiler, frame - 3, ProfileStage::GpuMainPass, 1.0f);
+    if (frame >= 3) profiler_record_counter(profiler, frame - 3, ProfileCounter::PhotosOccluded, 1);
+    frame += 1;
+  });
+  report("profiler/frame_record", 1, record);
+
+  std::vector<ProfileSample> samples;
+  const BenchResult summarize = run_bench(1, [&] {
+    profiler_snapshot(profiler, samples, 300);
+    g_sink = profiler_summarize(samples, ProfileStage::Frame).p99;
+  });
+  report("profiler/snapshot_summarize_300", 300, summarize);
+
+  std::string trace;
+  profiler_snapshot(profiler, samples, kProfilerRingSize);
+  profiler_write_chrome_trace(samples, trace);
+  std::printf("%-34s %8zu frames %10zu trace bytes\n", "", samples.size(), trace.size());
+
+  // Writer stamps every stage with the frame number; a torn copy would mix
+  // two frames.
+  profiler_init(profiler);
+  std::atomic<bool> done{false};
+  uint64_t torn = 0;
+  uint64_t read = 0;
+  std::thread reader([&] {
+    std::vector<ProfileSample> local;
+    while (!done.load(std::memory_order_relaxed)) {
+      profiler_snapshot(profiler, local, kProfilerRingSize);
+      for (const ProfileSample& s : local) {
+        read += 1;
+        for (int i = 1; i < kProfileStageCount - 1; ++i) {
+          torn += s.duration_ms[i] != static_cast<float>(s.frame % 1000) ? 1 : 0;
+        }
+      }
+    }
+  });
+  for (uint64_t f = 0; f < 200000; ++f) {
+    profiler_begin_frame(profiler, f, 0.0);
+    for (int i = 1; i < kProfileStageCount - 1; ++i) {
+      profiler_record(profiler, static_cast<ProfileStage>(i), 0.0, static_cast<double>(f % 1000));
+    }
+    profiler_end_frame(profiler, 1.0);
+  }
+  done.store(true);
+  reader.join();
+  std::printf("%-34s %8llu records read %6llu torn\n", "profiler/concurrent_read",
+              static_cast<unsigned long long>(read), static_cast<unsigned long long>(torn));
+  return torn == 0;
+}
+
+// Parallel cull + instance fill at 1, 2, 4 ... threads, up to the hardware
+// thread count. Every run must produce the same visible count as the serial
+// (BVH-order) path, which is reported as the baseline.
+bool bench_jobs(int n) {
+  PhotoScene scene{};
+  scene_init(scene, n);
+  Rng rng{31};
+  fill_scene(scene, n, rng);
+  std::vector<InstanceData> instances(static_cast<size_t>(n));
+  const Frustum camera = frustum_from_view_projection(bench_view_projection(Vec3{0.0f, 1.5f, 0.0f}, 0.3f));
+  const Frustum everything = frustum_enclosing_everything();
+
+  const int serial_camera = scene_prepare_instances(scene, camera, nullptr, instances.data(), n);
+  const BenchResult serial = run_bench(1, [&] {
+    g_sink = static_cast<float>(scene_prepare_instances(scene, everything, nullptr, instances.data(), n));
+  });
+  report_ms("jobs/serial_prepare_all", n, serial);
+
+  const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+  const int max_threads = std::min(std::max(hardware, 2), kMaxJobWorkers + 1);
+  bool ok = true;
+  double single_thread_ns = 0.0;
+  for (int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    JobSystem jobs;
+    jobs_init(jobs, threads - 1);
+    ok = ok && scene_prepare_instances_parallel(scene, camera, nullptr, instances.data(), n, jobs) == serial_camera;
+    const BenchResult r = run_bench(1, [&] {
+      g_sink = static_cast<float>(scene_prepare_instances_parallel(scene, everything, nullptr, instances.data(), n, jobs));
+    });
+    ok = ok && scene.last_cull.visible == n;
+    single_thread_ns = threads == 1 ? r.ns_per_op : single_thread_ns;
+    const JobStats stats = jobs_stats(jobs);
+    char name[64];
+    std::snprintf(name, sizeof(name), "jobs/parallel_prepare_all_t%d", threads);
+    report_ms(name, n, r);
+    std::printf("%-34s n=%-7d %12.2fx vs 1 thread %6llu jobs %8llu stolen\n",
+                "",
+                n,
+                single_thread_ns / r.ns_per_op,
+                static_cast<unsigned long long>(stats.executed),
+                static_cast<unsigned long long>(stats.stolen));
+    jobs_shutdown(jobs);
+    if (threads == max_threads) {
+      break;
+    }
+  }
+  if (!ok) {
+    std::fprintf(stderr, "parallel prepare does not match the serial path\n");
+  }
+  return ok;
+}
+
+// Timed steps must not let volumes come to rest part way through a run.
+void physics_keep_moving(PhysicsWorld& world) {
+  for (PhysicsVolume& volume : world.volumes) {
+    volume.still_steps = 0;
+  }
+}
+
+// Volumes dropped into view must settle and stop being stepped, or render on
+// demand never gets an idle frame. Returns the steps until the last one rests.
+int physics_steps_to_rest(int volumes, int bodies, float radius, int max_steps) {
+  static PhysicsWorld world;
+  physics_init(world, volumes, bodies, radius);
+  for (int v = 0; v < volumes; ++v) {
+    physics_add_volume(world, static_cast<PhotoHandle>(v + 1), bodies, static_cast<uint32_t>(v));
+  }
+  JobSystem jobs;
+  jobs_init(jobs, 0);
+  int steps = 0;
+  for (; steps < max_steps; ++steps) {
+    physics_step(world, jobs);
+    if (world.last_stats.awake_volumes == 0) {
+      break;
+    }
+  }
+  jobs_shutdown(jobs);
+  return steps;
+}
+
+// The app's full physics world (at least kPhysicsBodyCapacity spheres, every
+// volume awake) stepped at 1, 2, 4 ... threads. The fastest run must fit a
+// step in 1/120 s of CPU for the fixed 120 Hz rate to keep up, or the bench
+// fails. The last run puts half the volumes to sleep.
+bool bench_physics() {
+  constexpr int kVolumes = kMaxPhysicsVolumes;
+  constexpr int kBodies = kPhysicsBodiesPerFrame;
+  static PhysicsWorld world;
+  physics_init(world, kVolumes, kBodies, kPhysicsBodyRadius);
+  for (int v = 0; v < kVolumes; ++v) {
+    physics_add_volume(world, static_cast<PhotoHandle>(v + 1), kBodies, static_cast<uint32_t>(v));
+  }
+  JobSystem settle;
+  jobs_init(settle, 0);
+  for (int i = 0; i < 120; ++i) {
+    physics_step(world, settle);
+  }
+  jobs_shutdown(settle);
+
+  const int n = physics_body_count(world);
+  const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+  const int max_threads = std::min(std::max(hardware, 2), kMaxJobWorkers + 1);
+  constexpr double kStepBudgetNs = 1.0e9 / 120.0;
+  double best_ns = 0.0;
+  for (int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    JobSystem jobs;
+    jobs_init(jobs, threads - 1);
+    const BenchResult r = run_bench(1, [&] {
+      physics_keep_moving(world);
+      physics_step(world, jobs);
+    });
+    best_ns = threads == 1 ? r.ns_per_op : std::min(best_ns, r.ns_per_op);
+    char name[64];
+    std::snprintf(name, sizeof(name), "physics/step_t%d", threads);
+    report_ms(name, n, r);
+    std::printf("%-34s n=%-7d %12.0f Hz max %9d contacts %s\n",
+                "",
+                n,
+                1.0e9 / r.ns_per_op,
+                world.last_stats.contacts,
+                r.ns_per_op <= kStepBudgetNs ? "(keeps up with 120 Hz)" : "(below 120 Hz)");
+    if (threads == max_threads) {
+      for (int v = 0; v < kVolumes; v += 2) {
+        world.volumes[v].awake = false;
+      }
+      const BenchResult half = run_bench(1, [&] {
+        physics_keep_moving(world);
+        physics_step(world, jobs);
+      });
+      report_ms("physics/step_half_asleep", world.last_stats.awake_bodies, half);
+      jobs_shutdown(jobs);
+      break;
+    }
+    jobs_shutdown(jobs);
+  }
+
+  // Every body must still be finite and inside its box.
+  int escaped = 0;
+  for (const PhysicsVolume& volume : world.volumes) {
+    const int base = static_cast<int>(&volume - world.volumes.data()) * world.bodies_per_volume;
+    for (int b = base; b < base + volume.body_count; ++b) {
+      const bool inside = world.px[b] >= world.box_min.x && world.px[b] <= world.box_max.x &&
+                          world.py[b] >= world.box_min.y && world.py[b] <= world.box_max.y &&
+                          world.pz[b] >= world.box_min.z && world.pz[b] <= world.box_max.z;
+      escaped += inside ? 0 : 1;
+    }
+  }
+  std::printf("%-34s n=%-7d %12d outside their volume\n", "physics/containment", n, escaped);
+  if (best_ns > kStepBudgetNs) {
+    std::fprintf(stderr, "no thread count steps %d bodies within 1/120 s (best %.3f ms)\n", n, best_ns * 1.0e-6);
+  }
+
+  constexpr int kRestVolumes = 200;
+  constexpr int kMaxRestSteps = 10 * 120;
+  const int rest_steps = physics_steps_to_rest(kRestVolumes, kPhysicsBodiesPerFrame, kPhysicsBodyRadius, kMaxRestSteps);
+  std::printf("%-34s n=%-7d %12.2f s until every volume rests\n",
+              "physics/settle",
+              kRestVolumes * kPhysicsBodiesPerFrame,
+              rest_steps * kPhysicsStepSeconds);
+  if (rest_steps >= kMaxRestSteps) {
+    std::fprintf(stderr, "physics volumes never came to rest\n");
+  }
+  return escaped == 0 && best_ns <= kStepBudgetNs && rest_steps < kMaxRestSteps;
+}
+
+// The page thread pushes while the render thread drains a frame's worth at a
+// time; every event must arrive once and in order, with drops counted when
+// the consumer falls behind.
+// The renderer publishes a frame's stats while the page polls them; every
+// read must see one frame's values, never a mix of two.
+bool check_page_stats() {
+  static PageStats stats;
+  page_stats_init(stats);
+  constexpr int kFrames = 200000;
+  std::atomic<bool> done{false};
+  std::thread renderer([&] {
+    double values[kPageStatCount];
+    for (int frame = 1; frame <= kFrames; ++frame) {
+      std::fill(values, values + kPageStatCount, static_cast<double>(frame));
+      page_stats_publish(stats, values);
+    }
+    done.store(true, std::memory_order_release);
+  });
+  int reads = 0;
+  int retries_exhausted = 0;
+  int torn = 0;
+  double values[kPageStatCount];
+  while (!done.load(std::memory_order_acquire)) {
+    if (!page_stats_read(stats, values, 8)) {
+      retries_exhausted += 1;
+      continue;
+    }
+    reads += 1;
+    torn += std::count(values, values + kPageStatCount, values[0]) == kPageStatCount ? 0 : 1;
+  }
+  renderer.join();
+  const bool last_ok = page_stats_read(stats, values, 1) && values[0] == kFrames;
+  std::printf("%-34s n=%-7d %12d reads %6d torn %6d gave up\n", "input_queue/page_stats", kFrames, reads, torn,
+              retries_exhausted);
+  return torn == 0 && last_ok;
+}
+
+bool bench_input_queue() {
+  static InputQueue queue;
+  input_queue_init(queue);
+  constexpr int kEvents = 1000000;
+  std::vector<InputEvent> drained(kInputQueueCapacity);
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::thread producer([&] {
+    for (int i = 0; i < kEvents; ++i) {
+      const InputEvent e{static_cast<uint32_t>(InputEventType::MouseMove), i, -i, 0};
+      while (!input_queue_push(queue, e)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  int received = 0;
+  int out_of_order = 0;
+  while (received < kEvents) {
+    const int count = input_queue_drain(queue, drained.data(), static_cast<int>(drained.size()));
+    for (int i = 0; i < count; ++i) {
+      out_of_order += drained[i].a != received || drained[i].b != -received ? 1 : 0;
+      received += 1;
+    }
+    if (count == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  std::printf("%-34s n=%-7d %12.2f ns/op %10u full pushes %6d out of order\n",
+              "input_queue/spsc_transfer",
+              kEvents,
+              ns / kEvents,
+              queue.dropped.load(),
+              out_of_order);
+  return out_of_order == 0 && check_page_stats();
+}
+
+// Drives the dynamic resolution controller with a synthetic frame cost: a
+// fill-bound part that scales with pixel count, a fixed part, and +-10%
+// jitter. Returns the scale it settled at and counts its steps.
+float run_resolution_phase(ResolutionScaler& scaler, float fill_ms, int frames, uint32_t& rng, int* settled_frame) {
+  constexpr float kFixedMs = 2.0f;
+  *settled_frame = 0;
+  for (int f = 0; f < frames; ++f) {
+    rng = rng * 1664525u + 1013904223u;
+    const float jitter = 0.9f + 0.2f * static_cast<float>(rng >> 8) / static_cast<float>(1u << 24);
+    const float cost = (fill_ms * scaler.scale * scaler.scale + kFixedMs) * jitter;
+    if (resolution_update(scaler, cost)) {
+      *settled_frame = f + 1;
+    }
+  }
+  return scaler.scale;
+}
+
+bool bench_resolution() {
+  ResolutionScaler scaler;
+  resolution_init(scaler, 1000.0f / 60.0f);
+  uint32_t rng = 1;
+  int settled = 0;
+
+  // 24 ms at full size: only 0.75 (14.4 ms) fits, and 0.875 would not fit
+  // the headroom, so it should step down twice and stay.
+  const float heavy = run_resolution_phase(scaler, 22.0f, 3000, rng, &settled);
+  const uint32_t heavy_changes = scaler.changes;
+  std::printf("%-34s %8.3f scale %6u steps %6d frames to settle\n",
+              "resolution/heavy_scene", heavy, heavy_changes, settled);
+
+  const float light = run_resolution_phase(scaler, 5.0f, 3000, rng, &settled);
+  std::printf("%-34s %8.3f scale %6u steps %6d frames to settle\n",
+              "resolution/light_scene", light, scaler.changes - heavy_changes, settled);
+  return heavy == 0.75f && heavy_changes == 2 && light == 1.0f && scaler.changes == 4;
+}
+
+InputEvent command_event(InputCommand command, int32_t b) {
+  return InputEvent{static_cast<uint32_t>(InputEventType::Command), static_cast<int32_t>(command), b, 0};
+}
+
+// A minute of a session at 60 Hz: mouse look most frames, a key change now
+// and then, a capture, a placement and a move every few seconds, an
+// occasional delete, and a stress scene half way through.
+InputTrace synthetic_trace() {
+  InputTrace trace;
+  FlyCamera start;
+  camera_init(start);
+  input_trace_begin(trace, start, 1);
+  Rng rng{23};
+  bool held[static_cast<int>(InputKey::Count)] = {};
+  int32_t shots = 0;
+  int32_t photo_ids = 0;
+  for (uint32_t frame = 0; frame < 3600; ++frame) {
+    const double ms = frame * 16.667 + rng_float(rng, 0.0f, 2.0f);
+    if (rng_float(rng, 0.0f, 1.0f) < 0.8f) {
+      const InputEvent move{static_cast<uint32_t>(InputEventType::MouseMove),
+                            static_cast<int32_t>(rng_float(rng, -12.0f, 12.0f)),
+                            static_cast<int32_t>(rng_float(rng, -6.0f, 6.0f)), 0};
+      input_trace_add(trace, frame, ms, move, nullptr);
+    }
+    if (rng_float(rng, 0.0f, 1.0f) < 0.05f) {
+      const int key = static_cast<int>(rng_float(rng, 0.0f, static_cast<float>(InputKey::Count)));
+      held[key] = !held[key];
+      const InputEventType type = held[key] ? InputEventType::KeyDown : InputEventType::KeyUp;
+      input_trace_add(trace, frame, ms, InputEvent{static_cast<uint32_t>(type), key, 0, 0}, nullptr);
+    }
+    if (frame == 1800) {
+      const uint32_t args[kInputTraceGenerateArgs] = {static_cast<uint32_t>(SceneLayout::Cloud), 8, 5};
+      input_trace_add(trace, frame, ms, command_event(InputCommand::GenerateScene, 200), args);
+      shots = 8;
+      photo_ids = 200;
+    } else if (frame % 300 == 150) {
+      shots += 1;
+      input_trace_add(trace, frame, ms, command_event(InputCommand::Capture, 0), nullptr);
+    } else if (frame % 300 == 180) {
+      photo_ids += 1;
+      input_trace_add(trace, frame, ms, command_event(InputCommand::Place, shots), nullptr);
+    } else if (frame % 300 == 240) {
+      const float pose[kInputTraceMoveArgs] = {rng_float(rng, -5.0f, 5.0f), 1.5f, rng_float(rng, -5.0f, 0.0f),
+                                               rng_float(rng, -3.0f, 3.0f), 1.0f};
+      uint32_t args[kInputTraceMoveArgs];
+      std::memcpy(args, pose, sizeof(args));
+      input_trace_add(trace, frame, ms, command_event(InputCommand::MovePhoto, photo_ids), args);
+    } else if (frame % 900 == 270) {
+      input_trace_add(trace, frame, ms, command_event(InputCommand::DeletePhoto, photo_ids - 1), nullptr);
+    }
+  }
+  trace.frame_count = 3600;
+  return trace;
+}
+
+// Plays the trace's camera path the way the renderer and tools/replay.cpp do.
+FlyCamera replay_camera(const InputTrace& trace) {
+  FlyCamera camera;
+  camera_init(camera);
+  input_trace_start_camera(trace, camera);
+  InputReplay replay;
+  input_replay_begin(replay);
+  std::vector<InputEvent> events;
+  while (input_replay_next_frame(replay, trace, events)) {
+    for (const InputEvent& e : events) {
+      if (e.type == static_cast<uint32_t>(InputEventType::KeyDown) ||
+          e.type == static_cast<uint32_t>(InputEventType::KeyUp)) {
+        camera_set_key(camera, static_cast<InputKey>(e.a), e.type == static_cast<uint32_t>(InputEventType::KeyDown));
+      } else if (e.type == static_cast<uint32_t>(InputEventType::MouseMove)) {
+        camera_mouse_look(camera, static_cast<float>(e.a), static_cast<float>(e.b));
+      }
+    }
+    camera_update(camera, trace.step_seconds);
+  }
+  return camera;
+}
+
+void place_row(PhotoScene& scene, int count) {
+  for (int i = 0; i < count; ++i) {
+    scene_place_photo(scene, static_cast<uint32_t>(i + 1), Vec3{static_cast<float>(i), 1.5f, -4.0f}, 0.0f, 1.0f);
+  }
+}
+
+// The recorder's and the replayer's edits, applied through trace photo ids.
+void edit_through_trace_ids(PhotoScene& scene, InputTracePhotos& photos) {
+  input_trace_photos_reset(photos, scene);
+  input_trace_photos_add(photos, scene_place_photo(scene, 20, Vec3{0.0f, 1.5f, -8.0f}, 0.0f, 1.0f));
+  scene_move_photo(scene, input_trace_photos_handle(photos, 2), Vec3{1.0f, 2.0f, -3.0f}, 0.5f, 2.0f);
+  const PhotoHandle removed = input_trace_photos_handle(photos, 4);
+  scene_remove_photo(scene, removed);
+  input_trace_photos_remove(photos, removed);
+  const uint32_t newest = static_cast<uint32_t>(photos.handles.size());
+  scene_move_photo(scene, input_trace_photos_handle(photos, newest), Vec3{4.0f, 5.0f, -6.0f}, 0.0f, 1.0f);
+}
+
+// The recording's scene had photos removed before, so its handles differ
+// from those of a replay that starts from the same photos. Edits named by
+// trace photo id must still land on the matching photos.
+bool check_trace_photo_ids() {
+  static PhotoScene recorded;
+  static PhotoScene replayed;
+  scene_init(recorded, 64);
+  scene_init(replayed, 64);
+  place_row(recorded, 10);
+  scene_remove_photo(recorded, scene_handle_at(recorded, 2));
+  scene_remove_photo(recorded, scene_handle_at(recorded, 5));
+  for (int i = 0; i < recorded.count; ++i) {
+    PlacedPhoto photo{};
+    scene_get_photo(recorded, scene_handle_at(recorded, i), &photo);
+    scene_place_photo(replayed, photo.shot_id, photo.position, photo.yaw, photo.scale);
+  }
+  bool handles_differ = false;
+  for (int i = 0; i < recorded.count; ++i) {
+    handles_differ = handles_differ || scene_handle_at(recorded, i) != scene_handle_at(replayed, i);
+  }
+
+  InputTracePhotos recorded_ids;
+  InputTracePhotos replayed_ids;
+  edit_through_trace_ids(recorded, recorded_ids);
+  edit_through_trace_ids(replayed, replayed_ids);
+  int mismatches = recorded.count == replayed.count ? 0 : 1;
+  for (int i = 0; mismatches == 0 && i < recorded.count; ++i) {
+    PlacedPhoto x{};
+    PlacedPhoto y{};
+    scene_get_photo(recorded, scene_handle_at(recorded, i), &x);
+    scene_get_photo(replayed, scene_handle_at(replayed, i), &y);
+    mismatches += x.shot_id == y.shot_id && std::memcmp(&x.position, &y.position, sizeof(Vec3)) == 0 &&
+                          x.yaw == y.yaw && x.scale == y.scale
+                      ? 0
+                      : 1;
+  }
+  std::printf("%-34s n=%-7d %12d mismatched photos after place/move/delete %s\n",
+              "replay/photo_ids", recorded.count, mismatches, handles_differ ? "(handles differ)" : "");
+  return handles_differ && mismatches == 0;
+}
+
+// Version 1 traces had no args; one that claims a MovePhoto must be
+// rejected rather than replayed with an arg index past the end of `args`.
+bool check_trace_v1_args() {
+  FlyCamera camera{};
+  camera_init(camera);
+  InputTrace trace;
+  input_trace_begin(trace, camera, 1);
+  input_trace_add(trace, 0, 0.0, command_event(InputCommand::Place, 1), nullptr);
+  std::vector<uint8_t> place_only;
+  input_trace_write(trace, place_only);
+  const uint32_t pose[kInputTraceMoveArgs] = {};
+  input_trace_add(trace, 1, 16.0, command_event(InputCommand::MovePhoto, 1), pose);
+  std::vector<uint8_t> with_move;
+  input_trace_write(trace, with_move);
+
+  const uint16_t v1 = 1;
+  std::memcpy(place_only.data() + offsetof(InputTraceHeader, version), &v1, sizeof(v1));
+  std::memcpy(with_move.data() + offsetof(InputTraceHeader, version), &v1, sizeof(v1));
+  InputTrace loaded;
+  const bool place_reads = input_trace_read(place_only.data(), place_only.size(), loaded);
+  const bool move_rejected = !input_trace_read(with_move.data(), with_move.size(), loaded);
+  InputEvent stray = command_event(InputCommand::MovePhoto, 1);
+  stray.c = 1;
+  const bool stray_rejected = input_trace_args(trace, stray) == nullptr;
+  std::printf("%-34s v1 place %s, v1 move %s, stray arg index %s\n", "replay/v1_args",
+              place_reads ? "reads" : "REJECTED", move_rejected ? "rejected" : "READ", stray_rejected ? "rejected" : "READ");
+  return place_reads && move_rejected && stray_rejected;
+}
+
+bool bench_replay() {
+  const InputTrace trace = synthetic_trace();
+  std::vector<uint8_t> bytes;
+  const BenchResult write = run_bench(trace.records.size(), [&] { input_trace_write(trace, bytes); });
+  report("replay/trace_write", static_cast<int>(trace.records.size()), write);
+
+  InputTrace loaded;
+  bool read_ok = true;
+  const BenchResult read = run_bench(trace.records.size(), [&] {
+    read_ok = read_ok && input_trace_read(bytes.data(), bytes.size(), loaded);
+  });
+  report("replay/trace_read", static_cast<int>(trace.records.size()), read);
+
+  bool same = read_ok && loaded.frame_count == trace.frame_count && loaded.records.size() == trace.records.size() &&
+              loaded.step_seconds == trace.step_seconds && loaded.first_shot_id == trace.first_shot_id;
+  for (size_t i = 0; same && i < trace.records.size(); ++i) {
+    const InputTraceRecord& x = trace.records[i];
+    const InputTraceRecord& y = loaded.records[i];
+    same = x.frame == y.frame && x.time_us == y.time_us && x.event.type == y.event.type && x.event.a == y.event.a &&
+           x.event.b == y.event.b && x.event.c == y.event.c;
+  }
+  same = same && loaded.args == trace.args;
+  std::printf("%-34s %8zu events %8zu bytes %6.2f bytes/event (InputEvent: %zu)\n",
+              "replay/trace_size", trace.records.size(), bytes.size(),
+              static_cast<double>(bytes.size() - sizeof(InputTraceHeader)) / static_cast<double>(trace.records.size()),
+              sizeof(InputEvent));
+
+  // Fixed steps and identical inputs have to land on the same pose bit for bit.
+  const FlyCamera a = replay_camera(trace);
+  const FlyCamera b = replay_camera(loaded);
+  const bool deterministic = std::memcmp(&a.position, &b.position, sizeof(Vec3)) == 0 && a.yaw == b.yaw &&
+                             a.pitch == b.pitch;
+  std::printf("%-34s (%.4f, %.4f, %.4f) yaw %.4f pitch %.4f %s\n",
+              "replay/final_camera", a.position.x, a.position.y, a.position.z, a.yaw, a.pitch,
+              deterministic ? "matches" : "DIVERGED");
+  if (!same) {
+    std::fprintf(stderr, "input trace did not survive a write/read round trip\n");
+  }
+  const bool ids_ok = check_trace_photo_ids();
+  const bool v1_ok = check_trace_v1_args();
+  return same && deterministic && ids_ok && v1_ok;
+}
+
+constexpr float kTorusMajor = 1.0f;
+constexpr float kTorusMinor = 0.35f;
+
+// A vertex-colored torus as OBJ text with no normals, triangles shuffled to
+// stand in for an exporter that emits them in no useful order.
+std::string torus_obj(int segments, int sides) {
+  std::string text;
+  char line[96];
+  for (int i = 0; i < segments; ++i) {
+    for (int j = 0; j < sides; ++j) {
+      const float u = 6.2831853f * static_cast<float>(i) / static_cast<float>(segments);
+      const float v = 6.2831853f * static_cast<float>(j) / static_cast<float>(sides);
+      const float ring = kTorusMajor + kTorusMinor * std::cos(v);
+      std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f %.3f %.3f %.3f\n",
+                    ring * std::cos(u), kTorusMinor * std::sin(v), ring * std::sin(u),
+                    0.5f + 0.5f * std::cos(u), 0.5f + 0.5f * std::sin(v), 0.5f);
+      text += line;
+    }
+  }
+  std::vector<int> quads(static_cast<size_t>(segments * sides));
+  for (size_t q = 0; q < quads.size(); ++q) {
+    quads[q] = static_cast<int>(q);
+  }
+  Rng rng{41};
+  for (size_t q = quads.size() - 1; q > 0; --q) {
+    std::swap(quads[q], quads[static_cast<size_t>(rng_float(rng, 0.0f, static_cast<float>(q + 1)))]);
+  }
+  for (const int q : quads) {
+    const int i = q / sides;
+    const int j = q % sides;
+    const int a = i * sides + j + 1;
+    const int b = ((i + 1) % segments) * sides + j + 1;
+    const int c = ((i + 1) % segments) * sides + (j + 1) % sides + 1;
+    const int d = i * sides + (j + 1) % sides + 1;
+    std::snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n", a, c, b, a, d, c);
+    text += line;
+  }
+  return text;
+}
+
+bool bench_mesh() {
+  constexpr int kSegments = 256;
+  constexpr int kSides = 128;
+  const std::string obj = torus_obj(kSegments, kSides);
+  const int triangles = kSegments * kSides * 2;
+
+  std::vector<uint8_t> blob;
+  MeshImportStats stats{};
+  bool ok = true;
+  report_ms("mesh/import_obj", triangles, run_bench(1, [&] {
+    ok = ok && mesh_import_obj(obj.data(), obj.size(), blob, &stats);
+  }));
+  std::printf("%-34s n=%-7d %9.3f -> %.3f ACMR (FIFO %d)\n",
+              "", triangles, stats.acmr_before, stats.acmr_after, kMeshAcmrCacheSize);
+  std::printf("%-34s n=%-7d %12zu bytes packed, %zu as floats (%.0f%%)\n",
+              "", triangles, stats.packed_bytes, stats.float_bytes,
+              100.0 * static_cast<double>(stats.packed_bytes) / static_cast<double>(stats.float_bytes));
+
+  // Every decoded vertex should sit on the torus surface within quantization
+  // error, with a normal close to the analytic one.
+  MeshFileView view{};
+  ok = ok && mesh_file_open(blob.data(), blob.size(), view) && view.header->index_count == triangles * 3u &&
+       view.header->index_bytes == 2;
+  float max_surface_error = 0.0f;
+  float min_normal_dot = 1.0f;
+  for (uint32_t v = 0; ok && v < view.header->vertex_count; ++v) {
+    const PackedVertex& pv = view.vertices[v];
+    Vec3 p{};
+    float* pc = &p.x;
+    for (int k = 0; k < 3; ++k) {
+      pc[k] = view.header->bounds_center[k] + static_cast<float>(pv.position[k]) / 32767.0f * view.header->bounds_scale[k];
+    }
+    const float ring = std::sqrt(p.x * p.x + p.z * p.z);
+    const Vec3 tube{p.x / ring * kTorusMajor, 0.0f, p.z / ring * kTorusMajor};
+    const Vec3 offset = vec3_sub(p, tube);
+    max_surface_error = std::max(max_surface_error, std::fabs(std::sqrt(vec3_dot(offset, offset)) - kTorusMinor));
+    const int8_t oct[2] = {pv.normal[0], pv.normal[1]};
+    min_normal_dot = std::min(min_normal_dot, vec3_dot(oct_decode_snorm8(oct), vec3_normalize(offset)));
+  }
+  std::printf("%-34s %.6f max surface error, %.2f deg max normal error\n",
+              "mesh/decode_check", max_surface_error, std::acos(std::min(min_normal_dot, 1.0f)) * 57.29578f);
+  // Vertices lie exactly on the surface, so only quantization (scale / 32767)
+  // contributes to the position error.
+  ok = ok && max_surface_error < 1.0e-4f && min_normal_dot > std::cos(3.0f / 57.29578f) &&
+       stats.acmr_after < stats.acmr_before;
+  if (!ok) {
+    std::fprintf(stderr, "mesh import produced a wrong or unoptimised blob\n");
+  }
+  return ok;
+}
+
+// A capture-sized frame that looks like what the renderer produces: a sky
+// gradient over a shaded floor, a few lit quads at different depths and a
+// little per-pixel noise standing in for texture detail.
+void synth_capture(SnapshotPayload& p, uint32_t seed) {
+  constexpr uint32_t kW = 480;
+  constexpr uint32_t kH = 320;
+  Rng rng{seed};
+  p.info = PhotoSnapshot{seed, Vec3{1.0f, 1.5f, 2.0f}, 0.3f, -0.1f, 1000.0 + seed};
+  p.width = kW;
+  p.height = kH;
+  p.z_near = 0.1f;
+  p.z_far = 200.0f;
+  p.color.assign(kW * kH * 4, 255);
+  p.depth.assign(kW * kH, p.z_far);
+
+  for (uint32_t y = 0; y < kH; ++y) {
+    for (uint32_t x = 0; x < kW; ++x) {
+      const size_t i = static_cast<size_t>(y) * kW + x;
+      const float v = static_cast<float>(y) / kH;
+      uint8_t* c = &p.color[i * 4];
+      if (v < 0.45f) {
+        c[0] = static_cast<uint8_t>(15 + 40 * v);
+        c[1] = static_cast<uint8_t>(20 + 60 * v);
+        c[2] = static_cast<uint8_t>(28 + 90 * v);
+      } else {
+        const float d = 1.5f / (v - 0.44f);
+        const int checker = (static_cast<int>(d * 2.0f) + static_cast<int>((x - 240.0f) * d * 0.01f)) & 1;
+        const int shade = static_cast<int>(60 + 80 * (v - 0.45f)) + checker * 12;
+        c[0] = static_cast<uint8_t>(shade);
+        c[1] = static_cast<uint8_t>(shade + 6);
+        c[2] = static_cast<uint8_t>(shade + 10);
+        p.depth[i] = std::min(p.z_far, d);
+      }
+    }
+  }
+
+  for (int q = 0; q < 6; ++q) {
+    const int x0 = static_cast<int>(rng_float(rng, 0.0f, 400.0f));
+    const int y0 = static_cast<int>(rng_float(rng, 20.0f, 240.0f));
+    const int w = static_cast<int>(rng_float(rng, 30.0f, 120.0f));
+    const int h = static_cast<int>(rng_float(rng, 20.0f, 80.0f));
+    const float z = rng_float(rng, 1.0f, 40.0f);
+    const float tint[3] = {rng_float(rng, 0.3f, 1.0f), rng_float(rng, 0.3f, 1.0f), rng_float(rng, 0.3f, 1.0f)};
+    for (int y = y0; y < std::min(y0 + h, 320); ++y) {
+      for (int x = x0; x < std::min(x0 + w, 480); ++x) {
+        const size_t i = static_cast<size_t>(y) * kW + static_cast<size_t>(x);
+        if (p.depth[i] < z) {
+          continue;
+        }
+        const float light = 0.6f + 0.4f * static_cast<float>(x - x0) / static_cast<float>(w);
+        const int noise = static_cast<int>(rng_float(rng, -3.0f, 3.0f));
+        for (int ch = 0; ch < 3; ++ch) {
+          const int value = static_cast<int>(230.0f * tint[ch] * light) + noise;
+          p.color[i * 4 + ch] = static_cast<uint8_t>(std::clamp(value, 0, 255));
+        }
+        p.depth[i] = z + 0.01f * static_cast<float>(y - y0);
+      }
+    }
+  }
+}
+
+bool codec_round_trip_ok(const SnapshotPayload& src, const SnapshotPayload& dst) {
+  if (dst.color.size() != src.color.size() || dst.depth.size() != src.depth.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < src.color.size(); ++i) {
+    if ((i & 3) != 3 && src.color[i] != dst.color[i]) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < src.depth.size(); ++i) {
+    if (std::fabs(dst.depth[i] - src.depth[i]) > src.depth[i] * 2.0e-4f) {
+      return false;
+    }
+  }
+  return dst.info.id == src.info.id && dst.info.yaw == src.info.yaw;
+}
+
+#if defined(FRAMESPACE_BENCH_HAS_PNG)
+void png_append(png_structp png, png_bytep data, png_size_t size) {
+  auto* out = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(png));
+  out->insert(out->end(), data, data + size);
+}
+
+size_t png_encode_rgba(const SnapshotPayload& p, std::vector<uint8_t>& out) {
+  out.clear();
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  png_infop info = png_create_info_struct(png);
+  if (setjmp(png_jmpbuf(png))) {
+    png_destroy_write_struct(&png, &info);
+    return 0;
+  }
+  png_set_write_fn(png, &out, png_append, nullptr);
+  png_set_IHDR(png, info, p.width, p.height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+  for (uint32_t y = 0; y < p.height; ++y) {
+    png_write_row(png, const_cast<png_bytep>(p.color.data() + static_cast<size_t>(y) * p.width * 4));
+  }
+  png_write_end(png, nullptr);
+  png_destroy_write_struct(&png, &info);
+  return out.size();
+}
+#endif
+
+void report_codec(const char* name, size_t raw_bytes, size_t encoded_bytes, const BenchResult& r) {
+  std::printf("%-34s %9.1f MB/s %8.2fx ratio %10zu -> %zu bytes\n",
+              name,
+              static_cast<double>(raw_bytes) / r.ns_per_op * 1.0e3,
+              static_cast<double>(raw_bytes) / static_cast<double>(encoded_bytes),
+              raw_bytes,
+              encoded_bytes);
+}
+
+// A blob read back from storage sizes the decode buffers from its header, so
+// dimensions past the snapshot texture, or more pixels than the sections can
+// encode, must be rejected before anything is allocated.
+bool check_codec_rejects_bad_sizes() {
+  SnapshotPayload small{};
+  snapshot_generate(small, 1, 16, 16, 0.1f, 200.0f);
+  std::vector<uint8_t> blob;
+  snapshot_encode(small, blob, true);
+  SnapshotBlobInfo info{};
+  const bool small_ok = snapshot_blob_peek(blob.data(), blob.size(), info);
+
+  auto rejects = [&](uint32_t width, uint32_t height) {
+    std::vector<uint8_t> bad = blob;
+    std::memcpy(bad.data() + 8, &width, sizeof(width));
+    std::memcpy(bad.data() + 12, &height, sizeof(height));
+    SnapshotPayload out{};
+    return !snapshot_blob_peek(bad.data(), bad.size(), info) && !snapshot_decode(bad.data(), bad.size(), out);
+  };
+  const bool huge_rejected = rejects(65536, 65536);
+  const bool short_rejected = rejects(kSnapshotWidth, kSnapshotHeight);
+  std::printf("%-34s 16x16 %s, 65536x65536 %s, %ux%u from a 16x16 payload %s\n", "codec/bad_sizes",
+              small_ok ? "reads" : "REJECTED", huge_rejected ? "rejected" : "READ", kSnapshotWidth, kSnapshotHeight,
+              short_rejected ? "rejected" : "READ");
+  if (!small_ok || !huge_rejected || !short_rejected) {
+    std::fprintf(stderr, "snapshot codec accepted a header its sections cannot hold\n");
+    return false;
+  }
+  return true;
+}
+
+bool bench_codec() {
+  SnapshotPayload src{};
+  synth_capture(src, 7);
+  const size_t color_raw = src.color.size();
+  const size_t raw = color_raw + src.depth.size() * sizeof(float);
+
+  std::vector<uint8_t> blob;
+  std::vector<uint8_t> blob_scalar;
+  snapshot_encode(src, blob, true);
+  snapshot_encode(src, blob_scalar, false);
+  SnapshotPayload decoded{};
+  SnapshotPayload decoded_scalar{};
+  if (blob != blob_scalar || !snapshot_decode(blob.data(), blob.size(), decoded, true) ||
+      !snapshot_decode(blob.data(), blob.size(), decoded_scalar, false) || !codec_round_trip_ok(src, decoded) ||
+      decoded.color != decoded_scalar.color || decoded.depth != decoded_scalar.depth) {
+    std::fprintf(stderr, "snapshot codec round trip mismatch\n");
+    return false;
+  }
+  SnapshotBlobInfo info{};
+  snapshot_blob_peek(blob.data(), blob.size(), info);
+  if (!check_codec_rejects_bad_sizes()) {
+    return false;
+  }
+
+  report_codec("codec/encode", raw, blob.size(), run_bench(1, [&] { snapshot_encode(src, blob, true); }));
+  report_codec("codec/encode_scalar", raw, blob.size(), run_bench(1, [&] { snapshot_encode(src, blob, false); }));
+  report_codec("codec/decode", raw, blob.size(),
+               run_bench(1, [&] { snapshot_decode(blob.data(), blob.size(), decoded, true); }));
+  report_codec("codec/decode_scalar", raw, blob.size(),
+               run_bench(1, [&] { snapshot_decode(blob.data(), blob.size(), decoded, false); }));
+  std::printf("%-34s %8u color bytes %8u depth bytes\n", "", info.color_bytes, info.depth_bytes);
+
+#if defined(FRAMESPACE_BENCH_HAS_PNG)
+  std::vector<uint8_t> png;
+  png_encode_rgba(src, png);
+  report_codec("codec/png_color_only", color_raw, png.size(), run_bench(1, [&] { png_encode_rgba(src, png); }));
+#endif
+  return true;
+}
+
+// Reference for scene_pick_photo: every quad, as a plane hit plus a bounds
+// check along the frame's right and up axes.
+bool pick_brute_force(const PhotoScene& scene, Vec3 origin, Vec3 dir, float max_distance, PhotoPick* out) {
+  dir = vec3_normalize(dir);
+  bool hit = false;
+  for (int i = 0; i < scene.count; ++i) {
+    const Vec3 pos{scene.px[i], scene.py[i], scene.pz[i]};
+    const Vec3 normal{std::sin(scene.yaw[i]), 0.0f, std::cos(scene.yaw[i])};
+    const Vec3 right{std::cos(scene.yaw[i]), 0.0f, -std::sin(scene.yaw[i])};
+    const float denom = vec3_dot(dir, normal);
+    if (std::fabs(denom) < 1.0e-8f) {
+      continue;
+    }
+    const float t = vec3_dot(vec3_sub(pos, origin), normal) / denom;
+    if (t < 0.0f || t > max_distance || (hit && t >= out->distance)) {
+      continue;
+    }
+    const Vec3 local = vec3_sub(vec3_add(origin, vec3_scale(dir, t)), pos);
+    if (std::fabs(vec3_dot(local, right)) <= kPhotoHalfWidth * scene.scale[i] &&
+        std::fabs(local.y) <= kPhotoHalfHeight * scene.scale[i]) {
+      *out = PhotoPick{scene_handle_at(scene, i), t};
+      hit = true;
+    }
+  }
+  return hit;
+}
+
+int count_pick_mismatches(const PhotoScene& scene, Vec3 origin, const std::vector<Vec3>& rays, int checked) {
+  int mismatches = 0;
+  for (int r = 0; r < checked; ++r) {
+    PhotoPick fast{};
+    PhotoPick slow{};
+    const bool fast_hit = scene_pick_photo(scene, origin, rays[r], 200.0f, &fast);
+    const bool slow_hit = pick_brute_force(scene, origin, rays[r], 200.0f, &slow);
+    // Different handles are fine on an exact tie in distance.
+    if (fast_hit != slow_hit ||
+        (fast_hit && fast.handle != slow.handle && std::fabs(fast.distance - slow.distance) > 1.0e-4f)) {
+      mismatches += 1;
+    }
+  }
+  return mismatches;
+}
+
+// Crosshair picks from the start camera into 100k generated photos, checked
+// against brute force before and after moving a share of them.
+bool bench_pick() {
+  constexpr int kPhotos = 100000;
+  constexpr int kRays = 4096;
+  constexpr int kChecked = 256;
+  constexpr int kMoves = 2000;
+  FlyCamera camera;
+  camera_init(camera);
+  PhotoScene scene{};
+  scene_init(scene, kPhotos);
+  std::vector<Vec3> rays(kRays);
+
+  bool ok = true;
+  for (int l = 0; l < static_cast<int>(SceneLayout::Count); ++l) {
+    const SceneLayout layout = static_cast<SceneLayout>(l);
+    scene_generate(scene, SceneGenParams{layout, kPhotos, 0, 1});
+    Rng rng{static_cast<uint32_t>(17 + l)};
+    for (Vec3& ray : rays) {
+      FlyCamera aim = camera;
+      aim.yaw += rng_float(rng, -0.5f, 0.5f);
+      aim.pitch = rng_float(rng, -0.3f, 0.3f);
+      ray = camera_forward(aim);
+    }
+
+    int mismatches = count_pick_mismatches(scene, camera.position, rays, kChecked);
+    int hits = 0;
+    char name[48];
+    std::snprintf(name, sizeof(name), "pick/%s", scene_layout_name(layout));
+    report(name, kPhotos, run_bench(kRays, [&] {
+             hits = 0;
+             for (const Vec3& ray : rays) {
+               hits += scene_pick_photo(scene, camera.position, ray, 200.0f, nullptr) ? 1 : 0;
+             }
+           }));
+
+    // Pull photos into the view so the moved leaves are the ones being hit.
+    const BenchResult moves = run_bench(kMoves, [&] {
+      for (int m = 0; m < kMoves; ++m) {
+        const PhotoHandle handle = scene_handle_at(scene, static_cast<int>(rng_float(rng, 0.0f, kPhotos - 1.0f)));
+        const Vec3 pos{rng_float(rng, -8.0f, 8.0f), rng_float(rng, 0.0f, 3.0f), rng_float(rng, -20.0f, 0.0f)};
+        scene_move_photo(scene, handle, pos, rng_float(rng, -3.14f, 3.14f), 1.0f);
+      }
+    });
+    std::snprintf(name, sizeof(name), "pick/%s_move", scene_layout_name(layout));
+    report(name, kPhotos, moves);
+    mismatches += count_pick_mismatches(scene, camera.position, rays, kChecked);
+    std::printf("%-34s n=%-7d %11.1f%% hit %9d brute-force mismatches\n", "", kPhotos,
+                100.0 * hits / kRays, mismatches);
+    ok = ok && mismatches == 0;
+  }
+  return ok;
+}
+
+// The scaling sweep covers the web build's 100k-photo capacity and ten times
+// that; the scene handle format allows up to kMaxPhotoSceneCapacity.
+constexpr int kStressSizes[] = {100, 1000, 10000, 100000, 1000000};
+constexpr int kStressShots = static_cast<int>(kSnapshotLayers);
+
+struct StressRow {
+  SceneLayout layout;
+  int photos;
+  double generate_ms;
+  double prep_ms;
+  int visible;
+  uint64_t scene_bytes;
+  uint64_t instance_bytes;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+bool write_stress_json(const char* path,
+                       int threads,
+                       double shot_generate_ms,
+                       double shot_encode_ms,
+                       size_t shot_raw_bytes,
+                       size_t shot_encoded_bytes,
+                       const std::vector<StressRow>& rows) {
+  std::string json;
+  char buf[512];
+  std::snprintf(buf, sizeof(buf),
+                "{\n  \"suite\": \"stress\",\n  \"build\": \"native\",\n  \"threads\": %d,\n"
+                "  \"snapshots\": {\"count\": %d, \"generate_ms\": %.3f, \"encode_ms\": %.3f, "
+                "\"raw_bytes\": %zu, \"encoded_bytes\": %zu},\n  \"runs\": [\n",
+                threads, kStressShots, shot_generate_ms, shot_encode_ms, shot_raw_bytes, shot_encoded_bytes);
+  json += buf;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    const StressRow& r = rows[i];
+    // No GPU natively; the web sweep fills gpu_ms with the same schema.
+    std::snprintf(buf, sizeof(buf),
+                  "    {\"layout\": \"%s\", \"photos\": %d, \"generate_ms\": %.3f, \"prep_ms\": %.4f, "
+                  "\"visible\": %d, \"scene_bytes\": %llu, \"instance_bytes\": %llu, \"gpu_ms\": null}%s\n",
+                  scene_layout_name(r.layout), r.photos, r.generate_ms, r.prep_ms, r.visible,
+                  static_cast<unsigned long long>(r.scene_bytes), static_cast<unsigned long long>(r.instance_bytes),
+                  i + 1 < rows.size() ? "," : "");
+    json += buf;
+  }
+  json += "  ]\n}\n";
+
+  FILE* f = std::fopen(path, "wb");
+  if (!f) {
+    std::fprintf(stderr, "could not write %s\n", path);
+    return false;
+  }
+  const bool ok = std::fwrite(json.data(), 1, json.size(), f) == json.size();
+  std::fclose(f);
+  return ok;
+}
+
+// Generated scenes from 100 to 1M photos in every layout, viewed from the
+// start camera: generation time, per-frame CPU prep (cull + instance fill on
+// the job system), and resident memory. Snapshot generation and encoding do
+// not depend on the photo count and are measured once.
+bool bench_stress(const char* json_path) {
+  JobSystem jobs;
+  jobs_init(jobs, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  const int threads = jobs_thread_count(jobs);
+  SnapshotLayerTable layers;
+  snapshot_layers_init(layers, kStressShots);
+
+  SnapshotPayload shot{};
+  std::vector<uint8_t> blob;
+  double shot_generate_ms = 0.0;
+  double shot_encode_ms = 0.0;
+  size_t shot_raw_bytes = 0;
+  size_t shot_encoded_bytes = 0;
+  for (int id = 1; id <= kStressShots; ++id) {
+    auto t0 = std::chrono::steady_clock::now();
+    snapshot_generate(shot, static_cast<uint32_t>(id), 480, 320, 0.1f, 200.0f);
+    shot_generate_ms += elapsed_ms(t0);
+    t0 = std::chrono::steady_clock::now();
+    snapshot_encode(shot, blob, true);
+    shot_encode_ms += elapsed_ms(t0);
+    shot_raw_bytes += shot.color.size() + shot.depth.size() * sizeof(float);
+    shot_encoded_bytes += blob.size();
+    snapshot_layer_assign(layers, static_cast<uint32_t>(id));
+  }
+  std::printf("%-34s n=%-7d %10.3f ms generate %10.3f ms encode %8.2fx ratio\n",
+              "stress/snapshots", kStressShots, shot_generate_ms / kStressShots, shot_encode_ms / kStressShots,
+              static_cast<double>(shot_raw_bytes) / static_cast<double>(shot_encoded_bytes));
+
+  FlyCamera camera;
+  camera_init(camera);
+  const Frustum frustum = frustum_from_view_projection(camera_view_projection(camera, 16.0f / 9.0f, nullptr));
+  std::vector<StressRow> rows;
+  for (const int n : kStressSizes) {
+    const uint64_t bytes_before = g_alloc_bytes;
+    PhotoScene scene{};
+    scene_init(scene, n);
+    std::vector<InstanceData> instances(static_cast<size_t>(n));
+    const uint64_t scene_bytes = g_alloc_bytes - bytes_before - instances.size() * sizeof(InstanceData);
+
+    for (int l = 0; l < static_cast<int>(SceneLayout::Count); ++l) {
+      StressRow row{};
+      row.layout = static_cast<SceneLayout>(l);
+      row.photos = n;
+      row.scene_bytes = scene_bytes;
+      row.instance_bytes = instances.size() * sizeof(InstanceData);
+      const auto t0 = std::chrono::steady_clock::now();
+      if (!scene_generate(scene, SceneGenParams{row.layout, n, kStressShots, 1})) {
+        std::fprintf(stderr, "scene_generate failed for %s n=%d\n", scene_layout_name(row.layout), n);
+        jobs_shutdown(jobs);
+        return false;
+      }
+      row.generate_ms = elapsed_ms(t0);
+      const BenchResult r = run_bench(1, [&] {
+        row.visible = scene_prepare_instances_parallel(scene, frustum, &layers, instances.data(), n, jobs);
+      });
+      row.prep_ms = r.ns_per_op * 1.0e-6;
+
+      char name[48];
+      std::snprintf(name, sizeof(name), "stress/%s", scene_layout_name(row.layout));
+      std::printf("%-34s n=%-7d %10.3f ms generate %10.4f ms prep %8d visible %8.1f MiB\n",
+                  name, n, row.generate_ms, row.prep_ms, row.visible,
+                  static_cast<double>(row.scene_bytes + row.instance_bytes) / (1024.0 * 1024.0));
+      rows.push_back(row);
+    }
+  }
+  jobs_shutdown(jobs);
+
+  if (json_path) {
+    if (!write_stress_json(json_path, threads, shot_generate_ms / kStressShots,
+                           shot_encode_ms / kStressShots, shot_raw_bytes, shot_encoded_bytes, rows)) {
+      return false;
+    }
+    std::printf("%-34s %s\n", "stress/json", json_path);
+  }
+  return true;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  g_alloc_count += 1;
+  g_alloc_bytes += size;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+int main(int argc, char** argv) {
+  const char* filter = nullptr;
+  const char* json_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    } else {
+      filter = argv[i];
+    }
+  }
+  constexpr int kSizes[] = {1000, 10000, 100000};
+
+#if defined(__AVX2__) && (defined(__GNUC__) || defined(__clang__))
+  if (!__builtin_cpu_supports("avx2")) {
+    std::printf("built with AVX2, which this CPU lacks; skipped\n");
+    return 77;  // ctest's SKIP_RETURN_CODE
+  }
+#endif
+  if (!check_batch_kernels()) {
+    return EXIT_FAILURE;
+  }
+
+  for (const int n : kSizes) {
+    if (section_enabled(filter, "math")) bench_math(n);
+    if (section_enabled(filter, "scene")) {
+      bench_placement(n);
+      bench_scene_prep(n);
+      bench_residency(n);
+    }
+    if (section_enabled(filter, "scene_file") && !bench_scene_file(n)) {
+      return EXIT_FAILURE;
+    }
+  }
+  if (section_enabled(filter, "jobs") && !bench_jobs(100000)) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "physics") && !bench_physics()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "input_queue") && !bench_input_queue()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "profiler") && !bench_profiler()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "resolution") && !bench_resolution()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "replay") && !bench_replay()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "mesh") && !bench_mesh()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "codec") && !bench_codec()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "pick") && !bench_pick()) {
+    return EXIT_FAILURE;
+  }
+  if (section_enabled(filter, "stress") && !bench_stress(json_path)) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
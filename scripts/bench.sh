@@ -0,0 +1,10 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+
+cmake -S "$PROJECT_ROOT" -B "$PROJECT_ROOT/build-native" -DCMAKE_BUILD_TYPE=Release ${FRAMESPACE_CMAKE_ARGS:-}
+cmake --build "$PROJECT_ROOT/build-native" --target framespace_bench
+
+"$PROJECT_ROOT/build-native/framespace_bench" "$@"
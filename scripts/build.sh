@@ -19,7 +19,7 @@ PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
 # shellcheck source=/dev/null
 source "$EMSDK_ROOT/emsdk_env.sh"
 
-emcmake cmake -S "$PROJECT_ROOT" -B "$PROJECT_ROOT/build" -G Ninja
+emcmake cmake -S "$PROJECT_ROOT" -B "$PROJECT_ROOT/build" -G Ninja ${FRAMESPACE_CMAKE_ARGS:-}
 cmake --build "$PROJECT_ROOT/build"
 
 echo "Build complete: $PROJECT_ROOT/build/framespace.html"
@@ -10,4 +10,18 @@ if [[ ! -f "$PROJECT_ROOT/build/framespace.html" ]]; then
 fi
 
 cd "$PROJECT_ROOT/build"
-python3 -m http.server 8080
+# pthreads need SharedArrayBuffer, which browsers only expose on
+# cross-origin isolated pages.
+python3 - <<'PY'
+from http.server import SimpleHTTPRequestHandler, ThreadingHTTPServer
+
+
+class IsolatedHandler(SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        super().end_headers()
+
+
+ThreadingHTTPServer(("", 8080), IsolatedHandler).serve_forever()
+PY
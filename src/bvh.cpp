@@ -0,0 +1,503 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr int kQueryStackSize = 256;
+
+int allocate_node(Bvh& tree) {
+  if (tree.free_list == kBvhNull) {
+    const int first_new = static_cast<int>(tree.nodes.size());
+    const int grow = std::max(first_new, 16);
+    tree.nodes.resize(static_cast<size_t>(first_new + grow));
+    for (int i = first_new; i < first_new + grow; ++i) {
+      tree.nodes[i].parent = i + 1 < first_new + grow ? i + 1 : kBvhNull;
+      tree.nodes[i].height = -1;
+    }
+    tree.free_list = first_new;
+  }
+
+  const int id = tree.free_list;
+  BvhNode& node = tree.nodes[id];
+  tree.free_list = node.parent;
+  node.parent = kBvhNull;
+  node.child0 = kBvhNull;
+  node.child1 = kBvhNull;
+  node.height = 0;
+  node.user = 0;
+  return id;
+}
+
+void free_node(Bvh& tree, int id) {
+  tree.nodes[id].parent = tree.free_list;
+  tree.nodes[id].height = -1;
+  tree.free_list = id;
+}
+
+bool is_leaf(const BvhNode& node) {
+  return node.child0 == kBvhNull;
+}
+
+// Slab test; `t_enter` is where the ray enters the box (0 when it starts
+// inside). fmin/fmax drop the NaN of an axis-parallel ray on a slab plane.
+bool ray_hits_box(const Aabb& box, Vec3 origin, Vec3 inv_dir, float max_t, float* t_enter) {
+  const float tx0 = (box.min.x - origin.x) * inv_dir.x;
+  const float tx1 = (box.max.x - origin.x) * inv_dir.x;
+  const float ty0 = (box.min.y - origin.y) * inv_dir.y;
+  const float ty1 = (box.max.y - origin.y) * inv_dir.y;
+  const float tz0 = (box.min.z - origin.z) * inv_dir.z;
+  const float tz1 = (box.max.z - origin.z) * inv_dir.z;
+  const float enter = std::fmax(std::fmax(std::fmin(tx0, tx1), std::fmin(ty0, ty1)),
+                                std::fmax(std::fmin(tz0, tz1), 0.0f));
+  const float exit = std::fmin(std::fmin(std::fmax(tx0, tx1), std::fmax(ty0, ty1)),
+                               std::fmin(std::fmax(tz0, tz1), max_t));
+  *t_enter = enter;
+  return enter <= exit;
+}
+
+// Rotates the subtree rooted at a if it is imbalanced; returns the new root.
+int balance(Bvh& tree, int a_id) {
+  BvhNode& a = tree.nodes[a_id];
+  if (is_leaf(a) || a.height < 2) {
+    return a_id;
+  }
+
+  const int b_id = a.child0;
+  const int c_id = a.child1;
+  BvhNode& b = tree.nodes[b_id];
+  BvhNode& c = tree.nodes[c_id];
+  const int diff = c.height - b.height;
+
+  if (diff > 1) {
+    // Promote c.
+    const int f_id = c.child0;
+    const int g_id = c.child1;
+    BvhNode& f = tree.nodes[f_id];
+    BvhNode& g = tree.nodes[g_id];
+
+    c.child0 = a_id;
+    c.parent = a.parent;
+    a.parent = c_id;
+    if (c.parent != kBvhNull) {
+      BvhNode& cp = tree.nodes[c.parent];
+      if (cp.child0 == a_id) {
+        cp.child0 = c_id;
+      } else {
+        cp.child1 = c_id;
+      }
+    } else {
+      tree.root = c_id;
+    }
+
+    if (f.height > g.height) {
+      c.child1 = f_id;
+      a.child1 = g_id;
+      g.parent = a_id;
+      a.box = aabb_union(b.box, g.box);
+      c.box = aabb_union(a.box, f.box);
+      a.height = 1 + std::max(b.height, g.height);
+      c.height = 1 + std::max(a.height, f.height);
+    } else {
+      c.child1 = g_id;
+      a.child1 = f_id;
+      f.parent = a_id;
+      a.box = aabb_union(b.box, f.box);
+      c.box = aabb_union(a.box, g.box);
+      a.height = 1 + std::max(b.height, f.height);
+      c.height = 1 + std::max(a.height, g.height);
+    }
+    return c_id;
+  }
+
+  if (diff < -1) {
+    // Promote b.
+    const int d_id = b.child0;
+    const int e_id = b.child1;
+    BvhNode& d = tree.nodes[d_id];
+    BvhNode& e = tree.nodes[e_id];
+
+    b.child0 = a_id;
+    b.parent = a.parent;
+    a.parent = b_id;
+    if (b.parent != kBvhNull) {
+      BvhNode& bp = tree.nodes[b.parent];
+      if (bp.child0 == a_id) {
+        bp.child0 = b_id;
+      } else {
+        bp.child1 = b_id;
+      }
+    } else {
+      tree.root = b_id;
+    }
+
+    if (d.height > e.height) {
+      b.child1 = d_id;
+      a.child0 = e_id;
+      e.parent = a_id;
+      a.box = aabb_union(c.box, e.box);
+      b.box = aabb_union(a.box, d.box);
+      a.height = 1 + std::max(c.height, e.height);
+      b.height = 1 + std::max(a.height, d.height);
+    } else {
+      b.child1 = e_id;
+      a.child0 = d_id;
+      d.parent = a_id;
+      a.box = aabb_union(c.box, d.box);
+      b.box = aabb_union(a.box, e.box);
+      a.height = 1 + std::max(c.height, d.height);
+      b.height = 1 + std::max(a.height, e.height);
+    }
+    return b_id;
+  }
+
+  return a_id;
+}
+
+// Walks from `index` to the root refitting boxes and rebalancing.
+void refit_upwards(Bvh& tree, int index) {
+  while (index != kBvhNull) {
+    index = balance(tree, index);
+    BvhNode& node = tree.nodes[index];
+    const BvhNode& c0 = tree.nodes[node.child0];
+    const BvhNode& c1 = tree.nodes[node.child1];
+    node.height = 1 + std::max(c0.height, c1.height);
+    node.box = aabb_union(c0.box, c1.box);
+    index = node.parent;
+  }
+}
+
+void insert_leaf(Bvh& tree, int leaf) {
+  if (tree.root == kBvhNull) {
+    tree.root = leaf;
+    tree.nodes[leaf].parent = kBvhNull;
+    return;
+  }
+
+  // Descend towards the sibling that minimizes the added surface area.
+  const Aabb leaf_box = tree.nodes[leaf].box;
+  int index = tree.root;
+  while (!is_leaf(tree.nodes[index])) {
+    const BvhNode& node = tree.nodes[index];
+    const float area = aabb_perimeter(node.box);
+    const float combined_area = aabb_perimeter(aabb_union(node.box, leaf_box));
+    const float cost = 2.0f * combined_area;
+    const float inheritance = 2.0f * (combined_area - area);
+
+    float child_cost[2];
+    const int children[2] = {node.child0, node.child1};
+    for (int k = 0; k < 2; ++k) {
+      const BvhNode& child = tree.nodes[children[k]];
+      const Aabb merged = aabb_union(leaf_box, child.box);
+      if (is_leaf(child)) {
+        child_cost[k] = aabb_perimeter(merged) + inheritance;
+      } else {
+        child_cost[k] = aabb_perimeter(merged) - aabb_perimeter(child.box) + inheritance;
+      }
+    }
+
+    if (cost < child_cost[0] && cost < child_cost[1]) {
+      break;
+    }
+    index = child_cost[0] < child_cost[1] ? node.child0 : node.child1;
+  }
+
+  const int sibling = index;
+  const int old_parent = tree.nodes[sibling].parent;
+  const int new_parent = allocate_node(tree);
+  BvhNode& np = tree.nodes[new_parent];
+  np.parent = old_parent;
+  np.box = aabb_union(leaf_box, tree.nodes[sibling].box);
+  np.height = tree.nodes[sibling].height + 1;
+  np.child0 = sibling;
+  np.child1 = leaf;
+  tree.nodes[sibling].parent = new_parent;
+  tree.nodes[leaf].parent = new_parent;
+
+  if (old_parent != kBvhNull) {
+    BvhNode& op = tree.nodes[old_parent];
+    if (op.child0 == sibling) {
+      op.child0 = new_parent;
+    } else {
+      op.child1 = new_parent;
+    }
+  } else {
+    tree.root = new_parent;
+  }
+
+  refit_upwards(tree, tree.nodes[leaf].parent);
+}
+
+void remove_leaf(Bvh& tree, int leaf) {
+  if (leaf == tree.root) {
+    tree.root = kBvhNull;
+    return;
+  }
+
+  const int parent = tree.nodes[leaf].parent;
+  const int grand_parent = tree.nodes[parent].parent;
+  const int sibling = tree.nodes[parent].child0 == leaf ? tree.nodes[parent].child1 : tree.nodes[parent].child0;
+
+  if (grand_parent != kBvhNull) {
+    BvhNode& gp = tree.nodes[grand_parent];
+    if (gp.child0 == parent) {
+      gp.child0 = sibling;
+    } else {
+      gp.child1 = sibling;
+    }
+    tree.nodes[sibling].parent = grand_parent;
+    free_node(tree, parent);
+    refit_upwards(tree, grand_parent);
+  } else {
+    tree.root = sibling;
+    tree.nodes[sibling].parent = kBvhNull;
+    free_node(tree, parent);
+  }
+}
+
+struct BuildItem {
+  float key;  // centroid along the current split axis
+  int leaf;
+  Vec3 centroid;
+};
+
+int build_range(Bvh& tree, BuildItem* items, int count, int& next_internal) {
+  if (count == 1) {
+    return items[0].leaf;
+  }
+
+  Vec3 lo = items[0].centroid;
+  Vec3 hi = items[0].centroid;
+  for (int i = 1; i < count; ++i) {
+    const Vec3& c = items[i].centroid;
+    lo = Vec3{std::min(lo.x, c.x), std::min(lo.y, c.y), std::min(lo.z, c.z)};
+    hi = Vec3{std::max(hi.x, c.x), std::max(hi.y, c.y), std::max(hi.z, c.z)};
+  }
+  const Vec3 extent = vec3_sub(hi, lo);
+  int axis = extent.y > extent.x ? 1 : 0;
+  if (extent.z > (axis == 0 ? extent.x : extent.y)) {
+    axis = 2;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    const Vec3& c = items[i].centroid;
+    items[i].key = axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+  }
+  const int half = count / 2;
+  std::nth_element(items, items + half, items + count,
+                   [](const BuildItem& a, const BuildItem& b) { return a.key < b.key; });
+
+  const int id = next_internal++;
+  const int c0 = build_range(tree, items, half, next_internal);
+  const int c1 = build_range(tree, items + half, count - half, next_internal);
+  BvhNode& node = tree.nodes[id];
+  node.child0 = c0;
+  node.child1 = c1;
+  node.user = 0;
+  node.box = aabb_union(tree.nodes[c0].box, tree.nodes[c1].box);
+  node.height = 1 + std::max(tree.nodes[c0].height, tree.nodes[c1].height);
+  tree.nodes[c0].parent = id;
+  tree.nodes[c1].parent = id;
+  return id;
+}
+
+}  // namespace
+
+void bvh_init(Bvh& tree, int leaf_capacity) {
+  tree.nodes.clear();
+  // A tree with n leaves has n - 1 internal nodes.
+  tree.nodes.reserve(static_cast<size_t>(std::max(2 * leaf_capacity, 16)));
+  tree.root = kBvhNull;
+  tree.free_list = kBvhNull;
+  tree.leaf_count = 0;
+}
+
+void bvh_clear(Bvh& tree) {
+  tree.root = kBvhNull;
+  tree.leaf_count = 0;
+  tree.free_list = kBvhNull;
+  for (int i = static_cast<int>(tree.nodes.size()) - 1; i >= 0; --i) {
+    free_node(tree, i);
+  }
+}
+
+int bvh_insert(Bvh& tree, const Aabb& box, uint32_t user) {
+  const int leaf = allocate_node(tree);
+  tree.nodes[leaf].box = box;
+  tree.nodes[leaf].user = user;
+  insert_leaf(tree, leaf);
+  tree.leaf_count += 1;
+  return leaf;
+}
+
+void bvh_remove(Bvh& tree, int leaf) {
+  remove_leaf(tree, leaf);
+  free_node(tree, leaf);
+  tree.leaf_count -= 1;
+}
+
+void bvh_move(Bvh& tree, int leaf, const Aabb& box) {
+  remove_leaf(tree, leaf);
+  tree.nodes[leaf].box = box;
+  insert_leaf(tree, leaf);
+}
+
+int bvh_query_frustum(const Bvh& tree, const Frustum& frustum, uint32_t* out, int max_out, BvhQueryStats* stats) {
+  BvhQueryStats local{};
+  int count = 0;
+  if (tree.root == kBvhNull) {
+    if (stats) *stats = local;
+    return 0;
+  }
+
+  // Each stack entry carries whether its subtree is already known to be
+  // fully inside, in which case no further plane tests are needed.
+  int stack[kQueryStackSize];
+  bool inside[kQueryStackSize];
+  int top = 0;
+  stack[top] = tree.root;
+  inside[top] = false;
+  top += 1;
+
+  while (top > 0 && count < max_out) {
+    top -= 1;
+    const int id = stack[top];
+    const bool parent_inside = inside[top];
+    const BvhNode& node = tree.nodes[id];
+    local.nodes_visited += 1;
+
+    bool node_inside = parent_inside;
+    if (!parent_inside) {
+      const FrustumTest test = frustum_test_aabb(frustum, node.box);
+      if (test == FrustumTest::Outside) {
+        continue;
+      }
+      node_inside = test == FrustumTest::Inside;
+    }
+
+    if (is_leaf(node)) {
+      local.leaves_tested += 1;
+      out[count++] = node.user;
+      continue;
+    }
+
+    if (top + 2 > kQueryStackSize) {
+      std::fprintf(stderr, "[Bvh] query stack overflow (height %d)\n", tree.nodes[tree.root].height);
+      break;
+    }
+    stack[top] = node.child0;
+    inside[top] = node_inside;
+    top += 1;
+    stack[top] = node.child1;
+    inside[top] = node_inside;
+    top += 1;
+  }
+
+  if (stats) *stats = local;
+  return count;
+}
+
+bool bvh_raycast(const Bvh& tree,
+                 Vec3 origin,
+                 Vec3 dir,
+                 float max_t,
+                 BvhRayHitFn hit_fn,
+                 void* ctx,
+                 BvhRayHit* out,
+                 BvhQueryStats* stats) {
+  BvhQueryStats local{};
+  BvhRayHit best{0, max_t};
+  bool hit = false;
+  const Vec3 inv_dir{1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z};
+
+  int stack[kQueryStackSize];
+  float stack_t[kQueryStackSize];
+  int top = 0;
+  float root_t = 0.0f;
+  if (tree.root != kBvhNull && ray_hits_box(tree.nodes[tree.root].box, origin, inv_dir, max_t, &root_t)) {
+    stack[top] = tree.root;
+    stack_t[top] = root_t;
+    top += 1;
+  }
+
+  while (top > 0) {
+    top -= 1;
+    if (stack_t[top] > best.t) {
+      continue;
+    }
+    const BvhNode& node = tree.nodes[stack[top]];
+    local.nodes_visited += 1;
+
+    if (is_leaf(node)) {
+      local.leaves_tested += 1;
+      const float t = hit_fn(ctx, node.user, best.t);
+      if (t >= 0.0f && t <= best.t) {
+        best = BvhRayHit{node.user, t};
+        hit = true;
+      }
+      continue;
+    }
+
+    float t0 = 0.0f;
+    float t1 = 0.0f;
+    const bool hit0 = ray_hits_box(tree.nodes[node.child0].box, origin, inv_dir, best.t, &t0);
+    const bool hit1 = ray_hits_box(tree.nodes[node.child1].box, origin, inv_dir, best.t, &t1);
+    if (top + 2 > kQueryStackSize) {
+      std::fprintf(stderr, "[Bvh] ray stack overflow (height %d)\n", tree.nodes[tree.root].height);
+      break;
+    }
+    // Push the farther child first so the nearer one is popped next.
+    const bool near0 = t0 <= t1;
+    const int order[2] = {near0 ? 1 : 0, near0 ? 0 : 1};
+    for (const int c : order) {
+      if (c == 0 ? hit0 : hit1) {
+        stack[top] = c == 0 ? node.child0 : node.child1;
+        stack_t[top] = c == 0 ? t0 : t1;
+        top += 1;
+      }
+    }
+  }
+
+  if (stats) *stats = local;
+  if (hit && out) *out = best;
+  return hit;
+}
+
+void bvh_build(Bvh& tree, const Aabb* boxes, const uint32_t* users, int count, int* out_leaves) {
+  tree.root = kBvhNull;
+  tree.free_list = kBvhNull;
+  tree.leaf_count = count;
+  if (count <= 0) {
+    bvh_clear(tree);
+    return;
+  }
+
+  // Leaves take ids [0, count), internal nodes [count, 2 * count - 1); any
+  // nodes beyond that go back on the free list.
+  const int used = 2 * count - 1;
+  if (static_cast<int>(tree.nodes.size()) < used) {
+    tree.nodes.resize(static_cast<size_t>(used));
+  }
+  for (int i = static_cast<int>(tree.nodes.size()) - 1; i >= used; --i) {
+    free_node(tree, i);
+  }
+
+  std::vector<BuildItem> items(static_cast<size_t>(count));
+  for (int i = 0; i < count; ++i) {
+    BvhNode& leaf = tree.nodes[i];
+    leaf.box = boxes[i];
+    leaf.parent = kBvhNull;
+    leaf.child0 = kBvhNull;
+    leaf.child1 = kBvhNull;
+    leaf.height = 0;
+    leaf.user = users[i];
+    items[i] = BuildItem{0.0f, i, vec3_scale(vec3_add(boxes[i].min, boxes[i].max), 0.5f)};
+    out_leaves[i] = i;
+  }
+
+  int next_internal = count;
+  tree.root = build_range(tree, items.data(), count, next_internal);
+  tree.nodes[tree.root].parent = kBvhNull;
+}
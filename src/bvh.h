@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "math3d.h"
+
+// Dynamic AABB tree. Leaves are inserted and removed incrementally and the
+// tree is kept height-balanced with rotations, so updates cost O(log n).
+struct BvhNode {
+  Aabb box;
+  int parent;  // next free node while on the free list
+  int child0;  // -1 for leaves
+  int child1;
+  int height;  // 0 for leaves, -1 for free nodes
+  uint32_t user;
+};
+
+struct BvhQueryStats {
+  int nodes_visited;
+  int leaves_tested;
+};
+
+struct Bvh {
+  std::vector<BvhNode> nodes;
+  int root;
+  int free_list;
+  int leaf_count;
+};
+
+constexpr int kBvhNull = -1;
+
+void bvh_init(Bvh& tree, int leaf_capacity);
+void bvh_clear(Bvh& tree);
+
+// Returns the leaf id, which stays valid until bvh_remove.
+int bvh_insert(Bvh& tree, const Aabb& box, uint32_t user);
+void bvh_remove(Bvh& tree, int leaf);
+void bvh_move(Bvh& tree, int leaf, const Aabb& box);
+
+// Distance along the ray at which the primitive behind `user` is hit, or a
+// negative value for a miss. Hits beyond `max_t` (the best so far) may be
+// reported as misses.
+using BvhRayHitFn = float (*)(void* ctx, uint32_t user, float max_t);
+
+struct BvhRayHit {
+  uint32_t user;
+  float t;
+};
+
+// Closest hit along origin + t * dir for t in [0, max_t]. Children are
+// visited nearest box first and any box starting beyond the best hit so far
+// is skipped, so a query costs about one root-to-leaf path plus the leaves
+// the ray actually passes near. Returns false when nothing is hit.
+bool bvh_raycast(const Bvh& tree,
+                 Vec3 origin,
+                 Vec3 dir,
+                 float max_t,
+                 BvhRayHitFn hit_fn,
+                 void* ctx,
+                 BvhRayHit* out,
+                 BvhQueryStats* stats);
+
+// Replaces the tree with one built top-down over `count` boxes by median
+// splits, which is much faster than inserting one by one for bulk loads.
+// The leaf id of box i is written to out_leaves[i]; the result supports
+// incremental updates like any other tree.
+void bvh_build(Bvh& tree, const Aabb* boxes, const uint32_t* users, int count, int* out_leaves);
+
+// Appends the user value of every leaf whose box is not outside the frustum
+// and returns how many were written (at most max_out).
+int bvh_query_frustum(const Bvh& tree, const Frustum& frustum, uint32_t* out, int max_out, BvhQueryStats* stats);
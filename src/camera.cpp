@@ -0,0 +1,74 @@
+#include "camera.h"
+
+#include <cmath>
+
+void camera_init(FlyCamera& camera) {
+  camera.position = Vec3{0.0f, 1.2f, 4.0f};
+  camera.yaw = -1.5707963f;
+  camera.pitch = 0.0f;
+  camera_release_keys(camera);
+}
+
+Vec3 camera_forward(const FlyCamera& camera) {
+  const float cp = std::cos(camera.pitch);
+  return vec3_normalize({
+      std::cos(camera.yaw) * cp,
+      std::sin(camera.pitch),
+      std::sin(camera.yaw) * cp,
+  });
+}
+
+bool camera_set_key(FlyCamera& camera, InputKey key, bool down) {
+  const int i = static_cast<int>(key);
+  if (i < 0 || i >= static_cast<int>(InputKey::Count) || camera.keys[i] == down) {
+    return false;
+  }
+  camera.keys[i] = down;
+  return true;
+}
+
+void camera_release_keys(FlyCamera& camera) {
+  for (bool& key : camera.keys) {
+    key = false;
+  }
+}
+
+void camera_mouse_look(FlyCamera& camera, float movement_x, float movement_y) {
+  camera.yaw += movement_x * kCameraLookSensitivity;
+  camera.pitch -= movement_y * kCameraLookSensitivity;
+  if (camera.pitch > kCameraPitchLimit) camera.pitch = kCameraPitchLimit;
+  if (camera.pitch < -kCameraPitchLimit) camera.pitch = -kCameraPitchLimit;
+}
+
+bool camera_moving(const FlyCamera& camera) {
+  return camera.keys[static_cast<int>(InputKey::W)] || camera.keys[static_cast<int>(InputKey::A)] ||
+         camera.keys[static_cast<int>(InputKey::S)] || camera.keys[static_cast<int>(InputKey::D)];
+}
+
+void camera_update(FlyCamera& camera, float dt_sec) {
+  const Vec3 forward = camera_forward(camera);
+  const Vec3 right = vec3_normalize(vec3_cross(forward, Vec3{0.0f, 1.0f, 0.0f}));
+
+  Vec3 move{0.0f, 0.0f, 0.0f};
+  if (camera.keys[static_cast<int>(InputKey::W)]) move = vec3_add(move, forward);
+  if (camera.keys[static_cast<int>(InputKey::S)]) move = vec3_sub(move, forward);
+  if (camera.keys[static_cast<int>(InputKey::D)]) move = vec3_add(move, right);
+  if (camera.keys[static_cast<int>(InputKey::A)]) move = vec3_sub(move, right);
+
+  if (vec3_dot(move, move) > 0.0f) {
+    move = vec3_normalize(move);
+  }
+
+  const float speed = camera.keys[static_cast<int>(InputKey::Shift)] ? kCameraFastSpeed : kCameraSpeed;
+  camera.position = vec3_add(camera.position, vec3_scale(move, speed * dt_sec));
+}
+
+Mat4 camera_view_projection(const FlyCamera& camera, float aspect, float* proj_y_scale) {
+  const Mat4 proj = mat4_perspective_rh_zo(kCameraFovY, aspect, kCameraNear, kCameraFar);
+  const Vec3 fwd = camera_forward(camera);
+  const Mat4 view = mat4_look_at_rh(camera.position, vec3_add(camera.position, fwd), Vec3{0.0f, 1.0f, 0.0f});
+  if (proj_y_scale) {
+    *proj_y_scale = proj.m[5];
+  }
+  return mat4_mul(proj, view);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "input_queue.h"
+#include "math3d.h"
+
+// First-person fly camera driven by InputKey state and mouse look. Shared by
+// the web renderer and the native replay tool, so a recorded session moves
+// the camera identically in both.
+constexpr float kCameraNear = 0.1f;
+constexpr float kCameraFar = 200.0f;
+constexpr float kCameraFovY = 60.0f * 3.14159265f / 180.0f;
+constexpr float kCameraLookSensitivity = 0.0025f;  // radians per CSS pixel
+constexpr float kCameraPitchLimit = 1.553343f;     // just short of straight up/down
+constexpr float kCameraSpeed = 3.5f;
+constexpr float kCameraFastSpeed = 7.0f;  // with Shift held
+
+struct FlyCamera {
+  Vec3 position;
+  float yaw;
+  float pitch;
+  bool keys[static_cast<int>(InputKey::Count)];
+};
+
+void camera_init(FlyCamera& camera);
+Vec3 camera_forward(const FlyCamera& camera);
+// Returns true when the key changed state (repeats are no-ops).
+bool camera_set_key(FlyCamera& camera, InputKey key, bool down);
+void camera_release_keys(FlyCamera& camera);
+void camera_mouse_look(FlyCamera& camera, float movement_x, float movement_y);
+// True while a movement key is held.
+bool camera_moving(const FlyCamera& camera);
+void camera_update(FlyCamera& camera, float dt_sec);
+// `proj_y_scale` (may be null) receives the projection's y scale.
+Mat4 camera_view_projection(const FlyCamera& camera, float aspect, float* proj_y_scale);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Section layout shared by the packed file formats (scene_file.h, mesh.h):
+// every section starts at a multiple of a power-of-two alignment, so a mapped
+// file is read in place.
+inline uint64_t file_align_up(uint64_t value, uint64_t align) {
+  return (value + align - 1) & ~(align - 1);
+}
+
+// True when [offset, offset + bytes) is aligned and inside a file of `size`
+// bytes, without overflowing on hostile offsets.
+inline bool file_section_fits(uint64_t offset, uint64_t bytes, uint64_t size, uint64_t align) {
+  return offset % align == 0 && offset <= size && bytes <= size - offset;
+}
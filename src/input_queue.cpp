@@ -0,0 +1,38 @@
+#include "input_queue.h"
+
+namespace {
+
+constexpr uint32_t kInputQueueMask = kInputQueueCapacity - 1;
+
+}  // namespace
+
+void input_queue_init(InputQueue& queue) {
+  queue.head.store(0, std::memory_order_relaxed);
+  queue.tail.store(0, std::memory_order_relaxed);
+  queue.dropped.store(0, std::memory_order_relaxed);
+  for (InputEvent& e : queue.events) {
+    e = InputEvent{};
+  }
+}
+
+bool input_queue_push(InputQueue& queue, const InputEvent& event) {
+  const uint32_t head = queue.head.load(std::memory_order_relaxed);
+  if (head - queue.tail.load(std::memory_order_acquire) >= kInputQueueCapacity) {
+    queue.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  queue.events[head & kInputQueueMask] = event;
+  queue.head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+int input_queue_drain(InputQueue& queue, InputEvent* out, int max_events) {
+  const uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+  const uint32_t available = queue.head.load(std::memory_order_acquire) - tail;
+  const uint32_t count = available < static_cast<uint32_t>(max_events) ? available : static_cast<uint32_t>(max_events);
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = queue.events[(tail + i) & kInputQueueMask];
+  }
+  queue.tail.store(tail + count, std::memory_order_release);
+  return static_cast<int>(count);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single-producer/single-consumer ring of fixed-size input records living in
+// wasm memory. In worker render mode the page is the producer and writes it
+// directly from JavaScript with Atomics (see pushInput() in web/shell.html),
+// so the layout below is part of that contract: head, tail and dropped each
+// sit on their own 64-byte line, followed by the 16-byte records. Neither
+// side ever blocks; a full queue drops the event and counts it.
+constexpr uint32_t kInputQueueCapacity = 1024;  // power of two
+
+enum class InputEventType : uint32_t {
+  None,
+  KeyDown,    // a = InputKey
+  KeyUp,      // a = InputKey
+  MouseMove,  // a = movementX, b = movementY, in CSS pixels
+  Command,    // a = InputCommand, b = argument
+};
+
+enum class InputKey : int32_t {
+  W,
+  A,
+  S,
+  D,
+  Shift,
+  Count,
+};
+
+enum class InputCommand : int32_t {
+  Capture,
+  Place,   // b = shot id
+  Export,  // b = shot id
+  SaveScene,
+  LoadScene,
+  LoadMesh,
+  RecordTrace,  // b = 1 to start, 0 to stop
+  ReplayTrace,
+  GenerateScene,  // parameters staged with framespace_generate_scene_begin
+  SelectPhoto,    // b = photo handle, 0 = the photo under the crosshair
+  MovePhoto,      // b = photo handle, 0 = the selection; moves it to the crosshair
+  DeletePhoto,    // b = photo handle, 0 = the selection
+  // Settings the page changes from its own thread; in worker render mode
+  // they must not write the renderer's globals directly.
+  SetContinuousRendering,  // b = 1 to draw every frame, 0 for render on demand
+  SetDynamicResolution,    // b = 1 to enable
+  DumpProfileTrace,
+};
+
+struct InputEvent {
+  uint32_t type;
+  int32_t a;
+  int32_t b;
+  int32_t c;
+};
+
+struct InputQueue {
+  alignas(64) std::atomic<uint32_t> head;  // next record to write
+  alignas(64) std::atomic<uint32_t> tail;  // next record to read
+  alignas(64) std::atomic<uint32_t> dropped;
+  alignas(64) InputEvent events[kInputQueueCapacity];
+};
+
+static_assert(sizeof(InputEvent) == 16, "InputEvent layout is shared with JavaScript");
+static_assert(offsetof(InputQueue, tail) == 64, "InputQueue layout is shared with JavaScript");
+static_assert(offsetof(InputQueue, dropped) == 128, "InputQueue layout is shared with JavaScript");
+static_assert(offsetof(InputQueue, events) == 192, "InputQueue layout is shared with JavaScript");
+
+void input_queue_init(InputQueue& queue);
+// Producer side. Returns false (and counts a drop) when the queue is full.
+bool input_queue_push(InputQueue& queue, const InputEvent& event);
+// Consumer side. Copies up to max_events pending records in order.
+int input_queue_drain(InputQueue& queue, InputEvent* out, int max_events);
@@ -0,0 +1,246 @@
+#include "input_trace.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+void put_varint(std::vector<uint8_t>& out, uint32_t v) {
+  while (v >= 0x80u) {
+    out.push_back(static_cast<uint8_t>(v | 0x80u));
+    v >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (p == end) {
+      return false;
+    }
+    const uint8_t byte = *p++;
+    v |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+    if (!(byte & 0x80u)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t zigzag(int32_t v) {
+  return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+int32_t unzigzag(uint32_t v) {
+  return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1u);
+}
+
+float step_seconds_from_us(uint32_t step_us) {
+  return static_cast<float>(step_us) * 1.0e-6f;
+}
+
+}  // namespace
+
+void input_trace_begin(InputTrace& trace, const FlyCamera& camera, uint32_t first_shot_id) {
+  trace.frame_count = 0;
+  trace.step_seconds = step_seconds_from_us(kInputTraceDefaultStepUs);
+  trace.first_shot_id = first_shot_id;
+  trace.camera_position = camera.position;
+  trace.camera_yaw = camera.yaw;
+  trace.camera_pitch = camera.pitch;
+  trace.records.clear();
+  trace.args.clear();
+}
+
+int input_trace_arg_count(const InputEvent& event) {
+  if (static_cast<InputEventType>(event.type) != InputEventType::Command) {
+    return 0;
+  }
+  switch (static_cast<InputCommand>(event.a)) {
+    case InputCommand::MovePhoto: return kInputTraceMoveArgs;
+    case InputCommand::GenerateScene: return kInputTraceGenerateArgs;
+    default: return 0;
+  }
+}
+
+const uint32_t* input_trace_args(const InputTrace& trace, const InputEvent& event) {
+  const int count = input_trace_arg_count(event);
+  if (count == 0 || event.c < 0 ||
+      static_cast<size_t>(event.c) + static_cast<size_t>(count) > trace.args.size()) {
+    return nullptr;
+  }
+  return trace.args.data() + event.c;
+}
+
+void input_trace_add(InputTrace& trace, uint32_t frame, double time_ms, const InputEvent& event, const uint32_t* args) {
+  const uint32_t time_us = static_cast<uint32_t>(std::lround(time_ms * 1000.0));
+  const int arg_count = input_trace_arg_count(event);
+  InputEvent e = event;
+  e.c = arg_count > 0 ? static_cast<int32_t>(trace.args.size()) : 0;
+  trace.args.insert(trace.args.end(), args, args + arg_count);
+  trace.records.push_back(InputTraceRecord{frame, time_us, e});
+  if (frame + 1 > trace.frame_count) {
+    trace.frame_count = frame + 1;
+  }
+}
+
+void input_trace_write(const InputTrace& trace, std::vector<uint8_t>& out) {
+  out.assign(sizeof(InputTraceHeader), 0);
+  uint32_t frame = 0;
+  uint32_t time_us = 0;
+  for (const InputTraceRecord& r : trace.records) {
+    put_varint(out, r.frame - frame);
+    put_varint(out, r.time_us - time_us);
+    out.push_back(static_cast<uint8_t>(r.event.type));
+    put_varint(out, zigzag(r.event.a));
+    put_varint(out, zigzag(r.event.b));
+    const int arg_count = input_trace_arg_count(r.event);
+    if (arg_count > 0) {
+      const size_t at = out.size();
+      out.resize(at + static_cast<size_t>(arg_count) * 4);
+      std::memcpy(out.data() + at, trace.args.data() + r.event.c, static_cast<size_t>(arg_count) * 4);
+    }
+    frame = r.frame;
+    time_us = r.time_us;
+  }
+
+  InputTraceHeader header{};
+  header.magic = kInputTraceMagic;
+  header.version = kInputTraceVersion;
+  header.header_bytes = sizeof(InputTraceHeader);
+  header.record_count = static_cast<uint32_t>(trace.records.size());
+  header.frame_count = trace.frame_count;
+  header.step_us = static_cast<uint32_t>(std::lround(trace.step_seconds * 1.0e6f));
+  header.first_shot_id = trace.first_shot_id;
+  header.camera_position[0] = trace.camera_position.x;
+  header.camera_position[1] = trace.camera_position.y;
+  header.camera_position[2] = trace.camera_position.z;
+  header.camera_yaw = trace.camera_yaw;
+  header.camera_pitch = trace.camera_pitch;
+  header.record_bytes = out.size() - sizeof(InputTraceHeader);
+  std::memcpy(out.data(), &header, sizeof(header));
+}
+
+bool input_trace_read(const uint8_t* data, size_t size, InputTrace& out) {
+  InputTraceHeader header{};
+  if (size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != kInputTraceMagic || header.version < 1 || header.version > kInputTraceVersion ||
+      header.header_bytes != sizeof(InputTraceHeader) || header.record_bytes > size - sizeof(header) ||
+      header.step_us == 0) {
+    return false;
+  }
+
+  out.frame_count = header.frame_count;
+  out.step_seconds = step_seconds_from_us(header.step_us);
+  out.first_shot_id = header.first_shot_id;
+  out.camera_position = Vec3{header.camera_position[0], header.camera_position[1], header.camera_position[2]};
+  out.camera_yaw = header.camera_yaw;
+  out.camera_pitch = header.camera_pitch;
+  out.records.clear();
+  out.records.reserve(header.record_count);
+  out.args.clear();
+
+  const uint8_t* p = data + sizeof(header);
+  const uint8_t* end = p + header.record_bytes;
+  uint32_t frame = 0;
+  uint32_t time_us = 0;
+  for (uint32_t i = 0; i < header.record_count; ++i) {
+    uint32_t frame_delta = 0;
+    uint32_t time_delta = 0;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    if (!get_varint(p, end, frame_delta) || !get_varint(p, end, time_delta) || p == end) {
+      return false;
+    }
+    const uint32_t type = *p++;
+    if (!get_varint(p, end, a) || !get_varint(p, end, b)) {
+      return false;
+    }
+    frame += frame_delta;
+    time_us += time_delta;
+    if (frame >= out.frame_count) {
+      return false;
+    }
+    InputEvent event{type, unzigzag(a), unzigzag(b), 0};
+    const int arg_count = input_trace_arg_count(event);
+    if (arg_count > 0 && header.version < 2) {
+      return false;  // version 1 had no command that carries args
+    }
+    if (arg_count > 0) {
+      if (static_cast<size_t>(end - p) < static_cast<size_t>(arg_count) * 4) {
+        return false;
+      }
+      event.c = static_cast<int32_t>(out.args.size());
+      out.args.resize(out.args.size() + static_cast<size_t>(arg_count));
+      std::memcpy(out.args.data() + event.c, p, static_cast<size_t>(arg_count) * 4);
+      p += static_cast<size_t>(arg_count) * 4;
+    }
+    out.records.push_back(InputTraceRecord{frame, time_us, event});
+  }
+  return p == end;
+}
+
+void input_trace_start_camera(const InputTrace& trace, FlyCamera& camera) {
+  camera.position = trace.camera_position;
+  camera.yaw = trace.camera_yaw;
+  camera.pitch = trace.camera_pitch;
+  camera_release_keys(camera);
+}
+
+void input_trace_photos_reset(InputTracePhotos& photos, const PhotoScene& scene) {
+  photos.handles.resize(static_cast<size_t>(scene.count));
+  for (int i = 0; i < scene.count; ++i) {
+    photos.handles[static_cast<size_t>(i)] = scene_handle_at(scene, i);
+  }
+}
+
+uint32_t input_trace_photos_add(InputTracePhotos& photos, PhotoHandle handle) {
+  photos.handles.push_back(handle);
+  return static_cast<uint32_t>(photos.handles.size());
+}
+
+uint32_t input_trace_photos_find(const InputTracePhotos& photos, PhotoHandle handle) {
+  if (handle == kInvalidPhotoHandle) {
+    return 0;
+  }
+  for (size_t i = 0; i < photos.handles.size(); ++i) {
+    if (photos.handles[i] == handle) {
+      return static_cast<uint32_t>(i + 1);
+    }
+  }
+  return 0;
+}
+
+PhotoHandle input_trace_photos_handle(const InputTracePhotos& photos, uint32_t id) {
+  return id > 0 && id <= photos.handles.size() ? photos.handles[id - 1] : kInvalidPhotoHandle;
+}
+
+uint32_t input_trace_photos_remove(InputTracePhotos& photos, PhotoHandle handle) {
+  const uint32_t id = input_trace_photos_find(photos, handle);
+  if (id > 0) {
+    photos.handles[id - 1] = kInvalidPhotoHandle;
+  }
+  return id;
+}
+
+void input_replay_begin(InputReplay& replay) {
+  replay.next_record = 0;
+  replay.frame = 0;
+}
+
+bool input_replay_next_frame(InputReplay& replay, const InputTrace& trace, std::vector<InputEvent>& out) {
+  out.clear();
+  if (replay.frame >= trace.frame_count) {
+    return false;
+  }
+  while (replay.next_record < trace.records.size() && trace.records[replay.next_record].frame == replay.frame) {
+    out.push_back(trace.records[replay.next_record].event);
+    replay.next_record += 1;
+  }
+  replay.frame += 1;
+  return true;
+}
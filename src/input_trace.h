@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "camera.h"
+#include "input_queue.h"
+#include "scene.h"
+
+// A recorded input session, replayed with a fixed time step so the same
+// camera path, captures and placements can be rerun against another build
+// (in the browser, or headless with tools/replay.cpp).
+//
+// Records carry the frame they were applied on, counted from the start of
+// the recording, and the wall time for reference. Only inputs that change
+// what is drawn are recorded: key state changes (not repeats), mouse look,
+// and these commands:
+//   Capture
+//   Place          b = shot id
+//   MovePhoto      b = trace photo id; args x, y, z, yaw, scale (f32 bits)
+//   DeletePhoto    b = trace photo id
+//   GenerateScene  b = photo count; args layout, shot count, seed
+// Place keeps the shot id the session used; a replay shifts ids at or above
+// first_shot_id onto the shots its own captures receive, until a
+// GenerateScene renumbers shots from 1 on both sides. Photos are named by
+// trace photo id (see InputTracePhotos), never by handle.
+//
+// File layout, little-endian:
+//
+//   InputTraceHeader
+//   records, each
+//     varint         frame delta from the previous record
+//     varint         wall time delta in microseconds
+//     u8             InputEventType
+//     zigzag varint  a, b
+//     u32            args, as many as input_trace_arg_count() says (version 2)
+// A mouse move with small deltas takes 5-7 bytes instead of the 16 of an
+// InputEvent.
+constexpr uint32_t kInputTraceMagic = 0x54495346;  // "FSIT"
+constexpr uint16_t kInputTraceVersion = 2;  // 1 had no command args and still reads
+// The step is stored in whole microseconds; a fresh trace starts from the
+// stored value so that replaying it before and after a save is identical.
+constexpr uint32_t kInputTraceDefaultStepUs = 16667;  // 60 Hz
+
+struct InputTraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_bytes;
+  uint32_t record_count;
+  uint32_t frame_count;
+  uint32_t step_us;
+  uint32_t first_shot_id;
+  float camera_position[3];
+  float camera_yaw;
+  float camera_pitch;
+  uint32_t reserved;
+  uint64_t record_bytes;
+};
+static_assert(sizeof(InputTraceHeader) == 56, "InputTraceHeader is part of the trace format");
+
+struct InputTraceRecord {
+  uint32_t frame;
+  uint32_t time_us;
+  InputEvent event;
+};
+
+constexpr int kInputTraceMoveArgs = 5;
+constexpr int kInputTraceGenerateArgs = 3;
+
+struct InputTrace {
+  uint32_t frame_count;
+  float step_seconds;  // fixed dt a replay advances by, a whole number of microseconds
+  uint32_t first_shot_id;
+  Vec3 camera_position;
+  float camera_yaw;
+  float camera_pitch;
+  std::vector<InputTraceRecord> records;
+  std::vector<uint32_t> args;  // a record with args has event.c = index of its first one
+};
+
+// Starts an empty trace from the camera pose the session begins at.
+void input_trace_begin(InputTrace& trace, const FlyCamera& camera, uint32_t first_shot_id);
+// Extra 32-bit words a record of this event carries.
+int input_trace_arg_count(const InputEvent& event);
+// The input_trace_arg_count(event) words of a record of `trace`, or null when
+// event.c does not point at that many of them.
+const uint32_t* input_trace_args(const InputTrace& trace, const InputEvent& event);
+// `frame` and `time_ms` are relative to the start of the recording and must
+// not go backwards. `args` holds input_trace_arg_count(event) words and may
+// be null when that is 0.
+void input_trace_add(InputTrace& trace, uint32_t frame, double time_ms, const InputEvent& event, const uint32_t* args);
+void input_trace_write(const InputTrace& trace, std::vector<uint8_t>& out);
+// Checks the magic, version and that every record decodes inside `size`.
+bool input_trace_read(const uint8_t* data, size_t size, InputTrace& out);
+// Puts the camera at the trace's starting pose with no keys held.
+void input_trace_start_camera(const InputTrace& trace, FlyCamera& camera);
+
+// Trace photo ids. A replay's scene hands out other handles than the
+// recording's did, so photos are named by the order they came to be. When a
+// recording or a replay starts, the photos in the scene get ids 1..count in
+// dense order; each Place takes the next id whether or not it got a slot, and
+// GenerateScene starts over from the generated scene. Recorder and replayer
+// keep the same table, so an id resolves to the matching photo as long as the
+// replay starts from the scene the recording started from.
+struct InputTracePhotos {
+  std::vector<PhotoHandle> handles;  // id - 1 -> handle; kInvalidPhotoHandle once deleted
+};
+
+void input_trace_photos_reset(InputTracePhotos& photos, const PhotoScene& scene);
+uint32_t input_trace_photos_add(InputTracePhotos& photos, PhotoHandle handle);
+// 0 for a photo the trace has no id for.
+uint32_t input_trace_photos_find(const InputTracePhotos& photos, PhotoHandle handle);
+PhotoHandle input_trace_photos_handle(const InputTracePhotos& photos, uint32_t id);
+// Forgets a deleted photo. Returns its id, or 0.
+uint32_t input_trace_photos_remove(InputTracePhotos& photos, PhotoHandle handle);
+
+struct InputReplay {
+  size_t next_record;
+  uint32_t frame;
+};
+
+void input_replay_begin(InputReplay& replay);
+// Appends the events of the next frame to `out` (cleared first). Returns
+// false once every frame of the trace has been played.
+bool input_replay_next_frame(InputReplay& replay, const InputTrace& trace, std::vector<InputEvent>& out);
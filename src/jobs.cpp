@@ -0,0 +1,201 @@
+#include "jobs.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int64_t kDequeMask = kJobDequeCapacity - 1;
+constexpr int kIdleSpins = 256;
+
+void cpu_relax() {
+#if defined(__SSE2__) || defined(_M_X64)
+  _mm_pause();
+#endif
+}
+
+void deque_reset(JobDeque& d) {
+  d.top.store(0, std::memory_order_relaxed);
+  d.bottom.store(0, std::memory_order_relaxed);
+}
+
+// Owner only.
+bool deque_push(JobDeque& d, Job* job) {
+  const int64_t b = d.bottom.load(std::memory_order_relaxed);
+  const int64_t t = d.top.load(std::memory_order_acquire);
+  if (b - t >= kJobDequeCapacity) {
+    return false;
+  }
+  d.slots[b & kDequeMask].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  d.bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+// Owner only.
+Job* deque_pop(JobDeque& d) {
+  const int64_t b = d.bottom.load(std::memory_order_relaxed) - 1;
+  d.bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = d.top.load(std::memory_order_relaxed);
+  if (t > b) {
+    d.bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Job* job = d.slots[b & kDequeMask].load(std::memory_order_relaxed);
+  if (t == b) {
+    // Last item: race any thief for it.
+    if (!d.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    d.bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+// Any thread.
+Job* deque_steal(JobDeque& d) {
+  int64_t t = d.top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = d.bottom.load(std::memory_order_acquire);
+  if (t >= b) {
+    return nullptr;
+  }
+  Job* job = d.slots[t & kDequeMask].load(std::memory_order_relaxed);
+  if (!d.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return job;
+}
+
+void run_job(JobSystem& js, Job* job) {
+  job->fn(job->ctx, job->begin, job->end);
+  job->pending->fetch_sub(1, std::memory_order_release);
+  js.executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Own deque first, then every other deque starting after our own.
+Job* find_job(JobSystem& js, int self) {
+  if (Job* job = deque_pop(*js.deques[self])) {
+    return job;
+  }
+  const int count = static_cast<int>(js.deques.size());
+  for (int i = 1; i < count; ++i) {
+    if (Job* job = deque_steal(*js.deques[(self + i) % count])) {
+      js.stolen.fetch_add(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void worker_main(JobSystem* js, int self) {
+  uint32_t seen = js->epoch.load(std::memory_order_acquire);
+  while (js->running.load(std::memory_order_acquire)) {
+    if (Job* job = find_job(*js, self)) {
+      run_job(*js, job);
+      continue;
+    }
+    bool found = false;
+    for (int spin = 0; spin < kIdleSpins && !found; ++spin) {
+      cpu_relax();
+      found = js->epoch.load(std::memory_order_acquire) != seen;
+    }
+    if (found) {
+      seen = js->epoch.load(std::memory_order_acquire);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(js->mutex);
+    js->wake.wait(lock, [js, seen] {
+      return !js->running.load(std::memory_order_acquire) || js->epoch.load(std::memory_order_acquire) != seen;
+    });
+    seen = js->epoch.load(std::memory_order_acquire);
+  }
+}
+
+}  // namespace
+
+void jobs_init(JobSystem& js, int worker_threads) {
+  worker_threads = std::clamp(worker_threads, 0, kMaxJobWorkers);
+  js.running.store(true, std::memory_order_relaxed);
+  js.epoch.store(0, std::memory_order_relaxed);
+  js.executed.store(0, std::memory_order_relaxed);
+  js.stolen.store(0, std::memory_order_relaxed);
+  js.deques.resize(static_cast<size_t>(worker_threads) + 1);
+  for (JobDeque*& d : js.deques) {
+    d = new JobDeque;
+    deque_reset(*d);
+  }
+  js.jobs.reserve(kJobDequeCapacity);
+  js.threads.reserve(static_cast<size_t>(worker_threads));
+  for (int i = 0; i < worker_threads; ++i) {
+    js.threads.emplace_back(worker_main, &js, i + 1);
+  }
+}
+
+void jobs_shutdown(JobSystem& js) {
+  {
+    std::lock_guard<std::mutex> lock(js.mutex);
+    js.running.store(false, std::memory_order_release);
+  }
+  js.wake.notify_all();
+  for (std::thread& t : js.threads) {
+    t.join();
+  }
+  js.threads.clear();
+  for (JobDeque* d : js.deques) {
+    delete d;
+  }
+  js.deques.clear();
+}
+
+int jobs_thread_count(const JobSystem& js) {
+  return static_cast<int>(js.deques.size());
+}
+
+JobStats jobs_stats(const JobSystem& js) {
+  return JobStats{js.executed.load(std::memory_order_relaxed), js.stolen.load(std::memory_order_relaxed)};
+}
+
+void jobs_parallel_for(JobSystem& js, int count, int batch, JobFn fn, void* ctx) {
+  if (count <= 0) {
+    return;
+  }
+  batch = std::max(batch, 1);
+  if (js.threads.empty() || count <= batch) {
+    fn(ctx, 0, count);
+    return;
+  }
+
+  std::atomic<int> pending{0};
+  js.jobs.clear();
+  for (int begin = 0; begin < count; begin += batch) {
+    js.jobs.push_back(Job{fn, ctx, begin, std::min(count, begin + batch), &pending});
+  }
+  pending.store(static_cast<int>(js.jobs.size()), std::memory_order_relaxed);
+
+  // Pushed in reverse so the owner pops from the front of the range while
+  // thieves take from the back.
+  JobDeque& own = *js.deques[0];
+  for (size_t i = js.jobs.size(); i-- > 0;) {
+    if (!deque_push(own, &js.jobs[i])) {
+      run_job(js, &js.jobs[i]);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(js.mutex);
+    js.epoch.fetch_add(1, std::memory_order_release);
+  }
+  js.wake.notify_all();
+
+  while (pending.load(std::memory_order_acquire) > 0) {
+    if (Job* job = find_job(js, 0)) {
+      run_job(js, job);
+    } else {
+      cpu_relax();
+    }
+  }
+}
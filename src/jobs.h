@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fork-join job system. Every participant, including the thread that
+// calls jobs_parallel_for, owns a fixed-capacity Chase-Lev deque: the owner
+// pushes and pops at the bottom, idle threads steal from the top. Workers
+// sleep on a condition variable between batches; the calling thread never
+// sleeps (the browser main thread may not block) and helps until its batch
+// is done.
+//
+// Runs on std::thread natively and on Emscripten pthreads in the web build.
+constexpr int kJobDequeCapacity = 4096;  // power of two
+constexpr int kMaxJobWorkers = 15;
+
+using JobFn = void (*)(void* ctx, int begin, int end);
+
+struct Job {
+  JobFn fn;
+  void* ctx;
+  int begin;
+  int end;
+  std::atomic<int>* pending;
+};
+
+struct JobDeque {
+  alignas(64) std::atomic<int64_t> top;
+  alignas(64) std::atomic<int64_t> bottom;
+  std::atomic<Job*> slots[kJobDequeCapacity];
+};
+
+struct JobStats {
+  uint64_t executed;
+  uint64_t stolen;
+};
+
+struct JobSystem {
+  // deques[0] belongs to the calling thread, deques[i] to threads[i - 1].
+  std::vector<JobDeque*> deques;
+  std::vector<std::thread> threads;
+  std::vector<Job> jobs;  // storage for the batch in flight
+  std::atomic<bool> running;
+  std::atomic<uint32_t> epoch;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::atomic<uint64_t> executed;
+  std::atomic<uint64_t> stolen;
+};
+
+// worker_threads may be 0, in which case jobs run inline on the caller.
+void jobs_init(JobSystem& js, int worker_threads);
+void jobs_shutdown(JobSystem& js);
+// Threads that execute jobs, counting the caller.
+int jobs_thread_count(const JobSystem& js);
+JobStats jobs_stats(const JobSystem& js);
+
+// Splits [0, count) into ranges of `batch` items, runs fn on each across all
+// threads and returns once every range has finished. Must only be called
+// from the thread that called jobs_init, and not from inside a job.
+void jobs_parallel_for(JobSystem& js, int count, int batch, JobFn fn, void* ctx);
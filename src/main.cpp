@@ -1,14 +1,35 @@
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include <emscripten.h>
 #include <emscripten/html5.h>
+#include <emscripten/threading.h>
 #include <webgpu/webgpu.h>
 
+#include "camera.h"
+#include "input_queue.h"
+#include "input_trace.h"
+#include "jobs.h"
 #include "math3d.h"
+#include "mesh.h"
+#include "page_stats.h"
+#include "physics.h"
+#include "profiler.h"
+#include "residency.h"
+#include "resolution.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "scene_gen.h"
+#include "snapshot.h"
+#include "snapshot_codec.h"
+#include "world_config.h"
 
 namespace {
 
@@ -22,27 +43,123 @@ struct Vertex {
 };
 
 struct Uniforms {
-  float mvp[16];
+  float view_proj[16];
   float tint[4];
 };
 
-struct PhotoSnapshot {
-  uint32_t id;
-  Vec3 position;
-  float yaw;
-  float pitch;
-  double timestamp_ms;
+struct UploadStats {
+  uint32_t uniform_bytes;
+  uint32_t instance_bytes;
+  uint32_t texture_bytes;
+  uint32_t queue_writes;
 };
 
-struct PlacedPhoto {
-  bool active;
-  uint32_t shot_id;
-  Vec3 position;
-  float yaw;
-  float scale;
+constexpr int kCubeInstance = 0;
+constexpr int kMeshInstance = 1;
+constexpr int kFirstPhotoInstance = 2;
+constexpr int kFirstBodyInstance = kFirstPhotoInstance + kMaxPlacedPhotos;
+// Photos disoccluded this frame (see kPhotoCullWGSL); overflow is drawn
+// through the early region from the next frame on.
+constexpr int kMaxLatePhotos = 16384;
+constexpr int kFirstLatePhotoInstance = kFirstBodyInstance + kMaxPhysicsInstances;
+constexpr int kMaxInstances = kFirstLatePhotoInstance + kMaxLatePhotos;
+
+// Per-draw uniforms live in a frame-sized arena; each frame owns one of
+// kUniformFrameCount regions so an upload never overwrites data that an
+// in-flight frame may still be reading.
+constexpr uint32_t kUniformAlign = 256;
+constexpr uint32_t kMaxDrawsPerFrame = 64;
+constexpr uint32_t kUniformFrameCount = 3;
+constexpr uint32_t kUniformFrameBytes = kUniformAlign * kMaxDrawsPerFrame;
+
+// The static scene draws (cube, photo frames, physics bodies) are recorded
+// into render bundles once. Each draw reads its instance range from a fixed
+// region of g_instance_buffer and its counts from g_indirect_buffer, so the
+// bundles stay valid while culling and placements change every frame; only
+// replacing a resource they reference (pipeline, bind group) re-records
+// them. One bundle per uniform frame region, since dynamic offsets are baked.
+constexpr int kCubeDraw = 0;
+constexpr int kPhotoDraw = 1;
+constexpr int kBodyDraw = 2;
+constexpr int kMeshDraw = 3;
+constexpr int kStaticDrawCount = 4;
+// Encoded directly after the Hi-Z pass, not part of the bundles.
+constexpr int kLatePhotoDraw = kStaticDrawCount;
+constexpr int kIndirectDrawCount = kStaticDrawCount + 1;
+
+struct DrawIndexedIndirectArgs {
+  uint32_t index_count;
+  uint32_t instance_count;
+  uint32_t first_index;
+  int32_t base_vertex;
+  uint32_t first_instance;  // always 0: indirect-first-instance is optional
+};
+
+struct BundleStats {
+  uint32_t rebuilds;
+  double last_record_ms;    // recording all static draws once
+  double replay_ms_total;   // ExecuteBundles plus the indirect upload
+  double saved_ms_total;    // estimated against encoding the draws directly
+};
+
+// GPU-driven photo culling. Past kGpuCullMinPhotos placed photos, a compute
+// pass tests every photo against the frustum and appends the visible ones to
+// the photo instance region, counting them straight into the photo draw's
+// indirect args. The CPU only uploads the scene columns when they change and
+// a fixed-size parameter block per frame; the visible count comes back a few
+// frames late through a small readback ring. Below the threshold the CPU
+// path is cheaper and also drives detail streaming, which needs the visible
+// list on the CPU.
+constexpr int kGpuCullMinPhotos = 2048;
+constexpr uint32_t kGpuCullWorkgroupSize = 64;
+constexpr int kGpuCullReadbackSlots = 3;
+constexpr int kGpuCullColumns = 6;  // px, py, pz, yaw, scale, shot_id
+
+struct GpuCullParams {
+  float planes[6][4];
+  uint32_t photo_count;
+  uint32_t column_stride;
+  uint32_t first_instance;
+  uint32_t count_word;  // u32 index of the photo draw's instance_count
+  uint32_t layer_shot[48];
+  int32_t layer_slot[48];
+  float view_proj[16];
+  uint32_t occlusion;  // 0: the early pass draws everything in the frustum
+  uint32_t late_first_instance;
+  uint32_t late_count_word;
+  uint32_t late_capacity;
 };
 
-constexpr int kMaxPlacedPhotos = 64;
+// Early count, late count, occluded count.
+constexpr int kGpuCullReadbackWords = 3;
+
+struct GpuCullReadback {
+  WGPUBuffer buffer;
+  uint64_t frame;
+  bool busy;
+};
+
+// Captured shots are blitted from the swap chain at full snapshot resolution
+// (kSnapshotWidth x kSnapshotHeight, see snapshot.h), then downsampled into
+// one layer of an always-resident base-tier array. Full-resolution pixels are
+// read back once and re-uploaded into a budgeted detail pool on demand (see
+// residency.h).
+constexpr int kSnapshotDetailMips = 3;
+constexpr uint32_t kSnapshotBaseWidth = kSnapshotWidth >> kSnapshotDetailMips;
+constexpr uint32_t kSnapshotBaseHeight = kSnapshotHeight >> kSnapshotDetailMips;
+constexpr WGPUTextureFormat kSnapshotFormat = WGPUTextureFormat_RGBA8Unorm;
+constexpr uint32_t kSnapshotReadbackRowBytes = (kSnapshotWidth * 4 + 255) / 256 * 256;
+constexpr WGPUTextureFormat kSnapshotDepthFormat = WGPUTextureFormat_R32Float;
+constexpr int kDefaultReadbackRingDepth = 4;
+
+constexpr WGPUTextureFormat kDepthFormat = WGPUTextureFormat_Depth32Float;
+constexpr uint64_t kDefaultSnapshotBudgetBytes = 16ull * 1024 * 1024;
+// Dynamic resolution aims the GPU main pass (or the CPU frame) at 60 Hz.
+constexpr float kDefaultFrameBudgetMs = 1000.0f / 60.0f;
+
+// The imported mesh (see src/mesh.h) stands beside the cube, scaled so its
+// longest half extent is one unit.
+constexpr Vec3 kImportedMeshPosition{-3.0f, 0.0f, 0.0f};
 
 constexpr Vertex kCubeVertices[] = {
     {-1.0f, -1.0f, -1.0f, 0.96f, 0.36f, 0.31f},
@@ -77,37 +194,407 @@ constexpr uint16_t kPhotoFrameIndices[] = {
 
 constexpr char kShaderWGSL[] = R"(
 struct Uniforms {
-  mvp : mat4x4<f32>,
+  view_proj : mat4x4<f32>,
   tint : vec4<f32>,
 };
 
 @group(0) @binding(0)
 var<uniform> ubo : Uniforms;
+@group(0) @binding(1)
+var snapshot_base : texture_2d_array<f32>;
+@group(0) @binding(2)
+var snapshot_sampler : sampler;
+@group(0) @binding(3)
+var snapshot_detail : texture_2d_array<f32>;
 
 struct VSIn {
   @location(0) position : vec3<f32>,
   @location(1) color : vec3<f32>,
 };
 
+struct InstanceIn {
+  @location(2) model0 : vec4<f32>,
+  @location(3) model1 : vec4<f32>,
+  @location(4) model2 : vec4<f32>,
+  @location(5) model3 : vec4<f32>,
+  @location(6) tint : vec4<f32>,
+  @location(7) params : vec4<f32>,
+};
+
 struct VSOut {
   @builtin(position) pos : vec4<f32>,
   @location(0) color : vec3<f32>,
+  @location(1) uv : vec2<f32>,
+  @location(2) @interpolate(flat) layer : i32,
+  @location(3) @interpolate(flat) detail : i32,
+};
+
+@vertex
+fn vs_main(in : VSIn, inst : InstanceIn) -> VSOut {
+  let model = mat4x4<f32>(inst.model0, inst.model1, inst.model2, inst.model3);
+  var out : VSOut;
+  out.pos = ubo.view_proj * model * vec4<f32>(in.position, 1.0);
+  out.color = in.color * inst.tint.rgb * ubo.tint.rgb;
+  // Photo frame spans [-0.75, 0.75] x [-0.5, 0.5]; other meshes never sample.
+  out.uv = vec2<f32>(in.position.x / 1.5 + 0.5, 0.5 - in.position.y);
+  out.layer = i32(round(inst.params.x));
+  out.detail = i32(round(inst.params.y));
+  return out;
+}
+
+struct PackedVSIn {
+  @location(0) position : vec4<f32>,
+  @location(1) color : vec4<f32>,
+  @location(8) normal : vec4<f32>,
 };
 
+// Mirrors oct_decode_snorm8() in src/mesh.cpp.
+fn oct_decode(e : vec2<f32>) -> vec3<f32> {
+  var n = vec3<f32>(e, 1.0 - abs(e.x) - abs(e.y));
+  let t = max(-n.z, 0.0);
+  n.x += select(t, -t, n.x >= 0.0);
+  n.y += select(t, -t, n.y >= 0.0);
+  return normalize(n);
+}
+
+// Imported meshes: the instance transform already includes the mesh's
+// dequantization (bounds center and scale), and since those instances are
+// only translated and uniformly scaled, lighting uses the object-space normal.
 @vertex
-fn vs_main(in : VSIn) -> VSOut {
+fn vs_packed(in : PackedVSIn, inst : InstanceIn) -> VSOut {
+  let model = mat4x4<f32>(inst.model0, inst.model1, inst.model2, inst.model3);
+  let n = oct_decode(in.normal.xy);
+  let light = 0.35 + 0.65 * max(dot(n, normalize(vec3<f32>(0.4, 0.8, 0.45))), 0.0);
   var out : VSOut;
-  out.pos = ubo.mvp * vec4<f32>(in.position, 1.0);
-  out.color = in.color * ubo.tint.rgb;
+  out.pos = ubo.view_proj * model * vec4<f32>(in.position.xyz, 1.0);
+  out.color = in.color.rgb * light * inst.tint.rgb * ubo.tint.rgb;
+  out.uv = vec2<f32>(0.0);
+  out.layer = -1;
+  out.detail = -1;
   return out;
 }
 
 @fragment
 fn fs_main(in : VSOut) -> @location(0) vec4<f32> {
+  // Derivatives are taken in uniform control flow so the branches below can
+  // still pick a mip per pixel.
+  let ddx = dpdx(in.uv);
+  let ddy = dpdy(in.uv);
+  if (in.detail >= 0) {
+    let texel = textureSampleGrad(snapshot_detail, snapshot_sampler, in.uv, in.detail, ddx, ddy);
+    return vec4<f32>(texel.rgb * ubo.tint.rgb, 1.0);
+  }
+  if (in.layer >= 0) {
+    let texel = textureSampleGrad(snapshot_base, snapshot_sampler, in.uv, in.layer, ddx, ddy);
+    return vec4<f32>(texel.rgb * ubo.tint.rgb, 1.0);
+  }
   return vec4<f32>(in.color, 1.0);
 }
 )";
 
+// fs_capture downscales the swap chain image into a snapshot: the source is
+// center-cropped to the snapshot aspect and box-filtered with four bilinear
+// taps so high-resolution canvases do not alias. fs_downsample builds the
+// next mip level; one bilinear tap at a 2x ratio is already a 2x2 box.
+constexpr char kSnapshotBlitWGSL[] = R"(
+@group(0) @binding(0)
+var source : texture_2d<f32>;
+@group(0) @binding(1)
+var source_sampler : sampler;
+
+struct VSOut {
+  @builtin(position) pos : vec4<f32>,
+  @location(0) uv : vec2<f32>,
+};
+
+@vertex
+fn vs_main(@builtin(vertex_index) index : u32) -> VSOut {
+  let xy = vec2<f32>(f32((index << 1u) & 2u), f32(index & 2u)) * 2.0 - 1.0;
+  var out : VSOut;
+  out.pos = vec4<f32>(xy, 0.0, 1.0);
+  out.uv = vec2<f32>(xy.x * 0.5 + 0.5, 0.5 - xy.y * 0.5);
+  return out;
+}
+
+@fragment
+fn fs_capture(in : VSOut) -> @location(0) vec4<f32> {
+  let src_size = vec2<f32>(textureDimensions(source));
+  let dst_aspect = 1.5;
+  var crop = vec2<f32>(1.0, 1.0);
+  if (src_size.x / src_size.y > dst_aspect) {
+    crop.x = dst_aspect * src_size.y / src_size.x;
+  } else {
+    crop.y = src_size.x / (dst_aspect * src_size.y);
+  }
+  let uv = (in.uv - 0.5) * crop + 0.5;
+  // A quarter of one destination texel, in source uv.
+  let d = 0.25 * crop * vec2<f32>(dpdx(in.uv).x, dpdy(in.uv).y);
+  var c = textureSampleLevel(source, source_sampler, uv + vec2<f32>(-d.x, -d.y), 0.0);
+  c += textureSampleLevel(source, source_sampler, uv + vec2<f32>(d.x, -d.y), 0.0);
+  c += textureSampleLevel(source, source_sampler, uv + vec2<f32>(-d.x, d.y), 0.0);
+  c += textureSampleLevel(source, source_sampler, uv + vec2<f32>(d.x, d.y), 0.0);
+  return vec4<f32>(c.rgb * 0.25, 1.0);
+}
+
+@fragment
+fn fs_downsample(in : VSOut) -> @location(0) vec4<f32> {
+  return textureSampleLevel(source, source_sampler, in.uv, 0.0);
+}
+)";
+
+// Point-samples the scene depth buffer with the same crop as fs_capture so
+// color and depth texels line up. Depth stays nonlinear here; the CPU
+// linearizes it once the readback lands.
+constexpr char kSnapshotDepthWGSL[] = R"(
+@group(0) @binding(0)
+var depth_source : texture_depth_2d;
+
+struct VSOut {
+  @builtin(position) pos : vec4<f32>,
+  @location(0) uv : vec2<f32>,
+};
+
+@vertex
+fn vs_main(@builtin(vertex_index) index : u32) -> VSOut {
+  let xy = vec2<f32>(f32((index << 1u) & 2u), f32(index & 2u)) * 2.0 - 1.0;
+  var out : VSOut;
+  out.pos = vec4<f32>(xy, 0.0, 1.0);
+  out.uv = vec2<f32>(xy.x * 0.5 + 0.5, 0.5 - xy.y * 0.5);
+  return out;
+}
+
+@fragment
+fn fs_main(in : VSOut) -> @location(0) vec4<f32> {
+  let src_size = vec2<f32>(textureDimensions(depth_source));
+  let dst_aspect = 1.5;
+  var crop = vec2<f32>(1.0, 1.0);
+  if (src_size.x / src_size.y > dst_aspect) {
+    crop.x = dst_aspect * src_size.y / src_size.x;
+  } else {
+    crop.y = src_size.x / (dst_aspect * src_size.y);
+  }
+  let uv = (in.uv - 0.5) * crop + 0.5;
+  let texel = vec2<i32>(clamp(uv * src_size, vec2<f32>(0.0), src_size - 1.0));
+  return vec4<f32>(textureLoad(depth_source, texel, 0), 0.0, 0.0, 1.0);
+}
+)";
+
+// Two-phase photo culling. cs_cull_early draws, without an occlusion test,
+// the photos in the frustum that were visible last frame. The Hi-Z pyramid is
+// then built from that depth and cs_cull_late tests every photo in the
+// frustum against it: it records visibility for the next frame and appends
+// the visible photos the early pass skipped, so a newly disoccluded photo is
+// drawn the same frame instead of popping in one frame late.
+//
+// The frustum test, instance transform, tint and layer lookup mirror
+// photo_bounds(), frustum_test_aabb(), the trs-y compose kernel and
+// scene_prepare_instances.
+constexpr char kPhotoCullWGSL[] = R"(
+struct CullParams {
+  planes : array<vec4<f32>, 6>,
+  photo_count : u32,
+  column_stride : u32,
+  first_instance : u32,
+  count_word : u32,
+  layer_shot : array<u32, 48>,
+  layer_slot : array<i32, 48>,
+  view_proj : mat4x4<f32>,
+  occlusion : u32,
+  late_first_instance : u32,
+  late_count_word : u32,
+  late_capacity : u32,
+};
+
+struct Instance {
+  model : mat4x4<f32>,
+  tint : vec4<f32>,
+  params : vec4<f32>,
+};
+
+@group(0) @binding(0) var<storage, read> cull : CullParams;
+@group(0) @binding(1) var<storage, read> photos : array<f32>;
+@group(0) @binding(2) var<storage, read_write> instances : array<Instance>;
+@group(0) @binding(3) var<storage, read_write> draw_args : array<atomic<u32>>;
+@group(0) @binding(4) var<storage, read_write> visible_last : array<u32>;
+@group(0) @binding(5) var<storage, read_write> occluded : atomic<u32>;
+@group(1) @binding(0) var hiz : texture_2d<f32>;
+
+struct Photo {
+  pos : vec3<f32>,
+  c : f32,
+  s : f32,
+  scale : f32,
+  shot_id : u32,
+  extent : vec3<f32>,
+};
+
+fn load_photo(i : u32) -> Photo {
+  let stride = cull.column_stride;
+  var p : Photo;
+  p.pos = vec3<f32>(photos[i], photos[stride + i], photos[2u * stride + i]);
+  let yaw = photos[3u * stride + i];
+  p.c = cos(yaw);
+  p.s = sin(yaw);
+  p.scale = photos[4u * stride + i];
+  p.shot_id = bitcast<u32>(photos[5u * stride + i]);
+  p.extent = vec3<f32>(abs(p.c) * 0.75 * p.scale, 0.5 * p.scale, abs(p.s) * 0.75 * p.scale);
+  return p;
+}
+
+fn in_frustum(p : Photo) -> bool {
+  for (var k = 0u; k < 6u; k = k + 1u) {
+    // Distance of the box corner furthest along the plane normal.
+    let plane = cull.planes[k];
+    if (dot(plane.xyz, p.pos) + dot(abs(plane.xyz), p.extent) + plane.w < 0.0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+fn write_instance(p : Photo, index : u32) {
+  var layer = -1;
+  var detail = -1;
+  if (p.shot_id != 0u) {
+    let l = (p.shot_id - 1u) % 48u;
+    if (cull.layer_shot[l] == p.shot_id) {
+      layer = i32(l);
+      detail = cull.layer_slot[l];
+    }
+  }
+  let t = f32(p.shot_id) * 0.37;
+  var inst : Instance;
+  inst.model = mat4x4<f32>(vec4<f32>(p.c * p.scale, 0.0, -p.s * p.scale, 0.0),
+                           vec4<f32>(0.0, p.scale, 0.0, 0.0),
+                           vec4<f32>(p.s, 0.0, p.c, 0.0),
+                           vec4<f32>(p.pos, 1.0));
+  inst.tint = vec4<f32>(0.55 + 0.45 * sin(vec3<f32>(t, t + 2.1, t + 4.2)), 1.0);
+  inst.params = vec4<f32>(f32(layer), f32(detail), 0.0, 0.0);
+  instances[index] = inst;
+}
+
+// Conservative: the box's nearest depth against the farthest depth of the
+// pyramid texels under its screen rectangle, at the level where that
+// rectangle spans at most two texels per axis.
+fn passes_hiz(p : Photo) -> bool {
+  var ndc_min = vec3<f32>(1.0e9);
+  var ndc_max = vec3<f32>(-1.0e9);
+  for (var k = 0u; k < 8u; k = k + 1u) {
+    let corner_sign = vec3<f32>(select(-1.0, 1.0, (k & 1u) != 0u),
+                                select(-1.0, 1.0, (k & 2u) != 0u),
+                                select(-1.0, 1.0, (k & 4u) != 0u));
+    let clip = cull.view_proj * vec4<f32>(p.pos + p.extent * corner_sign, 1.0);
+    if (clip.w <= 1.0e-4) {
+      return true;  // reaches behind the camera
+    }
+    let ndc = clip.xyz / clip.w;
+    ndc_min = min(ndc_min, ndc);
+    ndc_max = max(ndc_max, ndc);
+  }
+  let size = vec2<f32>(textureDimensions(hiz, 0));
+  // NDC y points up, texel rows go down.
+  let px_min = clamp(vec2<f32>(ndc_min.x, -ndc_max.y) * 0.5 + 0.5, vec2<f32>(0.0), vec2<f32>(1.0)) * size;
+  let px_max = clamp(vec2<f32>(ndc_max.x, -ndc_min.y) * 0.5 + 0.5, vec2<f32>(0.0), vec2<f32>(1.0)) * size;
+  let span = max(px_max.x - px_min.x, px_max.y - px_min.y);
+  let level = min(u32(ceil(log2(max(span, 1.0)))), textureNumLevels(hiz) - 1u);
+  let last = vec2<u32>(textureDimensions(hiz, level)) - 1u;
+  let t0 = min(vec2<u32>(px_min) >> vec2<u32>(level), last);
+  let t1 = min(vec2<u32>(px_max) >> vec2<u32>(level), last);
+  let depth = max(max(textureLoad(hiz, t0, level).r, textureLoad(hiz, vec2<u32>(t1.x, t0.y), level).r),
+                  max(textureLoad(hiz, vec2<u32>(t0.x, t1.y), level).r, textureLoad(hiz, t1, level).r));
+  return ndc_min.z <= depth;
+}
+
+@compute @workgroup_size(64)
+fn cs_cull_early(@builtin(global_invocation_id) id : vec3<u32>) {
+  let i = id.x;
+  if (i >= cull.photo_count) {
+    return;
+  }
+  let p = load_photo(i);
+  if (!in_frustum(p)) {
+    visible_last[i] = 0u;
+    return;
+  }
+  if (cull.occlusion != 0u && visible_last[i] == 0u) {
+    return;
+  }
+  let slot = atomicAdd(&draw_args[cull.count_word], 1u);
+  write_instance(p, cull.first_instance + slot);
+}
+
+@compute @workgroup_size(64)
+fn cs_cull_late(@builtin(global_invocation_id) id : vec3<u32>) {
+  let i = id.x;
+  if (i >= cull.photo_count) {
+    return;
+  }
+  let p = load_photo(i);
+  if (!in_frustum(p)) {
+    return;
+  }
+  let drawn = visible_last[i] != 0u;
+  if (!passes_hiz(p)) {
+    visible_last[i] = 0u;
+    atomicAdd(&occluded, 1u);
+    return;
+  }
+  visible_last[i] = 1u;
+  if (drawn) {
+    return;
+  }
+  let slot = atomicAdd(&draw_args[cull.late_count_word], 1u);
+  if (slot >= cull.late_capacity) {
+    // Out of room: the photo is drawn early from next frame on.
+    atomicSub(&draw_args[cull.late_count_word], 1u);
+    return;
+  }
+  write_instance(p, cull.late_first_instance + slot);
+}
+)";
+
+// Hi-Z pyramid: level 0 is a copy of the depth buffer, every further level
+// keeps the farthest depth of the texels it covers.
+constexpr char kHizCopyWGSL[] = R"(
+@group(0) @binding(0) var depth_source : texture_depth_2d;
+@group(0) @binding(1) var dst : texture_storage_2d<r32float, write>;
+
+@compute @workgroup_size(8, 8)
+fn cs_main(@builtin(global_invocation_id) id : vec3<u32>) {
+  let size = textureDimensions(dst);
+  if (id.x >= size.x || id.y >= size.y) {
+    return;
+  }
+  textureStore(dst, id.xy, vec4<f32>(textureLoad(depth_source, id.xy, 0), 0.0, 0.0, 0.0));
+}
+)";
+
+constexpr char kHizReduceWGSL[] = R"(
+@group(0) @binding(0) var src : texture_2d<f32>;
+@group(0) @binding(1) var dst : texture_storage_2d<r32float, write>;
+
+@compute @workgroup_size(8, 8)
+fn cs_main(@builtin(global_invocation_id) id : vec3<u32>) {
+  let size = textureDimensions(dst);
+  if (id.x >= size.x || id.y >= size.y) {
+    return;
+  }
+  let src_last = textureDimensions(src, 0) - 1u;
+  let first = id.xy * 2u;
+  // The last texel of a level also covers an odd source row or column.
+  let last = select(min(first + 1u, src_last), src_last, id.xy == size - 1u);
+  var depth = 0.0;
+  for (var y = first.y; y <= last.y; y = y + 1u) {
+    for (var x = first.x; x <= last.x; x = x + 1u) {
+      depth = max(depth, textureLoad(src, vec2<u32>(x, y), 0).r);
+    }
+  }
+  textureStore(dst, id.xy, vec4<f32>(depth, 0.0, 0.0, 0.0));
+}
+)";
+static_assert(kSnapshotLayers == 48, "kPhotoCullWGSL sizes its layer tables for 48 snapshot layers");
+static_assert(sizeof(GpuCullParams) == 576, "GpuCullParams layout is shared with kPhotoCullWGSL");
+
 WGPUInstance g_instance = nullptr;
 WGPUDevice g_device = nullptr;
 WGPUQueue g_queue = nullptr;
@@ -116,42 +603,224 @@ WGPUSurface g_surface = nullptr;
 WGPUTextureFormat g_surface_format = WGPUTextureFormat_BGRA8Unorm;
 WGPUSurfaceConfiguration g_surface_config = WGPU_SURFACE_CONFIGURATION_INIT;
 
-WGPUBuffer g_cube_vertex_buffer = nullptr;
-WGPUBuffer g_cube_index_buffer = nullptr;
-WGPUBuffer g_photo_vertex_buffer = nullptr;
-WGPUBuffer g_photo_index_buffer = nullptr;
+// Byte ranges of one static mesh inside g_mesh_buffer.
+struct MeshRange {
+  uint64_t vertex_offset;
+  uint64_t vertex_size;
+  uint64_t index_offset;
+  uint64_t index_size;
+  uint32_t index_count;
+};
+
+WGPUBuffer g_mesh_buffer = nullptr;  // every static mesh, vertices then indices
+MeshRange g_cube_mesh{};
+MeshRange g_photo_mesh{};
 WGPUBuffer g_uniform_buffer = nullptr;
+WGPUBuffer g_instance_buffer = nullptr;
+WGPUBuffer g_indirect_buffer = nullptr;
+WGPURenderBundle g_static_bundles[kUniformFrameCount] = {};
+bool g_bundles_enabled = true;
+bool g_bundles_dirty = true;
+BundleStats g_bundle_stats{};
+WGPUComputePipeline g_cull_pipeline = nullptr;
+WGPUBindGroupLayout g_cull_bind_group_layout = nullptr;
+WGPUBindGroup g_cull_bind_group = nullptr;
+WGPUBuffer g_cull_params_buffer = nullptr;
+WGPUBuffer g_cull_photo_buffer = nullptr;  // kGpuCullColumns columns of kMaxPlacedPhotos
+uint32_t g_cull_photo_version = UINT32_MAX;  // scene version the columns were uploaded at
+GpuCullReadback g_cull_readbacks[kGpuCullReadbackSlots]{};
+bool g_gpu_culling_enabled = true;
+bool g_gpu_culling_active = false;
+int g_gpu_visible_count = 0;
+int g_gpu_occluded_count = 0;
+
+WGPUComputePipeline g_cull_late_pipeline = nullptr;
+WGPUBindGroupLayout g_cull_hiz_layout = nullptr;  // group 1 of cs_cull_late
+WGPUBindGroup g_cull_hiz_group = nullptr;
+WGPUBuffer g_cull_visibility_buffer = nullptr;  // one u32 per dense photo index
+WGPUBuffer g_cull_occluded_buffer = nullptr;
+bool g_occlusion_culling_enabled = true;
+WGPUComputePipeline g_hiz_copy_pipeline = nullptr;
+WGPUComputePipeline g_hiz_reduce_pipeline = nullptr;
+WGPUBindGroupLayout g_hiz_copy_layout = nullptr;
+WGPUBindGroupLayout g_hiz_reduce_layout = nullptr;
+// Sized like the depth buffer, which is recreated on every canvas resize;
+// the pyramid follows lazily when its size no longer matches.
+int g_hiz_width = 0;
+int g_hiz_height = 0;
+WGPUTexture g_hiz_texture = nullptr;
+WGPUTextureView g_hiz_view = nullptr;
+std::vector<WGPUTextureView> g_hiz_mip_views;
+std::vector<WGPUBindGroup> g_hiz_build_groups;  // one per level, writing it
 WGPUBindGroupLayout g_bind_group_layout = nullptr;
 WGPUBindGroup g_bind_group = nullptr;
 WGPUPipelineLayout g_pipeline_layout = nullptr;
 WGPURenderPipeline g_pipeline = nullptr;
+WGPURenderPipeline g_packed_pipeline = nullptr;
+// The whole mesh blob, uploaded unchanged; vertices and indices are bound at
+// their section offsets. vertex_count is 0 until a mesh is loaded.
+WGPUBuffer g_imported_mesh_buffer = nullptr;
+MeshFileHeader g_imported_mesh{};
 WGPUTexture g_depth_texture = nullptr;
 WGPUTextureView g_depth_view = nullptr;
+// Below full scale the scene renders here and g_upscale_pipeline stretches it
+// over the swap chain; at full scale it is null and the scene renders
+// straight into the swap chain.
+WGPUTexture g_scene_color_texture = nullptr;
+WGPUTextureView g_scene_color_view = nullptr;
+WGPURenderPipeline g_upscale_pipeline = nullptr;
+
+WGPUTexture g_snapshot_capture_texture = nullptr;
+WGPUTextureView g_snapshot_capture_view = nullptr;
+WGPUTexture g_snapshot_base_texture = nullptr;
+WGPUTextureView g_snapshot_base_view = nullptr;
+WGPUTexture g_snapshot_detail_texture = nullptr;
+WGPUTextureView g_snapshot_detail_view = nullptr;
+WGPUSampler g_snapshot_sampler = nullptr;
+WGPUBindGroupLayout g_blit_bind_group_layout = nullptr;
+WGPURenderPipeline g_blit_capture_pipeline = nullptr;
+WGPURenderPipeline g_blit_downsample_pipeline = nullptr;
+WGPUTexture g_snapshot_depth_texture = nullptr;
+WGPUTextureView g_snapshot_depth_view = nullptr;
+WGPUBindGroupLayout g_depth_blit_bind_group_layout = nullptr;
+WGPURenderPipeline g_depth_blit_pipeline = nullptr;
+std::vector<WGPUBuffer> g_readback_color_buffers;
+std::vector<WGPUBuffer> g_readback_depth_buffers;
 
 int g_canvas_width = 1280;
 int g_canvas_height = 720;
+// Size of the depth and scene color targets: the canvas times the dynamic
+// resolution scale.
+int g_render_width = 0;
+int g_render_height = 0;
+ResolutionScaler g_resolution{};
+bool g_dynamic_resolution_enabled = true;
+// Newest GPU main-pass time not yet fed to g_resolution; each sample is used
+// once. Without timestamp queries the CPU time of the frame is fed instead.
+float g_gpu_pass_ms = -1.0f;
+float g_last_frame_cpu_ms = -1.0f;
 
 double g_last_time_ms = 0.0;
 float g_accum_time = 0.0f;
 
-Vec3 g_camera_pos{0.0f, 1.2f, 4.0f};
-float g_camera_yaw = -1.5707963f;
-float g_camera_pitch = 0.0f;
+// Render on demand: frame() draws only when something marked it dirty since
+// the last drawn frame, and otherwise returns before any matrix, encoding or
+// swap chain work. The cube's idle spin does not count; its clock only
+// advances on frames that are drawn.
+constexpr uint32_t kDirtyCamera = 1u << 0;
+constexpr uint32_t kDirtySurface = 1u << 1;
+constexpr uint32_t kDirtyScene = 1u << 2;     // placement, bundles, imported mesh
+constexpr uint32_t kDirtyTextures = 1u << 3;  // captures, restores, detail streaming
+constexpr uint32_t kDirtySimulation = 1u << 4;
+constexpr uint32_t kDirtyRequested = 1u << 5;
+uint32_t g_dirty = ~0u;
+bool g_render_on_demand = true;
+uint32_t g_drawn_scene_version = UINT32_MAX;
+bool g_residency_streaming = false;  // the last drawn frame uploaded detail layers
+uint32_t g_skipped_frames = 0;
 
-bool g_key_w = false;
-bool g_key_a = false;
-bool g_key_s = false;
-bool g_key_d = false;
-bool g_key_shift = false;
+FlyCamera g_camera{};
+PhotoHandle g_selected_photo = kInvalidPhotoHandle;
+double g_last_pick_us = 0.0;
 
 uint32_t g_photo_capture_count = 0;
 PhotoSnapshot g_last_snapshot{};
 bool g_has_snapshot = false;
-PlacedPhoto g_placed_photos[kMaxPlacedPhotos]{};
+SnapshotLayerTable g_snapshot_layers{};
+struct PendingCapture {
+  int layer;
+  PhotoSnapshot info;
+};
+
+std::vector<PendingCapture> g_pending_captures;
+std::vector<int> g_frame_capture_slots;
+double g_last_capture_ms = 0.0;
+double g_last_readback_ms = 0.0;
+SnapshotResidency g_residency{};
+ReadbackRing g_readback_ring{};
+std::vector<SnapshotPayload> g_snapshot_payloads;
+SnapshotCodecWorker g_codec_worker{};
+std::vector<SnapshotCodecJob> g_codec_finished;
+std::vector<std::vector<uint8_t>> g_snapshot_blobs;
+std::vector<uint32_t> g_snapshot_blob_shot;
+double g_last_encode_ms = 0.0;
+// Layers whose payload came from a loaded scene and still need their base
+// tier rebuilt on the GPU; one per frame since they share the capture texture.
+std::vector<int> g_pending_restores;
+std::vector<uint8_t> g_scene_file_bytes;
+SceneGenParams g_generate_params{};
+
+constexpr int kGpuTimingSlots = 4;
+constexpr int kProfileSummaryFrames = 300;
+
+struct GpuTimingSlot {
+  WGPUBuffer buffer;
+  uint64_t frame;
+  bool busy;
+};
+
+// Cores left over after the render thread, the codec worker and (in worker
+// render mode) the page's own thread go to jobs.
+#if defined(FRAMESPACE_WORKER_RENDER)
+constexpr int kReservedThreads = 3;
+#else
+constexpr int kReservedThreads = 2;
+#endif
+
+JobSystem g_jobs;
+PhysicsWorld g_physics;
+InputQueue g_input_queue;
+InputEvent g_input_events[kInputQueueCapacity];
+PageStats g_page_stats;
+
+Profiler g_profiler;
+bool g_timestamps_supported = false;
+WGPUQuerySet g_timestamp_query_set = nullptr;
+WGPUBuffer g_timestamp_resolve_buffer = nullptr;
+GpuTimingSlot g_gpu_timing_slots[kGpuTimingSlots]{};
+std::vector<ProfileSample> g_profile_samples;
+std::string g_profile_trace;
+std::vector<uint8_t> g_scene_load_bytes;
+std::vector<uint8_t> g_mesh_load_bytes;
+
+// Input recording and replay (see src/input_trace.h). While a replay runs,
+// frames advance by its fixed step and live input is ignored.
+constexpr uint64_t kReplaySampleLag = 8;  // frames for GPU timings to land
+InputTrace g_trace{};
+bool g_trace_recording = false;
+uint64_t g_trace_start_frame = 0;
+double g_trace_start_ms = 0.0;
+std::vector<uint8_t> g_trace_file_bytes;  // the last finished recording
+std::vector<uint8_t> g_replay_load_bytes;
+InputTrace g_replay_trace{};
+InputReplay g_replay{};
+bool g_replay_active = false;
+int64_t g_replay_shot_offset = 0;
+InputTracePhotos g_trace_photos{};  // ids of the recording or replay in progress
+uint64_t g_replay_next_sample = 0;
+std::vector<InputEvent> g_replay_events;
+std::vector<ProfileSample> g_replay_samples;
+PhotoScene g_scene{};
+std::vector<InstanceData> g_instance_data;
+
+alignas(16) uint8_t g_uniform_staging[kUniformFrameBytes]{};
+uint32_t g_uniform_draw_count = 0;
+uint64_t g_frame_index = 0;
+UploadStats g_upload_stats{};
+UploadStats g_last_upload_stats{};
 
 Mat4 g_last_vp{};
+float g_last_proj_y_scale = 1.0f;
 
 bool g_initialized = false;
+// Pipelines still compiling. Until they are all in, frame() only clears the
+// surface. A render pipeline that fails to compile keeps it that way; every
+// compute pipeline belongs to GPU photo culling, so a failed one only sends
+// culling back to the CPU.
+int g_pipelines_pending = 0;
+int g_render_pipelines_failed = 0;
+bool g_gpu_culling_failed = false;
+StartupTimeline g_startup{};
 
 WGPUStringView make_str_view(const char* s) {
   WGPUStringView v = WGPU_STRING_VIEW_INIT;
@@ -160,16 +829,42 @@ WGPUStringView make_str_view(const char* s) {
   return v;
 }
 
-Vec3 camera_forward() {
-  const float cp = std::cos(g_camera_pitch);
-  return vec3_normalize({
-      std::cos(g_camera_yaw) * cp,
-      std::sin(g_camera_pitch),
-      std::sin(g_camera_yaw) * cp,
-  });
-}
+// Depth at the render size, plus the scene color target when that is smaller
+// than the canvas. Depth is only replaced when its size changes, so the Hi-Z
+// pyramid (rebuilt on a size mismatch) never keeps sampling a released one.
+void create_render_targets() {
+  int width = 0;
+  int height = 0;
+  resolution_target_size(g_resolution, g_canvas_width, g_canvas_height, &width, &height);
+  const bool offscreen = width != g_canvas_width || height != g_canvas_height;
+  const bool resized = !g_depth_texture || width != g_render_width || height != g_render_height;
+  g_render_width = width;
+  g_render_height = height;
+
+  if (g_scene_color_texture && (resized || !offscreen)) {
+    wgpuTextureViewRelease(g_scene_color_view);
+    wgpuTextureRelease(g_scene_color_texture);
+    g_scene_color_view = nullptr;
+    g_scene_color_texture = nullptr;
+  }
+  if (offscreen && !g_scene_color_texture) {
+    WGPUTextureDescriptor color_desc = WGPU_TEXTURE_DESCRIPTOR_INIT;
+    color_desc.label = make_str_view("scene_color_texture");
+    color_desc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding;
+    color_desc.dimension = WGPUTextureDimension_2D;
+    color_desc.size.width = static_cast<uint32_t>(width);
+    color_desc.size.height = static_cast<uint32_t>(height);
+    color_desc.size.depthOrArrayLayers = 1;
+    color_desc.format = g_surface_format;
+    color_desc.mipLevelCount = 1;
+    color_desc.sampleCount = 1;
+    g_scene_color_texture = wgpuDeviceCreateTexture(g_device, &color_desc);
+    g_scene_color_view = wgpuTextureCreateView(g_scene_color_texture, nullptr);
+  }
+  if (!resized) {
+    return;
+  }
 
-void create_depth_buffer() {
   if (g_depth_view) {
     wgpuTextureViewRelease(g_depth_view);
     g_depth_view = nullptr;
@@ -181,12 +876,12 @@ void create_depth_buffer() {
 
   WGPUTextureDescriptor depth_desc = WGPU_TEXTURE_DESCRIPTOR_INIT;
   depth_desc.label = make_str_view("depth_texture");
-  depth_desc.usage = WGPUTextureUsage_RenderAttachment;
+  depth_desc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding;
   depth_desc.dimension = WGPUTextureDimension_2D;
-  depth_desc.size.width = static_cast<uint32_t>(g_canvas_width);
-  depth_desc.size.height = static_cast<uint32_t>(g_canvas_height);
+  depth_desc.size.width = static_cast<uint32_t>(width);
+  depth_desc.size.height = static_cast<uint32_t>(height);
   depth_desc.size.depthOrArrayLayers = 1;
-  depth_desc.format = WGPUTextureFormat_Depth24Plus;
+  depth_desc.format = kDepthFormat;
   depth_desc.mipLevelCount = 1;
   depth_desc.sampleCount = 1;
 
@@ -211,7 +906,8 @@ void recreate_surface_if_needed() {
   g_surface_config.width = static_cast<uint32_t>(g_canvas_width);
   g_surface_config.height = static_cast<uint32_t>(g_canvas_height);
   wgpuSurfaceConfigure(g_surface, &g_surface_config);
-  create_depth_buffer();
+  create_render_targets();
+  g_dirty |= kDirtySurface;
 }
 
 WGPUTextureFormat choose_surface_format(WGPUSurface surface, WGPUAdapter adapter) {
@@ -232,98 +928,244 @@ WGPUTextureFormat choose_surface_format(WGPUSurface surface, WGPUAdapter adapter
   return chosen;
 }
 
-void create_pipeline_resources() {
-  WGPUBufferDescriptor vb_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
-  vb_desc.label = make_str_view("cube_vertex_buffer");
-  vb_desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst;
-  vb_desc.size = sizeof(kCubeVertices);
-  g_cube_vertex_buffer = wgpuDeviceCreateBuffer(g_device, &vb_desc);
-  wgpuQueueWriteBuffer(g_queue, g_cube_vertex_buffer, 0, kCubeVertices, sizeof(kCubeVertices));
-
-  WGPUBufferDescriptor ib_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
-  ib_desc.label = make_str_view("cube_index_buffer");
-  ib_desc.usage = WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst;
-  ib_desc.size = sizeof(kCubeIndices);
-  g_cube_index_buffer = wgpuDeviceCreateBuffer(g_device, &ib_desc);
-  wgpuQueueWriteBuffer(g_queue, g_cube_index_buffer, 0, kCubeIndices, sizeof(kCubeIndices));
-
-  WGPUBufferDescriptor pvb_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
-  pvb_desc.label = make_str_view("photo_vertex_buffer");
-  pvb_desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst;
-  pvb_desc.size = sizeof(kPhotoFrameVertices);
-  g_photo_vertex_buffer = wgpuDeviceCreateBuffer(g_device, &pvb_desc);
-  wgpuQueueWriteBuffer(g_queue, g_photo_vertex_buffer, 0, kPhotoFrameVertices, sizeof(kPhotoFrameVertices));
-
-  WGPUBufferDescriptor pib_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
-  pib_desc.label = make_str_view("photo_index_buffer");
-  pib_desc.usage = WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst;
-  pib_desc.size = sizeof(kPhotoFrameIndices);
-  g_photo_index_buffer = wgpuDeviceCreateBuffer(g_device, &pib_desc);
-  wgpuQueueWriteBuffer(g_queue, g_photo_index_buffer, 0, kPhotoFrameIndices, sizeof(kPhotoFrameIndices));
+WGPUTexture create_snapshot_array(const char* label,
+                                  uint32_t width,
+                                  uint32_t height,
+                                  uint32_t layers,
+                                  WGPUTextureUsage usage,
+                                  WGPUTextureView* out_view) {
+  const uint32_t mips = static_cast<uint32_t>(mip_count_for(width, height));
 
-  WGPUBufferDescriptor ub_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
-  ub_desc.label = make_str_view("camera_uniform_buffer");
-  ub_desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
-  ub_desc.size = sizeof(Uniforms);
-  g_uniform_buffer = wgpuDeviceCreateBuffer(g_device, &ub_desc);
+  WGPUTextureDescriptor desc = WGPU_TEXTURE_DESCRIPTOR_INIT;
+  desc.label = make_str_view(label);
+  desc.usage = usage;
+  desc.dimension = WGPUTextureDimension_2D;
+  desc.size.width = width;
+  desc.size.height = height;
+  desc.size.depthOrArrayLayers = layers;
+  desc.format = kSnapshotFormat;
+  desc.mipLevelCount = mips;
+  desc.sampleCount = 1;
+  WGPUTexture texture = wgpuDeviceCreateTexture(g_device, &desc);
 
-  WGPUBindGroupLayoutEntry bgl_entry = WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT;
-  bgl_entry.binding = 0;
-  bgl_entry.visibility = WGPUShaderStage_Vertex;
-  bgl_entry.buffer = WGPU_BUFFER_BINDING_LAYOUT_INIT;
-  bgl_entry.buffer.type = WGPUBufferBindingType_Uniform;
-  bgl_entry.buffer.minBindingSize = sizeof(Uniforms);
+  WGPUTextureViewDescriptor view_desc = WGPU_TEXTURE_VIEW_DESCRIPTOR_INIT;
+  view_desc.format = kSnapshotFormat;
+  view_desc.dimension = WGPUTextureViewDimension_2DArray;
+  view_desc.baseMipLevel = 0;
+  view_desc.mipLevelCount = mips;
+  view_desc.baseArrayLayer = 0;
+  view_desc.arrayLayerCount = layers;
+  *out_view = wgpuTextureCreateView(texture, &view_desc);
+  return texture;
+}
 
-  WGPUBindGroupLayoutDescriptor bgl_desc = WGPU_BIND_GROUP_LAYOUT_DESCRIPTOR_INIT;
-  bgl_desc.label = make_str_view("camera_bgl");
-  bgl_desc.entryCount = 1;
-  bgl_desc.entries = &bgl_entry;
-  g_bind_group_layout = wgpuDeviceCreateBindGroupLayout(g_device, &bgl_desc);
+// The detail pool is sized by the residency budget; a zero-slot budget still
+// allocates one layer so the bind group stays valid.
+void create_snapshot_detail_pool() {
+  if (g_snapshot_detail_view) {
+    wgpuTextureViewRelease(g_snapshot_detail_view);
+    g_snapshot_detail_view = nullptr;
+  }
+  if (g_snapshot_detail_texture) {
+    wgpuTextureDestroy(g_snapshot_detail_texture);
+    wgpuTextureRelease(g_snapshot_detail_texture);
+    g_snapshot_detail_texture = nullptr;
+  }
+  const uint32_t layers = static_cast<uint32_t>(g_residency.slot_count > 0 ? g_residency.slot_count : 1);
+  g_snapshot_detail_texture = create_snapshot_array("snapshot_detail_pool",
+                                                    kSnapshotWidth,
+                                                    kSnapshotHeight,
+                                                    layers,
+                                                    WGPUTextureUsage_TextureBinding |
+                                                        WGPUTextureUsage_RenderAttachment |
+                                                        WGPUTextureUsage_CopyDst,
+                                                    &g_snapshot_detail_view);
+}
 
-  WGPUPipelineLayoutDescriptor pl_desc = WGPU_PIPELINE_LAYOUT_DESCRIPTOR_INIT;
-  pl_desc.label = make_str_view("main_pipeline_layout");
-  pl_desc.bindGroupLayoutCount = 1;
-  pl_desc.bindGroupLayouts = &g_bind_group_layout;
-  g_pipeline_layout = wgpuDeviceCreatePipelineLayout(g_device, &pl_desc);
+void create_main_bind_group() {
+  if (g_bind_group) {
+    wgpuBindGroupRelease(g_bind_group);
+    g_bind_group = nullptr;
+  }
 
-  WGPUBindGroupEntry bg_entry = WGPU_BIND_GROUP_ENTRY_INIT;
-  bg_entry.binding = 0;
-  bg_entry.buffer = g_uniform_buffer;
-  bg_entry.offset = 0;
-  bg_entry.size = sizeof(Uniforms);
+  WGPUBindGroupEntry bg_entries[4] = {
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+  };
+  bg_entries[0].binding = 0;
+  bg_entries[0].buffer = g_uniform_buffer;
+  bg_entries[0].offset = 0;
+  bg_entries[0].size = sizeof(Uniforms);
+  bg_entries[1].binding = 1;
+  bg_entries[1].textureView = g_snapshot_base_view;
+  bg_entries[2].binding = 2;
+  bg_entries[2].sampler = g_snapshot_sampler;
+  bg_entries[3].binding = 3;
+  bg_entries[3].textureView = g_snapshot_detail_view;
 
   WGPUBindGroupDescriptor bg_desc = WGPU_BIND_GROUP_DESCRIPTOR_INIT;
   bg_desc.label = make_str_view("camera_bg");
   bg_desc.layout = g_bind_group_layout;
-  bg_desc.entryCount = 1;
-  bg_desc.entries = &bg_entry;
+  bg_desc.entryCount = 4;
+  bg_desc.entries = bg_entries;
   g_bind_group = wgpuDeviceCreateBindGroup(g_device, &bg_desc);
+  g_bundles_dirty = true;
+}
+
+void finish_pipeline_request() {
+  g_pipelines_pending -= 1;
+  if (g_pipelines_pending == 0) {
+    startup_mark(g_startup, StartupMark::PipelinesReady, emscripten_get_now());
+  }
+}
+
+void on_pipeline_created(WGPUCreatePipelineAsyncStatus status,
+                         WGPURenderPipeline pipeline,
+                         WGPUStringView message,
+                         void* userdata1,
+                         void*) {
+  if (status != WGPUCreatePipelineAsyncStatus_Success || pipeline == nullptr) {
+    // The pipeline stays null and frame() keeps presenting clear frames.
+    std::fprintf(stderr, "Failed to create render pipeline: %s\n", message.data ? message.data : "");
+    g_render_pipelines_failed += 1;
+  } else {
+    *static_cast<WGPURenderPipeline*>(userdata1) = pipeline;
+  }
+  finish_pipeline_request();
+}
+
+// Compiles off the calling thread; `target` is filled in by the callback.
+void create_render_pipeline_async(const WGPURenderPipelineDescriptor& desc, WGPURenderPipeline* target) {
+  WGPUCreateRenderPipelineAsyncCallbackInfo cb = WGPU_CREATE_RENDER_PIPELINE_ASYNC_CALLBACK_INFO_INIT;
+  cb.mode = WGPUCallbackMode_AllowSpontaneous;
+  cb.callback = on_pipeline_created;
+  cb.userdata1 = target;
+  g_pipelines_pending += 1;
+  wgpuDeviceCreateRenderPipelineAsync(g_device, &desc, cb);
+}
+
+void on_compute_pipeline_created(WGPUCreatePipelineAsyncStatus status,
+                                 WGPUComputePipeline pipeline,
+                                 WGPUStringView message,
+                                 void* userdata1,
+                                 void*) {
+  if (status != WGPUCreatePipelineAsyncStatus_Success || pipeline == nullptr) {
+    std::fprintf(stderr, "Failed to create compute pipeline: %s; culling photos on the CPU\n",
+                 message.data ? message.data : "");
+    g_gpu_culling_failed = true;
+  } else {
+    *static_cast<WGPUComputePipeline*>(userdata1) = pipeline;
+  }
+  finish_pipeline_request();
+}
+
+void create_compute_pipeline_async(const WGPUComputePipelineDescriptor& desc, WGPUComputePipeline* target) {
+  WGPUCreateComputePipelineAsyncCallbackInfo cb = WGPU_CREATE_COMPUTE_PIPELINE_ASYNC_CALLBACK_INFO_INIT;
+  cb.mode = WGPUCallbackMode_AllowSpontaneous;
+  cb.callback = on_compute_pipeline_created;
+  cb.userdata1 = target;
+  g_pipelines_pending += 1;
+  wgpuDeviceCreateComputePipelineAsync(g_device, &desc, cb);
+}
+
+void create_snapshot_blit_pipeline() {
+  WGPUBindGroupLayoutEntry entries[2] = {WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT, WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT};
+  entries[0].binding = 0;
+  entries[0].visibility = WGPUShaderStage_Fragment;
+  entries[0].texture = WGPU_TEXTURE_BINDING_LAYOUT_INIT;
+  entries[0].texture.sampleType = WGPUTextureSampleType_Float;
+  entries[0].texture.viewDimension = WGPUTextureViewDimension_2D;
+  entries[1].binding = 1;
+  entries[1].visibility = WGPUShaderStage_Fragment;
+  entries[1].sampler = WGPU_SAMPLER_BINDING_LAYOUT_INIT;
+  entries[1].sampler.type = WGPUSamplerBindingType_Filtering;
+
+  WGPUBindGroupLayoutDescriptor bgl_desc = WGPU_BIND_GROUP_LAYOUT_DESCRIPTOR_INIT;
+  bgl_desc.label = make_str_view("snapshot_blit_bgl");
+  bgl_desc.entryCount = 2;
+  bgl_desc.entries = entries;
+  g_blit_bind_group_layout = wgpuDeviceCreateBindGroupLayout(g_device, &bgl_desc);
+
+  WGPUPipelineLayoutDescriptor pl_desc = WGPU_PIPELINE_LAYOUT_DESCRIPTOR_INIT;
+  pl_desc.label = make_str_view("snapshot_blit_layout");
+  pl_desc.bindGroupLayoutCount = 1;
+  pl_desc.bindGroupLayouts = &g_blit_bind_group_layout;
+  WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(g_device, &pl_desc);
 
   WGPUShaderSourceWGSL wgsl_desc = WGPU_SHADER_SOURCE_WGSL_INIT;
-  wgsl_desc.code = make_str_view(kShaderWGSL);
+  wgsl_desc.code = make_str_view(kSnapshotBlitWGSL);
 
   WGPUShaderModuleDescriptor shader_desc = WGPU_SHADER_MODULE_DESCRIPTOR_INIT;
-  shader_desc.label = make_str_view("main_shader");
+  shader_desc.label = make_str_view("snapshot_blit_shader");
   shader_desc.nextInChain = reinterpret_cast<WGPUChainedStruct*>(&wgsl_desc);
-
   WGPUShaderModule shader = wgpuDeviceCreateShaderModule(g_device, &shader_desc);
 
-  WGPUVertexAttribute attrs[2] = {WGPU_VERTEX_ATTRIBUTE_INIT, WGPU_VERTEX_ATTRIBUTE_INIT};
-  attrs[0].format = WGPUVertexFormat_Float32x3;
-  attrs[0].offset = 0;
-  attrs[0].shaderLocation = 0;
-  attrs[1].format = WGPUVertexFormat_Float32x3;
-  attrs[1].offset = 3 * sizeof(float);
-  attrs[1].shaderLocation = 1;
+  WGPUColorTargetState color_target = WGPU_COLOR_TARGET_STATE_INIT;
+  color_target.format = kSnapshotFormat;
+  color_target.writeMask = WGPUColorWriteMask_All;
 
-  WGPUVertexBufferLayout vbuf_layout = WGPU_VERTEX_BUFFER_LAYOUT_INIT;
-  vbuf_layout.arrayStride = sizeof(Vertex);
-  vbuf_layout.stepMode = WGPUVertexStepMode_Vertex;
-  vbuf_layout.attributeCount = 2;
-  vbuf_layout.attributes = attrs;
+  WGPUFragmentState frag_state = WGPU_FRAGMENT_STATE_INIT;
+  frag_state.module = shader;
+  frag_state.entryPoint = make_str_view("fs_capture");
+  frag_state.targetCount = 1;
+  frag_state.targets = &color_target;
 
-  WGPUColorTargetState color_target = WGPU_COLOR_TARGET_STATE_INIT;
+  WGPURenderPipelineDescriptor pipe_desc = WGPU_RENDER_PIPELINE_DESCRIPTOR_INIT;
+  pipe_desc.label = make_str_view("snapshot_capture_pipeline");
+  pipe_desc.layout = layout;
+  pipe_desc.vertex.module = shader;
+  pipe_desc.vertex.entryPoint = make_str_view("vs_main");
+  pipe_desc.primitive = WGPU_PRIMITIVE_STATE_INIT;
+  pipe_desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+  pipe_desc.multisample = WGPU_MULTISAMPLE_STATE_INIT;
+  pipe_desc.multisample.count = 1;
+  pipe_desc.fragment = &frag_state;
+  create_render_pipeline_async(pipe_desc, &g_blit_capture_pipeline);
+
+  frag_state.entryPoint = make_str_view("fs_downsample");
+  pipe_desc.label = make_str_view("snapshot_downsample_pipeline");
+  create_render_pipeline_async(pipe_desc, &g_blit_downsample_pipeline);
+
+  // The same bilinear fetch into the swap chain upscales the scene target.
   color_target.format = g_surface_format;
+  pipe_desc.label = make_str_view("present_upscale_pipeline");
+  create_render_pipeline_async(pipe_desc, &g_upscale_pipeline);
+  wgpuShaderModuleRelease(shader);
+  wgpuPipelineLayoutRelease(layout);
+}
+
+void create_snapshot_depth_pipeline() {
+  WGPUBindGroupLayoutEntry entry = WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT;
+  entry.binding = 0;
+  entry.visibility = WGPUShaderStage_Fragment;
+  entry.texture = WGPU_TEXTURE_BINDING_LAYOUT_INIT;
+  entry.texture.sampleType = WGPUTextureSampleType_Depth;
+  entry.texture.viewDimension = WGPUTextureViewDimension_2D;
+
+  WGPUBindGroupLayoutDescriptor bgl_desc = WGPU_BIND_GROUP_LAYOUT_DESCRIPTOR_INIT;
+  bgl_desc.label = make_str_view("snapshot_depth_bgl");
+  bgl_desc.entryCount = 1;
+  bgl_desc.entries = &entry;
+  g_depth_blit_bind_group_layout = wgpuDeviceCreateBindGroupLayout(g_device, &bgl_desc);
+
+  WGPUPipelineLayoutDescriptor pl_desc = WGPU_PIPELINE_LAYOUT_DESCRIPTOR_INIT;
+  pl_desc.label = make_str_view("snapshot_depth_layout");
+  pl_desc.bindGroupLayoutCount = 1;
+  pl_desc.bindGroupLayouts = &g_depth_blit_bind_group_layout;
+  WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(g_device, &pl_desc);
+
+  WGPUShaderSourceWGSL wgsl_desc = WGPU_SHADER_SOURCE_WGSL_INIT;
+  wgsl_desc.code = make_str_view(kSnapshotDepthWGSL);
+
+  WGPUShaderModuleDescriptor shader_desc = WGPU_SHADER_MODULE_DESCRIPTOR_INIT;
+  shader_desc.label = make_str_view("snapshot_depth_shader");
+  shader_desc.nextInChain = reinterpret_cast<WGPUChainedStruct*>(&wgsl_desc);
+  WGPUShaderModule shader = wgpuDeviceCreateShaderModule(g_device, &shader_desc);
+
+  WGPUColorTargetState color_target = WGPU_COLOR_TARGET_STATE_INIT;
+  color_target.format = kSnapshotDepthFormat;
   color_target.writeMask = WGPUColorWriteMask_All;
 
   WGPUFragmentState frag_state = WGPU_FRAGMENT_STATE_INIT;
@@ -332,209 +1174,2287 @@ void create_pipeline_resources() {
   frag_state.targetCount = 1;
   frag_state.targets = &color_target;
 
-  WGPUDepthStencilState depth_state = WGPU_DEPTH_STENCIL_STATE_INIT;
-  depth_state.format = WGPUTextureFormat_Depth24Plus;
-  depth_state.depthWriteEnabled = WGPUOptionalBool_True;
-  depth_state.depthCompare = WGPUCompareFunction_Less;
-
   WGPURenderPipelineDescriptor pipe_desc = WGPU_RENDER_PIPELINE_DESCRIPTOR_INIT;
-  pipe_desc.label = make_str_view("main_pipeline");
-  pipe_desc.layout = g_pipeline_layout;
+  pipe_desc.label = make_str_view("snapshot_depth_pipeline");
+  pipe_desc.layout = layout;
   pipe_desc.vertex.module = shader;
   pipe_desc.vertex.entryPoint = make_str_view("vs_main");
-  pipe_desc.vertex.bufferCount = 1;
-  pipe_desc.vertex.buffers = &vbuf_layout;
   pipe_desc.primitive = WGPU_PRIMITIVE_STATE_INIT;
   pipe_desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
-  pipe_desc.primitive.frontFace = WGPUFrontFace_CCW;
-  pipe_desc.primitive.cullMode = WGPUCullMode_None;
   pipe_desc.multisample = WGPU_MULTISAMPLE_STATE_INIT;
   pipe_desc.multisample.count = 1;
-  pipe_desc.depthStencil = &depth_state;
   pipe_desc.fragment = &frag_state;
+  create_render_pipeline_async(pipe_desc, &g_depth_blit_pipeline);
 
-  g_pipeline = wgpuDeviceCreateRenderPipeline(g_device, &pipe_desc);
   wgpuShaderModuleRelease(shader);
+  wgpuPipelineLayoutRelease(layout);
+}
 
-  create_depth_buffer();
+WGPUShaderModule create_wgsl_module(const char* label, const char* code) {
+  WGPUShaderSourceWGSL wgsl_desc = WGPU_SHADER_SOURCE_WGSL_INIT;
+  wgsl_desc.code = make_str_view(code);
+  WGPUShaderModuleDescriptor shader_desc = WGPU_SHADER_MODULE_DESCRIPTOR_INIT;
+  shader_desc.label = make_str_view(label);
+  shader_desc.nextInChain = reinterpret_cast<WGPUChainedStruct*>(&wgsl_desc);
+  return wgpuDeviceCreateShaderModule(g_device, &shader_desc);
 }
 
-void update_camera(float dt_sec) {
-  const Vec3 forward = camera_forward();
-  const Vec3 right = vec3_normalize(vec3_cross(forward, Vec3{0.0f, 1.0f, 0.0f}));
+void create_compute_pipeline(const char* label,
+                             WGPUShaderModule shader,
+                             const char* entry_point,
+                             const WGPUBindGroupLayout* layouts,
+                             size_t layout_count,
+                             WGPUComputePipeline* target) {
+  WGPUPipelineLayoutDescriptor pl_desc = WGPU_PIPELINE_LAYOUT_DESCRIPTOR_INIT;
+  pl_desc.label = make_str_view(label);
+  pl_desc.bindGroupLayoutCount = layout_count;
+  pl_desc.bindGroupLayouts = layouts;
+  WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(g_device, &pl_desc);
 
-  Vec3 move{0.0f, 0.0f, 0.0f};
-  if (g_key_w) move = vec3_add(move, forward);
-  if (g_key_s) move = vec3_sub(move, forward);
-  if (g_key_d) move = vec3_add(move, right);
-  if (g_key_a) move = vec3_sub(move, right);
+  WGPUComputePipelineDescriptor pipe_desc = WGPU_COMPUTE_PIPELINE_DESCRIPTOR_INIT;
+  pipe_desc.label = make_str_view(label);
+  pipe_desc.layout = layout;
+  pipe_desc.compute.module = shader;
+  pipe_desc.compute.entryPoint = make_str_view(entry_point);
+  create_compute_pipeline_async(pipe_desc, target);
+  wgpuPipelineLayoutRelease(layout);
+}
 
-  if (vec3_dot(move, move) > 0.0f) {
-    move = vec3_normalize(move);
-  }
+// Source texture (depth or float) at binding 0, r32float storage at binding 1.
+WGPUBindGroupLayout create_hiz_build_layout(const char* label, WGPUTextureSampleType source_type) {
+  WGPUBindGroupLayoutEntry entries[2] = {WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT, WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT};
+  entries[0].binding = 0;
+  entries[0].visibility = WGPUShaderStage_Compute;
+  entries[0].texture = WGPU_TEXTURE_BINDING_LAYOUT_INIT;
+  entries[0].texture.sampleType = source_type;
+  entries[0].texture.viewDimension = WGPUTextureViewDimension_2D;
+  entries[1].binding = 1;
+  entries[1].visibility = WGPUShaderStage_Compute;
+  entries[1].storageTexture = WGPU_STORAGE_TEXTURE_BINDING_LAYOUT_INIT;
+  entries[1].storageTexture.access = WGPUStorageTextureAccess_WriteOnly;
+  entries[1].storageTexture.format = WGPUTextureFormat_R32Float;
+  entries[1].storageTexture.viewDimension = WGPUTextureViewDimension_2D;
 
-  const float speed = g_key_shift ? 7.0f : 3.5f;
-  g_camera_pos = vec3_add(g_camera_pos, vec3_scale(move, speed * dt_sec));
+  WGPUBindGroupLayoutDescriptor bgl_desc = WGPU_BIND_GROUP_LAYOUT_DESCRIPTOR_INIT;
+  bgl_desc.label = make_str_view(label);
+  bgl_desc.entryCount = 2;
+  bgl_desc.entries = entries;
+  return wgpuDeviceCreateBindGroupLayout(g_device, &bgl_desc);
 }
 
-void update_view_projection() {
-  const float aspect = static_cast<float>(g_canvas_width) / static_cast<float>(g_canvas_height);
-  const Mat4 proj = mat4_perspective_rh_zo(60.0f * 3.14159265f / 180.0f, aspect, 0.1f, 200.0f);
-  const Vec3 fwd = camera_forward();
-  const Mat4 view = mat4_look_at_rh(g_camera_pos, vec3_add(g_camera_pos, fwd), Vec3{0.0f, 1.0f, 0.0f});
-  g_last_vp = mat4_mul(proj, view);
+void release_hiz_pyramid() {
+  for (WGPUBindGroup group : g_hiz_build_groups) {
+    wgpuBindGroupRelease(group);
+  }
+  g_hiz_build_groups.clear();
+  for (WGPUTextureView view : g_hiz_mip_views) {
+    wgpuTextureViewRelease(view);
+  }
+  g_hiz_mip_views.clear();
+  if (g_cull_hiz_group) {
+    wgpuBindGroupRelease(g_cull_hiz_group);
+    g_cull_hiz_group = nullptr;
+  }
+  if (g_hiz_view) {
+    wgpuTextureViewRelease(g_hiz_view);
+    g_hiz_view = nullptr;
+  }
+  if (g_hiz_texture) {
+    wgpuTextureRelease(g_hiz_texture);
+    g_hiz_texture = nullptr;
+  }
 }
 
-void write_uniform(Mat4 model, float tr, float tg, float tb) {
-  const Mat4 mvp = mat4_mul(g_last_vp, model);
-  Uniforms u{};
-  std::memcpy(u.mvp, mvp.m, sizeof(mvp.m));
-  u.tint[0] = tr;
+// Full mip chain over the depth buffer's size, one bind group per level.
+void create_hiz_pyramid() {
+  release_hiz_pyramid();
+  g_hiz_width = g_render_width;
+  g_hiz_height = g_render_height;
+  const uint32_t width = static_cast<uint32_t>(g_render_width);
+  const uint32_t height = static_cast<uint32_t>(g_render_height);
+  uint32_t levels = 1;
+  while ((std::max(width, height) >> levels) > 0) {
+    levels += 1;
+  }
+
+  WGPUTextureDescriptor desc = WGPU_TEXTURE_DESCRIPTOR_INIT;
+  desc.label = make_str_view("hiz_pyramid");
+  desc.usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_StorageBinding;
+  desc.dimension = WGPUTextureDimension_2D;
+  desc.size.width = width;
+  desc.size.height = height;
+  desc.size.depthOrArrayLayers = 1;
+  desc.format = WGPUTextureFormat_R32Float;
+  desc.mipLevelCount = levels;
+  desc.sampleCount = 1;
+  g_hiz_texture = wgpuDeviceCreateTexture(g_device, &desc);
+  g_hiz_view = wgpuTextureCreateView(g_hiz_texture, nullptr);
+
+  for (uint32_t level = 0; level < levels; ++level) {
+    WGPUTextureViewDescriptor view_desc = WGPU_TEXTURE_VIEW_DESCRIPTOR_INIT;
+    view_desc.label = make_str_view("hiz_level");
+    view_desc.format = WGPUTextureFormat_R32Float;
+    view_desc.dimension = WGPUTextureViewDimension_2D;
+    view_desc.baseMipLevel = level;
+    view_desc.mipLevelCount = 1;
+    view_desc.baseArrayLayer = 0;
+    view_desc.arrayLayerCount = 1;
+    view_desc.aspect = WGPUTextureAspect_All;
+    g_hiz_mip_views.push_back(wgpuTextureCreateView(g_hiz_texture, &view_desc));
+  }
+
+  for (uint32_t level = 0; level < levels; ++level) {
+    WGPUBindGroupEntry entries[2] = {WGPU_BIND_GROUP_ENTRY_INIT, WGPU_BIND_GROUP_ENTRY_INIT};
+    entries[0].binding = 0;
+    entries[0].textureView = level == 0 ? g_depth_view : g_hiz_mip_views[level - 1];
+    entries[1].binding = 1;
+    entries[1].textureView = g_hiz_mip_views[level];
+    WGPUBindGroupDescriptor bg_desc = WGPU_BIND_GROUP_DESCRIPTOR_INIT;
+    bg_desc.label = make_str_view("hiz_build_bind_group");
+    bg_desc.layout = level == 0 ? g_hiz_copy_layout : g_hiz_reduce_layout;
+    bg_desc.entryCount = 2;
+    bg_desc.entries = entries;
+    g_hiz_build_groups.push_back(wgpuDeviceCreateBindGroup(g_device, &bg_desc));
+  }
+
+  WGPUBindGroupEntry cull_entry = WGPU_BIND_GROUP_ENTRY_INIT;
+  cull_entry.binding = 0;
+  cull_entry.textureView = g_hiz_view;
+  WGPUBindGroupDescriptor cull_desc = WGPU_BIND_GROUP_DESCRIPTOR_INIT;
+  cull_desc.label = make_str_view("photo_cull_hiz_bind_group");
+  cull_desc.layout = g_cull_hiz_layout;
+  cull_desc.entryCount = 1;
+  cull_desc.entries = &cull_entry;
+  g_cull_hiz_group = wgpuDeviceCreateBindGroup(g_device, &cull_desc);
+}
+
+void create_photo_cull_resources() {
+  WGPUBufferDescriptor params_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  params_desc.label = make_str_view("photo_cull_params");
+  params_desc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+  params_desc.size = sizeof(GpuCullParams);
+  g_cull_params_buffer = wgpuDeviceCreateBuffer(g_device, &params_desc);
+
+  WGPUBufferDescriptor photo_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  photo_desc.label = make_str_view("photo_cull_columns");
+  photo_desc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+  photo_desc.size = static_cast<uint64_t>(kGpuCullColumns) * kMaxPlacedPhotos * sizeof(float);
+  g_cull_photo_buffer = wgpuDeviceCreateBuffer(g_device, &photo_desc);
+
+  // Zero-initialised: nothing counts as visible last frame at first.
+  WGPUBufferDescriptor visibility_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  visibility_desc.label = make_str_view("photo_cull_visibility");
+  visibility_desc.usage = WGPUBufferUsage_Storage;
+  visibility_desc.size = static_cast<uint64_t>(kMaxPlacedPhotos) * sizeof(uint32_t);
+  g_cull_visibility_buffer = wgpuDeviceCreateBuffer(g_device, &visibility_desc);
+
+  WGPUBufferDescriptor occluded_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  occluded_desc.label = make_str_view("photo_cull_occluded");
+  occluded_desc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+  occluded_desc.size = sizeof(uint32_t);
+  g_cull_occluded_buffer = wgpuDeviceCreateBuffer(g_device, &occluded_desc);
+
+  for (GpuCullReadback& slot : g_cull_readbacks) {
+    WGPUBufferDescriptor read_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+    read_desc.label = make_str_view("photo_cull_readback");
+    read_desc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    read_desc.size = kGpuCullReadbackWords * sizeof(uint32_t);
+    slot.buffer = wgpuDeviceCreateBuffer(g_device, &read_desc);
+    slot.busy = false;
+  }
+
+  constexpr uint32_t kBindings = 6;
+  WGPUBindGroupLayoutEntry entries[kBindings] = {
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+  };
+  const WGPUBufferBindingType types[kBindings] = {
+      WGPUBufferBindingType_ReadOnlyStorage,
+      WGPUBufferBindingType_ReadOnlyStorage,
+      WGPUBufferBindingType_Storage,
+      WGPUBufferBindingType_Storage,
+      WGPUBufferBindingType_Storage,
+      WGPUBufferBindingType_Storage,
+  };
+  for (uint32_t i = 0; i < kBindings; ++i) {
+    entries[i].binding = i;
+    entries[i].visibility = WGPUShaderStage_Compute;
+    entries[i].buffer = WGPU_BUFFER_BINDING_LAYOUT_INIT;
+    entries[i].buffer.type = types[i];
+  }
+  WGPUBindGroupLayoutDescriptor bgl_desc = WGPU_BIND_GROUP_LAYOUT_DESCRIPTOR_INIT;
+  bgl_desc.label = make_str_view("photo_cull_bgl");
+  bgl_desc.entryCount = kBindings;
+  bgl_desc.entries = entries;
+  g_cull_bind_group_layout = wgpuDeviceCreateBindGroupLayout(g_device, &bgl_desc);
+
+  // The instance buffer is bound whole: the photo region starts at 192 bytes,
+  // below the storage offset alignment, so the shader adds first_instance.
+  WGPUBindGroupEntry bg_entries[kBindings] = {
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+      WGPU_BIND_GROUP_ENTRY_INIT,
+  };
+  const WGPUBuffer buffers[kBindings] = {
+      g_cull_params_buffer,
+      g_cull_photo_buffer,
+      g_instance_buffer,
+      g_indirect_buffer,
+      g_cull_visibility_buffer,
+      g_cull_occluded_buffer,
+  };
+  for (uint32_t i = 0; i < kBindings; ++i) {
+    bg_entries[i].binding = i;
+    bg_entries[i].buffer = buffers[i];
+    bg_entries[i].offset = 0;
+    bg_entries[i].size = WGPU_WHOLE_SIZE;
+  }
+  WGPUBindGroupDescriptor bg_desc = WGPU_BIND_GROUP_DESCRIPTOR_INIT;
+  bg_desc.label = make_str_view("photo_cull_bind_group");
+  bg_desc.layout = g_cull_bind_group_layout;
+  bg_desc.entryCount = kBindings;
+  bg_desc.entries = bg_entries;
+  g_cull_bind_group = wgpuDeviceCreateBindGroup(g_device, &bg_desc);
+
+  WGPUBindGroupLayoutEntry hiz_entry = WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT;
+  hiz_entry.binding = 0;
+  hiz_entry.visibility = WGPUShaderStage_Compute;
+  hiz_entry.texture = WGPU_TEXTURE_BINDING_LAYOUT_INIT;
+  hiz_entry.texture.sampleType = WGPUTextureSampleType_UnfilterableFloat;
+  hiz_entry.texture.viewDimension = WGPUTextureViewDimension_2D;
+  WGPUBindGroupLayoutDescriptor hiz_desc = WGPU_BIND_GROUP_LAYOUT_DESCRIPTOR_INIT;
+  hiz_desc.label = make_str_view("photo_cull_hiz_bgl");
+  hiz_desc.entryCount = 1;
+  hiz_desc.entries = &hiz_entry;
+  g_cull_hiz_layout = wgpuDeviceCreateBindGroupLayout(g_device, &hiz_desc);
+
+  WGPUShaderModule cull_shader = create_wgsl_module("photo_cull_shader", kPhotoCullWGSL);
+  create_compute_pipeline("photo_cull_early", cull_shader, "cs_cull_early", &g_cull_bind_group_layout, 1,
+                          &g_cull_pipeline);
+  const WGPUBindGroupLayout late_layouts[2] = {g_cull_bind_group_layout, g_cull_hiz_layout};
+  create_compute_pipeline("photo_cull_late", cull_shader, "cs_cull_late", late_layouts, 2, &g_cull_late_pipeline);
+  wgpuShaderModuleRelease(cull_shader);
+
+  g_hiz_copy_layout = create_hiz_build_layout("hiz_copy_bgl", WGPUTextureSampleType_Depth);
+  g_hiz_reduce_layout = create_hiz_build_layout("hiz_reduce_bgl", WGPUTextureSampleType_UnfilterableFloat);
+  WGPUShaderModule copy_shader = create_wgsl_module("hiz_copy_shader", kHizCopyWGSL);
+  create_compute_pipeline("hiz_copy", copy_shader, "cs_main", &g_hiz_copy_layout, 1, &g_hiz_copy_pipeline);
+  wgpuShaderModuleRelease(copy_shader);
+  WGPUShaderModule reduce_shader = create_wgsl_module("hiz_reduce_shader", kHizReduceWGSL);
+  create_compute_pipeline("hiz_reduce", reduce_shader, "cs_main", &g_hiz_reduce_layout, 1, &g_hiz_reduce_pipeline);
+  wgpuShaderModuleRelease(reduce_shader);
+}
+
+void release_readback_buffers() {
+  for (WGPUBuffer buffer : g_readback_color_buffers) {
+    wgpuBufferRelease(buffer);
+  }
+  for (WGPUBuffer buffer : g_readback_depth_buffers) {
+    wgpuBufferRelease(buffer);
+  }
+  g_readback_color_buffers.clear();
+  g_readback_depth_buffers.clear();
+}
+
+// One color and one depth staging buffer per ring slot, allocated up front so
+// a capture never creates buffers on the frame path.
+void create_readback_ring(int depth) {
+  release_readback_buffers();
+  readback_ring_init(g_readback_ring, depth);
+
+  WGPUBufferDescriptor buf_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  buf_desc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+  buf_desc.size = static_cast<uint64_t>(kSnapshotReadbackRowBytes) * kSnapshotHeight;
+  for (int i = 0; i < depth; ++i) {
+    buf_desc.label = make_str_view("snapshot_readback_color");
+    g_readback_color_buffers.push_back(wgpuDeviceCreateBuffer(g_device, &buf_desc));
+    buf_desc.label = make_str_view("snapshot_readback_depth");
+    g_readback_depth_buffers.push_back(wgpuDeviceCreateBuffer(g_device, &buf_desc));
+  }
+}
+
+// Two timestamps (main pass begin/end) per frame, resolved once and copied
+// into a small ring of mappable buffers so a pending map never blocks the
+// next frame's resolve.
+void create_timestamp_resources() {
+  if (!g_timestamps_supported) {
+    return;
+  }
+  WGPUQuerySetDescriptor qs_desc = WGPU_QUERY_SET_DESCRIPTOR_INIT;
+  qs_desc.label = make_str_view("frame_timestamps");
+  qs_desc.type = WGPUQueryType_Timestamp;
+  qs_desc.count = 2;
+  g_timestamp_query_set = wgpuDeviceCreateQuerySet(g_device, &qs_desc);
+
+  WGPUBufferDescriptor resolve_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  resolve_desc.label = make_str_view("timestamp_resolve");
+  resolve_desc.usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+  resolve_desc.size = 2 * sizeof(uint64_t);
+  g_timestamp_resolve_buffer = wgpuDeviceCreateBuffer(g_device, &resolve_desc);
+
+  for (GpuTimingSlot& slot : g_gpu_timing_slots) {
+    WGPUBufferDescriptor read_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+    read_desc.label = make_str_view("timestamp_readback");
+    read_desc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    read_desc.size = 2 * sizeof(uint64_t);
+    slot.buffer = wgpuDeviceCreateBuffer(g_device, &read_desc);
+    slot.busy = false;
+  }
+}
+
+int acquire_gpu_timing_slot() {
+  if (!g_timestamp_query_set || !g_profiler.enabled) {
+    return -1;
+  }
+  for (int i = 0; i < kGpuTimingSlots; ++i) {
+    if (!g_gpu_timing_slots[i].busy) {
+      g_gpu_timing_slots[i].busy = true;
+      g_gpu_timing_slots[i].frame = g_frame_index;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void on_gpu_timing_mapped(WGPUMapAsyncStatus status, WGPUStringView, void* userdata1, void*) {
+  GpuTimingSlot& slot = g_gpu_timing_slots[reinterpret_cast<intptr_t>(userdata1)];
+  if (status == WGPUMapAsyncStatus_Success) {
+    const uint64_t* ticks =
+        static_cast<const uint64_t*>(wgpuBufferGetConstMappedRange(slot.buffer, 0, 2 * sizeof(uint64_t)));
+    // Timestamps are in nanoseconds; a reset or reordered pair reads as 0.
+    const double ns = ticks[1] > ticks[0] ? static_cast<double>(ticks[1] - ticks[0]) : 0.0;
+    profiler_record_gpu(g_profiler, slot.frame, ProfileStage::GpuMainPass, static_cast<float>(ns * 1.0e-6));
+    g_gpu_pass_ms = static_cast<float>(ns * 1.0e-6);
+    wgpuBufferUnmap(slot.buffer);
+  }
+  slot.busy = false;
+}
+
+void map_gpu_timing(int slot) {
+  WGPUBufferMapCallbackInfo cb = WGPU_BUFFER_MAP_CALLBACK_INFO_INIT;
+  cb.mode = WGPUCallbackMode_AllowSpontaneous;
+  cb.callback = on_gpu_timing_mapped;
+  cb.userdata1 = reinterpret_cast<void*>(static_cast<intptr_t>(slot));
+  wgpuBufferMapAsync(g_gpu_timing_slots[slot].buffer, WGPUMapMode_Read, 0, 2 * sizeof(uint64_t), cb);
+}
+
+uint64_t align4(uint64_t bytes) {
+  return (bytes + 3) & ~uint64_t{3};
+}
+
+// All static geometry goes into one buffer that is written while mapped at
+// creation, so startup does a single allocation and no queue writes.
+void create_mesh_buffer() {
+  g_cube_mesh.vertex_offset = 0;
+  g_cube_mesh.vertex_size = sizeof(kCubeVertices);
+  g_photo_mesh.vertex_offset = align4(g_cube_mesh.vertex_offset + g_cube_mesh.vertex_size);
+  g_photo_mesh.vertex_size = sizeof(kPhotoFrameVertices);
+  g_cube_mesh.index_offset = align4(g_photo_mesh.vertex_offset + g_photo_mesh.vertex_size);
+  g_cube_mesh.index_size = sizeof(kCubeIndices);
+  g_cube_mesh.index_count = static_cast<uint32_t>(sizeof(kCubeIndices) / sizeof(kCubeIndices[0]));
+  g_photo_mesh.index_offset = align4(g_cube_mesh.index_offset + g_cube_mesh.index_size);
+  g_photo_mesh.index_size = sizeof(kPhotoFrameIndices);
+  g_photo_mesh.index_count = static_cast<uint32_t>(sizeof(kPhotoFrameIndices) / sizeof(kPhotoFrameIndices[0]));
+  const uint64_t total = align4(g_photo_mesh.index_offset + g_photo_mesh.index_size);
+
+  WGPUBufferDescriptor desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  desc.label = make_str_view("static_mesh_buffer");
+  desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_Index;
+  desc.size = total;
+  desc.mappedAtCreation = WGPU_TRUE;
+  g_mesh_buffer = wgpuDeviceCreateBuffer(g_device, &desc);
+
+  uint8_t* dst = static_cast<uint8_t*>(wgpuBufferGetMappedRange(g_mesh_buffer, 0, static_cast<size_t>(total)));
+  std::memset(dst, 0, static_cast<size_t>(total));
+  std::memcpy(dst + g_cube_mesh.vertex_offset, kCubeVertices, sizeof(kCubeVertices));
+  std::memcpy(dst + g_photo_mesh.vertex_offset, kPhotoFrameVertices, sizeof(kPhotoFrameVertices));
+  std::memcpy(dst + g_cube_mesh.index_offset, kCubeIndices, sizeof(kCubeIndices));
+  std::memcpy(dst + g_photo_mesh.index_offset, kPhotoFrameIndices, sizeof(kPhotoFrameIndices));
+  wgpuBufferUnmap(g_mesh_buffer);
+}
+
+// Render pipelines are only requested here; they arrive through
+// on_pipeline_created while the first frames present a plain clear.
+void create_pipeline_resources() {
+  create_mesh_buffer();
+
+  WGPUBufferDescriptor ub_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  ub_desc.label = make_str_view("camera_uniform_buffer");
+  ub_desc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+  ub_desc.size = static_cast<uint64_t>(kUniformFrameBytes) * kUniformFrameCount;
+  g_uniform_buffer = wgpuDeviceCreateBuffer(g_device, &ub_desc);
+
+  WGPUBufferDescriptor inst_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  inst_desc.label = make_str_view("instance_buffer");
+  inst_desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+  inst_desc.size = static_cast<uint64_t>(kMaxInstances) * sizeof(InstanceData);
+  g_instance_buffer = wgpuDeviceCreateBuffer(g_device, &inst_desc);
+
+  WGPUBufferDescriptor indirect_desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  indirect_desc.label = make_str_view("static_draw_indirect");
+  indirect_desc.usage =
+      WGPUBufferUsage_Indirect | WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+  indirect_desc.size = kIndirectDrawCount * sizeof(DrawIndexedIndirectArgs);
+  g_indirect_buffer = wgpuDeviceCreateBuffer(g_device, &indirect_desc);
+
+  WGPUTextureDescriptor capture_desc = WGPU_TEXTURE_DESCRIPTOR_INIT;
+  capture_desc.label = make_str_view("snapshot_capture");
+  capture_desc.usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc |
+                       WGPUTextureUsage_CopyDst;
+  capture_desc.dimension = WGPUTextureDimension_2D;
+  capture_desc.size.width = kSnapshotWidth;
+  capture_desc.size.height = kSnapshotHeight;
+  capture_desc.size.depthOrArrayLayers = 1;
+  capture_desc.format = kSnapshotFormat;
+  capture_desc.mipLevelCount = 1;
+  capture_desc.sampleCount = 1;
+  g_snapshot_capture_texture = wgpuDeviceCreateTexture(g_device, &capture_desc);
+  g_snapshot_capture_view = wgpuTextureCreateView(g_snapshot_capture_texture, nullptr);
+
+  WGPUTextureDescriptor snap_depth_desc = capture_desc;
+  snap_depth_desc.label = make_str_view("snapshot_depth");
+  snap_depth_desc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc;
+  snap_depth_desc.format = kSnapshotDepthFormat;
+  g_snapshot_depth_texture = wgpuDeviceCreateTexture(g_device, &snap_depth_desc);
+  g_snapshot_depth_view = wgpuTextureCreateView(g_snapshot_depth_texture, nullptr);
+
+  g_snapshot_base_texture = create_snapshot_array("snapshot_base_array",
+                                                  kSnapshotBaseWidth,
+                                                  kSnapshotBaseHeight,
+                                                  kSnapshotLayers,
+                                                  WGPUTextureUsage_TextureBinding | WGPUTextureUsage_RenderAttachment,
+                                                  &g_snapshot_base_view);
+  create_snapshot_detail_pool();
+
+  WGPUSamplerDescriptor sampler_desc = WGPU_SAMPLER_DESCRIPTOR_INIT;
+  sampler_desc.label = make_str_view("snapshot_sampler");
+  sampler_desc.magFilter = WGPUFilterMode_Linear;
+  sampler_desc.minFilter = WGPUFilterMode_Linear;
+  sampler_desc.mipmapFilter = WGPUMipmapFilterMode_Linear;
+  g_snapshot_sampler = wgpuDeviceCreateSampler(g_device, &sampler_desc);
+
+  WGPUBindGroupLayoutEntry bgl_entries[4] = {
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+      WGPU_BIND_GROUP_LAYOUT_ENTRY_INIT,
+  };
+  bgl_entries[0].binding = 0;
+  bgl_entries[0].visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment;
+  bgl_entries[0].buffer = WGPU_BUFFER_BINDING_LAYOUT_INIT;
+  bgl_entries[0].buffer.type = WGPUBufferBindingType_Uniform;
+  bgl_entries[0].buffer.hasDynamicOffset = WGPU_TRUE;
+  bgl_entries[0].buffer.minBindingSize = sizeof(Uniforms);
+  bgl_entries[1].binding = 1;
+  bgl_entries[1].visibility = WGPUShaderStage_Fragment;
+  bgl_entries[1].texture = WGPU_TEXTURE_BINDING_LAYOUT_INIT;
+  bgl_entries[1].texture.sampleType = WGPUTextureSampleType_Float;
+  bgl_entries[1].texture.viewDimension = WGPUTextureViewDimension_2DArray;
+  bgl_entries[2].binding = 2;
+  bgl_entries[2].visibility = WGPUShaderStage_Fragment;
+  bgl_entries[2].sampler = WGPU_SAMPLER_BINDING_LAYOUT_INIT;
+  bgl_entries[2].sampler.type = WGPUSamplerBindingType_Filtering;
+  bgl_entries[3].binding = 3;
+  bgl_entries[3].visibility = WGPUShaderStage_Fragment;
+  bgl_entries[3].texture = WGPU_TEXTURE_BINDING_LAYOUT_INIT;
+  bgl_entries[3].texture.sampleType = WGPUTextureSampleType_Float;
+  bgl_entries[3].texture.viewDimension = WGPUTextureViewDimension_2DArray;
+
+  WGPUBindGroupLayoutDescriptor bgl_desc = WGPU_BIND_GROUP_LAYOUT_DESCRIPTOR_INIT;
+  bgl_desc.label = make_str_view("camera_bgl");
+  bgl_desc.entryCount = 4;
+  bgl_desc.entries = bgl_entries;
+  g_bind_group_layout = wgpuDeviceCreateBindGroupLayout(g_device, &bgl_desc);
+
+  WGPUPipelineLayoutDescriptor pl_desc = WGPU_PIPELINE_LAYOUT_DESCRIPTOR_INIT;
+  pl_desc.label = make_str_view("main_pipeline_layout");
+  pl_desc.bindGroupLayoutCount = 1;
+  pl_desc.bindGroupLayouts = &g_bind_group_layout;
+  g_pipeline_layout = wgpuDeviceCreatePipelineLayout(g_device, &pl_desc);
+
+  create_main_bind_group();
+
+  WGPUShaderSourceWGSL wgsl_desc = WGPU_SHADER_SOURCE_WGSL_INIT;
+  wgsl_desc.code = make_str_view(kShaderWGSL);
+
+  WGPUShaderModuleDescriptor shader_desc = WGPU_SHADER_MODULE_DESCRIPTOR_INIT;
+  shader_desc.label = make_str_view("main_shader");
+  shader_desc.nextInChain = reinterpret_cast<WGPUChainedStruct*>(&wgsl_desc);
+
+  WGPUShaderModule shader = wgpuDeviceCreateShaderModule(g_device, &shader_desc);
+
+  WGPUVertexAttribute attrs[2] = {WGPU_VERTEX_ATTRIBUTE_INIT, WGPU_VERTEX_ATTRIBUTE_INIT};
+  attrs[0].format = WGPUVertexFormat_Float32x3;
+  attrs[0].offset = 0;
+  attrs[0].shaderLocation = 0;
+  attrs[1].format = WGPUVertexFormat_Float32x3;
+  attrs[1].offset = 3 * sizeof(float);
+  attrs[1].shaderLocation = 1;
+
+  WGPUVertexAttribute inst_attrs[6] = {
+      WGPU_VERTEX_ATTRIBUTE_INIT,
+      WGPU_VERTEX_ATTRIBUTE_INIT,
+      WGPU_VERTEX_ATTRIBUTE_INIT,
+      WGPU_VERTEX_ATTRIBUTE_INIT,
+      WGPU_VERTEX_ATTRIBUTE_INIT,
+      WGPU_VERTEX_ATTRIBUTE_INIT,
+  };
+  for (int i = 0; i < 4; ++i) {
+    inst_attrs[i].format = WGPUVertexFormat_Float32x4;
+    inst_attrs[i].offset = static_cast<uint64_t>(i) * 4 * sizeof(float);
+    inst_attrs[i].shaderLocation = static_cast<uint32_t>(2 + i);
+  }
+  inst_attrs[4].format = WGPUVertexFormat_Float32x4;
+  inst_attrs[4].offset = offsetof(InstanceData, tint);
+  inst_attrs[4].shaderLocation = 6;
+  inst_attrs[5].format = WGPUVertexFormat_Float32x4;
+  inst_attrs[5].offset = offsetof(InstanceData, params);
+  inst_attrs[5].shaderLocation = 7;
+
+  WGPUVertexBufferLayout vbuf_layouts[2] = {WGPU_VERTEX_BUFFER_LAYOUT_INIT, WGPU_VERTEX_BUFFER_LAYOUT_INIT};
+  vbuf_layouts[0].arrayStride = sizeof(Vertex);
+  vbuf_layouts[0].stepMode = WGPUVertexStepMode_Vertex;
+  vbuf_layouts[0].attributeCount = 2;
+  vbuf_layouts[0].attributes = attrs;
+  vbuf_layouts[1].arrayStride = sizeof(InstanceData);
+  vbuf_layouts[1].stepMode = WGPUVertexStepMode_Instance;
+  vbuf_layouts[1].attributeCount = 6;
+  vbuf_layouts[1].attributes = inst_attrs;
+
+  WGPUColorTargetState color_target = WGPU_COLOR_TARGET_STATE_INIT;
+  color_target.format = g_surface_format;
+  color_target.writeMask = WGPUColorWriteMask_All;
+
+  WGPUFragmentState frag_state = WGPU_FRAGMENT_STATE_INIT;
+  frag_state.module = shader;
+  frag_state.entryPoint = make_str_view("fs_main");
+  frag_state.targetCount = 1;
+  frag_state.targets = &color_target;
+
+  WGPUDepthStencilState depth_state = WGPU_DEPTH_STENCIL_STATE_INIT;
+  depth_state.format = kDepthFormat;
+  depth_state.depthWriteEnabled = WGPUOptionalBool_True;
+  depth_state.depthCompare = WGPUCompareFunction_Less;
+
+  WGPURenderPipelineDescriptor pipe_desc = WGPU_RENDER_PIPELINE_DESCRIPTOR_INIT;
+  pipe_desc.label = make_str_view("main_pipeline");
+  pipe_desc.layout = g_pipeline_layout;
+  pipe_desc.vertex.module = shader;
+  pipe_desc.vertex.entryPoint = make_str_view("vs_main");
+  pipe_desc.vertex.bufferCount = 2;
+  pipe_desc.vertex.buffers = vbuf_layouts;
+  pipe_desc.primitive = WGPU_PRIMITIVE_STATE_INIT;
+  pipe_desc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+  pipe_desc.primitive.frontFace = WGPUFrontFace_CCW;
+  pipe_desc.primitive.cullMode = WGPUCullMode_None;
+  pipe_desc.multisample = WGPU_MULTISAMPLE_STATE_INIT;
+  pipe_desc.multisample.count = 1;
+  pipe_desc.depthStencil = &depth_state;
+  pipe_desc.fragment = &frag_state;
+
+  create_render_pipeline_async(pipe_desc, &g_pipeline);
+
+  WGPUVertexAttribute packed_attrs[3] = {WGPU_VERTEX_ATTRIBUTE_INIT, WGPU_VERTEX_ATTRIBUTE_INIT, WGPU_VERTEX_ATTRIBUTE_INIT};
+  packed_attrs[0].format = WGPUVertexFormat_Snorm16x4;
+  packed_attrs[0].offset = offsetof(PackedVertex, position);
+  packed_attrs[0].shaderLocation = 0;
+  packed_attrs[1].format = WGPUVertexFormat_Unorm8x4;
+  packed_attrs[1].offset = offsetof(PackedVertex, color);
+  packed_attrs[1].shaderLocation = 1;
+  packed_attrs[2].format = WGPUVertexFormat_Snorm8x4;
+  packed_attrs[2].offset = offsetof(PackedVertex, normal);
+  packed_attrs[2].shaderLocation = 8;
+  vbuf_layouts[0].arrayStride = sizeof(PackedVertex);
+  vbuf_layouts[0].attributeCount = 3;
+  vbuf_layouts[0].attributes = packed_attrs;
+  pipe_desc.label = make_str_view("packed_mesh_pipeline");
+  pipe_desc.vertex.entryPoint = make_str_view("vs_packed");
+  create_render_pipeline_async(pipe_desc, &g_packed_pipeline);
+  wgpuShaderModuleRelease(shader);
+
+  create_render_targets();
+  create_snapshot_blit_pipeline();
+  create_snapshot_depth_pipeline();
+  create_readback_ring(kDefaultReadbackRingDepth);
+  create_timestamp_resources();
+  create_photo_cull_resources();
+}
+
+void update_view_projection() {
+  const float aspect = static_cast<float>(g_canvas_width) / static_cast<float>(g_canvas_height);
+  g_last_vp = camera_view_projection(g_camera, aspect, &g_last_proj_y_scale);
+}
+
+void begin_uniform_frame() {
+  g_uniform_draw_count = 0;
+  g_upload_stats = UploadStats{};
+}
+
+uint32_t uniform_frame_base() {
+  return static_cast<uint32_t>(g_frame_index % kUniformFrameCount) * kUniformFrameBytes;
+}
+
+// Stages one draw's uniforms and returns its dynamic offset into g_uniform_buffer.
+uint32_t push_uniforms(float tr, float tg, float tb) {
+  if (g_uniform_draw_count >= kMaxDrawsPerFrame) {
+    std::fprintf(stderr, "[Uniforms] per-frame draw limit (%u) exceeded\n", kMaxDrawsPerFrame);
+    return uniform_frame_base() + (kMaxDrawsPerFrame - 1) * kUniformAlign;
+  }
+
+  Uniforms u{};
+  std::memcpy(u.view_proj, g_last_vp.m, sizeof(g_last_vp.m));
+  u.tint[0] = tr;
   u.tint[1] = tg;
   u.tint[2] = tb;
   u.tint[3] = 1.0f;
-  wgpuQueueWriteBuffer(g_queue, g_uniform_buffer, 0, &u, sizeof(u));
-}
-
-void draw_mesh(WGPURenderPassEncoder pass,
-               WGPUBuffer vertex_buffer,
-               size_t vertex_size,
-               WGPUBuffer index_buffer,
-               size_t index_size,
-               uint32_t index_count,
-               Mat4 model,
-               float tr,
-               float tg,
-               float tb) {
-  write_uniform(model, tr, tg, tb);
-  wgpuRenderPassEncoderSetVertexBuffer(pass, 0, vertex_buffer, 0, vertex_size);
-  wgpuRenderPassEncoderSetIndexBuffer(pass, index_buffer, WGPUIndexFormat_Uint16, 0, index_size);
-  wgpuRenderPassEncoderDrawIndexed(pass, index_count, 1, 0, 0, 0);
-}
-
-Vec3 shot_tint(uint32_t shot_id) {
-  const float t = static_cast<float>(shot_id) * 0.37f;
-  return {
-      0.55f + 0.45f * std::sin(t + 0.0f),
-      0.55f + 0.45f * std::sin(t + 2.1f),
-      0.55f + 0.45f * std::sin(t + 4.2f),
+
+  const uint32_t local_offset = g_uniform_draw_count * kUniformAlign;
+  std::memcpy(g_uniform_staging + local_offset, &u, sizeof(u));
+  g_uniform_draw_count += 1;
+  return uniform_frame_base() + local_offset;
+}
+
+void flush_uniforms() {
+  if (g_uniform_draw_count == 0) {
+    return;
+  }
+  const uint32_t bytes = (g_uniform_draw_count - 1) * kUniformAlign + static_cast<uint32_t>(sizeof(Uniforms));
+  wgpuQueueWriteBuffer(g_queue, g_uniform_buffer, uniform_frame_base(), g_uniform_staging, bytes);
+  g_upload_stats.uniform_bytes += bytes;
+  g_upload_stats.queue_writes += 1;
+}
+
+void set_instance(int index, Mat4 model, float tr, float tg, float tb) {
+  InstanceData& inst = g_instance_data[index];
+  std::memcpy(inst.model, model.m, sizeof(model.m));
+  inst.tint[0] = tr;
+  inst.tint[1] = tg;
+  inst.tint[2] = tb;
+  inst.tint[3] = 1.0f;
+  inst.params[0] = -1.0f;
+  inst.params[1] = 0.0f;
+  inst.params[2] = 0.0f;
+  inst.params[3] = 0.0f;
+}
+
+void draw_mesh_instanced(WGPURenderPassEncoder pass,
+                         const MeshRange& mesh,
+                         uint32_t first_instance,
+                         uint32_t instance_count,
+                         uint32_t uniform_offset) {
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, g_bind_group, 1, &uniform_offset);
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 0, g_mesh_buffer, mesh.vertex_offset, mesh.vertex_size);
+  wgpuRenderPassEncoderSetIndexBuffer(pass, g_mesh_buffer, WGPUIndexFormat_Uint16, mesh.index_offset, mesh.index_size);
+  wgpuRenderPassEncoderDrawIndexed(pass, mesh.index_count, instance_count, 0, 0, first_instance);
+}
+
+void record_static_draw(WGPURenderBundleEncoder bundle,
+                        const MeshRange& mesh,
+                        int first_instance,
+                        int max_instances,
+                        int draw) {
+  wgpuRenderBundleEncoderSetVertexBuffer(bundle, 0, g_mesh_buffer, mesh.vertex_offset, mesh.vertex_size);
+  wgpuRenderBundleEncoderSetIndexBuffer(bundle, g_mesh_buffer, WGPUIndexFormat_Uint16, mesh.index_offset, mesh.index_size);
+  wgpuRenderBundleEncoderSetVertexBuffer(bundle,
+                                         1,
+                                         g_instance_buffer,
+                                         static_cast<uint64_t>(first_instance) * sizeof(InstanceData),
+                                         static_cast<uint64_t>(max_instances) * sizeof(InstanceData));
+  wgpuRenderBundleEncoderDrawIndexedIndirect(bundle,
+                                             g_indirect_buffer,
+                                             static_cast<uint64_t>(draw) * sizeof(DrawIndexedIndirectArgs));
+}
+
+WGPUIndexFormat imported_mesh_index_format() {
+  return g_imported_mesh.index_bytes == 2 ? WGPUIndexFormat_Uint16 : WGPUIndexFormat_Uint32;
+}
+
+uint64_t imported_mesh_index_bytes() {
+  return static_cast<uint64_t>(g_imported_mesh.index_count) * g_imported_mesh.index_bytes;
+}
+
+// Folds the mesh's dequantization into its instance transform.
+void set_imported_mesh_instance() {
+  const float* scale = g_imported_mesh.bounds_scale;
+  const float fit = 1.0f / std::max(scale[0], std::max(scale[1], scale[2]));
+  const float* center = g_imported_mesh.bounds_center;
+  const Mat4 dequantize = mat4_mul(mat4_translation(Vec3{center[0], center[1], center[2]}),
+                                   mat4_scale(scale[0], scale[1], scale[2]));
+  const Mat4 place = mat4_mul(mat4_translation(kImportedMeshPosition), mat4_scale(fit, fit, fit));
+  set_instance(kMeshInstance, mat4_mul(place, dequantize), 1.0f, 1.0f, 1.0f);
+}
+
+void record_static_bundles() {
+  const double start_ms = profiler_now_ms();
+  WGPURenderBundleEncoderDescriptor enc_desc = WGPU_RENDER_BUNDLE_ENCODER_DESCRIPTOR_INIT;
+  enc_desc.label = make_str_view("static_scene_bundle_encoder");
+  enc_desc.colorFormatCount = 1;
+  enc_desc.colorFormats = &g_surface_format;
+  enc_desc.depthStencilFormat = kDepthFormat;
+  enc_desc.sampleCount = 1;
+
+  WGPURenderBundleDescriptor bundle_desc = WGPU_RENDER_BUNDLE_DESCRIPTOR_INIT;
+  bundle_desc.label = make_str_view("static_scene_bundle");
+  for (uint32_t slot = 0; slot < kUniformFrameCount; ++slot) {
+    if (g_static_bundles[slot]) {
+      wgpuRenderBundleRelease(g_static_bundles[slot]);
+    }
+    WGPURenderBundleEncoder bundle = wgpuDeviceCreateRenderBundleEncoder(g_device, &enc_desc);
+    wgpuRenderBundleEncoderSetPipeline(bundle, g_pipeline);
+    // Matches the first push_uniforms() of a frame that uses this slot.
+    const uint32_t uniform_offset = slot * kUniformFrameBytes;
+    wgpuRenderBundleEncoderSetBindGroup(bundle, 0, g_bind_group, 1, &uniform_offset);
+    record_static_draw(bundle, g_cube_mesh, kCubeInstance, 1, kCubeDraw);
+    record_static_draw(bundle, g_photo_mesh, kFirstPhotoInstance, kMaxPlacedPhotos, kPhotoDraw);
+    record_static_draw(bundle, g_cube_mesh, kFirstBodyInstance, kMaxPhysicsInstances, kBodyDraw);
+    if (g_imported_mesh.vertex_count > 0) {
+      wgpuRenderBundleEncoderSetPipeline(bundle, g_packed_pipeline);
+      wgpuRenderBundleEncoderSetVertexBuffer(bundle,
+                                             0,
+                                             g_imported_mesh_buffer,
+                                             g_imported_mesh.vertex_offset,
+                                             static_cast<uint64_t>(g_imported_mesh.vertex_count) * sizeof(PackedVertex));
+      wgpuRenderBundleEncoderSetIndexBuffer(bundle,
+                                            g_imported_mesh_buffer,
+                                            imported_mesh_index_format(),
+                                            g_imported_mesh.index_offset,
+                                            imported_mesh_index_bytes());
+      wgpuRenderBundleEncoderSetVertexBuffer(bundle, 1, g_instance_buffer, kMeshInstance * sizeof(InstanceData),
+                                             sizeof(InstanceData));
+      wgpuRenderBundleEncoderDrawIndexedIndirect(bundle,
+                                                 g_indirect_buffer,
+                                                 static_cast<uint64_t>(kMeshDraw) * sizeof(DrawIndexedIndirectArgs));
+    }
+    g_static_bundles[slot] = wgpuRenderBundleEncoderFinish(bundle, &bundle_desc);
+    wgpuRenderBundleEncoderRelease(bundle);
+  }
+  g_bundles_dirty = false;
+  g_bundle_stats.rebuilds += 1;
+  g_bundle_stats.last_record_ms = (profiler_now_ms() - start_ms) / kUniformFrameCount;
+}
+
+void write_static_draw_args(int photo_count, int body_count) {
+  DrawIndexedIndirectArgs args[kIndirectDrawCount] = {};
+  args[kCubeDraw].index_count = g_cube_mesh.index_count;
+  args[kCubeDraw].instance_count = 1;
+  args[kPhotoDraw].index_count = g_photo_mesh.index_count;
+  args[kPhotoDraw].instance_count = static_cast<uint32_t>(photo_count);
+  args[kBodyDraw].index_count = g_cube_mesh.index_count;
+  args[kBodyDraw].instance_count = static_cast<uint32_t>(body_count);
+  args[kMeshDraw].index_count = g_imported_mesh.index_count;
+  args[kMeshDraw].instance_count = g_imported_mesh.vertex_count > 0 ? 1 : 0;
+  args[kLatePhotoDraw].index_count = g_photo_mesh.index_count;
+  wgpuQueueWriteBuffer(g_queue, g_indirect_buffer, 0, args, sizeof(args));
+  g_upload_stats.queue_writes += 1;
+}
+
+constexpr uint64_t kPhotoDrawCountOffset =
+    kPhotoDraw * sizeof(DrawIndexedIndirectArgs) + offsetof(DrawIndexedIndirectArgs, instance_count);
+constexpr uint64_t kLatePhotoDrawCountOffset =
+    kLatePhotoDraw * sizeof(DrawIndexedIndirectArgs) + offsetof(DrawIndexedIndirectArgs, instance_count);
+
+// Re-uploads the cull input columns only when the placed photos changed.
+void upload_photo_cull_columns() {
+  if (g_cull_photo_version == g_scene.version) {
+    return;
+  }
+  g_cull_photo_version = g_scene.version;
+  const size_t bytes = static_cast<size_t>(g_scene.count) * sizeof(float);
+  if (bytes == 0) {
+    return;
+  }
+  const void* columns[kGpuCullColumns] = {
+      g_scene.px.data(), g_scene.py.data(), g_scene.pz.data(),
+      g_scene.yaw.data(), g_scene.scale.data(), g_scene.shot_id.data(),
   };
+  for (int c = 0; c < kGpuCullColumns; ++c) {
+    wgpuQueueWriteBuffer(g_queue,
+                         g_cull_photo_buffer,
+                         static_cast<uint64_t>(c) * kMaxPlacedPhotos * sizeof(float),
+                         columns[c],
+                         bytes);
+  }
+  g_upload_stats.instance_bytes += static_cast<uint32_t>(bytes * kGpuCullColumns);
+  g_upload_stats.queue_writes += kGpuCullColumns;
+}
+
+int acquire_cull_readback() {
+  for (int i = 0; i < kGpuCullReadbackSlots; ++i) {
+    if (!g_cull_readbacks[i].busy) {
+      g_cull_readbacks[i].busy = true;
+      g_cull_readbacks[i].frame = g_frame_index;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void on_cull_readback_mapped(WGPUMapAsyncStatus status, WGPUStringView, void* userdata1, void*) {
+  GpuCullReadback& slot = g_cull_readbacks[reinterpret_cast<intptr_t>(userdata1)];
+  if (status == WGPUMapAsyncStatus_Success) {
+    const uint32_t* counts = static_cast<const uint32_t*>(
+        wgpuBufferGetConstMappedRange(slot.buffer, 0, kGpuCullReadbackWords * sizeof(uint32_t)));
+    g_gpu_visible_count = static_cast<int>(counts[0] + counts[1]);
+    g_gpu_occluded_count = static_cast<int>(counts[2]);
+    profiler_record_counter(g_profiler, slot.frame, ProfileCounter::PhotosDrawnEarly, static_cast<int32_t>(counts[0]));
+    profiler_record_counter(g_profiler, slot.frame, ProfileCounter::PhotosDrawnLate, static_cast<int32_t>(counts[1]));
+    profiler_record_counter(g_profiler, slot.frame, ProfileCounter::PhotosOccluded, static_cast<int32_t>(counts[2]));
+    wgpuBufferUnmap(slot.buffer);
+  }
+  slot.busy = false;
+}
+
+void map_cull_readback(int slot) {
+  WGPUBufferMapCallbackInfo cb = WGPU_BUFFER_MAP_CALLBACK_INFO_INIT;
+  cb.mode = WGPUCallbackMode_AllowSpontaneous;
+  cb.callback = on_cull_readback_mapped;
+  cb.userdata1 = reinterpret_cast<void*>(static_cast<intptr_t>(slot));
+  wgpuBufferMapAsync(g_cull_readbacks[slot].buffer, WGPUMapMode_Read, 0, kGpuCullReadbackWords * sizeof(uint32_t), cb);
+}
+
+// Early phase: culls every placed photo on the GPU into the photo instance
+// region. Both photo draws' instance counts must already be queued as 0.
+void encode_photo_cull(WGPUCommandEncoder encoder, const Frustum& frustum, bool occlusion) {
+  upload_photo_cull_columns();
+
+  GpuCullParams params{};
+  for (int p = 0; p < 6; ++p) {
+    params.planes[p][0] = frustum.planes[p].normal.x;
+    params.planes[p][1] = frustum.planes[p].normal.y;
+    params.planes[p][2] = frustum.planes[p].normal.z;
+    params.planes[p][3] = frustum.planes[p].d;
+  }
+  params.photo_count = static_cast<uint32_t>(g_scene.count);
+  params.column_stride = kMaxPlacedPhotos;
+  params.first_instance = kFirstPhotoInstance;
+  params.count_word = static_cast<uint32_t>(kPhotoDrawCountOffset / sizeof(uint32_t));
+  for (uint32_t layer = 0; layer < kSnapshotLayers; ++layer) {
+    params.layer_shot[layer] = g_snapshot_layers.layer_shot[layer];
+    params.layer_slot[layer] = g_residency.layer_slot[layer];
+  }
+  std::memcpy(params.view_proj, g_last_vp.m, sizeof(params.view_proj));
+  params.occlusion = occlusion ? 1u : 0u;
+  params.late_first_instance = kFirstLatePhotoInstance;
+  params.late_count_word = static_cast<uint32_t>(kLatePhotoDrawCountOffset / sizeof(uint32_t));
+  params.late_capacity = kMaxLatePhotos;
+  wgpuQueueWriteBuffer(g_queue, g_cull_params_buffer, 0, &params, sizeof(params));
+  const uint32_t zero = 0;
+  wgpuQueueWriteBuffer(g_queue, g_cull_occluded_buffer, 0, &zero, sizeof(zero));
+  g_upload_stats.queue_writes += 2;
+
+  WGPUComputePassDescriptor pass_desc = WGPU_COMPUTE_PASS_DESCRIPTOR_INIT;
+  pass_desc.label = make_str_view("photo_cull_early_pass");
+  WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &pass_desc);
+  wgpuComputePassEncoderSetPipeline(pass, g_cull_pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass, 0, g_cull_bind_group, 0, nullptr);
+  wgpuComputePassEncoderDispatchWorkgroups(
+      pass, (params.photo_count + kGpuCullWorkgroupSize - 1) / kGpuCullWorkgroupSize, 1, 1);
+  wgpuComputePassEncoderEnd(pass);
+  wgpuComputePassEncoderRelease(pass);
+}
+
+// Late phase, after the main pass: builds the pyramid from this frame's
+// depth, then re-tests every photo in the frustum against it.
+void encode_photo_cull_late(WGPUCommandEncoder encoder) {
+  if (g_hiz_width != g_render_width || g_hiz_height != g_render_height) {
+    create_hiz_pyramid();
+  }
+
+  WGPUComputePassDescriptor pass_desc = WGPU_COMPUTE_PASS_DESCRIPTOR_INIT;
+  pass_desc.label = make_str_view("photo_cull_late_pass");
+  WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &pass_desc);
+  uint32_t width = static_cast<uint32_t>(g_hiz_width);
+  uint32_t height = static_cast<uint32_t>(g_hiz_height);
+  for (size_t level = 0; level < g_hiz_build_groups.size(); ++level) {
+    wgpuComputePassEncoderSetPipeline(pass, level == 0 ? g_hiz_copy_pipeline : g_hiz_reduce_pipeline);
+    wgpuComputePassEncoderSetBindGroup(pass, 0, g_hiz_build_groups[level], 0, nullptr);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, (width + 7) / 8, (height + 7) / 8, 1);
+    width = std::max(1u, width / 2);
+    height = std::max(1u, height / 2);
+  }
+  wgpuComputePassEncoderSetPipeline(pass, g_cull_late_pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass, 0, g_cull_bind_group, 0, nullptr);
+  wgpuComputePassEncoderSetBindGroup(pass, 1, g_cull_hiz_group, 0, nullptr);
+  wgpuComputePassEncoderDispatchWorkgroups(
+      pass, (static_cast<uint32_t>(g_scene.count) + kGpuCullWorkgroupSize - 1) / kGpuCullWorkgroupSize, 1, 1);
+  wgpuComputePassEncoderEnd(pass);
+  wgpuComputePassEncoderRelease(pass);
+}
+
+// Copies the early, late and occluded counts for the stats readback. Returns
+// the slot, or -1 when every slot is still in flight.
+int copy_cull_counts(WGPUCommandEncoder encoder) {
+  const int slot = acquire_cull_readback();
+  if (slot < 0) {
+    return -1;
+  }
+  WGPUBuffer dst = g_cull_readbacks[slot].buffer;
+  wgpuCommandEncoderCopyBufferToBuffer(encoder, g_indirect_buffer, kPhotoDrawCountOffset, dst, 0, sizeof(uint32_t));
+  wgpuCommandEncoderCopyBufferToBuffer(encoder, g_indirect_buffer, kLatePhotoDrawCountOffset, dst, sizeof(uint32_t),
+                                       sizeof(uint32_t));
+  wgpuCommandEncoderCopyBufferToBuffer(encoder, g_cull_occluded_buffer, 0, dst, 2 * sizeof(uint32_t),
+                                       sizeof(uint32_t));
+  return slot;
+}
+
+// Direct-encoding counterpart of the photo draw in the static bundles, for
+// GPU-culled frames: the count only exists in g_indirect_buffer.
+void draw_photos_indirect(WGPURenderPassEncoder pass,
+                          uint32_t uniform_offset,
+                          int first_instance,
+                          int max_instances,
+                          int draw) {
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, g_bind_group, 1, &uniform_offset);
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 0, g_mesh_buffer, g_photo_mesh.vertex_offset, g_photo_mesh.vertex_size);
+  wgpuRenderPassEncoderSetIndexBuffer(pass, g_mesh_buffer, WGPUIndexFormat_Uint16, g_photo_mesh.index_offset,
+                                      g_photo_mesh.index_size);
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 1, g_instance_buffer, first_instance * sizeof(InstanceData),
+                                       static_cast<uint64_t>(max_instances) * sizeof(InstanceData));
+  wgpuRenderPassEncoderDrawIndexedIndirect(pass, g_indirect_buffer, draw * sizeof(DrawIndexedIndirectArgs));
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 1, g_instance_buffer, 0,
+                                       static_cast<uint64_t>(kMaxInstances) * sizeof(InstanceData));
+}
+
+// Draws the photos cs_cull_late found on top of the main pass's color and
+// depth.
+void encode_late_photo_pass(WGPUCommandEncoder encoder, WGPUTextureView color_view, uint32_t uniform_offset) {
+  WGPURenderPassColorAttachment color_attachment = WGPU_RENDER_PASS_COLOR_ATTACHMENT_INIT;
+  color_attachment.view = color_view;
+  color_attachment.loadOp = WGPULoadOp_Load;
+  color_attachment.storeOp = WGPUStoreOp_Store;
+
+  WGPURenderPassDepthStencilAttachment depth_attachment = WGPU_RENDER_PASS_DEPTH_STENCIL_ATTACHMENT_INIT;
+  depth_attachment.view = g_depth_view;
+  depth_attachment.depthLoadOp = WGPULoadOp_Load;
+  depth_attachment.depthStoreOp = WGPUStoreOp_Store;
+  depth_attachment.depthReadOnly = WGPU_FALSE;
+
+  WGPURenderPassDescriptor pass_desc = WGPU_RENDER_PASS_DESCRIPTOR_INIT;
+  pass_desc.label = make_str_view("late_photo_pass");
+  pass_desc.colorAttachmentCount = 1;
+  pass_desc.colorAttachments = &color_attachment;
+  pass_desc.depthStencilAttachment = &depth_attachment;
+
+  WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &pass_desc);
+  wgpuRenderPassEncoderSetPipeline(pass, g_pipeline);
+  draw_photos_indirect(pass, uniform_offset, kFirstLatePhotoInstance, kMaxLatePhotos, kLatePhotoDraw);
+  wgpuRenderPassEncoderEnd(pass);
+  wgpuRenderPassEncoderRelease(pass);
+}
+
+// The page's callbacks live on the browser main thread. In worker render mode
+// they are queued to it without waiting, so pixels go out in a heap copy that
+// the page frees once it has sliced it.
+void notify_page_snapshot_added(uint32_t shot_id) {
+  MAIN_THREAD_ASYNC_EM_ASM({
+    if (window.__framespaceAddSnapshot) {
+      window.__framespaceAddSnapshot($0);
+    }
+  }, static_cast<int>(shot_id));
+}
+
+void send_page_snapshot_pixels(uint32_t shot_id, const uint8_t* rgba, uint32_t width, uint32_t height) {
+#if defined(FRAMESPACE_WORKER_RENDER)
+  const size_t bytes = static_cast<size_t>(width) * height * 4;
+  uint8_t* copy = static_cast<uint8_t*>(std::malloc(bytes));
+  if (!copy) {
+    return;
+  }
+  std::memcpy(copy, rgba, bytes);
+  MAIN_THREAD_ASYNC_EM_ASM({
+    if (window.__framespaceSetSnapshotPixels) {
+      window.__framespaceSetSnapshotPixels($0, HEAPU8.slice($1, $1 + $2 * $3 * 4), $2, $3);
+    }
+    _free($1);
+  }, static_cast<int>(shot_id), copy, width, height);
+#else
+  EM_ASM({
+    if (window.__framespaceSetSnapshotPixels) {
+      window.__framespaceSetSnapshotPixels($0, HEAPU8.slice($1, $1 + $2 * $3 * 4), $2, $3);
+    }
+  }, static_cast<int>(shot_id), rgba, width, height);
+#endif
+}
+
+void send_page_export_pixels(uint32_t shot_id, const uint8_t* rgba, uint32_t width, uint32_t height) {
+  const uint32_t row_bytes = width * 4;
+#if defined(FRAMESPACE_WORKER_RENDER)
+  const size_t bytes = static_cast<size_t>(row_bytes) * height;
+  uint8_t* copy = static_cast<uint8_t*>(std::malloc(bytes));
+  if (!copy) {
+    return;
+  }
+  std::memcpy(copy, rgba, bytes);
+  MAIN_THREAD_ASYNC_EM_ASM({
+    if (window.__framespaceExportPixels) {
+      window.__framespaceExportPixels($0, HEAPU8.slice($1, $1 + $2 * $4), $3, $4, $2);
+    }
+    _free($1);
+  }, static_cast<int>(shot_id), copy, row_bytes, width, height);
+#else
+  EM_ASM({
+    if (window.__framespaceExportPixels) {
+      window.__framespaceExportPixels($0, HEAPU8.slice($1, $1 + $2 * $4), $3, $4, $2);
+    }
+  }, static_cast<int>(shot_id), rgba, row_bytes, width, height);
+#endif
+}
+
+// Adds an input that changes what is drawn to the recording, if one is on.
+// `args` carries the extra words the command records (see input_trace.h).
+void record_input(InputEventType type, int32_t a, int32_t b, const uint32_t* args) {
+  if (!g_trace_recording) {
+    return;
+  }
+  const InputEvent event{static_cast<uint32_t>(type), a, b, 0};
+  input_trace_add(g_trace,
+                  static_cast<uint32_t>(g_frame_index - g_trace_start_frame),
+                  emscripten_get_now() - g_trace_start_ms,
+                  event,
+                  args);
+}
+
+bool trace_photos_tracked() {
+  return g_trace_recording || g_replay_active;
+}
+
+void capture_photo_snapshot() {
+  record_input(InputEventType::Command, static_cast<int32_t>(InputCommand::Capture), 0, nullptr);
+  g_photo_capture_count += 1;
+  g_last_snapshot.id = g_photo_capture_count;
+  g_last_snapshot.position = g_camera.position;
+  g_last_snapshot.yaw = g_camera.yaw;
+  g_last_snapshot.pitch = g_camera.pitch;
+  g_last_snapshot.timestamp_ms = emscripten_get_now();
+  g_has_snapshot = true;
+
+  // The blit into the snapshot array is recorded by the next frame() that has
+  // a free readback slot, right after the scene pass, so the shot matches
+  // what was on screen then.
+  const int layer = snapshot_layer_assign(g_snapshot_layers, g_last_snapshot.id);
+  residency_invalidate_layer(g_residency, layer);
+  g_pending_restores.erase(std::remove(g_pending_restores.begin(), g_pending_restores.end(), layer),
+                           g_pending_restores.end());
+  g_pending_captures.push_back(PendingCapture{layer, g_last_snapshot});
+
+  std::fprintf(stdout, "[Capture] shot=%u layer=%d pos=(%.2f, %.2f, %.2f) yaw=%.2f pitch=%.2f\n",
+               g_last_snapshot.id,
+               layer,
+               g_last_snapshot.position.x,
+               g_last_snapshot.position.y,
+               g_last_snapshot.position.z,
+               g_last_snapshot.yaw,
+               g_last_snapshot.pitch);
+
+  notify_page_snapshot_added(g_last_snapshot.id);
+}
+
+WGPUTextureView create_snapshot_view(WGPUTexture texture, uint32_t mip, uint32_t layer) {
+  WGPUTextureViewDescriptor view_desc = WGPU_TEXTURE_VIEW_DESCRIPTOR_INIT;
+  view_desc.format = kSnapshotFormat;
+  view_desc.dimension = WGPUTextureViewDimension_2D;
+  view_desc.baseMipLevel = mip;
+  view_desc.mipLevelCount = 1;
+  view_desc.baseArrayLayer = layer;
+  view_desc.arrayLayerCount = 1;
+  return wgpuTextureCreateView(texture, &view_desc);
+}
+
+void encode_blit(WGPUCommandEncoder encoder,
+                 WGPURenderPipeline pipeline,
+                 WGPUTextureView source_view,
+                 WGPUTextureView target_view) {
+  WGPUBindGroupEntry entries[2] = {WGPU_BIND_GROUP_ENTRY_INIT, WGPU_BIND_GROUP_ENTRY_INIT};
+  entries[0].binding = 0;
+  entries[0].textureView = source_view;
+  entries[1].binding = 1;
+  entries[1].sampler = g_snapshot_sampler;
+
+  WGPUBindGroupDescriptor bg_desc = WGPU_BIND_GROUP_DESCRIPTOR_INIT;
+  bg_desc.label = make_str_view("snapshot_blit_bg");
+  bg_desc.layout = g_blit_bind_group_layout;
+  bg_desc.entryCount = 2;
+  bg_desc.entries = entries;
+  WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(g_device, &bg_desc);
+
+  WGPURenderPassColorAttachment color_attachment = WGPU_RENDER_PASS_COLOR_ATTACHMENT_INIT;
+  color_attachment.view = target_view;
+  color_attachment.loadOp = WGPULoadOp_Clear;
+  color_attachment.storeOp = WGPUStoreOp_Store;
+  color_attachment.clearValue = WGPUColor{0.0, 0.0, 0.0, 1.0};
+
+  WGPURenderPassDescriptor pass_desc = WGPU_RENDER_PASS_DESCRIPTOR_INIT;
+  pass_desc.label = make_str_view("snapshot_blit_pass");
+  pass_desc.colorAttachmentCount = 1;
+  pass_desc.colorAttachments = &color_attachment;
+
+  WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &pass_desc);
+  wgpuRenderPassEncoderSetPipeline(pass, pipeline);
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, bind_group, 0, nullptr);
+  wgpuRenderPassEncoderDraw(pass, 3, 1, 0, 0);
+  wgpuRenderPassEncoderEnd(pass);
+  wgpuRenderPassEncoderRelease(pass);
+
+  wgpuBindGroupRelease(bind_group);
+}
+
+// Fills mips 1..N-1 of one array layer from mip 0.
+void encode_mip_chain(WGPUCommandEncoder encoder, WGPUTexture texture, uint32_t layer, uint32_t width, uint32_t height) {
+  const uint32_t mips = static_cast<uint32_t>(mip_count_for(width, height));
+  for (uint32_t mip = 1; mip < mips; ++mip) {
+    WGPUTextureView src = create_snapshot_view(texture, mip - 1, layer);
+    WGPUTextureView dst = create_snapshot_view(texture, mip, layer);
+    encode_blit(encoder, g_blit_downsample_pipeline, src, dst);
+    wgpuTextureViewRelease(dst);
+    wgpuTextureViewRelease(src);
+  }
+}
+
+void finish_snapshot_readback(int slot) {
+  ReadbackSlot& rs = g_readback_ring.slots[slot];
+  WGPUBuffer color = g_readback_color_buffers[slot];
+  WGPUBuffer depth = g_readback_depth_buffers[slot];
+  const size_t bytes = static_cast<size_t>(kSnapshotReadbackRowBytes) * kSnapshotHeight;
+
+  // A newer capture may have claimed the layer while this one was in flight.
+  if (!rs.map_failed && g_snapshot_layers.layer_shot[rs.layer] == rs.info.id) {
+    snapshot_payload_assign(g_snapshot_payloads[rs.layer],
+                            rs.info,
+                            kSnapshotWidth,
+                            kSnapshotHeight,
+                            static_cast<const uint8_t*>(wgpuBufferGetConstMappedRange(color, 0, bytes)),
+                            kSnapshotReadbackRowBytes,
+                            static_cast<const uint8_t*>(wgpuBufferGetConstMappedRange(depth, 0, bytes)),
+                            kSnapshotReadbackRowBytes,
+                            kCameraNear,
+                            kCameraFar);
+    residency_set_source_ready(g_residency, rs.layer, true);
+    g_readback_ring.stats.completed += 1;
+    g_last_readback_ms = emscripten_get_now() - rs.info.timestamp_ms;
+
+    SnapshotCodecJob job{};
+    job.kind = CodecJobKind::Encode;
+    job.tag = static_cast<uint32_t>(rs.layer);
+    job.payload = g_snapshot_payloads[rs.layer];
+    codec_worker_submit(g_codec_worker, std::move(job));
+
+    send_page_snapshot_pixels(rs.info.id, g_snapshot_payloads[rs.layer].color.data(), kSnapshotWidth, kSnapshotHeight);
+  }
+
+  if (!rs.map_failed) {
+    wgpuBufferUnmap(color);
+    wgpuBufferUnmap(depth);
+  }
+  readback_ring_release(g_readback_ring, slot);
+}
+
+void on_snapshot_readback_mapped(WGPUMapAsyncStatus status, WGPUStringView message, void* userdata1, void*) {
+  const int slot = static_cast<int>(reinterpret_cast<intptr_t>(userdata1));
+  ReadbackSlot& rs = g_readback_ring.slots[slot];
+  if (status != WGPUMapAsyncStatus_Success) {
+    std::fprintf(stderr, "[Snapshot] readback failed: %.*s\n",
+                 static_cast<int>(message.data ? message.length : 0),
+                 message.data ? message.data : "");
+    rs.map_failed = true;
+  }
+  rs.pending_maps -= 1;
+  if (rs.pending_maps == 0) {
+    finish_snapshot_readback(slot);
+  }
+}
+
+void encode_copy_to_readback(WGPUCommandEncoder encoder, WGPUTexture texture, WGPUBuffer buffer) {
+  WGPUTexelCopyTextureInfo src{};
+  src.texture = texture;
+  src.mipLevel = 0;
+  src.origin = WGPUOrigin3D{0, 0, 0};
+  src.aspect = WGPUTextureAspect_All;
+
+  WGPUTexelCopyBufferInfo dst{};
+  dst.buffer = buffer;
+  dst.layout.offset = 0;
+  dst.layout.bytesPerRow = kSnapshotReadbackRowBytes;
+  dst.layout.rowsPerImage = kSnapshotHeight;
+
+  const WGPUExtent3D extent{kSnapshotWidth, kSnapshotHeight, 1};
+  wgpuCommandEncoderCopyTextureToBuffer(encoder, &src, &dst, &extent);
+}
+
+// Called after the frame's submit; the copies recorded into this slot are
+// ordered before any map request.
+void map_snapshot_readback(int slot) {
+  ReadbackSlot& rs = g_readback_ring.slots[slot];
+  rs.state = ReadbackState::Mapping;
+  rs.pending_maps = 2;
+
+  WGPUBufferMapCallbackInfo cb = WGPU_BUFFER_MAP_CALLBACK_INFO_INIT;
+  cb.mode = WGPUCallbackMode_AllowSpontaneous;
+  cb.callback = on_snapshot_readback_mapped;
+  cb.userdata1 = reinterpret_cast<void*>(static_cast<intptr_t>(slot));
+  const size_t bytes = static_cast<size_t>(kSnapshotReadbackRowBytes) * kSnapshotHeight;
+  wgpuBufferMapAsync(g_readback_color_buffers[slot], WGPUMapMode_Read, 0, bytes, cb);
+  wgpuBufferMapAsync(g_readback_depth_buffers[slot], WGPUMapMode_Read, 0, bytes, cb);
+}
+
+void encode_depth_blit(WGPUCommandEncoder encoder) {
+  WGPUBindGroupEntry entry = WGPU_BIND_GROUP_ENTRY_INIT;
+  entry.binding = 0;
+  entry.textureView = g_depth_view;
+
+  WGPUBindGroupDescriptor bg_desc = WGPU_BIND_GROUP_DESCRIPTOR_INIT;
+  bg_desc.label = make_str_view("snapshot_depth_bg");
+  bg_desc.layout = g_depth_blit_bind_group_layout;
+  bg_desc.entryCount = 1;
+  bg_desc.entries = &entry;
+  WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(g_device, &bg_desc);
+
+  WGPURenderPassColorAttachment color_attachment = WGPU_RENDER_PASS_COLOR_ATTACHMENT_INIT;
+  color_attachment.view = g_snapshot_depth_view;
+  color_attachment.loadOp = WGPULoadOp_Clear;
+  color_attachment.storeOp = WGPUStoreOp_Store;
+  color_attachment.clearValue = WGPUColor{1.0, 0.0, 0.0, 1.0};
+
+  WGPURenderPassDescriptor pass_desc = WGPU_RENDER_PASS_DESCRIPTOR_INIT;
+  pass_desc.label = make_str_view("snapshot_depth_pass");
+  pass_desc.colorAttachmentCount = 1;
+  pass_desc.colorAttachments = &color_attachment;
+
+  WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &pass_desc);
+  wgpuRenderPassEncoderSetPipeline(pass, g_depth_blit_pipeline);
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, bind_group, 0, nullptr);
+  wgpuRenderPassEncoderDraw(pass, 3, 1, 0, 0);
+  wgpuRenderPassEncoderEnd(pass);
+  wgpuRenderPassEncoderRelease(pass);
+
+  wgpuBindGroupRelease(bind_group);
+}
+
+// Swap chain -> full-resolution capture texture -> base-tier layer + mips,
+// plus color and depth copies into the readback ring slot.
+void encode_snapshot_capture(WGPUCommandEncoder encoder, WGPUTextureView source_view, int layer, int slot) {
+  encode_blit(encoder, g_blit_capture_pipeline, source_view, g_snapshot_capture_view);
+
+  WGPUTextureView base_view = create_snapshot_view(g_snapshot_base_texture, 0, static_cast<uint32_t>(layer));
+  encode_blit(encoder, g_blit_downsample_pipeline, g_snapshot_capture_view, base_view);
+  wgpuTextureViewRelease(base_view);
+  encode_mip_chain(encoder, g_snapshot_base_texture, static_cast<uint32_t>(layer), kSnapshotBaseWidth, kSnapshotBaseHeight);
+
+  encode_depth_blit(encoder);
+  encode_copy_to_readback(encoder, g_snapshot_capture_texture, g_readback_color_buffers[slot]);
+  encode_copy_to_readback(encoder, g_snapshot_depth_texture, g_readback_depth_buffers[slot]);
+}
+
+// Rebuilds a layer's base tier from a decoded payload by sending it through
+// the same downsample path a live capture takes.
+void encode_snapshot_restore(WGPUCommandEncoder encoder, int layer) {
+  const std::vector<uint8_t>& pixels = g_snapshot_payloads[layer].color;
+
+  WGPUTexelCopyTextureInfo dst{};
+  dst.texture = g_snapshot_capture_texture;
+  dst.mipLevel = 0;
+  dst.origin = WGPUOrigin3D{0, 0, 0};
+  dst.aspect = WGPUTextureAspect_All;
+
+  WGPUTexelCopyBufferLayout layout{};
+  layout.offset = 0;
+  layout.bytesPerRow = kSnapshotWidth * 4;
+  layout.rowsPerImage = kSnapshotHeight;
+
+  const WGPUExtent3D extent{kSnapshotWidth, kSnapshotHeight, 1};
+  wgpuQueueWriteTexture(g_queue, &dst, pixels.data(), pixels.size(), &layout, &extent);
+  g_upload_stats.texture_bytes += static_cast<uint32_t>(pixels.size());
+  g_upload_stats.queue_writes += 1;
+
+  WGPUTextureView base_view = create_snapshot_view(g_snapshot_base_texture, 0, static_cast<uint32_t>(layer));
+  encode_blit(encoder, g_blit_downsample_pipeline, g_snapshot_capture_view, base_view);
+  wgpuTextureViewRelease(base_view);
+  encode_mip_chain(encoder, g_snapshot_base_texture, static_cast<uint32_t>(layer), kSnapshotBaseWidth, kSnapshotBaseHeight);
+}
+
+void upload_snapshot_detail(WGPUCommandEncoder encoder, const ResidencyUpload& upload) {
+  const std::vector<uint8_t>& pixels = g_snapshot_payloads[upload.layer].color;
+
+  WGPUTexelCopyTextureInfo dst{};
+  dst.texture = g_snapshot_detail_texture;
+  dst.mipLevel = 0;
+  dst.origin = WGPUOrigin3D{0, 0, static_cast<uint32_t>(upload.slot)};
+  dst.aspect = WGPUTextureAspect_All;
+
+  WGPUTexelCopyBufferLayout layout{};
+  layout.offset = 0;
+  layout.bytesPerRow = kSnapshotWidth * 4;
+  layout.rowsPerImage = kSnapshotHeight;
+
+  const WGPUExtent3D extent{kSnapshotWidth, kSnapshotHeight, 1};
+  wgpuQueueWriteTexture(g_queue, &dst, pixels.data(), pixels.size(), &layout, &extent);
+  g_upload_stats.texture_bytes += static_cast<uint32_t>(pixels.size());
+  g_upload_stats.queue_writes += 1;
+
+  encode_mip_chain(encoder, g_snapshot_detail_texture, static_cast<uint32_t>(upload.slot), kSnapshotWidth, kSnapshotHeight);
+}
+
+// PNG export reads the CPU payload kept for residency uploads, so it never
+// touches the GPU.
+bool export_snapshot(uint32_t shot_id) {
+  const int layer = snapshot_layer_find(g_snapshot_layers, shot_id);
+  if (layer < 0) {
+    std::fprintf(stdout, "[Export] skipped: shot %u is not resident\n", shot_id);
+    return false;
+  }
+  if (!g_residency.layer_source_ready[layer]) {
+    std::fprintf(stdout, "[Export] skipped: shot %u readback still in flight\n", shot_id);
+    return false;
+  }
+
+  send_page_export_pixels(shot_id, g_snapshot_payloads[layer].color.data(), kSnapshotWidth, kSnapshotHeight);
+  return true;
+}
+
+// Where a photo placed or moved right now lands: in front of the camera.
+Vec3 crosshair_place_position() {
+  return vec3_add(g_camera.position, vec3_scale(camera_forward(g_camera), kPlaceDistance));
+}
+
+PhotoHandle place_snapshot(int selected_shot) {
+  if (selected_shot <= 0) {
+    std::fprintf(stdout, "[Place] skipped: no selected snapshot\n");
+    return kInvalidPhotoHandle;
+  }
+
+  record_input(InputEventType::Command, static_cast<int32_t>(InputCommand::Place), selected_shot, nullptr);
+  const Vec3 pos = crosshair_place_position();
+  const PhotoHandle handle = scene_place_photo(
+      g_scene, static_cast<uint32_t>(selected_shot), pos, photo_yaw_facing_camera(g_camera.yaw), 1.0f);
+  if (trace_photos_tracked()) {
+    input_trace_photos_add(g_trace_photos, handle);
+  }
+  if (handle == kInvalidPhotoHandle) {
+    std::fprintf(stdout, "[Place] skipped: photo slots are full\n");
+    return kInvalidPhotoHandle;
+  }
+  if (physics_add_volume(g_physics, handle, kPhysicsBodiesPerFrame, handle) < 0) {
+    std::fprintf(stdout, "[Place] physics volumes are full; handle=%u has no bodies\n", handle);
+  }
+
+  std::fprintf(stdout, "[Place] shot=%d handle=%u pos=(%.2f, %.2f, %.2f)\n",
+               selected_shot,
+               handle,
+               pos.x,
+               pos.y,
+               pos.z);
+  return handle;
+}
+
+// Asks the page which inventory entry is selected. Worker render mode cannot
+// call back synchronously, so there the page sends the id with the command.
+PhotoHandle place_selected_snapshot() {
+  const int selected_shot = EM_ASM_INT({
+    return window.__framespaceGetSelectedShotId ? window.__framespaceGetSelectedShotId() : 0;
+  });
+  const int shot_exists = EM_ASM_INT({
+    if (!window.__framespaceHasShotId) return 0;
+    return window.__framespaceHasShotId($0) ? 1 : 0;
+  }, selected_shot);
+  if (selected_shot > 0 && !shot_exists) {
+    std::fprintf(stdout, "[Place] skipped: selected snapshot no longer exists (id=%d)\n", selected_shot);
+    return kInvalidPhotoHandle;
+  }
+  return place_snapshot(selected_shot);
+}
+
+// The photo under the crosshair, or kInvalidPhotoHandle. Cheap enough to run
+// every frame for hover.
+PhotoHandle pick_photo_at_crosshair() {
+  const double started = emscripten_get_now();
+  PhotoPick pick{};
+  const bool hit = scene_pick_photo(g_scene, g_camera.position, camera_forward(g_camera), kCameraFar, &pick);
+  g_last_pick_us = (emscripten_get_now() - started) * 1000.0;
+  return hit ? pick.handle : kInvalidPhotoHandle;
+}
+
+void notify_page_photo_selected(PhotoHandle handle) {
+  MAIN_THREAD_ASYNC_EM_ASM({
+    if (window.__framespacePhotoSelected) {
+      window.__framespacePhotoSelected($0 >>> 0);
+    }
+  }, handle);
+}
+
+// kInvalidPhotoHandle clears the selection; a stale handle leaves it alone.
+bool select_photo(PhotoHandle handle) {
+  if (handle != kInvalidPhotoHandle && scene_find_photo(g_scene, handle) < 0) {
+    std::fprintf(stdout, "[Select] skipped: handle=%u is not placed\n", handle);
+    return false;
+  }
+  g_selected_photo = handle;
+  notify_page_photo_selected(handle);
+  return true;
+}
+
+// Selecting empty space clears the selection.
+PhotoHandle select_photo_at_crosshair() {
+  const PhotoHandle handle = pick_photo_at_crosshair();
+  select_photo(handle);
+  std::fprintf(stdout, "[Select] handle=%u pick=%.2f us\n", handle, g_last_pick_us);
+  return handle;
+}
+
+// The selection only survives while its photo does; scene loads, clears and
+// removals all retire the handle.
+PhotoHandle selected_photo() {
+  return scene_find_photo(g_scene, g_selected_photo) >= 0 ? g_selected_photo : kInvalidPhotoHandle;
+}
+
+bool move_photo(PhotoHandle handle, Vec3 position, float yaw, float scale) {
+  if (!scene_move_photo(g_scene, handle, position, yaw, scale)) {
+    std::fprintf(stdout, "[Move] skipped: handle=%u is not placed\n", handle);
+    return false;
+  }
+  const uint32_t trace_id = g_trace_recording ? input_trace_photos_find(g_trace_photos, handle) : 0;
+  if (trace_id != 0) {
+    const float pose[kInputTraceMoveArgs] = {position.x, position.y, position.z, yaw, scale};
+    uint32_t args[kInputTraceMoveArgs];
+    std::memcpy(args, pose, sizeof(args));
+    record_input(InputEventType::Command, static_cast<int32_t>(InputCommand::MovePhoto),
+                 static_cast<int32_t>(trace_id), args);
+  }
+  std::fprintf(stdout, "[Move] handle=%u pos=(%.2f, %.2f, %.2f)\n", handle, position.x, position.y, position.z);
+  return true;
+}
+
+// Puts the photo where a fresh placement would go, keeping its scale.
+bool move_photo_to_crosshair(PhotoHandle handle) {
+  PlacedPhoto photo{};
+  if (!scene_get_photo(g_scene, handle, &photo)) {
+    std::fprintf(stdout, "[Move] skipped: handle=%u is not placed\n", handle);
+    return false;
+  }
+  return move_photo(handle, crosshair_place_position(), photo_yaw_facing_camera(g_camera.yaw), photo.scale);
+}
+
+bool delete_photo(PhotoHandle handle) {
+  physics_remove_volume(g_physics, handle);
+  if (!scene_remove_photo(g_scene, handle)) {
+    return false;
+  }
+  if (handle == g_selected_photo) {
+    select_photo(kInvalidPhotoHandle);
+  }
+  const uint32_t trace_id = trace_photos_tracked() ? input_trace_photos_remove(g_trace_photos, handle) : 0;
+  if (trace_id != 0) {
+    record_input(InputEventType::Command, static_cast<int32_t>(InputCommand::DeletePhoto),
+                 static_cast<int32_t>(trace_id), nullptr);
+  }
+  std::fprintf(stdout, "[Delete] handle=%u\n", handle);
+  return true;
+}
+
+// Accepts either a packed mesh blob or OBJ text, which is imported on the
+// spot. The packed blob becomes one vertex+index buffer without any rewrite.
+int load_mesh_blob(const uint8_t* data, size_t size) {
+  const double started = emscripten_get_now();
+  std::vector<uint8_t> imported;
+  MeshFileView view{};
+  if (!mesh_file_open(data, size, view)) {
+    MeshImportStats stats{};
+    if (!mesh_import_obj(reinterpret_cast<const char*>(data), size, imported, &stats) ||
+        !mesh_file_open(imported.data(), imported.size(), view)) {
+      std::fprintf(stderr, "[Mesh] load failed: neither a mesh file nor OBJ text\n");
+      return -1;
+    }
+    std::fprintf(stdout, "[Mesh] imported OBJ: %d vertices, %d triangles, ACMR %.3f -> %.3f\n",
+                 stats.vertex_count, stats.triangle_count, stats.acmr_before, stats.acmr_after);
+    data = imported.data();
+  }
+
+  const MeshFileHeader& header = *view.header;
+  WGPUBufferDescriptor desc = WGPU_BUFFER_DESCRIPTOR_INIT;
+  desc.label = make_str_view("imported_mesh_buffer");
+  desc.usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_Index;
+  desc.size = header.file_bytes;
+  desc.mappedAtCreation = WGPU_TRUE;
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(g_device, &desc);
+  void* dst = wgpuBufferGetMappedRange(buffer, 0, static_cast<size_t>(header.file_bytes));
+  std::memcpy(dst, data, static_cast<size_t>(header.file_bytes));
+  wgpuBufferUnmap(buffer);
+
+  if (g_imported_mesh_buffer) {
+    wgpuBufferRelease(g_imported_mesh_buffer);
+  }
+  g_imported_mesh_buffer = buffer;
+  g_imported_mesh = header;
+  g_bundles_dirty = true;
+  std::fprintf(stdout, "[Mesh] loaded %u vertices, %u indices (u%u), %llu bytes in %.1f ms\n",
+               header.vertex_count, header.index_count, header.index_bytes * 8,
+               static_cast<unsigned long long>(header.file_bytes), emscripten_get_now() - started);
+  return static_cast<int>(header.vertex_count);
+}
+
+// Writes the placed photos plus every shot still held by a snapshot layer,
+// with its encoded blob when the background encoder has produced one.
+size_t save_scene_file() {
+  std::vector<SceneFileSnapshotSource> shots;
+  for (size_t layer = 0; layer < g_snapshot_layers.layer_shot.size(); ++layer) {
+    const uint32_t shot_id = g_snapshot_layers.layer_shot[layer];
+    if (shot_id == 0) {
+      continue;
+    }
+    SceneFileSnapshotSource src{};
+    src.info = g_snapshot_payloads[layer].info;
+    if (src.info.id != shot_id) {
+      // Readback still in flight: metadata is not known here yet either.
+      continue;
+    }
+    if (g_snapshot_blob_shot[layer] == shot_id) {
+      src.blob = g_snapshot_blobs[layer].data();
+      src.blob_bytes = g_snapshot_blobs[layer].size();
+    }
+    shots.push_back(src);
+  }
+  std::sort(shots.begin(), shots.end(), [](const SceneFileSnapshotSource& a, const SceneFileSnapshotSource& b) {
+    return a.info.id < b.info.id;
+  });
+
+  scene_file_write(g_scene, shots.data(), static_cast<int>(shots.size()), g_photo_capture_count + 1, g_scene_file_bytes);
+  std::fprintf(stdout, "[Scene] saved %d photos, %zu shots, %zu bytes\n", g_scene.count, shots.size(), g_scene_file_bytes.size());
+  return g_scene_file_bytes.size();
+}
+
+// After the photos were replaced wholesale: one volume per photo until the
+// volumes run out.
+void rebuild_physics_volumes() {
+  physics_clear(g_physics);
+  for (int i = 0; i < g_scene.count; ++i) {
+    const PhotoHandle handle = scene_handle_at(g_scene, i);
+    physics_add_volume(g_physics, handle, kPhysicsBodiesPerFrame, handle);
+  }
+}
+
+void reset_snapshot_layers() {
+  snapshot_layers_init(g_snapshot_layers, static_cast<int>(kSnapshotLayers));
+  for (int layer = 0; layer < static_cast<int>(kSnapshotLayers); ++layer) {
+    residency_invalidate_layer(g_residency, layer);
+    g_snapshot_blobs[layer].clear();
+    g_snapshot_blob_shot[layer] = 0;
+  }
+  g_pending_captures.clear();
+  g_pending_restores.clear();
+}
+
+bool load_scene_file(const uint8_t* data, size_t size) {
+  const double started = emscripten_get_now();
+  SceneFileView view{};
+  if (!scene_file_open(data, size, view)) {
+    std::fprintf(stderr, "[Scene] load failed: not a valid scene file\n");
+    return false;
+  }
+  if (!scene_load_photos(g_scene, view)) {
+    std::fprintf(stderr, "[Scene] load failed: %u photos exceed capacity %d\n",
+                 view.header->photo_count, scene_capacity(g_scene));
+    return false;
+  }
+  rebuild_physics_volumes();
+  reset_snapshot_layers();
+
+  const uint32_t next_id = view.header->next_shot_id;
+  g_photo_capture_count = next_id > 0 ? next_id - 1 : 0;
+  for (uint32_t i = 0; i < view.header->snapshot_count; ++i) {
+    const SceneFileSnapshot& record = view.snapshots[i];
+    const int layer = snapshot_layer_assign(g_snapshot_layers, record.id);
+    if (layer < 0) {
+      continue;
+    }
+    g_last_snapshot = scene_file_snapshot_info(record);
+    g_has_snapshot = true;
+    g_photo_capture_count = std::max(g_photo_capture_count, record.id);
+    notify_page_snapshot_added(record.id);
+
+    if (record.blob_bytes == 0) {
+      continue;
+    }
+    const uint8_t* blob = view.blobs + record.blob_offset;
+    g_snapshot_blobs[layer].assign(blob, blob + record.blob_bytes);
+    g_snapshot_blob_shot[layer] = record.id;
+
+    SnapshotCodecJob job{};
+    job.kind = CodecJobKind::Decode;
+    job.tag = static_cast<uint32_t>(layer);
+    job.blob = g_snapshot_blobs[layer];
+    codec_worker_submit(g_codec_worker, std::move(job));
+  }
+
+  std::fprintf(stdout, "[Scene] loaded %u photos, %u shots in %.2f ms\n",
+               view.header->photo_count, view.header->snapshot_count, emscripten_get_now() - started);
+  return true;
+}
+
+// Replaces the scene the way a scene load does, with generated photos and
+// generated snapshots. Shots are capped at the layer count, since the round
+// robin would evict the rest before they were drawn. The camera goes back to
+// its start pose so runs with the same parameters see the same frames.
+// Returns the photo count, or -1 when the parameters do not fit.
+int generate_stress_scene(const SceneGenParams& params) {
+  const double started = emscripten_get_now();
+  SceneGenParams p = params;
+  p.shot_count = std::clamp(p.shot_count, 0, static_cast<int>(kSnapshotLayers));
+  if (!scene_generate(g_scene, p)) {
+    std::fprintf(stderr, "[Stress] generate failed: %d photos, layout %d, capacity %d\n",
+                 p.photo_count, static_cast<int>(p.layout), scene_capacity(g_scene));
+    return -1;
+  }
+  rebuild_physics_volumes();
+  reset_snapshot_layers();
+
+  for (int id = 1; id <= p.shot_count; ++id) {
+    const uint32_t shot_id = static_cast<uint32_t>(id);
+    const int layer = snapshot_layer_assign(g_snapshot_layers, shot_id);
+    SnapshotPayload& payload = g_snapshot_payloads[layer];
+    snapshot_generate(payload, shot_id, kSnapshotWidth, kSnapshotHeight, kCameraNear, kCameraFar);
+    residency_set_source_ready(g_residency, layer, true);
+    g_pending_restores.push_back(layer);
+    g_last_snapshot = payload.info;
+    g_has_snapshot = true;
+    notify_page_snapshot_added(shot_id);
+    send_page_snapshot_pixels(shot_id, payload.color.data(), payload.width, payload.height);
+
+    SnapshotCodecJob job{};
+    job.kind = CodecJobKind::Encode;
+    job.tag = static_cast<uint32_t>(layer);
+    job.payload = payload;
+    codec_worker_submit(g_codec_worker, std::move(job));
+  }
+  g_photo_capture_count = static_cast<uint32_t>(p.shot_count);
+  camera_init(g_camera);
+  g_dirty |= kDirtyRequested;
+  const uint32_t args[kInputTraceGenerateArgs] = {
+      static_cast<uint32_t>(p.layout), static_cast<uint32_t>(p.shot_count), p.seed};
+  record_input(InputEventType::Command, static_cast<int32_t>(InputCommand::GenerateScene), p.photo_count, args);
+  if (trace_photos_tracked()) {
+    input_trace_photos_reset(g_trace_photos, g_scene);
+  }
+
+  std::fprintf(stdout, "[Stress] %s: %d photos, %d shots in %.2f ms\n",
+               scene_layout_name(p.layout), g_scene.count, p.shot_count, emscripten_get_now() - started);
+  return g_scene.count;
+}
+
+void start_trace_recording() {
+  input_trace_begin(g_trace, g_camera, g_photo_capture_count + 1);
+  input_trace_photos_reset(g_trace_photos, g_scene);
+  g_trace_recording = true;
+  g_trace_start_frame = g_frame_index;
+  g_trace_start_ms = emscripten_get_now();
+  std::fprintf(stdout, "[Trace] recording input\n");
+}
+
+// Serializes the recording into g_trace_file_bytes. Returns its size, or 0
+// when nothing was being recorded.
+size_t finish_trace_recording() {
+  if (!g_trace_recording) {
+    return 0;
+  }
+  g_trace_recording = false;
+  g_trace.frame_count = std::max(g_trace.frame_count, static_cast<uint32_t>(g_frame_index - g_trace_start_frame));
+  input_trace_write(g_trace, g_trace_file_bytes);
+  std::fprintf(stdout, "[Trace] recorded %u frames, %zu inputs in %zu bytes\n",
+               g_trace.frame_count, g_trace.records.size(), g_trace_file_bytes.size());
+  return g_trace_file_bytes.size();
+}
+
+// Returns the trace's frame count, or -1 when the bytes are not a trace.
+int start_trace_replay(const uint8_t* data, size_t size) {
+  if (!input_trace_read(data, size, g_replay_trace)) {
+    std::fprintf(stderr, "[Replay] not a valid input trace\n");
+    return -1;
+  }
+  g_trace_recording = false;
+  input_trace_start_camera(g_replay_trace, g_camera);
+  input_trace_photos_reset(g_trace_photos, g_scene);
+  input_replay_begin(g_replay);
+  g_replay_shot_offset = static_cast<int64_t>(g_photo_capture_count) + 1 - g_replay_trace.first_shot_id;
+  g_replay_next_sample = g_frame_index;
+  g_replay_samples.clear();
+  g_replay_active = true;
+  g_dirty |= kDirtyRequested;
+  std::fprintf(stdout, "[Replay] %u frames, %zu inputs, step %.2f ms\n",
+               g_replay_trace.frame_count, g_replay_trace.records.size(), g_replay_trace.step_seconds * 1000.0f);
+  return static_cast<int>(g_replay_trace.frame_count);
+}
+
+// Keeps the profiler records of replayed frames before the ring overwrites
+// them.
+void collect_replay_samples(uint64_t up_to_frame) {
+  ProfileSample sample;
+  for (; g_replay_next_sample < up_to_frame; ++g_replay_next_sample) {
+    if (profiler_read_frame(g_profiler, g_replay_next_sample, sample)) {
+      g_replay_samples.push_back(sample);
+    }
+  }
+}
+
+void finish_replay() {
+  g_replay_active = false;
+  camera_release_keys(g_camera);
+  collect_replay_samples(g_frame_index);
+  const ProfileSummary frame = profiler_summarize(g_replay_samples, ProfileStage::Frame);
+  const ProfileSummary encode = profiler_summarize(g_replay_samples, ProfileStage::Encode);
+  const ProfileSummary gpu = profiler_summarize(g_replay_samples, ProfileStage::GpuMainPass);
+  std::fprintf(stdout,
+               "[Replay] done: %d frames, p50/p95/p99 frame %.2f/%.2f/%.2f ms, encode %.2f/%.2f/%.2f ms, "
+               "gpu %.2f/%.2f/%.2f ms (%d samples)\n",
+               frame.samples, frame.p50, frame.p95, frame.p99, encode.p50, encode.p95, encode.p99,
+               gpu.p50, gpu.p95, gpu.p99, gpu.samples);
+  MAIN_THREAD_ASYNC_EM_ASM({
+    if (window.__framespaceReplayFinished) {
+      window.__framespaceReplayFinished($0);
+    }
+  }, frame.samples);
+}
+
+extern "C" {
+EMSCRIPTEN_KEEPALIVE void framespace_trigger_capture() {
+  if (!g_replay_active) {
+    capture_photo_snapshot();
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_trigger_place() {
+  return g_replay_active ? kInvalidPhotoHandle : place_selected_snapshot();
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_remove_placed_photo(uint32_t handle) {
+  return delete_photo(handle) ? 1 : 0;
+}
+
+// Hover query: the photo under the crosshair without changing the selection.
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_pick_photo() {
+  return pick_photo_at_crosshair();
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_last_pick_us() {
+  return g_last_pick_us;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_select_photo(uint32_t handle) {
+  return select_photo(handle) ? 1 : 0;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_select_photo_at_crosshair() {
+  return select_photo_at_crosshair();
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_selected_photo() {
+  return selected_photo();
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_move_photo(uint32_t handle, float x, float y, float z, float yaw, float scale) {
+  return move_photo(handle, Vec3{x, y, z}, yaw, scale) ? 1 : 0;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_move_photo_to_crosshair(uint32_t handle) {
+  return move_photo_to_crosshair(handle) ? 1 : 0;
+}
+
+EMSCRIPTEN_KEEPALIVE void framespace_clear_placed_photos() {
+  physics_clear(g_physics);
+  scene_clear(g_scene);
+  select_photo(kInvalidPhotoHandle);
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_placed_photo_count() {
+  return g_scene.count;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_placed_photo_handle(int index) {
+  return scene_handle_at(g_scene, index);
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_uniform_bytes_per_frame() {
+  return g_last_upload_stats.uniform_bytes;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_upload_bytes_per_frame() {
+  return g_last_upload_stats.uniform_bytes + g_last_upload_stats.instance_bytes + g_last_upload_stats.texture_bytes;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_queue_writes_per_frame() {
+  return g_last_upload_stats.queue_writes;
+}
+
+// With GPU culling active the visible count is the latest one read back,
+// a few frames behind the placed count.
+EMSCRIPTEN_KEEPALIVE int framespace_get_visible_photo_count() {
+  return g_gpu_culling_active ? g_gpu_visible_count : g_scene.last_cull.visible;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_culled_photo_count() {
+  return g_gpu_culling_active ? std::max(0, g_scene.count - g_gpu_visible_count) : g_scene.last_cull.culled;
+}
+
+EMSCRIPTEN_KEEPALIVE void framespace_set_gpu_culling_enabled(int enabled) {
+  g_gpu_culling_enabled = enabled != 0;
+  g_dirty |= kDirtyRequested;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_gpu_culling_active() {
+  return g_gpu_culling_active ? 1 : 0;
+}
+
+// Hi-Z occlusion culling on top of GPU culling.
+EMSCRIPTEN_KEEPALIVE void framespace_set_occlusion_culling_enabled(int enabled) {
+  g_occlusion_culling_enabled = enabled != 0;
+  g_dirty |= kDirtyRequested;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_occluded_photo_count() {
+  return g_gpu_culling_active && g_occlusion_culling_enabled ? g_gpu_occluded_count : 0;
+}
+
+// Render on demand is the default; continuous rendering draws every frame
+// (benchmarks, frame time measurements).
+EMSCRIPTEN_KEEPALIVE void framespace_set_continuous_rendering(int enabled) {
+  g_render_on_demand = enabled == 0;
+  g_dirty |= kDirtyRequested;
+}
+
+// For page-side changes the dirty tracking cannot see.
+EMSCRIPTEN_KEEPALIVE void framespace_request_redraw() {
+  g_dirty |= kDirtyRequested;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_skipped_frame_count() {
+  return static_cast<int>(g_skipped_frames);
+}
+
+// Dynamic resolution. Turning it off returns to full scale on the next
+// drawn frame.
+EMSCRIPTEN_KEEPALIVE void framespace_set_dynamic_resolution_enabled(int enabled) {
+  g_dynamic_resolution_enabled = enabled != 0;
+  g_dirty |= kDirtyRequested;
+}
+
+EMSCRIPTEN_KEEPALIVE void framespace_set_frame_budget_ms(double ms) {
+  g_resolution.budget_ms = static_cast<float>(ms);
+  g_dirty |= kDirtyRequested;
+}
+
+// Fraction of the canvas size the scene currently renders at.
+EMSCRIPTEN_KEEPALIVE double framespace_get_render_scale() {
+  return g_resolution.scale;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_render_scale_changes() {
+  return static_cast<int>(g_resolution.changes);
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_export_snapshot(uint32_t shot_id) {
+  return export_snapshot(shot_id) ? 1 : 0;
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_last_capture_ms() {
+  return g_last_capture_ms;
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_last_readback_ms() {
+  return g_last_readback_ms;
+}
+
+// The ring can only be resized while no readback is in flight.
+EMSCRIPTEN_KEEPALIVE int framespace_set_readback_ring_depth(int depth) {
+  if (depth < 1 || !g_initialized || g_readback_ring.stats.in_flight > 0) {
+    return 0;
+  }
+  create_readback_ring(depth);
+  return 1;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_readback_in_flight() {
+  return g_readback_ring.stats.in_flight;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_readback_peak_in_flight() {
+  return g_readback_ring.stats.peak_in_flight;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_readback_deferred() {
+  return g_readback_ring.stats.deferred;
+}
+
+// Linear depth of the most recent readback at a snapshot texel, or -1.
+EMSCRIPTEN_KEEPALIVE float framespace_get_snapshot_depth(uint32_t shot_id, int x, int y) {
+  const int layer = snapshot_layer_find(g_snapshot_layers, shot_id);
+  if (layer < 0 || !g_residency.layer_source_ready[layer]) {
+    return -1.0f;
+  }
+  const SnapshotPayload& payload = g_snapshot_payloads[layer];
+  if (x < 0 || y < 0 || x >= static_cast<int>(payload.width) || y >= static_cast<int>(payload.height)) {
+    return -1.0f;
+  }
+  return payload.depth[static_cast<size_t>(y) * payload.width + static_cast<size_t>(x)];
+}
+
+EMSCRIPTEN_KEEPALIVE void framespace_set_snapshot_budget_bytes(double bytes) {
+  residency_set_budget(g_residency, static_cast<uint64_t>(bytes > 0.0 ? bytes : 0.0));
+  if (g_initialized) {
+    create_snapshot_detail_pool();
+    create_main_bind_group();
+  }
+  g_dirty |= kDirtyRequested;
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_snapshot_budget_bytes() {
+  return static_cast<double>(g_residency.budget_bytes);
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_snapshot_resident_bytes() {
+  return static_cast<double>(g_residency.last_stats.bytes_resident);
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_snapshot_uploads_per_frame() {
+  return g_residency.last_stats.uploads;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_snapshot_evictions_per_frame() {
+  return g_residency.last_stats.evictions;
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_snapshot_evictions_total() {
+  return static_cast<double>(g_residency.total_evictions);
+}
+
+// Size of the shot's encoded blob, or 0 while it is still being encoded.
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_snapshot_encoded_bytes(uint32_t shot_id) {
+  const int layer = snapshot_layer_find(g_snapshot_layers, shot_id);
+  if (layer < 0 || g_snapshot_blob_shot[layer] != shot_id) {
+    return 0;
+  }
+  return static_cast<uint32_t>(g_snapshot_blobs[layer].size());
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_snapshot_encoded_total_bytes() {
+  double total = 0.0;
+  for (size_t layer = 0; layer < g_snapshot_blobs.size(); ++layer) {
+    if (g_snapshot_blob_shot[layer] != 0 && g_snapshot_layers.layer_shot[layer] == g_snapshot_blob_shot[layer]) {
+      total += static_cast<double>(g_snapshot_blobs[layer].size());
+    }
+  }
+  return total;
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_last_encode_ms() {
+  return g_last_encode_ms;
+}
+
+EMSCRIPTEN_KEEPALIVE void framespace_set_profiler_enabled(int enabled) {
+  g_profiler.enabled = enabled != 0;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_profile_stage_count() {
+  return kProfileStageCount;
+}
+
+EMSCRIPTEN_KEEPALIVE const char* framespace_get_profile_stage_name(int stage) {
+  return profile_stage_name(static_cast<ProfileStage>(stage));
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_profile_counter_count() {
+  return kProfileCounterCount;
+}
+
+EMSCRIPTEN_KEEPALIVE const char* framespace_get_profile_counter_name(int counter) {
+  return profile_counter_name(static_cast<ProfileCounter>(counter));
+}
+
+// Mean of a ProfileCounter over the same window as the percentiles; -1
+// while nothing recorded it.
+EMSCRIPTEN_KEEPALIVE float framespace_get_profile_counter_mean(int counter) {
+  if (counter < 0 || counter >= kProfileCounterCount) {
+    return -1.0f;
+  }
+  profiler_snapshot(g_profiler, g_profile_samples, kProfileSummaryFrames);
+  return profiler_counter_mean(g_profile_samples, static_cast<ProfileCounter>(counter));
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_has_gpu_timestamps() {
+  return g_timestamp_query_set ? 1 : 0;
+}
+
+// p50/p95/p99 (percentile = 50, 95 or 99; anything else returns the max) of
+// a stage over the last few seconds of frames, in ms; -1 without samples.
+EMSCRIPTEN_KEEPALIVE float framespace_get_profile_percentile_ms(int stage, int percentile) {
+  if (stage < 0 || stage >= kProfileStageCount) {
+    return -1.0f;
+  }
+  profiler_snapshot(g_profiler, g_profile_samples, kProfileSummaryFrames);
+  const ProfileSummary summary = profiler_summarize(g_profile_samples, static_cast<ProfileStage>(stage));
+  if (summary.samples == 0) {
+    return -1.0f;
+  }
+  switch (percentile) {
+    case 50: return summary.p50;
+    case 95: return summary.p95;
+    case 99: return summary.p99;
+    default: return summary.max;
+  }
 }
 
-void capture_photo_snapshot() {
-  g_photo_capture_count += 1;
-  g_last_snapshot.id = g_photo_capture_count;
-  g_last_snapshot.position = g_camera_pos;
-  g_last_snapshot.yaw = g_camera_yaw;
-  g_last_snapshot.pitch = g_camera_pitch;
-  g_last_snapshot.timestamp_ms = emscripten_get_now();
-  g_has_snapshot = true;
+// Chrome trace JSON of every frame still in the profiler ring. The string
+// stays valid until the next call.
+EMSCRIPTEN_KEEPALIVE const char* framespace_dump_profile_trace() {
+  profiler_snapshot(g_profiler, g_profile_samples, kProfilerRingSize);
+  profiler_write_chrome_trace(g_profile_samples, g_profile_trace);
+  return g_profile_trace.c_str();
+}
 
-  std::fprintf(stdout, "[Capture] shot=%u pos=(%.2f, %.2f, %.2f) yaw=%.2f pitch=%.2f\n",
-               g_last_snapshot.id,
-               g_last_snapshot.position.x,
-               g_last_snapshot.position.y,
-               g_last_snapshot.position.z,
-               g_last_snapshot.yaw,
-               g_last_snapshot.pitch);
+EMSCRIPTEN_KEEPALIVE int framespace_get_job_thread_count() {
+  return jobs_thread_count(g_jobs);
+}
 
-  EM_ASM({
-    const shotId = $0;
-    if (window.__framespaceAddSnapshotFromCanvas) {
-      window.__framespaceAddSnapshotFromCanvas(shotId);
-    }
-  }, static_cast<int>(g_last_snapshot.id));
+// Startup milestones (see StartupMark) in ms since page load; negative until
+// reached.
+EMSCRIPTEN_KEEPALIVE int framespace_get_startup_mark_count() {
+  return kStartupMarkCount;
 }
 
-void place_selected_snapshot() {
-  const int selected_shot = EM_ASM_INT({
-    return window.__framespaceGetSelectedShotId ? window.__framespaceGetSelectedShotId() : 0;
-  });
-  if (selected_shot <= 0) {
-    std::fprintf(stdout, "[Place] skipped: no selected snapshot\n");
-    return;
-  }
-  const int shot_exists = EM_ASM_INT({
-    if (!window.__framespaceHasShotId) return 0;
-    return window.__framespaceHasShotId($0) ? 1 : 0;
-  }, selected_shot);
-  if (!shot_exists) {
-    std::fprintf(stdout, "[Place] skipped: selected snapshot no longer exists (id=%d)\n", selected_shot);
-    return;
-  }
+EMSCRIPTEN_KEEPALIVE const char* framespace_get_startup_mark_name(int mark) {
+  return startup_mark_name(static_cast<StartupMark>(mark));
+}
 
-  int free_slot = -1;
-  for (int i = 0; i < kMaxPlacedPhotos; ++i) {
-    if (!g_placed_photos[i].active) {
-      free_slot = i;
-      break;
-    }
+EMSCRIPTEN_KEEPALIVE double framespace_get_startup_mark_ms(int mark) {
+  if (mark < 0 || mark >= kStartupMarkCount) {
+    return -1.0;
   }
-  if (free_slot < 0) {
-    std::fprintf(stdout, "[Place] skipped: photo slots are full\n");
-    return;
+  return g_startup.mark_ms[mark];
+}
+
+// Replays the static scene draws from render bundles (default) or encodes
+// them directly every frame, for A/B comparison of the encode stage.
+EMSCRIPTEN_KEEPALIVE void framespace_set_render_bundles_enabled(int enabled) {
+  g_bundles_enabled = enabled != 0;
+  g_dirty |= kDirtyRequested;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_render_bundle_rebuilds() {
+  return static_cast<int>(g_bundle_stats.rebuilds);
+}
+
+// Running total of CPU encode time saved by replaying bundles, estimated as
+// the cost of recording the same draws minus the cost of replaying them.
+EMSCRIPTEN_KEEPALIVE double framespace_get_render_bundle_saved_ms() {
+  return g_bundle_stats.saved_ms_total;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_physics_body_count() {
+  return physics_body_count(g_physics);
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_physics_awake_bodies() {
+  return g_physics.last_stats.awake_bodies;
+}
+
+EMSCRIPTEN_KEEPALIVE double framespace_get_physics_steps_total() {
+  return static_cast<double>(g_physics.total_steps);
+}
+
+// Total simulated time skipped because a frame would have needed more than
+// kPhysicsMaxSubsteps steps.
+EMSCRIPTEN_KEEPALIVE double framespace_get_physics_dropped_seconds() {
+  return g_physics.last_stats.dropped_seconds;
+}
+
+// 1 when the renderer runs in a worker on a transferred OffscreenCanvas; the
+// page then forwards input and commands through framespace_input_queue_ptr.
+EMSCRIPTEN_KEEPALIVE int framespace_render_in_worker() {
+#if defined(FRAMESPACE_WORKER_RENDER)
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+EMSCRIPTEN_KEEPALIVE uintptr_t framespace_input_queue_ptr() {
+  return reinterpret_cast<uintptr_t>(&g_input_queue);
+}
+
+// Stats the page polls, published once per frame (see page_stats.h).
+EMSCRIPTEN_KEEPALIVE uintptr_t framespace_page_stats_ptr() {
+  return reinterpret_cast<uintptr_t>(&g_page_stats);
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_get_input_dropped() {
+  return g_input_queue.dropped.load(std::memory_order_relaxed);
+}
+
+// Serializes the scene into a native buffer and returns its size; the page
+// reads it through framespace_scene_file_ptr and streams it to storage.
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_scene_save() {
+  return static_cast<uint32_t>(save_scene_file());
+}
+
+EMSCRIPTEN_KEEPALIVE uintptr_t framespace_scene_file_ptr() {
+  return reinterpret_cast<uintptr_t>(g_scene_file_bytes.data());
+}
+
+// Streaming load: the page allocates the destination with _begin, copies
+// chunks into it as storage delivers them, reporting progress with _chunk
+// (which rejects a bad header as soon as the first chunk lands), and
+// applies the scene with _end.
+EMSCRIPTEN_KEEPALIVE uintptr_t framespace_scene_load_begin(uint32_t total_bytes) {
+  g_scene_load_bytes.assign(total_bytes, 0);
+  return reinterpret_cast<uintptr_t>(g_scene_load_bytes.data());
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_scene_load_chunk(uint32_t received_bytes) {
+  SceneFileHeader header{};
+  if (received_bytes < sizeof(SceneFileHeader)) {
+    return 1;
   }
+  return scene_file_peek_header(g_scene_load_bytes.data(), received_bytes, header) &&
+                 header.file_bytes <= g_scene_load_bytes.size()
+             ? 1
+             : 0;
+}
 
-  const Vec3 forward = camera_forward();
-  const Vec3 pos = vec3_add(g_camera_pos, vec3_scale(forward, 2.8f));
+EMSCRIPTEN_KEEPALIVE int framespace_scene_load_end() {
+  const bool ok = load_scene_file(g_scene_load_bytes.data(), g_scene_load_bytes.size());
+  g_scene_load_bytes.clear();
+  g_scene_load_bytes.shrink_to_fit();
+  return ok ? g_scene.count : -1;
+}
 
-  g_placed_photos[free_slot].active = true;
-  g_placed_photos[free_slot].shot_id = static_cast<uint32_t>(selected_shot);
-  g_placed_photos[free_slot].position = pos;
-  g_placed_photos[free_slot].yaw = g_camera_yaw + 3.14159265f;
-  g_placed_photos[free_slot].scale = 1.0f;
+// Stress scenes: begin stages the parameters (layout 0 grid, 1 corridor,
+// 2 cloud), end generates and returns the photo count or -1. Worker mode
+// sends GenerateScene instead of calling end.
+EMSCRIPTEN_KEEPALIVE void framespace_generate_scene_begin(int layout, int photo_count, int shot_count, uint32_t seed) {
+  g_generate_params = SceneGenParams{static_cast<SceneLayout>(layout), photo_count, shot_count, seed};
+}
 
-  std::fprintf(stdout, "[Place] shot=%u slot=%d pos=(%.2f, %.2f, %.2f)\n",
-               g_placed_photos[free_slot].shot_id,
-               free_slot,
-               g_placed_photos[free_slot].position.x,
-               g_placed_photos[free_slot].position.y,
-               g_placed_photos[free_slot].position.z);
+EMSCRIPTEN_KEEPALIVE int framespace_generate_scene_end() {
+  return generate_stress_scene(g_generate_params);
 }
 
-extern "C" {
-EMSCRIPTEN_KEEPALIVE void framespace_trigger_capture() {
-  capture_photo_snapshot();
+// Same begin/end protocol for a mesh (OBJ text or a packed .fsmesh blob).
+// Returns the vertex count, or -1 when the bytes were rejected.
+EMSCRIPTEN_KEEPALIVE uintptr_t framespace_mesh_load_begin(uint32_t total_bytes) {
+  g_mesh_load_bytes.assign(total_bytes, 0);
+  return reinterpret_cast<uintptr_t>(g_mesh_load_bytes.data());
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_mesh_load_end() {
+  const int count = load_mesh_blob(g_mesh_load_bytes.data(), g_mesh_load_bytes.size());
+  g_mesh_load_bytes.clear();
+  g_mesh_load_bytes.shrink_to_fit();
+  return count;
+}
+
+// Input recording. End returns the trace size; the bytes stay at
+// framespace_trace_file_ptr() until the next recording ends.
+EMSCRIPTEN_KEEPALIVE void framespace_trace_record_begin() {
+  start_trace_recording();
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t framespace_trace_record_end() {
+  return static_cast<uint32_t>(finish_trace_recording());
+}
+
+EMSCRIPTEN_KEEPALIVE uintptr_t framespace_trace_file_ptr() {
+  return reinterpret_cast<uintptr_t>(g_trace_file_bytes.data());
+}
+
+// Replay, with the same begin/end protocol as the scene load. End returns
+// the frame count, or -1 when the bytes are not a trace.
+EMSCRIPTEN_KEEPALIVE uintptr_t framespace_trace_replay_begin(uint32_t total_bytes) {
+  g_replay_load_bytes.assign(total_bytes, 0);
+  return reinterpret_cast<uintptr_t>(g_replay_load_bytes.data());
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_trace_replay_end() {
+  const int frames = start_trace_replay(g_replay_load_bytes.data(), g_replay_load_bytes.size());
+  g_replay_load_bytes.clear();
+  g_replay_load_bytes.shrink_to_fit();
+  return frames;
+}
+
+EMSCRIPTEN_KEEPALIVE int framespace_get_replay_active() {
+  return g_replay_active ? 1 : 0;
+}
+
+// Percentiles over every frame of the last finished replay; -1 without one.
+EMSCRIPTEN_KEEPALIVE float framespace_get_replay_percentile_ms(int stage, int percentile) {
+  if (stage < 0 || stage >= kProfileStageCount || g_replay_active) {
+    return -1.0f;
+  }
+  const ProfileSummary summary = profiler_summarize(g_replay_samples, static_cast<ProfileStage>(stage));
+  if (summary.samples == 0) {
+    return -1.0f;
+  }
+  switch (percentile) {
+    case 50: return summary.p50;
+    case 95: return summary.p95;
+    case 99: return summary.p99;
+    default: return summary.max;
+  }
+}
+}
+
+void set_key(InputKey key, bool down) {
+  if (camera_set_key(g_camera, key, down)) {
+    record_input(down ? InputEventType::KeyDown : InputEventType::KeyUp, static_cast<int32_t>(key), 0, nullptr);
+  }
 }
 
-EMSCRIPTEN_KEEPALIVE void framespace_trigger_place() {
-  place_selected_snapshot();
+InputKey input_key_from_code(const char* code) {
+  if (std::strcmp(code, "KeyW") == 0) return InputKey::W;
+  if (std::strcmp(code, "KeyA") == 0) return InputKey::A;
+  if (std::strcmp(code, "KeyS") == 0) return InputKey::S;
+  if (std::strcmp(code, "KeyD") == 0) return InputKey::D;
+  if (std::strcmp(code, "ShiftLeft") == 0 || std::strcmp(code, "ShiftRight") == 0) return InputKey::Shift;
+  return InputKey::Count;
 }
+
+// Mouse deltas arrive as whole CSS pixels, which is what gets recorded.
+void apply_mouse_look(int32_t movement_x, int32_t movement_y) {
+  camera_mouse_look(g_camera, static_cast<float>(movement_x), static_cast<float>(movement_y));
+  record_input(InputEventType::MouseMove, movement_x, movement_y, nullptr);
+  g_dirty |= kDirtyCamera;
 }
 
 EM_BOOL on_key_down(int, const EmscriptenKeyboardEvent* e, void*) {
-  if (std::strcmp(e->code, "KeyW") == 0) g_key_w = true;
-  if (std::strcmp(e->code, "KeyA") == 0) g_key_a = true;
-  if (std::strcmp(e->code, "KeyS") == 0) g_key_s = true;
-  if (std::strcmp(e->code, "KeyD") == 0) g_key_d = true;
-  if (std::strcmp(e->code, "ShiftLeft") == 0 || std::strcmp(e->code, "ShiftRight") == 0) g_key_shift = true;
+  if (g_replay_active) {
+    return EM_TRUE;
+  }
+  set_key(input_key_from_code(e->code), true);
   if (std::strcmp(e->code, "KeyP") == 0 && !e->repeat) capture_photo_snapshot();
   if (std::strcmp(e->code, "KeyE") == 0 && !e->repeat) place_selected_snapshot();
+  if (std::strcmp(e->code, "KeyF") == 0 && !e->repeat) select_photo_at_crosshair();
+  if (std::strcmp(e->code, "KeyG") == 0 && !e->repeat) move_photo_to_crosshair(selected_photo());
+  if ((std::strcmp(e->code, "KeyX") == 0 || std::strcmp(e->code, "Delete") == 0) && !e->repeat) {
+    delete_photo(selected_photo());
+  }
   return EM_TRUE;
 }
 
 EM_BOOL on_key_up(int, const EmscriptenKeyboardEvent* e, void*) {
-  if (std::strcmp(e->code, "KeyW") == 0) g_key_w = false;
-  if (std::strcmp(e->code, "KeyA") == 0) g_key_a = false;
-  if (std::strcmp(e->code, "KeyS") == 0) g_key_s = false;
-  if (std::strcmp(e->code, "KeyD") == 0) g_key_d = false;
-  if (std::strcmp(e->code, "ShiftLeft") == 0 || std::strcmp(e->code, "ShiftRight") == 0) g_key_shift = false;
+  if (g_replay_active) {
+    return EM_TRUE;
+  }
+  set_key(input_key_from_code(e->code), false);
   return EM_TRUE;
 }
 
 EM_BOOL on_mouse_move(int, const EmscriptenMouseEvent* e, void*) {
   EmscriptenPointerlockChangeEvent lock_status{};
-  if (!emscripten_get_pointerlock_status(&lock_status) || !lock_status.isActive) {
+  if (g_replay_active || !emscripten_get_pointerlock_status(&lock_status) || !lock_status.isActive) {
     return EM_TRUE;
   }
-
-  const float sens = 0.0025f;
-  g_camera_yaw += static_cast<float>(e->movementX) * sens;
-  g_camera_pitch -= static_cast<float>(e->movementY) * sens;
-
-  const float limit = 1.553343f;
-  if (g_camera_pitch > limit) g_camera_pitch = limit;
-  if (g_camera_pitch < -limit) g_camera_pitch = -limit;
+  apply_mouse_look(static_cast<int32_t>(e->movementX), static_cast<int32_t>(e->movementY));
   return EM_TRUE;
 }
 
@@ -550,41 +3470,413 @@ void register_input_callbacks() {
   emscripten_set_click_callback("#canvas", nullptr, true, on_click);
 }
 
+void run_input_command(InputCommand command, int32_t arg) {
+  switch (command) {
+    case InputCommand::Capture:
+      capture_photo_snapshot();
+      break;
+    case InputCommand::Place:
+      place_snapshot(arg);
+      break;
+    case InputCommand::Export:
+      export_snapshot(static_cast<uint32_t>(arg));
+      break;
+    case InputCommand::SaveScene: {
+      const size_t size = save_scene_file();
+      MAIN_THREAD_ASYNC_EM_ASM({
+        if (window.__framespaceSceneSaved) {
+          window.__framespaceSceneSaved($0, $1);
+        }
+      }, g_scene_file_bytes.data(), static_cast<uint32_t>(size));
+      break;
+    }
+    case InputCommand::LoadScene: {
+      const int count = framespace_scene_load_end();
+      MAIN_THREAD_ASYNC_EM_ASM({
+        if (window.__framespaceSceneLoaded) {
+          window.__framespaceSceneLoaded($0);
+        }
+      }, count);
+      break;
+    }
+    case InputCommand::GenerateScene: {
+      const int count = framespace_generate_scene_end();
+      MAIN_THREAD_ASYNC_EM_ASM({
+        if (window.__framespaceSceneGenerated) {
+          window.__framespaceSceneGenerated($0);
+        }
+      }, count);
+      break;
+    }
+    case InputCommand::LoadMesh: {
+      const int count = framespace_mesh_load_end();
+      MAIN_THREAD_ASYNC_EM_ASM({
+        if (window.__framespaceMeshLoaded) {
+          window.__framespaceMeshLoaded($0);
+        }
+      }, count);
+      break;
+    }
+    case InputCommand::RecordTrace: {
+      if (arg != 0) {
+        start_trace_recording();
+        break;
+      }
+      const size_t size = finish_trace_recording();
+      MAIN_THREAD_ASYNC_EM_ASM({
+        if (window.__framespaceTraceRecorded) {
+          window.__framespaceTraceRecorded($0, $1);
+        }
+      }, g_trace_file_bytes.data(), static_cast<uint32_t>(size));
+      break;
+    }
+    case InputCommand::SelectPhoto:
+      if (arg != 0) {
+        select_photo(static_cast<PhotoHandle>(arg));
+      } else {
+        select_photo_at_crosshair();
+      }
+      break;
+    case InputCommand::MovePhoto:
+      move_photo_to_crosshair(arg != 0 ? static_cast<PhotoHandle>(arg) : selected_photo());
+      break;
+    case InputCommand::DeletePhoto:
+      delete_photo(arg != 0 ? static_cast<PhotoHandle>(arg) : selected_photo());
+      break;
+    case InputCommand::ReplayTrace: {
+      const int frames = framespace_trace_replay_end();
+      MAIN_THREAD_ASYNC_EM_ASM({
+        if (window.__framespaceReplayStarted) {
+          window.__framespaceReplayStarted($0);
+        }
+      }, frames);
+      break;
+    }
+    case InputCommand::SetContinuousRendering:
+      framespace_set_continuous_rendering(arg);
+      break;
+    case InputCommand::SetDynamicResolution:
+      framespace_set_dynamic_resolution_enabled(arg);
+      break;
+    case InputCommand::DumpProfileTrace: {
+      framespace_dump_profile_trace();
+      MAIN_THREAD_ASYNC_EM_ASM({
+        if (window.__framespaceProfileTrace) {
+          window.__framespaceProfileTrace($0, $1);
+        }
+      }, g_profile_trace.data(), static_cast<uint32_t>(g_profile_trace.size()));
+      break;
+    }
+  }
+}
+
+void replay_command(const InputEvent& e) {
+  switch (static_cast<InputCommand>(e.a)) {
+    case InputCommand::Capture:
+      capture_photo_snapshot();
+      break;
+    case InputCommand::Place: {
+      const int64_t shot = e.b >= static_cast<int32_t>(g_replay_trace.first_shot_id) ? e.b + g_replay_shot_offset : e.b;
+      place_snapshot(static_cast<int>(shot));
+      break;
+    }
+    case InputCommand::MovePhoto: {
+      const uint32_t* args = input_trace_args(g_replay_trace, e);
+      if (args == nullptr) {
+        break;
+      }
+      float pose[kInputTraceMoveArgs];
+      std::memcpy(pose, args, sizeof(pose));
+      move_photo(input_trace_photos_handle(g_trace_photos, static_cast<uint32_t>(e.b)),
+                 Vec3{pose[0], pose[1], pose[2]}, pose[3], pose[4]);
+      break;
+    }
+    case InputCommand::DeletePhoto:
+      delete_photo(input_trace_photos_handle(g_trace_photos, static_cast<uint32_t>(e.b)));
+      break;
+    case InputCommand::GenerateScene: {
+      // Shot ids start over from 1 on both sides, so they no longer shift.
+      const uint32_t* args = input_trace_args(g_replay_trace, e);
+      if (args == nullptr) {
+        break;
+      }
+      generate_stress_scene(
+          SceneGenParams{static_cast<SceneLayout>(args[0]), e.b, static_cast<int>(args[1]), args[2]});
+      g_replay_shot_offset = 0;
+      break;
+    }
+    default: break;
+  }
+}
+
+// Applies the next replay frame's inputs through the same paths live input
+// takes; ends the replay after its last frame.
+void advance_replay() {
+  if (!input_replay_next_frame(g_replay, g_replay_trace, g_replay_events)) {
+    finish_replay();
+    return;
+  }
+  for (const InputEvent& e : g_replay_events) {
+    switch (static_cast<InputEventType>(e.type)) {
+      case InputEventType::KeyDown: set_key(static_cast<InputKey>(e.a), true); break;
+      case InputEventType::KeyUp: set_key(static_cast<InputKey>(e.a), false); break;
+      case InputEventType::MouseMove: apply_mouse_look(e.a, e.b); break;
+      case InputEventType::Command: replay_command(e); break;
+      default: break;
+    }
+  }
+}
+
+// Worker render mode: everything the page sends arrives here, once per frame.
+void drain_input_queue() {
+  const int count = input_queue_drain(g_input_queue, g_input_events, static_cast<int>(kInputQueueCapacity));
+  for (int i = 0; i < count; ++i) {
+    const InputEvent& e = g_input_events[i];
+    // A running replay owns the camera and the capture, place, move and
+    // delete stream.
+    const bool replayed = static_cast<InputEventType>(e.type) != InputEventType::Command ||
+                          e.a == static_cast<int32_t>(InputCommand::Capture) ||
+                          e.a == static_cast<int32_t>(InputCommand::Place) ||
+                          e.a == static_cast<int32_t>(InputCommand::MovePhoto) ||
+                          e.a == static_cast<int32_t>(InputCommand::DeletePhoto);
+    if (g_replay_active && replayed) {
+      continue;
+    }
+    switch (static_cast<InputEventType>(e.type)) {
+      case InputEventType::KeyDown: set_key(static_cast<InputKey>(e.a), true); break;
+      case InputEventType::KeyUp: set_key(static_cast<InputKey>(e.a), false); break;
+      case InputEventType::MouseMove: apply_mouse_look(e.a, e.b); break;
+      case InputEventType::Command: run_input_command(static_cast<InputCommand>(e.a), e.b); break;
+      default: break;
+    }
+  }
+}
+
+void collect_encoded_snapshots() {
+  g_codec_finished.clear();
+  codec_worker_collect(g_codec_worker, g_codec_finished);
+  for (SnapshotCodecJob& job : g_codec_finished) {
+    const int layer = static_cast<int>(job.tag);
+    if (!job.ok || g_snapshot_layers.layer_shot[layer] != job.payload.info.id) {
+      continue;
+    }
+    if (job.kind == CodecJobKind::Decode) {
+      g_snapshot_payloads[layer] = std::move(job.payload);
+      residency_set_source_ready(g_residency, layer, true);
+      g_pending_restores.push_back(layer);
+
+      const SnapshotPayload& payload = g_snapshot_payloads[layer];
+      send_page_snapshot_pixels(payload.info.id, payload.color.data(), payload.width, payload.height);
+      continue;
+    }
+    g_snapshot_blobs[layer] = std::move(job.blob);
+    g_snapshot_blob_shot[layer] = job.payload.info.id;
+    g_last_encode_ms = job.elapsed_ms;
+  }
+}
+
+// Feeds the last frame's cost to the dynamic resolution controller and
+// resizes the render targets when it steps.
+void update_render_scale() {
+  if (!g_dynamic_resolution_enabled) {
+    if (g_resolution.scale != 1.0f) {
+      resolution_init(g_resolution, g_resolution.budget_ms);
+      create_render_targets();
+    }
+    return;
+  }
+  float cost_ms = g_last_frame_cpu_ms;
+  if (g_timestamp_query_set && g_profiler.enabled) {
+    cost_ms = g_gpu_pass_ms;
+    g_gpu_pass_ms = -1.0f;
+  }
+  if (cost_ms >= 0.0f && resolution_update(g_resolution, cost_ms)) {
+    create_render_targets();
+  }
+}
+
+// Folds the state-driven dirty sources into g_dirty. Mouse look, resizes and
+// redraw requests mark it where they happen.
+bool frame_is_dirty() {
+  if (camera_moving(g_camera)) {
+    g_dirty |= kDirtyCamera;
+  }
+  if (g_scene.version != g_drawn_scene_version || g_bundles_dirty) {
+    g_dirty |= kDirtyScene;
+  }
+  if (!g_pending_captures.empty() || !g_pending_restores.empty() || g_residency_streaming) {
+    g_dirty |= kDirtyTextures;
+  }
+  // Visible volumes that have come to rest are not stepped, so this only
+  // holds while something in view is still moving.
+  if (g_physics.last_stats.awake_bodies > 0) {
+    g_dirty |= kDirtySimulation;
+  }
+  return g_dirty != 0;
+}
+
+// Stand-in for frame() while pipelines compile: one clear pass, nothing else,
+// so the canvas shows the background instead of staying blank.
+void present_clear_frame() {
+  WGPUSurfaceTexture surface_texture = WGPU_SURFACE_TEXTURE_INIT;
+  wgpuSurfaceGetCurrentTexture(g_surface, &surface_texture);
+  if (surface_texture.status != WGPUSurfaceGetCurrentTextureStatus_SuccessOptimal &&
+      surface_texture.status != WGPUSurfaceGetCurrentTextureStatus_SuccessSuboptimal) {
+    return;
+  }
+  WGPUTextureView color_view = wgpuTextureCreateView(surface_texture.texture, nullptr);
+
+  WGPUCommandEncoderDescriptor encoder_desc = WGPU_COMMAND_ENCODER_DESCRIPTOR_INIT;
+  encoder_desc.label = make_str_view("clear_encoder");
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(g_device, &encoder_desc);
+
+  WGPURenderPassColorAttachment color_attachment = WGPU_RENDER_PASS_COLOR_ATTACHMENT_INIT;
+  color_attachment.view = color_view;
+  color_attachment.loadOp = WGPULoadOp_Clear;
+  color_attachment.storeOp = WGPUStoreOp_Store;
+  color_attachment.clearValue = WGPUColor{0.06, 0.08, 0.11, 1.0};
+
+  WGPURenderPassDescriptor pass_desc = WGPU_RENDER_PASS_DESCRIPTOR_INIT;
+  pass_desc.colorAttachmentCount = 1;
+  pass_desc.colorAttachments = &color_attachment;
+  WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &pass_desc);
+  wgpuRenderPassEncoderEnd(pass);
+  wgpuRenderPassEncoderRelease(pass);
+
+  WGPUCommandBuffer cmd = wgpuCommandEncoderFinish(encoder, nullptr);
+  wgpuQueueSubmit(g_queue, 1, &cmd);
+  startup_mark(g_startup, StartupMark::FirstClearFrame, emscripten_get_now());
+
+  wgpuCommandBufferRelease(cmd);
+  wgpuCommandEncoderRelease(encoder);
+  wgpuTextureViewRelease(color_view);
+  wgpuTextureRelease(surface_texture.texture);
+}
+
+void log_startup_timeline() {
+  const double* ms = g_startup.mark_ms;
+  std::fprintf(stdout,
+               "[Startup] adapter %.1f ms, device %.1f ms, pipelines %.1f ms, first frame %.1f ms "
+               "(main at %.1f ms, first clear %.1f ms)\n",
+               ms[static_cast<int>(StartupMark::AdapterReady)],
+               ms[static_cast<int>(StartupMark::DeviceReady)],
+               ms[static_cast<int>(StartupMark::PipelinesReady)],
+               ms[static_cast<int>(StartupMark::FirstFrame)],
+               ms[static_cast<int>(StartupMark::MainStart)],
+               ms[static_cast<int>(StartupMark::FirstClearFrame)]);
+}
+
+// Copies the stats the page polls into g_page_stats. The page reads only
+// that block, so in worker render mode it never touches the renderer's own
+// state.
+void publish_page_stats() {
+  profiler_snapshot(g_profiler, g_profile_samples, kProfileSummaryFrames);
+  const ProfileSummary frame = profiler_summarize(g_profile_samples, ProfileStage::Frame);
+  const ProfileSummary encode = profiler_summarize(g_profile_samples, ProfileStage::Encode);
+  const ProfileSummary gpu = profiler_summarize(g_profile_samples, ProfileStage::GpuMainPass);
+  double values[kPageStatCount];
+  auto set = [&](PageStat stat, double value) { values[static_cast<int>(stat)] = value; };
+  auto percentile = [](const ProfileSummary& s, float ms) { return s.samples > 0 ? static_cast<double>(ms) : -1.0; };
+  set(PageStat::FrameP50, percentile(frame, frame.p50));
+  set(PageStat::FrameP95, percentile(frame, frame.p95));
+  set(PageStat::FrameP99, percentile(frame, frame.p99));
+  set(PageStat::EncodeP50, percentile(encode, encode.p50));
+  set(PageStat::EncodeP95, percentile(encode, encode.p95));
+  set(PageStat::GpuP50, percentile(gpu, gpu.p50));
+  set(PageStat::GpuP95, percentile(gpu, gpu.p95));
+  set(PageStat::GpuP99, percentile(gpu, gpu.p99));
+  set(PageStat::OccludedMean, profiler_counter_mean(g_profile_samples, ProfileCounter::PhotosOccluded));
+  set(PageStat::VisiblePhotos, framespace_get_visible_photo_count());
+  set(PageStat::SkippedFrames, framespace_get_skipped_frame_count());
+  set(PageStat::RenderScale, framespace_get_render_scale());
+  set(PageStat::FirstFrameMs, framespace_get_startup_mark_ms(static_cast<int>(StartupMark::FirstFrame)));
+  set(PageStat::SnapshotResidentBytes, framespace_get_snapshot_resident_bytes());
+  set(PageStat::SnapshotBudgetBytes, framespace_get_snapshot_budget_bytes());
+  set(PageStat::SnapshotEvictions, framespace_get_snapshot_evictions_total());
+  set(PageStat::SnapshotEncodedBytes, framespace_get_snapshot_encoded_total_bytes());
+  set(PageStat::LastEncodeMs, framespace_get_last_encode_ms());
+  page_stats_publish(g_page_stats, values);
+}
+
 void frame() {
   if (!g_initialized) {
     return;
   }
+  // Published before anything can return early, so skipped frames still
+  // refresh the page's view.
+  publish_page_stats();
 
   const double now_ms = emscripten_get_now();
   float dt_sec = 1.0f / 60.0f;
   if (g_last_time_ms > 0.0) {
     dt_sec = static_cast<float>((now_ms - g_last_time_ms) * 0.001);
   }
+  float real_dt_sec = dt_sec;
   if (dt_sec > 0.05f) {
     dt_sec = 0.05f;
   }
   g_last_time_ms = now_ms;
-  g_accum_time += dt_sec;
 
-  recreate_surface_if_needed();
-  update_camera(dt_sec);
-  update_view_projection();
+  profiler_begin_frame(g_profiler, g_frame_index, profiler_now_ms());
+  {
+    ProfileScope scope(g_profiler, ProfileStage::RecreateSurface);
+    recreate_surface_if_needed();
+  }
+  collect_encoded_snapshots();
+  drain_input_queue();
+  if (g_replay_active) {
+    dt_sec = g_replay_trace.step_seconds;
+    real_dt_sec = dt_sec;
+    advance_replay();
+    g_dirty |= kDirtyRequested;
+  }
+  if (g_render_on_demand && g_pipelines_pending == 0 && !frame_is_dirty()) {
+    profiler_cancel_frame(g_profiler);
+    g_skipped_frames += 1;
+    return;
+  }
+  g_accum_time += dt_sec;
+  update_render_scale();
+  {
+    ProfileScope scope(g_profiler, ProfileStage::UpdateCamera);
+    camera_update(g_camera, dt_sec);
+  }
+  {
+    ProfileScope scope(g_profiler, ProfileStage::UpdateViewProjection);
+    update_view_projection();
+  }
+  if (g_pipelines_pending > 0 || g_render_pipelines_failed > 0) {
+    present_clear_frame();
+    profiler_end_frame(g_profiler, profiler_now_ms());
+    return;
+  }
+  const Frustum frustum = frustum_from_view_projection(g_last_vp);
+  {
+    ProfileScope scope(g_profiler, ProfileStage::Physics);
+    physics_update_sleep(g_physics, g_scene, frustum);
+    physics_advance(g_physics, real_dt_sec, g_jobs);
+  }
 
   WGPUSurfaceTexture surface_texture = WGPU_SURFACE_TEXTURE_INIT;
   wgpuSurfaceGetCurrentTexture(g_surface, &surface_texture);
   if (surface_texture.status != WGPUSurfaceGetCurrentTextureStatus_SuccessOptimal &&
       surface_texture.status != WGPUSurfaceGetCurrentTextureStatus_SuccessSuboptimal) {
+    profiler_end_frame(g_profiler, profiler_now_ms());
     return;
   }
 
+  const double encode_begin_ms = profiler_now_ms();
+
   WGPUTextureView color_view = wgpuTextureCreateView(surface_texture.texture, nullptr);
+  WGPUTextureView scene_view = g_scene_color_view ? g_scene_color_view : color_view;
+  begin_uniform_frame();
 
   WGPUCommandEncoderDescriptor encoder_desc = WGPU_COMMAND_ENCODER_DESCRIPTOR_INIT;
   encoder_desc.label = make_str_view("frame_encoder");
   WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(g_device, &encoder_desc);
 
   WGPURenderPassColorAttachment color_attachment = WGPU_RENDER_PASS_COLOR_ATTACHMENT_INIT;
-  color_attachment.view = color_view;
+  color_attachment.view = scene_view;
   color_attachment.loadOp = WGPULoadOp_Clear;
   color_attachment.storeOp = WGPUStoreOp_Store;
   color_attachment.clearValue = WGPUColor{0.06, 0.08, 0.11, 1.0};
@@ -601,57 +3893,190 @@ void frame() {
   pass_desc.colorAttachments = &color_attachment;
   pass_desc.depthStencilAttachment = &depth_attachment;
 
-  WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &pass_desc);
-  wgpuRenderPassEncoderSetPipeline(pass, g_pipeline);
-  wgpuRenderPassEncoderSetBindGroup(pass, 0, g_bind_group, 0, nullptr);
+  const int timing_slot = acquire_gpu_timing_slot();
+  WGPUPassTimestampWrites timestamp_writes{};
+  if (timing_slot >= 0) {
+    timestamp_writes.querySet = g_timestamp_query_set;
+    timestamp_writes.beginningOfPassWriteIndex = 0;
+    timestamp_writes.endOfPassWriteIndex = 1;
+    pass_desc.timestampWrites = &timestamp_writes;
+  }
 
   const Mat4 cube_model = mat4_rotation_y(g_accum_time * 0.7f);
-  draw_mesh(pass,
-            g_cube_vertex_buffer,
-            sizeof(kCubeVertices),
-            g_cube_index_buffer,
-            sizeof(kCubeIndices),
-            static_cast<uint32_t>(sizeof(kCubeIndices) / sizeof(kCubeIndices[0])),
-            cube_model,
-            1.0f,
-            1.0f,
-            1.0f);
-
-  for (int i = 0; i < kMaxPlacedPhotos; ++i) {
-    if (!g_placed_photos[i].active) {
-      continue;
-    }
+  set_instance(kCubeInstance, cube_model, 1.0f, 1.0f, 1.0f);
+  if (g_imported_mesh.vertex_count > 0) {
+    set_imported_mesh_instance();
+  }
 
-    const Mat4 t = mat4_translation(g_placed_photos[i].position);
-    const Mat4 r = mat4_rotation_y(g_placed_photos[i].yaw);
-    const Mat4 s = mat4_scale(g_placed_photos[i].scale, g_placed_photos[i].scale, 1.0f);
-    const Mat4 model = mat4_mul(t, mat4_mul(r, s));
-    const Vec3 tint = shot_tint(g_placed_photos[i].shot_id);
+  // GPU-culled frames leave photo_count at 0: the compute pass owns both the
+  // photo instances and their count.
+  const bool gpu_cull = g_gpu_culling_enabled && !g_gpu_culling_failed && g_scene.count >= kGpuCullMinPhotos;
+  g_gpu_culling_active = gpu_cull;
+  int photo_count = 0;
+  InstanceData* photo_instances = &g_instance_data[kFirstPhotoInstance];
+  if (!gpu_cull) {
+    photo_count = scene_prepare_instances_parallel(
+        g_scene, frustum, &g_snapshot_layers, photo_instances, kMaxPlacedPhotos, g_jobs);
+    residency_request_visible(g_residency,
+                              photo_instances,
+                              photo_count,
+                              g_camera.position,
+                              g_last_proj_y_scale,
+                              static_cast<float>(g_render_height),
+                              static_cast<float>(kSnapshotHeight));
+  }
+  residency_update(g_residency, g_frame_index);
+  for (const ResidencyUpload& upload : g_residency.uploads) {
+    upload_snapshot_detail(encoder, upload);
+  }
+  residency_apply(g_residency, photo_instances, photo_count);
+  const bool occlusion_cull = gpu_cull && g_occlusion_culling_enabled;
+  if (gpu_cull) {
+    encode_photo_cull(encoder, frustum, occlusion_cull);
+  }
+
+  const int body_count = physics_write_instances(
+      g_physics, g_scene, &g_instance_data[kFirstBodyInstance], kMaxPhysicsInstances);
 
-    draw_mesh(pass,
-              g_photo_vertex_buffer,
-              sizeof(kPhotoFrameVertices),
-              g_photo_index_buffer,
-              sizeof(kPhotoFrameIndices),
-              static_cast<uint32_t>(sizeof(kPhotoFrameIndices) / sizeof(kPhotoFrameIndices[0])),
-              model,
-              tint.x,
-              tint.y,
-              tint.z);
+  const size_t photo_bytes = static_cast<size_t>(kFirstPhotoInstance + photo_count) * sizeof(InstanceData);
+  wgpuQueueWriteBuffer(g_queue, g_instance_buffer, 0, g_instance_data.data(), photo_bytes);
+  const size_t body_bytes = static_cast<size_t>(body_count) * sizeof(InstanceData);
+  if (body_bytes > 0) {
+    wgpuQueueWriteBuffer(g_queue,
+                         g_instance_buffer,
+                         static_cast<uint64_t>(kFirstBodyInstance) * sizeof(InstanceData),
+                         &g_instance_data[kFirstBodyInstance],
+                         body_bytes);
+    g_upload_stats.queue_writes += 1;
+  }
+  g_upload_stats.instance_bytes += static_cast<uint32_t>(photo_bytes + body_bytes);
+  g_upload_stats.queue_writes += 1;
+
+  // Every static draw shares these uniforms; being the frame's first push it
+  // lands at the offset the bundle for this slot was recorded with.
+  const uint32_t uniform_offset = push_uniforms(1.0f, 1.0f, 1.0f);
+
+  WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &pass_desc);
+  const double draws_begin_ms = profiler_now_ms();
+  if (g_bundles_enabled) {
+    if (g_bundles_dirty) {
+      record_static_bundles();
+    }
+    write_static_draw_args(photo_count, body_count);
+    wgpuRenderPassEncoderExecuteBundles(pass, 1, &g_static_bundles[g_frame_index % kUniformFrameCount]);
+    const double replay_ms = profiler_now_ms() - draws_begin_ms;
+    g_bundle_stats.replay_ms_total += replay_ms;
+    g_bundle_stats.saved_ms_total += std::max(0.0, g_bundle_stats.last_record_ms - replay_ms);
+  } else {
+    wgpuRenderPassEncoderSetPipeline(pass, g_pipeline);
+    wgpuRenderPassEncoderSetVertexBuffer(pass, 1, g_instance_buffer, 0,
+                                         static_cast<uint64_t>(kMaxInstances) * sizeof(InstanceData));
+    draw_mesh_instanced(pass, g_cube_mesh, kCubeInstance, 1, uniform_offset);
+    if (gpu_cull) {
+      write_static_draw_args(0, body_count);
+      draw_photos_indirect(pass, uniform_offset, kFirstPhotoInstance, kMaxPlacedPhotos, kPhotoDraw);
+    } else if (photo_count > 0) {
+      draw_mesh_instanced(pass, g_photo_mesh, kFirstPhotoInstance, static_cast<uint32_t>(photo_count), uniform_offset);
+    }
+    if (body_count > 0) {
+      draw_mesh_instanced(pass, g_cube_mesh, kFirstBodyInstance, static_cast<uint32_t>(body_count), uniform_offset);
+    }
+    if (g_imported_mesh.vertex_count > 0) {
+      wgpuRenderPassEncoderSetPipeline(pass, g_packed_pipeline);
+      wgpuRenderPassEncoderSetVertexBuffer(pass,
+                                           0,
+                                           g_imported_mesh_buffer,
+                                           g_imported_mesh.vertex_offset,
+                                           static_cast<uint64_t>(g_imported_mesh.vertex_count) * sizeof(PackedVertex));
+      wgpuRenderPassEncoderSetIndexBuffer(pass,
+                                          g_imported_mesh_buffer,
+                                          imported_mesh_index_format(),
+                                          g_imported_mesh.index_offset,
+                                          imported_mesh_index_bytes());
+      wgpuRenderPassEncoderDrawIndexed(pass, g_imported_mesh.index_count, 1, 0, 0, kMeshInstance);
+    }
   }
 
   wgpuRenderPassEncoderEnd(pass);
   wgpuRenderPassEncoderRelease(pass);
 
+  if (occlusion_cull) {
+    encode_photo_cull_late(encoder);
+    encode_late_photo_pass(encoder, scene_view, uniform_offset);
+  }
+  const int cull_readback = gpu_cull ? copy_cull_counts(encoder) : -1;
+
+  if (timing_slot >= 0) {
+    wgpuCommandEncoderResolveQuerySet(encoder, g_timestamp_query_set, 0, 2, g_timestamp_resolve_buffer, 0);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, g_timestamp_resolve_buffer, 0,
+                                         g_gpu_timing_slots[timing_slot].buffer, 0, 2 * sizeof(uint64_t));
+  }
+
+  if (!g_pending_restores.empty()) {
+    const int layer = g_pending_restores.front();
+    g_pending_restores.erase(g_pending_restores.begin());
+    encode_snapshot_restore(encoder, layer);
+  }
+
+  g_frame_capture_slots.clear();
+  size_t captured = 0;
+  for (; captured < g_pending_captures.size(); ++captured) {
+    const int slot = readback_ring_acquire(g_readback_ring);
+    if (slot < 0) {
+      break;
+    }
+    const PendingCapture& pc = g_pending_captures[captured];
+    g_readback_ring.slots[slot].layer = pc.layer;
+    g_readback_ring.slots[slot].info = pc.info;
+    encode_snapshot_capture(encoder, scene_view, pc.layer, slot);
+    g_frame_capture_slots.push_back(slot);
+  }
+  g_pending_captures.erase(g_pending_captures.begin(), g_pending_captures.begin() + static_cast<ptrdiff_t>(captured));
+  g_readback_ring.stats.deferred += static_cast<uint32_t>(g_pending_captures.size());
+  if (g_scene_color_view) {
+    encode_blit(encoder, g_upscale_pipeline, g_scene_color_view, color_view);
+  }
+
+  // Queue writes are ordered before the submit below, so one upload of the
+  // staged block covers every draw recorded above.
+  flush_uniforms();
+
   WGPUCommandBufferDescriptor cmd_desc = WGPU_COMMAND_BUFFER_DESCRIPTOR_INIT;
   cmd_desc.label = make_str_view("frame_cmd");
   WGPUCommandBuffer cmd = wgpuCommandEncoderFinish(encoder, &cmd_desc);
+  const double submit_begin_ms = profiler_now_ms();
+  profiler_record(g_profiler, ProfileStage::Encode, encode_begin_ms, submit_begin_ms);
   wgpuQueueSubmit(g_queue, 1, &cmd);
+  if (startup_mark(g_startup, StartupMark::FirstFrame, emscripten_get_now())) {
+    log_startup_timeline();
+  }
+  for (const int slot : g_frame_capture_slots) {
+    g_last_capture_ms = emscripten_get_now() - g_readback_ring.slots[slot].info.timestamp_ms;
+    map_snapshot_readback(slot);
+  }
+  if (timing_slot >= 0) {
+    map_gpu_timing(timing_slot);
+  }
+  if (cull_readback >= 0) {
+    map_cull_readback(cull_readback);
+  }
+  profiler_record(g_profiler, ProfileStage::Submit, submit_begin_ms, profiler_now_ms());
 
   wgpuCommandBufferRelease(cmd);
   wgpuCommandEncoderRelease(encoder);
   wgpuTextureViewRelease(color_view);
   wgpuTextureRelease(surface_texture.texture);
+
+  g_last_upload_stats = g_upload_stats;
+  g_dirty = 0;
+  g_drawn_scene_version = g_scene.version;
+  g_residency_streaming = !g_residency.uploads.empty();
+  g_last_frame_cpu_ms = static_cast<float>(emscripten_get_now() - now_ms);
+  profiler_end_frame(g_profiler, profiler_now_ms());
+  g_frame_index += 1;
+  if (g_replay_active && g_frame_index > kReplaySampleLag) {
+    collect_replay_samples(g_frame_index - kReplaySampleLag);
+  }
 }
 
 void request_device_callback(WGPURequestDeviceStatus status,
@@ -664,6 +4089,7 @@ void request_device_callback(WGPURequestDeviceStatus status,
     return;
   }
 
+  startup_mark(g_startup, StartupMark::DeviceReady, emscripten_get_now());
   g_device = device;
   g_queue = wgpuDeviceGetQueue(g_device);
 
@@ -672,7 +4098,7 @@ void request_device_callback(WGPURequestDeviceStatus status,
   g_surface_format = choose_surface_format(g_surface, g_adapter);
   g_surface_config.device = g_device;
   g_surface_config.format = g_surface_format;
-  g_surface_config.usage = WGPUTextureUsage_RenderAttachment;
+  g_surface_config.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding;
   g_surface_config.width = static_cast<uint32_t>(g_canvas_width);
   g_surface_config.height = static_cast<uint32_t>(g_canvas_height);
   g_surface_config.presentMode = WGPUPresentMode_Fifo;
@@ -680,7 +4106,9 @@ void request_device_callback(WGPURequestDeviceStatus status,
   wgpuSurfaceConfigure(g_surface, &g_surface_config);
 
   create_pipeline_resources();
+#if !defined(FRAMESPACE_WORKER_RENDER)
   register_input_callbacks();
+#endif
 
   g_initialized = true;
   emscripten_set_main_loop(frame, 0, true);
@@ -696,11 +4124,21 @@ void request_adapter_callback(WGPURequestAdapterStatus status,
     return;
   }
 
+  startup_mark(g_startup, StartupMark::AdapterReady, emscripten_get_now());
   g_adapter = adapter;
 
   WGPUDeviceDescriptor device_desc = WGPU_DEVICE_DESCRIPTOR_INIT;
   device_desc.label = make_str_view("framespace_device");
 
+  // GPU pass timings are optional; without the feature the profiler only
+  // reports CPU stages.
+  static const WGPUFeatureName kTimestampFeature = WGPUFeatureName_TimestampQuery;
+  g_timestamps_supported = wgpuAdapterHasFeature(adapter, kTimestampFeature);
+  if (g_timestamps_supported) {
+    device_desc.requiredFeatureCount = 1;
+    device_desc.requiredFeatures = &kTimestampFeature;
+  }
+
   WGPURequestDeviceCallbackInfo cb = WGPU_REQUEST_DEVICE_CALLBACK_INFO_INIT;
   cb.mode = WGPUCallbackMode_AllowSpontaneous;
   cb.callback = request_device_callback;
@@ -743,8 +4181,34 @@ bool init_webgpu() {
 }  // namespace
 
 int main() {
+  startup_timeline_init(g_startup);
+  startup_mark(g_startup, StartupMark::MainStart, emscripten_get_now());
+  profiler_init(g_profiler);
+  page_stats_init(g_page_stats);
+  resolution_init(g_resolution, kDefaultFrameBudgetMs);
+  camera_init(g_camera);
+  scene_init(g_scene, kMaxPlacedPhotos);
+  snapshot_layers_init(g_snapshot_layers, static_cast<int>(kSnapshotLayers));
+  g_snapshot_payloads.resize(kSnapshotLayers);
+  g_snapshot_blobs.resize(kSnapshotLayers);
+  g_snapshot_blob_shot.assign(kSnapshotLayers, 0);
+  codec_worker_start(g_codec_worker);
+  jobs_init(g_jobs, emscripten_num_logical_cores() - kReservedThreads);
+  physics_init(g_physics, kMaxPhysicsVolumes, kPhysicsBodiesPerFrame, kPhysicsBodyRadius);
+  residency_init(g_residency,
+                 static_cast<int>(kSnapshotLayers),
+                 kSnapshotDetailMips,
+                 mip_chain_bytes(kSnapshotBaseWidth, kSnapshotBaseHeight),
+                 mip_chain_bytes(kSnapshotWidth, kSnapshotHeight),
+                 kDefaultSnapshotBudgetBytes);
+  g_instance_data.resize(kMaxInstances);
   if (!init_webgpu()) {
     return EXIT_FAILURE;
   }
+#if defined(FRAMESPACE_WORKER_RENDER)
+  // main() runs on its own pthread here; keep it alive for the WebGPU
+  // callbacks and the main loop instead of letting the return tear it down.
+  emscripten_exit_with_live_runtime();
+#endif
   return EXIT_SUCCESS;
 }
@@ -2,6 +2,22 @@
 
 #include <cmath>
 
+namespace {
+
+void mat4_mul_scalar(const float* a, const float* b, float* out) {
+  for (int c = 0; c < 4; ++c) {
+    for (int r = 0; r < 4; ++r) {
+      out[c * 4 + r] =
+          a[0 * 4 + r] * b[c * 4 + 0] +
+          a[1 * 4 + r] * b[c * 4 + 1] +
+          a[2 * 4 + r] * b[c * 4 + 2] +
+          a[3 * 4 + r] * b[c * 4 + 3];
+    }
+  }
+}
+
+}  // namespace
+
 Vec3 vec3_add(Vec3 a, Vec3 b) {
   return {a.x + b.x, a.y + b.y, a.z + b.z};
 }
@@ -45,15 +61,7 @@ Mat4 mat4_identity() {
 
 Mat4 mat4_mul(Mat4 a, Mat4 b) {
   Mat4 out{};
-  for (int c = 0; c < 4; ++c) {
-    for (int r = 0; r < 4; ++r) {
-      out.m[c * 4 + r] =
-          a.m[0 * 4 + r] * b.m[c * 4 + 0] +
-          a.m[1 * 4 + r] * b.m[c * 4 + 1] +
-          a.m[2 * 4 + r] * b.m[c * 4 + 2] +
-          a.m[3 * 4 + r] * b.m[c * 4 + 3];
-    }
-  }
+  mat4_mul_scalar(a.m, b.m, out.m);
   return out;
 }
 
@@ -116,3 +124,272 @@ Mat4 mat4_look_at_rh(Vec3 eye, Vec3 target, Vec3 up) {
   out.m[14] = vec3_dot(f, eye);
   return out;
 }
+
+Aabb aabb_union(const Aabb& a, const Aabb& b) {
+  return {
+      {std::fmin(a.min.x, b.min.x), std::fmin(a.min.y, b.min.y), std::fmin(a.min.z, b.min.z)},
+      {std::fmax(a.max.x, b.max.x), std::fmax(a.max.y, b.max.y), std::fmax(a.max.z, b.max.z)},
+  };
+}
+
+bool aabb_contains(const Aabb& outer, const Aabb& inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+         inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+float aabb_perimeter(const Aabb& box) {
+  const float dx = box.max.x - box.min.x;
+  const float dy = box.max.y - box.min.y;
+  const float dz = box.max.z - box.min.z;
+  return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+float rng_unit(uint32_t& state) {
+  state = state * 1664525u + 1013904223u;
+  return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+Frustum frustum_from_view_projection(const Mat4& vp) {
+  const float* m = vp.m;
+  // Row i of a column-major matrix is (m[i], m[4 + i], m[8 + i], m[12 + i]).
+  const float r0[4] = {m[0], m[4], m[8], m[12]};
+  const float r1[4] = {m[1], m[5], m[9], m[13]};
+  const float r2[4] = {m[2], m[6], m[10], m[14]};
+  const float r3[4] = {m[3], m[7], m[11], m[15]};
+
+  float raw[6][4];
+  for (int k = 0; k < 4; ++k) {
+    raw[0][k] = r3[k] + r0[k];  // left
+    raw[1][k] = r3[k] - r0[k];  // right
+    raw[2][k] = r3[k] + r1[k];  // bottom
+    raw[3][k] = r3[k] - r1[k];  // top
+    raw[4][k] = r2[k];          // near (z_ndc >= 0)
+    raw[5][k] = r3[k] - r2[k];  // far
+  }
+
+  Frustum out{};
+  for (int i = 0; i < 6; ++i) {
+    const Vec3 n{raw[i][0], raw[i][1], raw[i][2]};
+    const float len = std::sqrt(vec3_dot(n, n));
+    const float inv = len > 1e-12f ? 1.0f / len : 0.0f;
+    out.planes[i].normal = vec3_scale(n, inv);
+    out.planes[i].d = raw[i][3] * inv;
+  }
+  return out;
+}
+
+FrustumTest frustum_test_aabb(const Frustum& frustum, const Aabb& box) {
+  FrustumTest result = FrustumTest::Inside;
+  for (const Plane& p : frustum.planes) {
+    // Corner furthest along the plane normal, and the one opposite to it.
+    const Vec3 pos{
+        p.normal.x >= 0.0f ? box.max.x : box.min.x,
+        p.normal.y >= 0.0f ? box.max.y : box.min.y,
+        p.normal.z >= 0.0f ? box.max.z : box.min.z,
+    };
+    if (vec3_dot(p.normal, pos) + p.d < 0.0f) {
+      return FrustumTest::Outside;
+    }
+    const Vec3 neg{
+        p.normal.x >= 0.0f ? box.min.x : box.max.x,
+        p.normal.y >= 0.0f ? box.min.y : box.max.y,
+        p.normal.z >= 0.0f ? box.min.z : box.max.z,
+    };
+    if (vec3_dot(p.normal, neg) + p.d < 0.0f) {
+      result = FrustumTest::Intersects;
+    }
+  }
+  return result;
+}
+
+namespace {
+
+void compose_trs_y_scalar(float px, float py, float pz, float yaw, float scale, float* out) {
+  const float c = std::cos(yaw);
+  const float s = std::sin(yaw);
+  out[0] = c * scale;
+  out[1] = 0.0f;
+  out[2] = -s * scale;
+  out[3] = 0.0f;
+  out[4] = 0.0f;
+  out[5] = scale;
+  out[6] = 0.0f;
+  out[7] = 0.0f;
+  out[8] = s;
+  out[9] = 0.0f;
+  out[10] = c;
+  out[11] = 0.0f;
+  out[12] = px;
+  out[13] = py;
+  out[14] = pz;
+  out[15] = 1.0f;
+}
+
+}  // namespace
+
+#if !defined(FRAMESPACE_MATH_SCALAR) && defined(__wasm_simd128__)
+
+#include <wasm_simd128.h>
+
+#define FRAMESPACE_MATH_SIMD 1
+
+namespace {
+
+using f32x4 = v128_t;
+
+inline f32x4 simd_load(const float* p) { return wasm_v128_load(p); }
+inline void simd_store(float* p, f32x4 v) { wasm_v128_store(p, v); }
+inline f32x4 simd_splat(float v) { return wasm_f32x4_splat(v); }
+inline f32x4 simd_mul(f32x4 a, f32x4 b) { return wasm_f32x4_mul(a, b); }
+inline f32x4 simd_add(f32x4 a, f32x4 b) { return wasm_f32x4_add(a, b); }
+inline f32x4 simd_neg(f32x4 a) { return wasm_f32x4_neg(a); }
+
+inline void simd_transpose(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) {
+  const f32x4 t0 = wasm_i32x4_shuffle(r0, r1, 0, 4, 1, 5);
+  const f32x4 t1 = wasm_i32x4_shuffle(r2, r3, 0, 4, 1, 5);
+  const f32x4 t2 = wasm_i32x4_shuffle(r0, r1, 2, 6, 3, 7);
+  const f32x4 t3 = wasm_i32x4_shuffle(r2, r3, 2, 6, 3, 7);
+  r0 = wasm_i32x4_shuffle(t0, t1, 0, 1, 4, 5);
+  r1 = wasm_i32x4_shuffle(t0, t1, 2, 3, 6, 7);
+  r2 = wasm_i32x4_shuffle(t2, t3, 0, 1, 4, 5);
+  r3 = wasm_i32x4_shuffle(t2, t3, 2, 3, 6, 7);
+}
+
+}  // namespace
+
+#elif !defined(FRAMESPACE_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+
+#include <immintrin.h>
+
+#define FRAMESPACE_MATH_SIMD 1
+
+namespace {
+
+using f32x4 = __m128;
+
+inline f32x4 simd_load(const float* p) { return _mm_loadu_ps(p); }
+inline void simd_store(float* p, f32x4 v) { _mm_storeu_ps(p, v); }
+inline f32x4 simd_splat(float v) { return _mm_set1_ps(v); }
+inline f32x4 simd_mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+inline f32x4 simd_add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+inline f32x4 simd_neg(f32x4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+
+inline void simd_transpose(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) {
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+}  // namespace
+
+#endif
+
+#if defined(FRAMESPACE_MATH_SIMD)
+
+const char* math_batch_kernel_name() {
+#if defined(__wasm_simd128__)
+  return "wasm-simd128";
+#elif defined(__AVX__)
+  return "sse+avx";
+#else
+  return "sse";
+#endif
+}
+
+void mat4_mul_batch(const Mat4& a, const float* b, size_t b_stride, float* out, size_t out_stride, size_t count) {
+#if defined(__AVX__)
+  // Two output columns per 256-bit op; products are summed in the same
+  // order as mat4_mul so results stay bit-identical.
+  __m256 a2[4];
+  for (int k = 0; k < 4; ++k) {
+    const __m128 col = _mm_loadu_ps(a.m + k * 4);
+    a2[k] = _mm256_setr_m128(col, col);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const float* bi = b + i * b_stride;
+    float* oi = out + i * out_stride;
+    for (int c = 0; c < 4; c += 2) {
+      __m256 acc = _mm256_mul_ps(a2[0], _mm256_setr_m128(_mm_set1_ps(bi[c * 4 + 0]), _mm_set1_ps(bi[c * 4 + 4])));
+      for (int k = 1; k < 4; ++k) {
+        const __m256 bk = _mm256_setr_m128(_mm_set1_ps(bi[c * 4 + k]), _mm_set1_ps(bi[c * 4 + 4 + k]));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(a2[k], bk));
+      }
+      _mm256_storeu_ps(oi + c * 4, acc);
+    }
+  }
+#else
+  const f32x4 a0 = simd_load(a.m + 0);
+  const f32x4 a1 = simd_load(a.m + 4);
+  const f32x4 a2 = simd_load(a.m + 8);
+  const f32x4 a3 = simd_load(a.m + 12);
+  for (size_t i = 0; i < count; ++i) {
+    const float* bi = b + i * b_stride;
+    float* oi = out + i * out_stride;
+    for (int c = 0; c < 4; ++c) {
+      f32x4 acc = simd_mul(a0, simd_splat(bi[c * 4 + 0]));
+      acc = simd_add(acc, simd_mul(a1, simd_splat(bi[c * 4 + 1])));
+      acc = simd_add(acc, simd_mul(a2, simd_splat(bi[c * 4 + 2])));
+      acc = simd_add(acc, simd_mul(a3, simd_splat(bi[c * 4 + 3])));
+      simd_store(oi + c * 4, acc);
+    }
+  }
+#endif
+}
+
+void mat4_compose_trs_y_batch(const TrsSoA& in, float* out, size_t out_stride, size_t count) {
+  const f32x4 zero = simd_splat(0.0f);
+  const f32x4 one = simd_splat(1.0f);
+
+  // Four transforms per iteration: build each matrix column as a row across
+  // the four lanes, then transpose so every lane becomes one instance.
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    alignas(16) float cos_yaw[4];
+    alignas(16) float sin_yaw[4];
+    for (int l = 0; l < 4; ++l) {
+      cos_yaw[l] = std::cos(in.yaw[i + l]);
+      sin_yaw[l] = std::sin(in.yaw[i + l]);
+    }
+    const f32x4 c = simd_load(cos_yaw);
+    const f32x4 s = simd_load(sin_yaw);
+    const f32x4 scale = simd_load(in.scale + i);
+
+    f32x4 c0[4] = {simd_mul(c, scale), zero, simd_neg(simd_mul(s, scale)), zero};
+    f32x4 c1[4] = {zero, scale, zero, zero};
+    f32x4 c2[4] = {s, zero, c, zero};
+    f32x4 c3[4] = {simd_load(in.px + i), simd_load(in.py + i), simd_load(in.pz + i), one};
+    simd_transpose(c0[0], c0[1], c0[2], c0[3]);
+    simd_transpose(c1[0], c1[1], c1[2], c1[3]);
+    simd_transpose(c2[0], c2[1], c2[2], c2[3]);
+    simd_transpose(c3[0], c3[1], c3[2], c3[3]);
+
+    for (int l = 0; l < 4; ++l) {
+      float* o = out + (i + l) * out_stride;
+      simd_store(o + 0, c0[l]);
+      simd_store(o + 4, c1[l]);
+      simd_store(o + 8, c2[l]);
+      simd_store(o + 12, c3[l]);
+    }
+  }
+  for (; i < count; ++i) {
+    compose_trs_y_scalar(in.px[i], in.py[i], in.pz[i], in.yaw[i], in.scale[i], out + i * out_stride);
+  }
+}
+
+#else
+
+const char* math_batch_kernel_name() {
+  return "scalar";
+}
+
+void mat4_mul_batch(const Mat4& a, const float* b, size_t b_stride, float* out, size_t out_stride, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    mat4_mul_scalar(a.m, b + i * b_stride, out + i * out_stride);
+  }
+}
+
+void mat4_compose_trs_y_batch(const TrsSoA& in, float* out, size_t out_stride, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    compose_trs_y_scalar(in.px[i], in.py[i], in.pz[i], in.yaw[i], in.scale[i], out + i * out_stride);
+  }
+}
+
+#endif
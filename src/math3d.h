@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 struct Vec3 {
   float x;
   float y;
@@ -10,6 +13,27 @@ struct Mat4 {
   float m[16];
 };
 
+struct Aabb {
+  Vec3 min;
+  Vec3 max;
+};
+
+// Points p with dot(normal, p) + d >= 0 are on the inner side.
+struct Plane {
+  Vec3 normal;
+  float d;
+};
+
+struct Frustum {
+  Plane planes[6];
+};
+
+enum class FrustumTest {
+  Outside,
+  Intersects,
+  Inside,
+};
+
 Vec3 vec3_add(Vec3 a, Vec3 b);
 Vec3 vec3_sub(Vec3 a, Vec3 b);
 Vec3 vec3_scale(Vec3 v, float s);
@@ -24,3 +48,39 @@ Mat4 mat4_scale(float x, float y, float z);
 Mat4 mat4_rotation_y(float rad);
 Mat4 mat4_perspective_rh_zo(float fovy, float aspect, float z_near, float z_far);
 Mat4 mat4_look_at_rh(Vec3 eye, Vec3 target, Vec3 up);
+
+Aabb aabb_union(const Aabb& a, const Aabb& b);
+bool aabb_contains(const Aabb& outer, const Aabb& inner);
+float aabb_perimeter(const Aabb& box);
+
+// Steps a 32-bit LCG and returns a float in [0, 1). Shared by everything
+// seeded (physics spawns, generated scenes) so results are reproducible.
+float rng_unit(uint32_t& state);
+
+// Planes of a right-handed, zero-to-one depth view-projection (as built by
+// mat4_perspective_rh_zo), normalized and pointing inwards.
+Frustum frustum_from_view_projection(const Mat4& vp);
+FrustumTest frustum_test_aabb(const Frustum& frustum, const Aabb& box);
+
+// Batch kernels. Matrices are column-major float[16] blocks like Mat4::m;
+// each *_stride is the distance in floats between consecutive matrices
+// (16 for a packed Mat4 array). Results match the scalar functions above.
+
+// Structure-of-arrays input for mat4_compose_trs_y_batch.
+struct TrsSoA {
+  const float* px;
+  const float* py;
+  const float* pz;
+  const float* yaw;
+  const float* scale;
+};
+
+// out[i] = a * b[i]
+void mat4_mul_batch(const Mat4& a, const float* b, size_t b_stride, float* out, size_t out_stride, size_t count);
+
+// out[i] = translation(p[i]) * rotation_y(yaw[i]) * scale(scale[i], scale[i], 1)
+void mat4_compose_trs_y_batch(const TrsSoA& in, float* out, size_t out_stride, size_t count);
+
+// Which implementation the batch kernels were built with: "wasm-simd128",
+// "sse", "sse+avx" or "scalar".
+const char* math_batch_kernel_name();
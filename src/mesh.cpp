@@ -0,0 +1,638 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "file_layout.h"
+
+namespace {
+
+// Forsyth's scoring favours the three most recent vertices, then decays over
+// a 32-entry LRU cache; the valence term boosts vertices with few triangles
+// left so islands get finished.
+constexpr int kForsythCacheSize = 32;
+constexpr int kForsythMaxValence = 64;
+
+const char* skip_blanks(const char* p) {
+  while (*p == ' ' || *p == '\t' || *p == '\r') {
+    ++p;
+  }
+  return p;
+}
+
+const char* next_line(const char* p) {
+  while (*p != '\0' && *p != '\n') {
+    ++p;
+  }
+  return *p == '\n' ? p + 1 : p;
+}
+
+// OBJ indices are 1-based; negative ones count back from the latest element.
+int resolve_index(long index, size_t count) {
+  const long i = index > 0 ? index - 1 : static_cast<long>(count) + index;
+  return i >= 0 && i < static_cast<long>(count) ? static_cast<int>(i) : -1;
+}
+
+bool parse_corner(const char*& p, size_t position_count, size_t normal_count, int& v, int& n) {
+  char* end = nullptr;
+  const long vi = std::strtol(p, &end, 10);
+  if (end == p) {
+    return false;
+  }
+  p = end;
+  n = -1;
+  if (*p == '/') {
+    ++p;
+    if (*p != '/') {
+      std::strtol(p, &end, 10);  // texture coordinate, not imported
+      p = end;
+    }
+    if (*p == '/') {
+      ++p;
+      const long ni = std::strtol(p, &end, 10);
+      if (end == p) {
+        return false;
+      }
+      p = end;
+      n = resolve_index(ni, normal_count);
+      if (n < 0) {
+        return false;
+      }
+    }
+  }
+  v = resolve_index(vi, position_count);
+  return v >= 0;
+}
+
+Vec3 load_vec3(const std::vector<float>& values, size_t i) {
+  return Vec3{values[i * 3 + 0], values[i * 3 + 1], values[i * 3 + 2]};
+}
+
+void store_vec3(std::vector<float>& values, size_t i, Vec3 v) {
+  values[i * 3 + 0] = v.x;
+  values[i * 3 + 1] = v.y;
+  values[i * 3 + 2] = v.z;
+}
+
+// Twice the triangle's area, along its normal.
+Vec3 triangle_cross(const float* positions, uint32_t a, uint32_t b, uint32_t c) {
+  const Vec3 pa{positions[a * 3 + 0], positions[a * 3 + 1], positions[a * 3 + 2]};
+  const Vec3 pb{positions[b * 3 + 0], positions[b * 3 + 1], positions[b * 3 + 2]};
+  const Vec3 pc{positions[c * 3 + 0], positions[c * 3 + 1], positions[c * 3 + 2]};
+  return vec3_cross(vec3_sub(pb, pa), vec3_sub(pc, pa));
+}
+
+Vec3 normalize_or_up(Vec3 v) {
+  return vec3_dot(v, v) > 1.0e-24f ? vec3_normalize(v) : Vec3{0.0f, 1.0f, 0.0f};
+}
+
+struct ForsythTables {
+  float cache[kForsythCacheSize];
+  float valence[kForsythMaxValence];
+};
+
+ForsythTables make_forsyth_tables() {
+  ForsythTables t{};
+  for (int i = 0; i < kForsythCacheSize; ++i) {
+    t.cache[i] = i < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(i - 3) / (kForsythCacheSize - 3), 1.5f);
+  }
+  for (int i = 1; i < kForsythMaxValence; ++i) {
+    t.valence[i] = 2.0f / std::sqrt(static_cast<float>(i));
+  }
+  return t;
+}
+
+float forsyth_score(const ForsythTables& t, int cache_pos, uint32_t live) {
+  if (live == 0) {
+    return -1.0f;
+  }
+  const float cache = cache_pos >= 0 ? t.cache[cache_pos] : 0.0f;
+  const float valence = live < kForsythMaxValence ? t.valence[live] : 2.0f / std::sqrt(static_cast<float>(live));
+  return cache + valence;
+}
+
+int8_t to_snorm8(float v) {
+  return static_cast<int8_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 127.0f));
+}
+
+int16_t to_snorm16(float v) {
+  return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint8_t to_unorm8(float v) {
+  return static_cast<uint8_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+}
+
+}  // namespace
+
+bool mesh_parse_obj(const char* text, size_t size, MeshData& out) {
+  // strtof/strtol need a terminator the caller's buffer may not have.
+  const std::string source(text, size);
+  std::vector<float> raw_positions;
+  std::vector<float> raw_colors;
+  std::vector<float> raw_normals;
+  std::vector<int> corners;  // (position, normal) pairs, three per triangle
+  std::vector<int> face;
+
+  for (const char* p = source.c_str(); *p != '\0'; p = next_line(p)) {
+    p = skip_blanks(p);
+    if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+      char* end = nullptr;
+      float values[6] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+      const char* q = p + 1;
+      int parsed = 0;
+      for (; parsed < 6; ++parsed) {
+        const float value = std::strtof(q, &end);
+        if (end == q) {
+          break;
+        }
+        values[parsed] = value;
+        q = end;
+      }
+      if (parsed < 3) {
+        return false;
+      }
+      if (parsed < 6) {
+        values[3] = values[4] = values[5] = 1.0f;  // no vertex color (or a w)
+      }
+      raw_positions.insert(raw_positions.end(), values, values + 3);
+      raw_colors.insert(raw_colors.end(), values + 3, values + 6);
+    } else if (p[0] == 'v' && p[1] == 'n') {
+      char* end = nullptr;
+      const char* q = p + 2;
+      for (int i = 0; i < 3; ++i) {
+        raw_normals.push_back(std::strtof(q, &end));
+        q = end;
+      }
+    } else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+      face.clear();
+      const char* q = skip_blanks(p + 1);
+      while (*q != '\0' && *q != '\n' && *q != '#') {
+        int v = -1;
+        int n = -1;
+        if (!parse_corner(q, raw_positions.size() / 3, raw_normals.size() / 3, v, n)) {
+          return false;
+        }
+        face.push_back(v);
+        face.push_back(n);
+        q = skip_blanks(q);
+      }
+      const size_t count = face.size() / 2;
+      for (size_t i = 1; i + 1 < count; ++i) {
+        corners.insert(corners.end(), {face[0], face[1], face[i * 2], face[i * 2 + 1], face[i * 2 + 2], face[i * 2 + 3]});
+      }
+    }
+  }
+  if (corners.empty()) {
+    return false;
+  }
+
+  // Smooth normals per position, used for corners that did not name one.
+  const size_t position_count = raw_positions.size() / 3;
+  std::vector<float> smooth(raw_positions.size(), 0.0f);
+  for (size_t c = 0; c < corners.size(); c += 6) {
+    const uint32_t a = static_cast<uint32_t>(corners[c]);
+    const uint32_t b = static_cast<uint32_t>(corners[c + 2]);
+    const uint32_t d = static_cast<uint32_t>(corners[c + 4]);
+    const Vec3 n = triangle_cross(raw_positions.data(), a, b, d);
+    for (const uint32_t v : {a, b, d}) {
+      store_vec3(smooth, v, vec3_add(load_vec3(smooth, v), n));
+    }
+  }
+  for (size_t v = 0; v < position_count; ++v) {
+    store_vec3(smooth, v, normalize_or_up(load_vec3(smooth, v)));
+  }
+
+  out = MeshData{};
+  out.indices.reserve(corners.size() / 2);
+  std::unordered_map<uint64_t, uint32_t> welded;
+  welded.reserve(position_count * 2);
+  for (size_t c = 0; c < corners.size(); c += 2) {
+    const int v = corners[c];
+    const int n = corners[c + 1];
+    const uint64_t key = (static_cast<uint64_t>(v) << 32) | static_cast<uint32_t>(n + 1);
+    const auto [it, inserted] = welded.try_emplace(key, static_cast<uint32_t>(out.positions.size() / 3));
+    if (inserted) {
+      const size_t vi = static_cast<size_t>(v);
+      out.positions.insert(out.positions.end(), &raw_positions[vi * 3], &raw_positions[vi * 3] + 3);
+      out.colors.insert(out.colors.end(), &raw_colors[vi * 3], &raw_colors[vi * 3] + 3);
+      const Vec3 normal = n >= 0 ? normalize_or_up(load_vec3(raw_normals, static_cast<size_t>(n))) : load_vec3(smooth, vi);
+      out.normals.insert(out.normals.end(), {normal.x, normal.y, normal.z});
+    }
+    out.indices.push_back(it->second);
+  }
+  return true;
+}
+
+void mesh_optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count) {
+  const size_t tri_count = index_count / 3;
+  if (tri_count == 0) {
+    return;
+  }
+  static const ForsythTables tables = make_forsyth_tables();
+
+  // Triangles around each vertex; `live` shrinks as triangles are emitted.
+  std::vector<uint32_t> live(vertex_count, 0);
+  for (size_t i = 0; i < tri_count * 3; ++i) {
+    live[indices[i]] += 1;
+  }
+  std::vector<uint32_t> adjacency_start(vertex_count + 1, 0);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    adjacency_start[v + 1] = adjacency_start[v] + live[v];
+  }
+  std::vector<uint32_t> adjacency(tri_count * 3);
+  {
+    std::vector<uint32_t> fill(adjacency_start.begin(), adjacency_start.end() - 1);
+    for (size_t i = 0; i < tri_count * 3; ++i) {
+      adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+
+  std::vector<int> cache_pos(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    vertex_score[v] = forsyth_score(tables, -1, live[v]);
+  }
+  std::vector<float> tri_score(tri_count);
+  std::vector<uint8_t> emitted(tri_count, 0);
+  for (size_t t = 0; t < tri_count; ++t) {
+    tri_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+  }
+
+  std::vector<uint32_t> out(tri_count * 3);
+  uint32_t cache[kForsythCacheSize + 3];
+  uint32_t next_cache[kForsythCacheSize + 3];
+  int cache_count = 0;
+  size_t cursor = 0;  // dead-end fallback: next unemitted triangle in input order
+  int best = static_cast<int>(std::max_element(tri_score.begin(), tri_score.end()) - tri_score.begin());
+
+  for (size_t emitted_count = 0; emitted_count < tri_count; ++emitted_count) {
+    if (best < 0) {
+      while (emitted[cursor]) {
+        ++cursor;
+      }
+      best = static_cast<int>(cursor);
+    }
+    const uint32_t* tri = &indices[static_cast<size_t>(best) * 3];
+    std::copy(tri, tri + 3, &out[emitted_count * 3]);
+    emitted[static_cast<size_t>(best)] = 1;
+
+    int next_count = 0;
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v = tri[k];
+      uint32_t* list = &adjacency[adjacency_start[v]];
+      for (uint32_t j = 0; j < live[v]; ++j) {
+        if (list[j] == static_cast<uint32_t>(best)) {
+          list[j] = list[live[v] - 1];
+          break;
+        }
+      }
+      live[v] -= 1;
+      next_cache[next_count++] = v;
+    }
+    for (int i = 0; i < cache_count; ++i) {
+      const uint32_t v = cache[i];
+      if (v != tri[0] && v != tri[1] && v != tri[2]) {
+        next_cache[next_count++] = v;
+      }
+    }
+
+    // Rescore everything that entered, moved in or fell out of the cache.
+    for (int i = 0; i < next_count; ++i) {
+      cache_pos[next_cache[i]] = i < kForsythCacheSize ? i : -1;
+    }
+    best = -1;
+    float best_score = -1.0f;
+    for (int i = 0; i < next_count; ++i) {
+      const uint32_t v = next_cache[i];
+      vertex_score[v] = forsyth_score(tables, cache_pos[v], live[v]);
+    }
+    for (int i = 0; i < next_count; ++i) {
+      const uint32_t v = next_cache[i];
+      const uint32_t* list = &adjacency[adjacency_start[v]];
+      for (uint32_t j = 0; j < live[v]; ++j) {
+        const uint32_t t = list[j];
+        const float score = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+        tri_score[t] = score;
+        if (score > best_score) {
+          best_score = score;
+          best = static_cast<int>(t);
+        }
+      }
+    }
+    cache_count = std::min(next_count, kForsythCacheSize);
+    std::copy(next_cache, next_cache + cache_count, cache);
+  }
+  std::copy(out.begin(), out.end(), indices);
+}
+
+float mesh_acmr(const uint32_t* indices, size_t index_count, size_t vertex_count, int cache_size) {
+  if (index_count < 3) {
+    return 0.0f;
+  }
+  // FIFO by timestamp: a vertex is cached while fewer than cache_size misses
+  // happened since it was loaded.
+  std::vector<uint32_t> stamp(vertex_count, 0);
+  uint32_t time = static_cast<uint32_t>(cache_size) + 1;
+  size_t misses = 0;
+  for (size_t i = 0; i < index_count; ++i) {
+    const uint32_t v = indices[i];
+    if (time - stamp[v] > static_cast<uint32_t>(cache_size)) {
+      stamp[v] = time++;
+      misses += 1;
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(index_count / 3);
+}
+
+void mesh_optimize_overdraw(uint32_t* indices,
+                            size_t index_count,
+                            const float* positions,
+                            size_t vertex_count,
+                            float threshold) {
+  const size_t tri_count = index_count / 3;
+  if (tri_count < 2) {
+    return;
+  }
+  const uint32_t cache_size = kMeshAcmrCacheSize;
+  std::vector<uint32_t> stamp(vertex_count, 0);
+  uint32_t time = cache_size + 1;
+  auto triangle_misses = [&](size_t t) {
+    int misses = 0;
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v = indices[t * 3 + k];
+      if (time - stamp[v] > cache_size) {
+        stamp[v] = time++;
+        misses += 1;
+      }
+    }
+    return misses;
+  };
+  auto flush = [&]() { time += cache_size + 1; };
+
+  // Hard boundaries: triangles where the cache optimiser had to restart.
+  std::vector<size_t> hard{0};
+  for (size_t t = 0; t < tri_count; ++t) {
+    if (triangle_misses(t) == 3 && t > 0) {
+      hard.push_back(t);
+    }
+  }
+  hard.push_back(tri_count);
+
+  // Soft boundaries: inside each hard cluster, cut as soon as the running
+  // ACMR (counting a cold cache per cut) is within threshold of the whole
+  // cluster's, so sorting the pieces cannot cost more than that.
+  std::vector<size_t> clusters;
+  for (size_t h = 0; h + 1 < hard.size(); ++h) {
+    const size_t begin = hard[h];
+    const size_t end = hard[h + 1];
+    flush();
+    size_t cluster_misses = 0;
+    for (size_t t = begin; t < end; ++t) {
+      cluster_misses += static_cast<size_t>(triangle_misses(t));
+    }
+    const float target = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - begin);
+
+    flush();
+    clusters.push_back(begin);
+    size_t misses = 0;
+    size_t tris = 0;
+    for (size_t t = begin; t < end; ++t) {
+      misses += static_cast<size_t>(triangle_misses(t));
+      tris += 1;
+      if (t + 1 < end && static_cast<float>(misses) <= target * static_cast<float>(tris)) {
+        clusters.push_back(t + 1);
+        flush();
+        misses = 0;
+        tris = 0;
+      }
+    }
+  }
+  clusters.push_back(tri_count);
+
+  // Draw outward-facing clusters first: they are the likeliest occluders.
+  const size_t cluster_count = clusters.size() - 1;
+  Vec3 mesh_centroid{0.0f, 0.0f, 0.0f};
+  float mesh_area = 0.0f;
+  std::vector<Vec3> centroid(cluster_count);
+  std::vector<Vec3> normal(cluster_count);
+  for (size_t c = 0; c < cluster_count; ++c) {
+    Vec3 weighted{0.0f, 0.0f, 0.0f};
+    Vec3 n{0.0f, 0.0f, 0.0f};
+    float area = 0.0f;
+    for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+      const uint32_t a = indices[t * 3];
+      const uint32_t b = indices[t * 3 + 1];
+      const uint32_t d = indices[t * 3 + 2];
+      const Vec3 cross = triangle_cross(positions, a, b, d);
+      const float tri_area = std::sqrt(vec3_dot(cross, cross));
+      const Vec3 center{(positions[a * 3] + positions[b * 3] + positions[d * 3]) / 3.0f,
+                        (positions[a * 3 + 1] + positions[b * 3 + 1] + positions[d * 3 + 1]) / 3.0f,
+                        (positions[a * 3 + 2] + positions[b * 3 + 2] + positions[d * 3 + 2]) / 3.0f};
+      weighted = vec3_add(weighted, vec3_scale(center, tri_area));
+      n = vec3_add(n, cross);
+      area += tri_area;
+    }
+    centroid[c] = area > 0.0f ? vec3_scale(weighted, 1.0f / area) : weighted;
+    normal[c] = normalize_or_up(n);
+    mesh_centroid = vec3_add(mesh_centroid, weighted);
+    mesh_area += area;
+  }
+  if (mesh_area > 0.0f) {
+    mesh_centroid = vec3_scale(mesh_centroid, 1.0f / mesh_area);
+  }
+
+  std::vector<float> key(cluster_count);
+  std::vector<uint32_t> order(cluster_count);
+  for (size_t c = 0; c < cluster_count; ++c) {
+    key[c] = vec3_dot(vec3_sub(centroid[c], mesh_centroid), normal[c]);
+    order[c] = static_cast<uint32_t>(c);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key[a] > key[b]; });
+
+  std::vector<uint32_t> out;
+  out.reserve(tri_count * 3);
+  for (const uint32_t c : order) {
+    out.insert(out.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+  }
+  std::copy(out.begin(), out.end(), indices);
+}
+
+void mesh_optimize_vertex_fetch(MeshData& mesh) {
+  const size_t vertex_count = mesh.positions.size() / 3;
+  std::vector<uint32_t> remap(vertex_count, ~0u);
+  uint32_t next = 0;
+  for (uint32_t& index : mesh.indices) {
+    if (remap[index] == ~0u) {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+
+  MeshData reordered;
+  reordered.positions.resize(static_cast<size_t>(next) * 3);
+  reordered.normals.resize(static_cast<size_t>(next) * 3);
+  reordered.colors.resize(static_cast<size_t>(next) * 3);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    if (remap[v] == ~0u) {
+      continue;
+    }
+    const size_t dst = static_cast<size_t>(remap[v]) * 3;
+    std::copy(&mesh.positions[v * 3], &mesh.positions[v * 3] + 3, &reordered.positions[dst]);
+    std::copy(&mesh.normals[v * 3], &mesh.normals[v * 3] + 3, &reordered.normals[dst]);
+    std::copy(&mesh.colors[v * 3], &mesh.colors[v * 3] + 3, &reordered.colors[dst]);
+  }
+  mesh.positions.swap(reordered.positions);
+  mesh.normals.swap(reordered.normals);
+  mesh.colors.swap(reordered.colors);
+}
+
+void oct_encode_snorm8(Vec3 n, int8_t out[2]) {
+  const float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+  float x = l1 > 0.0f ? n.x / l1 : 0.0f;
+  float y = l1 > 0.0f ? n.y / l1 : 0.0f;
+  if (n.z < 0.0f) {
+    const float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    const float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  out[0] = to_snorm8(x);
+  out[1] = to_snorm8(y);
+}
+
+// Mirrors oct_decode() in the WGSL of src/main.cpp.
+Vec3 oct_decode_snorm8(const int8_t in[2]) {
+  float x = std::max(static_cast<float>(in[0]) / 127.0f, -1.0f);
+  float y = std::max(static_cast<float>(in[1]) / 127.0f, -1.0f);
+  const float z = 1.0f - std::fabs(x) - std::fabs(y);
+  const float t = std::max(-z, 0.0f);
+  x += x >= 0.0f ? -t : t;
+  y += y >= 0.0f ? -t : t;
+  return vec3_normalize(Vec3{x, y, z});
+}
+
+void mesh_write_packed(const MeshData& mesh, std::vector<uint8_t>& out) {
+  const uint32_t vertex_count = static_cast<uint32_t>(mesh.positions.size() / 3);
+  const uint32_t index_count = static_cast<uint32_t>(mesh.indices.size());
+
+  Vec3 lo{0.0f, 0.0f, 0.0f};
+  Vec3 hi{0.0f, 0.0f, 0.0f};
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    const Vec3 p = load_vec3(mesh.positions, v);
+    lo = v == 0 ? p : Vec3{std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+    hi = v == 0 ? p : Vec3{std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+  }
+
+  MeshFileHeader header{};
+  header.magic = kMeshFileMagic;
+  header.version = kMeshFileVersion;
+  header.header_bytes = sizeof(MeshFileHeader);
+  header.vertex_count = vertex_count;
+  header.index_count = index_count;
+  header.index_bytes = vertex_count <= 0x10000u ? 2 : 4;
+  header.bounds_center[0] = (lo.x + hi.x) * 0.5f;
+  header.bounds_center[1] = (lo.y + hi.y) * 0.5f;
+  header.bounds_center[2] = (lo.z + hi.z) * 0.5f;
+  // A flat axis still needs a non-zero scale to divide by.
+  header.bounds_scale[0] = std::max((hi.x - lo.x) * 0.5f, 1.0e-8f);
+  header.bounds_scale[1] = std::max((hi.y - lo.y) * 0.5f, 1.0e-8f);
+  header.bounds_scale[2] = std::max((hi.z - lo.z) * 0.5f, 1.0e-8f);
+  header.vertex_offset = file_align_up(sizeof(MeshFileHeader), kMeshFileAlign);
+  header.index_offset = file_align_up(
+      header.vertex_offset + static_cast<uint64_t>(vertex_count) * sizeof(PackedVertex), kMeshFileAlign);
+  header.file_bytes = file_align_up(
+      header.index_offset + static_cast<uint64_t>(index_count) * header.index_bytes, kMeshFileAlign);
+
+  out.assign(static_cast<size_t>(header.file_bytes), 0);
+  std::memcpy(out.data(), &header, sizeof(header));
+
+  PackedVertex* dst = reinterpret_cast<PackedVertex*>(out.data() + header.vertex_offset);
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    PackedVertex& pv = dst[v];
+    for (int k = 0; k < 3; ++k) {
+      pv.position[k] = to_snorm16((mesh.positions[v * 3 + k] - header.bounds_center[k]) / header.bounds_scale[k]);
+      pv.color[k] = to_unorm8(mesh.colors[v * 3 + k]);
+    }
+    pv.position[3] = 0;
+    pv.color[3] = 255;
+    oct_encode_snorm8(load_vec3(mesh.normals, v), pv.normal);
+    pv.normal[2] = 0;
+    pv.normal[3] = 0;
+  }
+
+  uint8_t* index_dst = out.data() + header.index_offset;
+  if (header.index_bytes == 2) {
+    for (uint32_t i = 0; i < index_count; ++i) {
+      const uint16_t index = static_cast<uint16_t>(mesh.indices[i]);
+      std::memcpy(index_dst + i * 2, &index, 2);
+    }
+  } else {
+    std::memcpy(index_dst, mesh.indices.data(), static_cast<size_t>(index_count) * 4);
+  }
+}
+
+bool mesh_file_open(const uint8_t* data, size_t size, MeshFileView& out) {
+  if (size < sizeof(MeshFileHeader)) {
+    return false;
+  }
+  const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(data);
+  if (header->magic != kMeshFileMagic || header->version != kMeshFileVersion ||
+      header->header_bytes != sizeof(MeshFileHeader) || header->file_bytes > size) {
+    return false;
+  }
+  if ((header->index_bytes != 2 && header->index_bytes != 4) || header->vertex_count == 0 ||
+      header->index_count == 0 || header->index_count % 3 != 0) {
+    return false;
+  }
+  const uint64_t vertex_bytes = static_cast<uint64_t>(header->vertex_count) * sizeof(PackedVertex);
+  const uint64_t index_bytes = static_cast<uint64_t>(header->index_count) * header->index_bytes;
+  if (!file_section_fits(header->vertex_offset, vertex_bytes, header->file_bytes, kMeshFileAlign) ||
+      !file_section_fits(header->index_offset, index_bytes, header->file_bytes, kMeshFileAlign)) {
+    return false;
+  }
+
+  const uint8_t* indices = data + header->index_offset;
+  for (uint32_t i = 0; i < header->index_count; ++i) {
+    uint32_t index = 0;
+    std::memcpy(&index, indices + static_cast<size_t>(i) * header->index_bytes, header->index_bytes);
+    if (index >= header->vertex_count) {
+      return false;
+    }
+  }
+
+  out.header = header;
+  out.vertices = reinterpret_cast<const PackedVertex*>(data + header->vertex_offset);
+  out.indices = indices;
+  return true;
+}
+
+bool mesh_import_obj(const char* text, size_t size, std::vector<uint8_t>& out, MeshImportStats* stats) {
+  MeshData mesh;
+  if (!mesh_parse_obj(text, size, mesh)) {
+    return false;
+  }
+  const size_t vertex_count = mesh.positions.size() / 3;
+  const float acmr_before = mesh_acmr(mesh.indices.data(), mesh.indices.size(), vertex_count, kMeshAcmrCacheSize);
+
+  mesh_optimize_vertex_cache(mesh.indices.data(), mesh.indices.size(), vertex_count);
+  mesh_optimize_overdraw(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), vertex_count,
+                         kMeshOverdrawThreshold);
+  mesh_optimize_vertex_fetch(mesh);
+  mesh_write_packed(mesh, out);
+
+  if (stats) {
+    stats->vertex_count = static_cast<int>(mesh.positions.size() / 3);
+    stats->triangle_count = static_cast<int>(mesh.indices.size() / 3);
+    stats->acmr_before = acmr_before;
+    stats->acmr_after = mesh_acmr(mesh.indices.data(), mesh.indices.size(), mesh.positions.size() / 3,
+                                  kMeshAcmrCacheSize);
+    stats->packed_bytes = out.size();
+    stats->float_bytes = mesh.positions.size() / 3 * 36 + mesh.indices.size() * 4;
+  }
+  return true;
+}
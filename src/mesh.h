@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "math3d.h"
+
+// Import path for real scene geometry: OBJ text is welded into an indexed
+// triangle list, reordered for the post-transform vertex cache and for
+// overdraw, then quantized into a packed blob the web build uploads as-is.
+//
+// A packed vertex is 16 bytes, against 36 for float position, normal and
+// color:
+//   position  snorm16 x 4  xyz relative to the mesh bounds, w = 0
+//   color     unorm8 x 4   rgb, a = 255
+//   normal    snorm8 x 4   octahedral xy, zw = 0
+// Positions decode as bounds_center + snorm * bounds_scale. The renderer
+// folds that into the instance transform, so the vertex shader only has to
+// unpack the normal.
+//
+// Blob layout, sections on 64-byte boundaries like the scene file so the
+// whole blob can back one vertex+index buffer:
+//
+//   MeshFileHeader
+//   vertices   PackedVertex[vertex_count]
+//   indices    u16 or u32 [index_count] (u16 whenever the vertices fit)
+constexpr uint32_t kMeshFileMagic = 0x484D5346;  // "FSMH"
+constexpr uint16_t kMeshFileVersion = 1;
+constexpr uint32_t kMeshFileAlign = 64;
+// FIFO size assumed when reporting ACMR (average cache misses per triangle).
+constexpr int kMeshAcmrCacheSize = 16;
+// Overdraw reordering may give up this much ACMR (5%) for better ordering.
+constexpr float kMeshOverdrawThreshold = 1.05f;
+
+struct MeshData {
+  std::vector<float> positions;  // xyz per vertex
+  std::vector<float> normals;    // xyz per vertex, unit length
+  std::vector<float> colors;     // rgb per vertex
+  std::vector<uint32_t> indices;  // triangle list
+};
+
+struct PackedVertex {
+  int16_t position[4];
+  uint8_t color[4];
+  int8_t normal[4];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex is part of the mesh file format");
+
+struct MeshFileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_bytes;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  uint32_t index_bytes;  // 2 or 4
+  uint32_t reserved;
+  float bounds_center[3];
+  float bounds_scale[3];  // half extent per axis
+  uint64_t vertex_offset;
+  uint64_t index_offset;
+  uint64_t file_bytes;
+  uint64_t reserved2;
+};
+static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader is part of the mesh file format");
+
+// Validated pointers into a mesh blob; nothing is copied.
+struct MeshFileView {
+  const MeshFileHeader* header;
+  const PackedVertex* vertices;
+  const uint8_t* indices;
+};
+
+struct MeshImportStats {
+  int vertex_count;
+  int triangle_count;
+  float acmr_before;  // as parsed
+  float acmr_after;   // after cache and overdraw reordering
+  size_t packed_bytes;
+  size_t float_bytes;  // the same mesh as float attributes and u32 indices
+};
+
+// Supports `v x y z [r g b]`, `vn`, and `f` with v, v/vt, v//vn and v/vt/vn
+// corners (negative indices included). Polygons are fanned into triangles.
+// Corners without a normal get the smooth area-weighted normal of their
+// position. Returns false when the text has no valid triangle.
+bool mesh_parse_obj(const char* text, size_t size, MeshData& out);
+
+// Forsyth's linear-speed vertex cache optimisation, in place.
+void mesh_optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count);
+// Splits a cache-optimised list into clusters at cache restarts and sorts
+// them outward-facing first (Sander et al.), accepting up to `threshold`
+// times the input ACMR.
+void mesh_optimize_overdraw(uint32_t* indices,
+                            size_t index_count,
+                            const float* positions,
+                            size_t vertex_count,
+                            float threshold);
+// Renumbers vertices in order of first use and drops unreferenced ones.
+void mesh_optimize_vertex_fetch(MeshData& mesh);
+float mesh_acmr(const uint32_t* indices, size_t index_count, size_t vertex_count, int cache_size);
+
+void oct_encode_snorm8(Vec3 n, int8_t out[2]);
+Vec3 oct_decode_snorm8(const int8_t in[2]);
+
+void mesh_write_packed(const MeshData& mesh, std::vector<uint8_t>& out);
+// `data` must be at least 8-byte aligned. Checks the magic, version, index
+// width, that every section lies inside `size` and that indices are in range.
+bool mesh_file_open(const uint8_t* data, size_t size, MeshFileView& out);
+
+// Parse, optimise and pack in one go. `stats` may be null.
+bool mesh_import_obj(const char* text, size_t size, std::vector<uint8_t>& out, MeshImportStats* stats);
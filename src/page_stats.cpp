@@ -0,0 +1,35 @@
+#include "page_stats.h"
+
+void page_stats_init(PageStats& stats) {
+  stats.sequence.store(0, std::memory_order_relaxed);
+  for (std::atomic<double>& v : stats.values) {
+    v.store(-1.0, std::memory_order_relaxed);
+  }
+}
+
+void page_stats_publish(PageStats& stats, const double* values) {
+  const uint32_t sequence = stats.sequence.load(std::memory_order_relaxed);
+  stats.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < kPageStatCount; ++i) {
+    stats.values[i].store(values[i], std::memory_order_relaxed);
+  }
+  stats.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool page_stats_read(const PageStats& stats, double* out, int attempts) {
+  for (int attempt = 0; attempt < attempts; ++attempt) {
+    const uint32_t before = stats.sequence.load(std::memory_order_acquire);
+    if (before & 1u) {
+      continue;
+    }
+    for (int i = 0; i < kPageStatCount; ++i) {
+      out[i] = stats.values[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (stats.sequence.load(std::memory_order_relaxed) == before) {
+      return true;
+    }
+  }
+  return false;
+}
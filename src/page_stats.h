@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Renderer stats the page polls for its status lines and the stress sweep.
+// In worker render mode the page cannot call the framespace_get_* getters
+// without racing the render thread, so the renderer publishes a copy here
+// once per frame and the page reads only this block (see readStats() in
+// web/shell.html).
+//
+// The block is a seqlock: the sequence is odd while the renderer writes, and
+// a reader that sees it change retries. Like InputQueue, the layout is part
+// of the contract with JavaScript: the sequence is a u32 at offset 0, the
+// values are f64 from offset 8, indexed by PageStat.
+enum class PageStat : uint32_t {
+  FrameP50,
+  FrameP95,
+  FrameP99,
+  EncodeP50,
+  EncodeP95,
+  GpuP50,
+  GpuP95,
+  GpuP99,
+  OccludedMean,
+  VisiblePhotos,
+  SkippedFrames,
+  RenderScale,
+  FirstFrameMs,
+  SnapshotResidentBytes,
+  SnapshotBudgetBytes,
+  SnapshotEvictions,
+  SnapshotEncodedBytes,
+  LastEncodeMs,
+  Count,
+};
+
+constexpr int kPageStatCount = static_cast<int>(PageStat::Count);
+
+struct PageStats {
+  alignas(64) std::atomic<uint32_t> sequence;
+  std::atomic<double> values[kPageStatCount];  // -1 where there is no sample yet
+};
+
+static_assert(offsetof(PageStats, values) == 8, "PageStats layout is shared with JavaScript");
+static_assert(sizeof(std::atomic<double>) == 8, "PageStats layout is shared with JavaScript");
+
+void page_stats_init(PageStats& stats);
+// Writer side; a single thread publishes.
+void page_stats_publish(PageStats& stats, const double* values);
+// Reader side. Copies a consistent set of kPageStatCount values, or returns
+// false when the writer kept interrupting for `attempts` tries.
+bool page_stats_read(const PageStats& stats, double* out, int attempts);
@@ -0,0 +1,556 @@
+#include "physics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if !defined(FRAMESPACE_MATH_SCALAR) && defined(__wasm_simd128__)
+
+#include <wasm_simd128.h>
+
+#define FRAMESPACE_PHYSICS_SIMD 1
+
+namespace {
+
+using f32x4 = v128_t;
+
+inline f32x4 simd_load(const float* p) { return wasm_v128_load(p); }
+inline void simd_store(float* p, f32x4 v) { wasm_v128_store(p, v); }
+inline f32x4 simd_splat(float v) { return wasm_f32x4_splat(v); }
+inline f32x4 simd_add(f32x4 a, f32x4 b) { return wasm_f32x4_add(a, b); }
+inline f32x4 simd_sub(f32x4 a, f32x4 b) { return wasm_f32x4_sub(a, b); }
+inline f32x4 simd_mul(f32x4 a, f32x4 b) { return wasm_f32x4_mul(a, b); }
+inline f32x4 simd_min(f32x4 a, f32x4 b) { return wasm_f32x4_pmin(a, b); }
+inline f32x4 simd_max(f32x4 a, f32x4 b) { return wasm_f32x4_pmax(a, b); }
+inline f32x4 simd_abs(f32x4 a) { return wasm_f32x4_abs(a); }
+inline f32x4 simd_neg(f32x4 a) { return wasm_f32x4_neg(a); }
+inline f32x4 simd_lt(f32x4 a, f32x4 b) { return wasm_f32x4_lt(a, b); }
+inline f32x4 simd_gt(f32x4 a, f32x4 b) { return wasm_f32x4_gt(a, b); }
+inline f32x4 simd_select(f32x4 mask, f32x4 a, f32x4 b) { return wasm_v128_bitselect(a, b, mask); }
+// Truncation toward zero; inputs are non-negative cell coordinates.
+inline f32x4 simd_trunc(f32x4 a) { return wasm_f32x4_convert_i32x4(wasm_i32x4_trunc_sat_f32x4(a)); }
+inline void simd_store_i32(int* p, f32x4 a) { wasm_v128_store(p, wasm_i32x4_trunc_sat_f32x4(a)); }
+inline int simd_mask(f32x4 a) { return static_cast<int>(wasm_i32x4_bitmask(a)); }
+
+}  // namespace
+
+#elif !defined(FRAMESPACE_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+
+#include <emmintrin.h>
+
+#define FRAMESPACE_PHYSICS_SIMD 1
+
+namespace {
+
+using f32x4 = __m128;
+
+inline f32x4 simd_load(const float* p) { return _mm_loadu_ps(p); }
+inline void simd_store(float* p, f32x4 v) { _mm_storeu_ps(p, v); }
+inline f32x4 simd_splat(float v) { return _mm_set1_ps(v); }
+inline f32x4 simd_add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+inline f32x4 simd_sub(f32x4 a, f32x4 b) { return _mm_sub_ps(a, b); }
+inline f32x4 simd_mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+inline f32x4 simd_min(f32x4 a, f32x4 b) { return _mm_min_ps(a, b); }
+inline f32x4 simd_max(f32x4 a, f32x4 b) { return _mm_max_ps(a, b); }
+inline f32x4 simd_abs(f32x4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline f32x4 simd_neg(f32x4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+inline f32x4 simd_lt(f32x4 a, f32x4 b) { return _mm_cmplt_ps(a, b); }
+inline f32x4 simd_gt(f32x4 a, f32x4 b) { return _mm_cmpgt_ps(a, b); }
+inline f32x4 simd_select(f32x4 mask, f32x4 a, f32x4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline f32x4 simd_trunc(f32x4 a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+inline void simd_store_i32(int* p, f32x4 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(a)); }
+inline int simd_mask(f32x4 a) { return _mm_movemask_ps(a); }
+
+}  // namespace
+
+#endif
+
+namespace {
+
+constexpr float kLinearDamping = 0.1f;  // per second
+constexpr int kBodiesPerJob = 1024;
+
+struct AxisStep {
+  float lo;  // wall positions for a sphere center
+  float hi;
+  float dv;  // velocity change from gravity over one step
+  float damping;
+  float restitution;
+};
+
+// One axis of semi-implicit Euler plus the two walls on that axis; axes are
+// independent, so each is a straight pass over two columns.
+void integrate_axis(float* p, float* v, int count, const AxisStep& a) {
+  int i = 0;
+#if defined(FRAMESPACE_PHYSICS_SIMD)
+  const f32x4 lo = simd_splat(a.lo);
+  const f32x4 hi = simd_splat(a.hi);
+  const f32x4 dv = simd_splat(a.dv);
+  const f32x4 damping = simd_splat(a.damping);
+  const f32x4 restitution = simd_splat(a.restitution);
+  const f32x4 dt = simd_splat(kPhysicsStepSeconds);
+  for (; i + 4 <= count; i += 4) {
+    f32x4 vel = simd_mul(simd_add(simd_load(v + i), dv), damping);
+    f32x4 pos = simd_add(simd_load(p + i), simd_mul(vel, dt));
+    const f32x4 below = simd_lt(pos, lo);
+    const f32x4 above = simd_gt(pos, hi);
+    const f32x4 bounce = simd_mul(simd_abs(vel), restitution);
+    vel = simd_select(below, bounce, simd_select(above, simd_neg(bounce), vel));
+    pos = simd_min(simd_max(pos, lo), hi);
+    simd_store(v + i, vel);
+    simd_store(p + i, pos);
+  }
+#endif
+  for (; i < count; ++i) {
+    float vel = (v[i] + a.dv) * a.damping;
+    float pos = p[i] + vel * kPhysicsStepSeconds;
+    if (pos < a.lo) {
+      pos = a.lo;
+      vel = std::fabs(vel) * a.restitution;
+    } else if (pos > a.hi) {
+      pos = a.hi;
+      vel = -std::fabs(vel) * a.restitution;
+    }
+    v[i] = vel;
+    p[i] = pos;
+  }
+}
+
+void compute_cells(const PhysicsWorld& w, const float* px, const float* py, const float* pz, int* cell, int count) {
+  int i = 0;
+#if defined(FRAMESPACE_PHYSICS_SIMD)
+  const f32x4 min_x = simd_splat(w.box_min.x);
+  const f32x4 min_y = simd_splat(w.box_min.y);
+  const f32x4 min_z = simd_splat(w.box_min.z);
+  const f32x4 inv_x = simd_splat(w.inv_cell.x);
+  const f32x4 inv_y = simd_splat(w.inv_cell.y);
+  const f32x4 inv_z = simd_splat(w.inv_cell.z);
+  const f32x4 zero = simd_splat(0.0f);
+  const f32x4 max_x = simd_splat(static_cast<float>(w.grid_x - 1));
+  const f32x4 max_y = simd_splat(static_cast<float>(w.grid_y - 1));
+  const f32x4 max_z = simd_splat(static_cast<float>(w.grid_z - 1));
+  const f32x4 dim_x = simd_splat(static_cast<float>(w.grid_x));
+  const f32x4 dim_y = simd_splat(static_cast<float>(w.grid_y));
+  for (; i + 4 <= count; i += 4) {
+    const f32x4 cx = simd_min(simd_max(simd_trunc(simd_mul(simd_sub(simd_load(px + i), min_x), inv_x)), zero), max_x);
+    const f32x4 cy = simd_min(simd_max(simd_trunc(simd_mul(simd_sub(simd_load(py + i), min_y), inv_y)), zero), max_y);
+    const f32x4 cz = simd_min(simd_max(simd_trunc(simd_mul(simd_sub(simd_load(pz + i), min_z), inv_z)), zero), max_z);
+    // Exact in float: cell counts are far below 2^24.
+    simd_store_i32(cell + i, simd_add(simd_mul(simd_add(simd_mul(cz, dim_y), cy), dim_x), cx));
+  }
+#endif
+  for (; i < count; ++i) {
+    const int cx = std::clamp(static_cast<int>((px[i] - w.box_min.x) * w.inv_cell.x), 0, w.grid_x - 1);
+    const int cy = std::clamp(static_cast<int>((py[i] - w.box_min.y) * w.inv_cell.y), 0, w.grid_y - 1);
+    const int cz = std::clamp(static_cast<int>((pz[i] - w.box_min.z) * w.inv_cell.z), 0, w.grid_z - 1);
+    cell[i] = (cz * w.grid_y + cy) * w.grid_x + cx;
+  }
+}
+
+// Moves both spheres apart along the contact normal and removes their
+// approaching velocity (equal masses). Returns true when they touched.
+bool resolve_pair(PhysicsWorld& w, int i, int j, float diameter, float restitution) {
+  float nx = w.px[j] - w.px[i];
+  float ny = w.py[j] - w.py[i];
+  float nz = w.pz[j] - w.pz[i];
+  const float d2 = nx * nx + ny * ny + nz * nz;
+  if (d2 >= diameter * diameter) {
+    return false;
+  }
+  float dist = std::sqrt(d2);
+  if (dist < 1.0e-6f) {
+    nx = 0.0f;
+    ny = 1.0f;
+    nz = 0.0f;
+    dist = 0.0f;
+  } else {
+    const float inv = 1.0f / dist;
+    nx *= inv;
+    ny *= inv;
+    nz *= inv;
+  }
+  const float half = (diameter - dist) * 0.5f;
+  w.px[i] -= nx * half;
+  w.py[i] -= ny * half;
+  w.pz[i] -= nz * half;
+  w.px[j] += nx * half;
+  w.py[j] += ny * half;
+  w.pz[j] += nz * half;
+
+  const float vn = (w.vx[j] - w.vx[i]) * nx + (w.vy[j] - w.vy[i]) * ny + (w.vz[j] - w.vz[i]) * nz;
+  if (vn < 0.0f) {
+    const float impulse = -(1.0f + restitution) * vn * 0.5f;
+    w.vx[i] -= impulse * nx;
+    w.vy[i] -= impulse * ny;
+    w.vz[i] -= impulse * nz;
+    w.vx[j] += impulse * nx;
+    w.vy[j] += impulse * ny;
+    w.vz[j] += impulse * nz;
+  }
+  return true;
+}
+
+// Body a against bodies [begin, end), four distance tests at a time; only
+// the lanes that touch go through resolve_pair.
+int collide_range(PhysicsWorld& w, int a, int begin, int end, float diameter) {
+  int contacts = 0;
+  int b = begin;
+#if defined(FRAMESPACE_PHYSICS_SIMD)
+  const f32x4 limit = simd_splat(diameter * diameter);
+  f32x4 ax = simd_splat(w.px[a]);
+  f32x4 ay = simd_splat(w.py[a]);
+  f32x4 az = simd_splat(w.pz[a]);
+  for (; b + 4 <= end; b += 4) {
+    const f32x4 dx = simd_sub(simd_load(&w.px[b]), ax);
+    const f32x4 dy = simd_sub(simd_load(&w.py[b]), ay);
+    const f32x4 dz = simd_sub(simd_load(&w.pz[b]), az);
+    const f32x4 d2 = simd_add(simd_add(simd_mul(dx, dx), simd_mul(dy, dy)), simd_mul(dz, dz));
+    int mask = simd_mask(simd_lt(d2, limit));
+    if (mask == 0) {
+      continue;
+    }
+    while (mask != 0) {
+      contacts += resolve_pair(w, a, b + __builtin_ctz(static_cast<unsigned>(mask)), diameter, w.restitution) ? 1 : 0;
+      mask &= mask - 1;
+    }
+    ax = simd_splat(w.px[a]);
+    ay = simd_splat(w.py[a]);
+    az = simd_splat(w.pz[a]);
+  }
+#endif
+  for (; b < end; ++b) {
+    contacts += resolve_pair(w, a, b, diameter, w.restitution) ? 1 : 0;
+  }
+  return contacts;
+}
+
+void step_volume(PhysicsWorld& w, int v) {
+  const int base = v * w.bodies_per_volume;
+  const int count = w.volumes[v].body_count;
+  const float damping = 1.0f - kLinearDamping * kPhysicsStepSeconds;
+  const float r = w.radius;
+  integrate_axis(&w.px[base], &w.vx[base], count, AxisStep{w.box_min.x + r, w.box_max.x - r, 0.0f, damping, w.restitution});
+  integrate_axis(&w.py[base], &w.vy[base], count,
+                 AxisStep{w.box_min.y + r, w.box_max.y - r, kPhysicsGravity * kPhysicsStepSeconds, damping, w.restitution});
+  integrate_axis(&w.pz[base], &w.vz[base], count, AxisStep{w.box_min.z + r, w.box_max.z - r, 0.0f, damping, w.restitution});
+
+  // Counting sort by cell, then the body columns are permuted into that
+  // order, so every cell and every run of cells along x is a contiguous
+  // range of bodies. Cell c holds bodies [start[c], start[c + 1]).
+  int* cell = &w.body_cell[base];
+  int* start = &w.cell_start[static_cast<size_t>(v) * (w.grid_cells + 1)];
+  int* order = &w.cell_bodies[base];
+  compute_cells(w, &w.px[base], &w.py[base], &w.pz[base], cell, count);
+  std::fill(start, start + w.grid_cells + 1, 0);
+  for (int i = 0; i < count; ++i) {
+    start[cell[i]] += 1;
+  }
+  int end = 0;
+  for (int c = 0; c < w.grid_cells; ++c) {
+    end += start[c];
+    start[c] = end;
+  }
+  start[w.grid_cells] = count;
+  for (int i = count - 1; i >= 0; --i) {
+    order[--start[cell[i]]] = i;
+  }
+  for (std::vector<float>* column : {&w.px, &w.py, &w.pz, &w.vx, &w.vy, &w.vz}) {
+    float* values = column->data() + base;
+    float* scratch = w.sort_scratch.data() + base;
+    for (int k = 0; k < count; ++k) {
+      scratch[k] = values[order[k]];
+    }
+    std::copy(scratch, scratch + count, values);
+  }
+  for (int c = 0; c <= w.grid_cells; ++c) {
+    start[c] += base;
+  }
+
+  // Every pair once: the rest of the body's own cell and the next cell in the
+  // row, the row above, and the three rows in the next layer.
+  const float diameter = 2.0f * r;
+  int contacts = 0;
+  for (int cz = 0; cz < w.grid_z; ++cz) {
+    for (int cy = 0; cy < w.grid_y; ++cy) {
+      const int row = (cz * w.grid_y + cy) * w.grid_x;
+      for (int cx = 0; cx < w.grid_x; ++cx) {
+        const int c = row + cx;
+        if (start[c] == start[c + 1]) {
+          continue;
+        }
+        const int x_lo = std::max(cx - 1, 0);
+        const int x_hi = std::min(cx + 1, w.grid_x - 1);
+        int ranges[4][2];
+        int range_count = 0;
+        if (cy + 1 < w.grid_y) {
+          const int up = row + w.grid_x;
+          ranges[range_count][0] = start[up + x_lo];
+          ranges[range_count++][1] = start[up + x_hi + 1];
+        }
+        if (cz + 1 < w.grid_z) {
+          const int layer = row + w.grid_x * w.grid_y;
+          const int first = layer + (cy > 0 ? -w.grid_x : 0);
+          const int last = layer + (cy + 1 < w.grid_y ? w.grid_x : 0);
+          for (int n = first; n <= last; n += w.grid_x) {
+            ranges[range_count][0] = start[n + x_lo];
+            ranges[range_count++][1] = start[n + x_hi + 1];
+          }
+        }
+        const int same_row_end = start[row + x_hi + 1];
+        for (int a = start[c]; a < start[c + 1]; ++a) {
+          contacts += collide_range(w, a, a + 1, same_row_end, diameter);
+          for (int k = 0; k < range_count; ++k) {
+            contacts += collide_range(w, a, ranges[k][0], ranges[k][1], diameter);
+          }
+        }
+      }
+    }
+  }
+  w.volume_contacts[v] = contacts;
+
+  float max_speed2 = 0.0f;
+  for (int b = base; b < base + count; ++b) {
+    max_speed2 = std::max(max_speed2, w.vx[b] * w.vx[b] + w.vy[b] * w.vy[b] + w.vz[b] * w.vz[b]);
+  }
+  PhysicsVolume& volume = w.volumes[v];
+  volume.still_steps = max_speed2 < kPhysicsRestSpeed * kPhysicsRestSpeed ? volume.still_steps + 1 : 0;
+}
+
+void step_volume_range(void* ctx, int begin, int end) {
+  PhysicsWorld& w = *static_cast<PhysicsWorld*>(ctx);
+  for (int k = begin; k < end; ++k) {
+    step_volume(w, w.awake_list[k]);
+  }
+}
+
+void copy_body(PhysicsWorld& w, int from, int to) {
+  w.px[to] = w.px[from];
+  w.py[to] = w.py[from];
+  w.pz[to] = w.pz[from];
+  w.vx[to] = w.vx[from];
+  w.vy[to] = w.vy[from];
+  w.vz[to] = w.vz[from];
+}
+
+void remove_volume_at(PhysicsWorld& w, int v) {
+  const int last = static_cast<int>(w.volumes.size()) - 1;
+  if (v != last) {
+    for (int b = 0; b < w.volumes[last].body_count; ++b) {
+      copy_body(w, last * w.bodies_per_volume + b, v * w.bodies_per_volume + b);
+    }
+    w.volumes[v] = w.volumes[last];
+  }
+  w.volumes.pop_back();
+}
+
+Aabb volume_bounds(Vec3 position, float yaw, float scale) {
+  const Aabb frame = photo_bounds(position, yaw, scale);
+  const float grow = kPhysicsVolumeDepth * scale;
+  return {
+      {frame.min.x - grow, frame.min.y, frame.min.z - grow},
+      {frame.max.x + grow, frame.max.y, frame.max.z + grow},
+  };
+}
+
+}  // namespace
+
+void physics_init(PhysicsWorld& world, int max_volumes, int bodies_per_volume, float radius) {
+  world.max_volumes = std::max(max_volumes, 0);
+  world.bodies_per_volume = std::max(bodies_per_volume, 1);
+  world.radius = radius;
+  world.restitution = 0.6f;
+  world.box_min = Vec3{-kPhotoHalfWidth, -kPhotoHalfHeight, 0.0f};
+  world.box_max = Vec3{kPhotoHalfWidth, kPhotoHalfHeight, kPhysicsVolumeDepth};
+
+  // Roughly one body per cell, but never narrower than a sphere.
+  const Vec3 extent = vec3_sub(world.box_max, world.box_min);
+  const float cell = std::max(2.0f * radius,
+                              std::cbrt(extent.x * extent.y * extent.z / static_cast<float>(world.bodies_per_volume)));
+  world.grid_x = std::max(1, static_cast<int>(extent.x / cell));
+  world.grid_y = std::max(1, static_cast<int>(extent.y / cell));
+  world.grid_z = std::max(1, static_cast<int>(extent.z / cell));
+  world.grid_cells = world.grid_x * world.grid_y * world.grid_z;
+  world.inv_cell = Vec3{static_cast<float>(world.grid_x) / extent.x,
+                        static_cast<float>(world.grid_y) / extent.y,
+                        static_cast<float>(world.grid_z) / extent.z};
+
+  const size_t bodies = static_cast<size_t>(world.max_volumes) * world.bodies_per_volume;
+  world.volumes.clear();
+  world.volumes.reserve(static_cast<size_t>(world.max_volumes));
+  world.px.assign(bodies, 0.0f);
+  world.py.assign(bodies, 0.0f);
+  world.pz.assign(bodies, 0.0f);
+  world.vx.assign(bodies, 0.0f);
+  world.vy.assign(bodies, 0.0f);
+  world.vz.assign(bodies, 0.0f);
+  world.body_cell.assign(bodies, 0);
+  world.cell_start.assign(static_cast<size_t>(world.max_volumes) * (world.grid_cells + 1), 0);
+  world.cell_bodies.assign(bodies, 0);
+  world.sort_scratch.assign(bodies, 0.0f);
+  world.volume_contacts.assign(static_cast<size_t>(world.max_volumes), 0);
+  world.awake_list.clear();
+  world.awake_list.reserve(static_cast<size_t>(world.max_volumes));
+  world.accumulator = 0.0;
+  world.total_steps = 0;
+  world.last_stats = PhysicsStats{};
+}
+
+int physics_add_volume(PhysicsWorld& world, PhotoHandle owner, int body_count, uint32_t seed) {
+  if (static_cast<int>(world.volumes.size()) >= world.max_volumes) {
+    return -1;
+  }
+  const int v = static_cast<int>(world.volumes.size());
+  body_count = std::clamp(body_count, 0, world.bodies_per_volume);
+  world.volumes.push_back(PhysicsVolume{owner, body_count, 0, true});
+
+  const float r = world.radius;
+  uint32_t state = seed * 2654435761u + 1u;
+  for (int b = 0; b < body_count; ++b) {
+    const int i = v * world.bodies_per_volume + b;
+    world.px[i] = world.box_min.x + r + rng_unit(state) * (world.box_max.x - world.box_min.x - 2.0f * r);
+    world.py[i] = world.box_min.y + r + rng_unit(state) * (world.box_max.y - world.box_min.y - 2.0f * r);
+    world.pz[i] = world.box_min.z + r + rng_unit(state) * (world.box_max.z - world.box_min.z - 2.0f * r);
+    world.vx[i] = rng_unit(state) * 2.0f - 1.0f;
+    world.vy[i] = rng_unit(state) * 2.0f - 1.0f;
+    world.vz[i] = rng_unit(state) * 2.0f - 1.0f;
+  }
+  return v;
+}
+
+bool physics_remove_volume(PhysicsWorld& world, PhotoHandle owner) {
+  const int v = physics_find_volume(world, owner);
+  if (v < 0) {
+    return false;
+  }
+  remove_volume_at(world, v);
+  return true;
+}
+
+void physics_clear(PhysicsWorld& world) {
+  world.volumes.clear();
+  world.accumulator = 0.0;
+}
+
+int physics_find_volume(const PhysicsWorld& world, PhotoHandle owner) {
+  for (size_t v = 0; v < world.volumes.size(); ++v) {
+    if (world.volumes[v].owner == owner) {
+      return static_cast<int>(v);
+    }
+  }
+  return -1;
+}
+
+int physics_body_count(const PhysicsWorld& world) {
+  int total = 0;
+  for (const PhysicsVolume& volume : world.volumes) {
+    total += volume.body_count;
+  }
+  return total;
+}
+
+bool physics_volume_resting(const PhysicsVolume& volume) {
+  return volume.still_steps >= kPhysicsRestSteps;
+}
+
+void physics_update_sleep(PhysicsWorld& world, const PhotoScene& scene, const Frustum& frustum) {
+  for (int v = 0; v < static_cast<int>(world.volumes.size());) {
+    PhysicsVolume& volume = world.volumes[v];
+    const int dense = scene_find_photo(scene, volume.owner);
+    if (dense < 0) {
+      remove_volume_at(world, v);
+      continue;
+    }
+    const Aabb box = volume_bounds(Vec3{scene.px[dense], scene.py[dense], scene.pz[dense]}, scene.yaw[dense], scene.scale[dense]);
+    volume.awake = frustum_test_aabb(frustum, box) != FrustumTest::Outside;
+    ++v;
+  }
+}
+
+void physics_step(PhysicsWorld& world, JobSystem& jobs) {
+  world.awake_list.clear();
+  int awake_bodies = 0;
+  int resting = 0;
+  for (size_t v = 0; v < world.volumes.size(); ++v) {
+    const PhysicsVolume& volume = world.volumes[v];
+    if (!volume.awake) {
+      continue;
+    }
+    if (physics_volume_resting(volume)) {
+      resting += 1;
+      continue;
+    }
+    world.awake_list.push_back(static_cast<int>(v));
+    awake_bodies += volume.body_count;
+  }
+  const int awake = static_cast<int>(world.awake_list.size());
+  const int batch = std::max(1, kBodiesPerJob / world.bodies_per_volume);
+  jobs_parallel_for(jobs, awake, batch, step_volume_range, &world);
+
+  int contacts = 0;
+  for (const int v : world.awake_list) {
+    contacts += world.volume_contacts[v];
+  }
+  world.total_steps += 1;
+  world.last_stats.awake_volumes = awake;
+  world.last_stats.resting_volumes = resting;
+  world.last_stats.sleeping_volumes = static_cast<int>(world.volumes.size()) - awake - resting;
+  world.last_stats.awake_bodies = awake_bodies;
+  world.last_stats.contacts = contacts;
+}
+
+int physics_advance(PhysicsWorld& world, float frame_seconds, JobSystem& jobs) {
+  world.accumulator += std::max(frame_seconds, 0.0f);
+  int steps = 0;
+  while (world.accumulator >= kPhysicsStepSeconds && steps < kPhysicsMaxSubsteps) {
+    physics_step(world, jobs);
+    world.accumulator -= kPhysicsStepSeconds;
+    steps += 1;
+  }
+  if (world.accumulator >= kPhysicsStepSeconds) {
+    const double kept = std::fmod(world.accumulator, static_cast<double>(kPhysicsStepSeconds));
+    world.last_stats.dropped_seconds += world.accumulator - kept;
+    world.accumulator = kept;
+  }
+  world.last_stats.steps = steps;
+  return steps;
+}
+
+int physics_write_instances(const PhysicsWorld& world, const PhotoScene& scene, InstanceData* out, int max_instances) {
+  int written = 0;
+  for (size_t v = 0; v < world.volumes.size() && written < max_instances; ++v) {
+    const PhysicsVolume& volume = world.volumes[v];
+    const int dense = volume.awake ? scene_find_photo(scene, volume.owner) : -1;
+    if (dense < 0) {
+      continue;
+    }
+    const float c = std::cos(scene.yaw[dense]);
+    const float s = std::sin(scene.yaw[dense]);
+    const float scale = scene.scale[dense];
+    const float k = world.radius * scale;  // the cube mesh spans [-1, 1]
+    const Vec3 tint = shot_tint(scene.shot_id[dense]);
+    const int n = std::min(volume.body_count, max_instances - written);
+    const int base = static_cast<int>(v) * world.bodies_per_volume;
+    for (int b = 0; b < n; ++b) {
+      const float lx = world.px[base + b] * scale;
+      const float ly = world.py[base + b] * scale;
+      const float lz = world.pz[base + b] * scale;
+      InstanceData& inst = out[written + b];
+      const float m[16] = {
+          c * k, 0.0f, -s * k, 0.0f,
+          0.0f, k, 0.0f, 0.0f,
+          s * k, 0.0f, c * k, 0.0f,
+          scene.px[dense] + c * lx + s * lz, scene.py[dense] + ly, scene.pz[dense] - s * lx + c * lz, 1.0f,
+      };
+      std::copy(m, m + 16, inst.model);
+      inst.tint[0] = 0.5f + 0.5f * tint.x;
+      inst.tint[1] = 0.5f + 0.5f * tint.y;
+      inst.tint[2] = 0.5f + 0.5f * tint.z;
+      inst.tint[3] = 1.0f;
+      inst.params[0] = -1.0f;
+      inst.params[1] = 0.0f;
+      inst.params[2] = 0.0f;
+      inst.params[3] = 0.0f;
+    }
+    written += n;
+  }
+  return written;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "jobs.h"
+#include "math3d.h"
+#include "scene.h"
+
+// Rigid spheres bouncing inside placed photo frames. Every volume belongs to
+// one PhotoHandle and owns a fixed block of bodies_per_volume body slots.
+// Bodies live in the frame's local space, in a box kPhysicsVolumeDepth deep in
+// front of the photo quad, so moving or scaling the frame never touches the
+// simulation. Body state is structure-of-arrays; bodies are anonymous and
+// every step reorders a volume's bodies by grid cell.
+//
+// physics_advance runs whole fixed steps of kPhysicsStepSeconds out of an
+// accumulator fed with real frame time (not the clamped render dt), at most
+// kPhysicsMaxSubsteps per call. Time beyond that is dropped rather than
+// letting a slow frame snowball. A step does the following for each volume:
+// - integrates and resolves the walls with SIMD kernels;
+// - bins the bodies into a uniform grid;
+// - resolves sphere contacts against the neighbouring cells.
+// Volumes are independent, so the step is spread across the job system.
+// Volumes whose frame is outside the frustum sleep: their state is kept and
+// they are not stepped. A volume whose bodies have all stayed slower than
+// kPhysicsRestSpeed for kPhysicsRestSteps steps has come to rest and is not
+// stepped either, though it is still drawn; nothing disturbs bodies in frame
+// space, so it stays at rest.
+constexpr float kPhysicsStepSeconds = 1.0f / 120.0f;
+constexpr int kPhysicsMaxSubsteps = 4;
+constexpr float kPhysicsRestSpeed = 0.25f;  // above the jitter of a body lying on the floor
+constexpr int kPhysicsRestSteps = 60;
+constexpr float kPhysicsVolumeDepth = 0.3f;
+constexpr float kPhysicsGravity = -9.8f;
+
+struct PhysicsVolume {
+  PhotoHandle owner;
+  int body_count;
+  int still_steps;  // consecutive steps with every body below kPhysicsRestSpeed
+  bool awake;       // inside the frustum
+};
+
+struct PhysicsStats {
+  int steps;
+  int awake_volumes;    // stepped in the last step
+  int resting_volumes;  // in view but at rest
+  int sleeping_volumes;
+  int awake_bodies;     // bodies the last step moved
+  int contacts;  // sphere pairs resolved in the last step
+  double dropped_seconds;
+};
+
+struct PhysicsWorld {
+  int max_volumes;
+  int bodies_per_volume;  // volume v owns body slots [v * bodies_per_volume, ...)
+  float radius;
+  float restitution;
+  Vec3 box_min;
+  Vec3 box_max;
+
+  // Per-volume uniform grid over the box. Cells are at least one diameter
+  // wide, so touching spheres are always in neighbouring cells.
+  int grid_x;
+  int grid_y;
+  int grid_z;
+  int grid_cells;
+  Vec3 inv_cell;
+
+  std::vector<PhysicsVolume> volumes;  // dense; removal swaps the last block in
+  std::vector<float> px;
+  std::vector<float> py;
+  std::vector<float> pz;
+  std::vector<float> vx;
+  std::vector<float> vy;
+  std::vector<float> vz;
+
+  // Step scratch, partitioned per volume so volumes can run in parallel.
+  std::vector<int> body_cell;
+  std::vector<int> cell_start;  // grid_cells + 1 entries per volume
+  std::vector<int> cell_bodies;
+  std::vector<float> sort_scratch;
+  std::vector<int> volume_contacts;
+  std::vector<int> awake_list;
+
+  double accumulator;
+  uint64_t total_steps;
+  PhysicsStats last_stats;
+};
+
+void physics_init(PhysicsWorld& world, int max_volumes, int bodies_per_volume, float radius);
+
+// Spawns body_count spheres (clamped to bodies_per_volume) at random spots in
+// a new volume owned by `owner`. Returns the volume index, or -1 when full.
+int physics_add_volume(PhysicsWorld& world, PhotoHandle owner, int body_count, uint32_t seed);
+bool physics_remove_volume(PhysicsWorld& world, PhotoHandle owner);
+void physics_clear(PhysicsWorld& world);
+int physics_find_volume(const PhysicsWorld& world, PhotoHandle owner);
+int physics_body_count(const PhysicsWorld& world);
+bool physics_volume_resting(const PhysicsVolume& volume);
+
+// Drops volumes whose photo no longer exists and wakes exactly those whose
+// volume intersects the frustum.
+void physics_update_sleep(PhysicsWorld& world, const PhotoScene& scene, const Frustum& frustum);
+
+// Returns the number of fixed steps taken.
+int physics_advance(PhysicsWorld& world, float frame_seconds, JobSystem& jobs);
+void physics_step(PhysicsWorld& world, JobSystem& jobs);
+
+// One untextured cube instance per body of every awake volume, in world
+// space. Returns how many were written.
+int physics_write_instances(const PhysicsWorld& world, const PhotoScene& scene, InstanceData* out, int max_instances);
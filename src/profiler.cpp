@@ -0,0 +1,287 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+constexpr uint64_t kRingMask = kProfilerRingSize - 1;
+
+const char* const kStageNames[kProfileStageCount] = {
+    "frame",
+    "recreate_surface",
+    "update_camera",
+    "update_view_projection",
+    "physics",
+    "encode",
+    "submit",
+    "gpu_main_pass",
+};
+
+const char* const kCounterNames[kProfileCounterCount] = {
+    "photos_drawn_early",
+    "photos_drawn_late",
+    "photos_occluded",
+};
+
+const char* const kStartupMarkNames[kStartupMarkCount] = {
+    "main_start",
+    "adapter_ready",
+    "device_ready",
+    "first_clear_frame",
+    "pipelines_ready",
+    "first_frame",
+};
+
+void reset_sample(ProfileSample& sample, uint64_t frame, double start_ms) {
+  sample.frame = frame;
+  sample.start_ms = start_ms;
+  for (int i = 0; i < kProfileStageCount; ++i) {
+    sample.begin_ms[i] = 0.0f;
+    sample.duration_ms[i] = -1.0f;
+  }
+  for (int32_t& value : sample.counters) {
+    value = -1;
+  }
+}
+
+// Seqlock writer side: the counter is odd while the record is inconsistent.
+void write_begin(ProfileFrame& f) {
+  f.seq.store(f.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void write_end(ProfileFrame& f) {
+  f.seq.store(f.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+float percentile(std::vector<float>& values, float p) {
+  const size_t k = std::min(values.size() - 1, static_cast<size_t>(p * static_cast<float>(values.size() - 1) + 0.5f));
+  std::nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(k), values.end());
+  return values[k];
+}
+
+}  // namespace
+
+const char* profile_stage_name(ProfileStage stage) {
+  const int i = static_cast<int>(stage);
+  return i >= 0 && i < kProfileStageCount ? kStageNames[i] : "unknown";
+}
+
+const char* profile_counter_name(ProfileCounter counter) {
+  const int i = static_cast<int>(counter);
+  return i >= 0 && i < kProfileCounterCount ? kCounterNames[i] : "unknown";
+}
+
+bool profile_stage_is_gpu(ProfileStage stage) {
+  return stage == ProfileStage::GpuMainPass;
+}
+
+void startup_timeline_init(StartupTimeline& timeline) {
+  for (double& ms : timeline.mark_ms) {
+    ms = -1.0;
+  }
+}
+
+bool startup_mark(StartupTimeline& timeline, StartupMark mark, double now_ms) {
+  const int i = static_cast<int>(mark);
+  if (i < 0 || i >= kStartupMarkCount || timeline.mark_ms[i] >= 0.0) {
+    return false;
+  }
+  timeline.mark_ms[i] = now_ms;
+  return true;
+}
+
+const char* startup_mark_name(StartupMark mark) {
+  const int i = static_cast<int>(mark);
+  return i >= 0 && i < kStartupMarkCount ? kStartupMarkNames[i] : "unknown";
+}
+
+double profiler_now_ms() {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profiler_init(Profiler& profiler) {
+  for (ProfileFrame& f : profiler.frames) {
+    f.seq.store(0, std::memory_order_relaxed);
+    reset_sample(f.sample, ~0ull, 0.0);
+  }
+  profiler.frames_written.store(0, std::memory_order_relaxed);
+  profiler.enabled = true;
+  profiler.in_frame = false;
+  profiler.current_frame = 0;
+}
+
+void profiler_begin_frame(Profiler& profiler, uint64_t frame, double now_ms) {
+  if (!profiler.enabled) {
+    return;
+  }
+  ProfileFrame& f = profiler.frames[frame & kRingMask];
+  write_begin(f);
+  reset_sample(f.sample, frame, now_ms);
+  profiler.in_frame = true;
+  profiler.current_frame = frame;
+}
+
+void profiler_record(Profiler& profiler, ProfileStage stage, double begin_ms, double end_ms) {
+  if (!profiler.in_frame) {
+    return;
+  }
+  ProfileSample& s = profiler.frames[profiler.current_frame & kRingMask].sample;
+  const int i = static_cast<int>(stage);
+  s.begin_ms[i] = static_cast<float>(begin_ms - s.start_ms);
+  s.duration_ms[i] = static_cast<float>(end_ms - begin_ms);
+}
+
+void profiler_end_frame(Profiler& profiler, double now_ms) {
+  if (!profiler.in_frame) {
+    return;
+  }
+  ProfileFrame& f = profiler.frames[profiler.current_frame & kRingMask];
+  f.sample.begin_ms[static_cast<int>(ProfileStage::Frame)] = 0.0f;
+  f.sample.duration_ms[static_cast<int>(ProfileStage::Frame)] = static_cast<float>(now_ms - f.sample.start_ms);
+  write_end(f);
+  profiler.in_frame = false;
+  profiler.frames_written.store(profiler.current_frame + 1, std::memory_order_release);
+}
+
+void profiler_cancel_frame(Profiler& profiler) {
+  if (!profiler.in_frame) {
+    return;
+  }
+  write_end(profiler.frames[profiler.current_frame & kRingMask]);
+  profiler.in_frame = false;
+}
+
+void profiler_record_gpu(Profiler& profiler, uint64_t frame, ProfileStage stage, float duration_ms) {
+  ProfileFrame& f = profiler.frames[frame & kRingMask];
+  if (f.sample.frame != frame || (profiler.in_frame && profiler.current_frame == frame)) {
+    return;
+  }
+  write_begin(f);
+  const int i = static_cast<int>(stage);
+  // The GPU starts on the frame's work after it is submitted.
+  f.sample.begin_ms[i] = f.sample.begin_ms[static_cast<int>(ProfileStage::Submit)];
+  f.sample.duration_ms[i] = duration_ms;
+  write_end(f);
+}
+
+void profiler_record_counter(Profiler& profiler, uint64_t frame, ProfileCounter counter, int32_t value) {
+  ProfileFrame& f = profiler.frames[frame & kRingMask];
+  if (f.sample.frame != frame || (profiler.in_frame && profiler.current_frame == frame)) {
+    return;
+  }
+  write_begin(f);
+  f.sample.counters[static_cast<int>(counter)] = value;
+  write_end(f);
+}
+
+bool profiler_read_frame(const Profiler& profiler, uint64_t frame, ProfileSample& out) {
+  const ProfileFrame& f = profiler.frames[frame & kRingMask];
+  for (int attempt = 0; attempt < 4; ++attempt) {
+    const uint32_t before = f.seq.load(std::memory_order_acquire);
+    if (before & 1u) {
+      continue;
+    }
+    const ProfileSample copy = f.sample;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (f.seq.load(std::memory_order_relaxed) == before) {
+      if (copy.frame != frame) {
+        return false;
+      }
+      out = copy;
+      return true;
+    }
+  }
+  return false;
+}
+
+void profiler_snapshot(const Profiler& profiler, std::vector<ProfileSample>& out, int max_frames) {
+  out.clear();
+  const uint64_t written = profiler.frames_written.load(std::memory_order_acquire);
+  const uint64_t count = std::min<uint64_t>({written, static_cast<uint64_t>(std::max(max_frames, 0)),
+                                             static_cast<uint64_t>(kProfilerRingSize - 1)});
+  out.reserve(static_cast<size_t>(count));
+  ProfileSample copy;
+  for (uint64_t frame = written - count; frame < written; ++frame) {
+    if (profiler_read_frame(profiler, frame, copy)) {
+      out.push_back(copy);
+    }
+  }
+}
+
+ProfileSummary profiler_summarize(const std::vector<ProfileSample>& samples, ProfileStage stage) {
+  const int i = static_cast<int>(stage);
+  std::vector<float> values;
+  values.reserve(samples.size());
+  for (const ProfileSample& s : samples) {
+    if (s.duration_ms[i] >= 0.0f) {
+      values.push_back(s.duration_ms[i]);
+    }
+  }
+  ProfileSummary summary{};
+  summary.samples = static_cast<int>(values.size());
+  if (values.empty()) {
+    return summary;
+  }
+  summary.max = *std::max_element(values.begin(), values.end());
+  summary.p50 = percentile(values, 0.50f);
+  summary.p95 = percentile(values, 0.95f);
+  summary.p99 = percentile(values, 0.99f);
+  return summary;
+}
+
+float profiler_counter_mean(const std::vector<ProfileSample>& samples, ProfileCounter counter) {
+  const int i = static_cast<int>(counter);
+  double sum = 0.0;
+  int count = 0;
+  for (const ProfileSample& s : samples) {
+    if (s.counters[i] >= 0) {
+      sum += s.counters[i];
+      count += 1;
+    }
+  }
+  return count > 0 ? static_cast<float>(sum / count) : -1.0f;
+}
+
+void profiler_write_chrome_trace(const std::vector<ProfileSample>& samples, std::string& out) {
+  out.clear();
+  out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}},";
+  out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}}";
+  char event[256];
+  for (const ProfileSample& s : samples) {
+    for (int i = 0; i < kProfileStageCount; ++i) {
+      if (s.duration_ms[i] < 0.0f) {
+        continue;
+      }
+      const ProfileStage stage = static_cast<ProfileStage>(i);
+      const double ts_us = (s.start_ms + s.begin_ms[i]) * 1000.0;
+      std::snprintf(event,
+                    sizeof(event),
+                    ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"frame\":%llu}}",
+                    profile_stage_name(stage),
+                    profile_stage_is_gpu(stage) ? "gpu" : "cpu",
+                    profile_stage_is_gpu(stage) ? 2 : 1,
+                    ts_us,
+                    static_cast<double>(s.duration_ms[i]) * 1000.0,
+                    static_cast<unsigned long long>(s.frame));
+      out += event;
+    }
+    for (int i = 0; i < kProfileCounterCount; ++i) {
+      if (s.counters[i] < 0) {
+        continue;
+      }
+      std::snprintf(event,
+                    sizeof(event),
+                    ",{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"count\":%d}}",
+                    profile_counter_name(static_cast<ProfileCounter>(i)),
+                    s.start_ms * 1000.0,
+                    s.counters[i]);
+      out += event;
+    }
+  }
+  out += "]}";
+}
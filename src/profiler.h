@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-frame stage timings kept in a fixed ring. The render loop is the only
+// writer; each record carries a sequence counter (odd while being written)
+// so readers on any thread can copy consistent records without locking.
+// GPU stages are filled in late, when their timestamp readback lands, using
+// the same protocol.
+enum class ProfileStage : uint8_t {
+  Frame,
+  RecreateSurface,
+  UpdateCamera,
+  UpdateViewProjection,
+  Physics,
+  Encode,
+  Submit,
+  GpuMainPass,
+  Count,
+};
+
+constexpr int kProfileStageCount = static_cast<int>(ProfileStage::Count);
+
+// Per-frame counts. Like GPU durations they usually arrive through a
+// readback, so they are attached to the frame that produced them.
+enum class ProfileCounter : uint8_t {
+  PhotosDrawnEarly,  // drawn because they were visible last frame
+  PhotosDrawnLate,   // disoccluded this frame, drawn after the Hi-Z test
+  PhotosOccluded,
+  Count,
+};
+
+constexpr int kProfileCounterCount = static_cast<int>(ProfileCounter::Count);
+constexpr int kProfilerRingSize = 512;  // power of two
+
+struct ProfileSample {
+  uint64_t frame;
+  double start_ms;
+  float begin_ms[kProfileStageCount];  // relative to start_ms
+  float duration_ms[kProfileStageCount];  // negative when not recorded
+  int32_t counters[kProfileCounterCount];  // negative when not recorded
+};
+
+struct ProfileFrame {
+  std::atomic<uint32_t> seq;
+  ProfileSample sample;
+};
+
+struct Profiler {
+  ProfileFrame frames[kProfilerRingSize];
+  std::atomic<uint64_t> frames_written;
+  bool enabled;
+  bool in_frame;
+  uint64_t current_frame;
+};
+
+// One-shot startup milestones, in the order they normally happen. Each mark
+// keeps its first timestamp; later calls are ignored.
+enum class StartupMark : uint8_t {
+  MainStart,
+  AdapterReady,
+  DeviceReady,
+  FirstClearFrame,  // presented while pipelines are still compiling
+  PipelinesReady,
+  FirstFrame,       // first frame that draws the scene
+  Count,
+};
+
+constexpr int kStartupMarkCount = static_cast<int>(StartupMark::Count);
+
+struct StartupTimeline {
+  double mark_ms[kStartupMarkCount];  // negative until recorded
+};
+
+struct ProfileSummary {
+  float p50;
+  float p95;
+  float p99;
+  float max;
+  int samples;
+};
+
+const char* profile_stage_name(ProfileStage stage);
+const char* profile_counter_name(ProfileCounter counter);
+bool profile_stage_is_gpu(ProfileStage stage);
+double profiler_now_ms();
+
+void profiler_init(Profiler& profiler);
+void profiler_begin_frame(Profiler& profiler, uint64_t frame, double now_ms);
+void profiler_record(Profiler& profiler, ProfileStage stage, double begin_ms, double end_ms);
+void profiler_end_frame(Profiler& profiler, double now_ms);
+// Drops the frame begun last without publishing it; the next begin reuses
+// the same frame number.
+void profiler_cancel_frame(Profiler& profiler);
+// Attaches a GPU duration to an earlier frame; dropped if the frame has
+// already been overwritten in the ring.
+void profiler_record_gpu(Profiler& profiler, uint64_t frame, ProfileStage stage, float duration_ms);
+// Same rules as profiler_record_gpu.
+void profiler_record_counter(Profiler& profiler, uint64_t frame, ProfileCounter counter, int32_t value);
+
+// Copies one frame's record if the ring still holds it and it is not being
+// written.
+bool profiler_read_frame(const Profiler& profiler, uint64_t frame, ProfileSample& out);
+// Copies up to the newest `max_frames` complete records, oldest first.
+void profiler_snapshot(const Profiler& profiler, std::vector<ProfileSample>& out, int max_frames);
+ProfileSummary profiler_summarize(const std::vector<ProfileSample>& samples, ProfileStage stage);
+// Mean over the samples that recorded the counter; -1 when none did.
+float profiler_counter_mean(const std::vector<ProfileSample>& samples, ProfileCounter counter);
+void startup_timeline_init(StartupTimeline& timeline);
+// Returns true when this call recorded the mark.
+bool startup_mark(StartupTimeline& timeline, StartupMark mark, double now_ms);
+const char* startup_mark_name(StartupMark mark);
+
+// Chrome trace event format ("X" complete events); CPU stages on one track,
+// GPU stages on another, both anchored at the frame's CPU start.
+void profiler_write_chrome_trace(const std::vector<ProfileSample>& samples, std::string& out);
+
+struct ProfileScope {
+  ProfileScope(Profiler& profiler, ProfileStage stage)
+      : profiler(profiler), stage(stage), begin_ms(profiler_now_ms()) {}
+  ~ProfileScope() { profiler_record(profiler, stage, begin_ms, profiler_now_ms()); }
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+  Profiler& profiler;
+  ProfileStage stage;
+  double begin_ms;
+};
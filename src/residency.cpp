@@ -0,0 +1,224 @@
+#include "residency.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+constexpr int kNoRequest = INT_MAX;
+
+void evict_slot(SnapshotResidency& r, int slot) {
+  const int layer = r.slot_layer[slot];
+  if (layer < 0) {
+    return;
+  }
+  r.layer_slot[layer] = -1;
+  r.slot_layer[slot] = -1;
+  r.slot_last_visible[slot] = 0;
+  r.frame_stats.evictions += 1;
+  r.total_evictions += 1;
+}
+
+int find_slot_for_upload(SnapshotResidency& r, uint64_t frame) {
+  int lru = -1;
+  for (int slot = 0; slot < r.slot_count; ++slot) {
+    if (r.slot_layer[slot] < 0) {
+      return slot;
+    }
+    if (r.slot_last_visible[slot] < frame && (lru < 0 || r.slot_last_visible[slot] < r.slot_last_visible[lru])) {
+      lru = slot;
+    }
+  }
+  if (lru >= 0) {
+    evict_slot(r, lru);
+  }
+  return lru;
+}
+
+int slot_count_for_budget(const SnapshotResidency& r, uint64_t budget_bytes) {
+  if (r.slot_bytes == 0 || budget_bytes <= r.base_bytes) {
+    return 0;
+  }
+  const uint64_t slots = (budget_bytes - r.base_bytes) / r.slot_bytes;
+  return static_cast<int>(std::min<uint64_t>(slots, static_cast<uint64_t>(r.layer_count)));
+}
+
+}  // namespace
+
+uint64_t mip_chain_bytes(uint32_t width, uint32_t height) {
+  uint64_t bytes = 0;
+  for (;;) {
+    bytes += static_cast<uint64_t>(width) * height * 4;
+    if (width == 1 && height == 1) {
+      return bytes;
+    }
+    width = std::max(1u, width / 2);
+    height = std::max(1u, height / 2);
+  }
+}
+
+int mip_count_for(uint32_t width, uint32_t height) {
+  int count = 1;
+  while (width > 1 || height > 1) {
+    width = std::max(1u, width / 2);
+    height = std::max(1u, height / 2);
+    count += 1;
+  }
+  return count;
+}
+
+void residency_init(SnapshotResidency& r,
+                    int layer_count,
+                    int detail_mip_count,
+                    uint64_t base_layer_bytes,
+                    uint64_t slot_bytes,
+                    uint64_t budget_bytes) {
+  r.layer_count = layer_count;
+  r.detail_mip_count = detail_mip_count;
+  r.max_uploads_per_frame = 2;
+  r.base_bytes = base_layer_bytes * static_cast<uint64_t>(layer_count);
+  r.slot_bytes = slot_bytes;
+  r.budget_bytes = budget_bytes;
+  r.slot_count = slot_count_for_budget(r, budget_bytes);
+
+  r.layer_slot.assign(static_cast<size_t>(layer_count), -1);
+  r.layer_wanted_mip.assign(static_cast<size_t>(layer_count), kNoRequest);
+  r.layer_source_ready.assign(static_cast<size_t>(layer_count), 0);
+  r.slot_layer.assign(static_cast<size_t>(r.slot_count), -1);
+  r.slot_last_visible.assign(static_cast<size_t>(r.slot_count), 0);
+  r.uploads.clear();
+  r.uploads.reserve(static_cast<size_t>(layer_count));
+
+  r.frame_stats = ResidencyStats{};
+  r.last_stats = ResidencyStats{};
+  r.last_stats.bytes_resident = r.base_bytes;
+  r.total_uploads = 0;
+  r.total_evictions = 0;
+}
+
+void residency_set_budget(SnapshotResidency& r, uint64_t budget_bytes) {
+  for (int slot = 0; slot < r.slot_count; ++slot) {
+    evict_slot(r, slot);
+  }
+  r.budget_bytes = budget_bytes;
+  r.slot_count = slot_count_for_budget(r, budget_bytes);
+  r.slot_layer.assign(static_cast<size_t>(r.slot_count), -1);
+  r.slot_last_visible.assign(static_cast<size_t>(r.slot_count), 0);
+}
+
+void residency_set_source_ready(SnapshotResidency& r, int layer, bool ready) {
+  if (layer < 0 || layer >= r.layer_count) {
+    return;
+  }
+  r.layer_source_ready[layer] = ready ? 1 : 0;
+}
+
+void residency_invalidate_layer(SnapshotResidency& r, int layer) {
+  if (layer < 0 || layer >= r.layer_count) {
+    return;
+  }
+  r.layer_source_ready[layer] = 0;
+  if (r.layer_slot[layer] >= 0) {
+    evict_slot(r, r.layer_slot[layer]);
+  }
+}
+
+float photo_projected_height_px(const Vec3& camera_pos,
+                                const Vec3& photo_pos,
+                                float scale,
+                                float proj_y_scale,
+                                float viewport_height_px) {
+  const Vec3 d = vec3_sub(photo_pos, camera_pos);
+  const float dist = std::sqrt(vec3_dot(d, d));
+  if (dist <= 1e-4f) {
+    return viewport_height_px;
+  }
+  return (2.0f * kPhotoHalfHeight * scale) * proj_y_scale * 0.5f * viewport_height_px / dist;
+}
+
+int snapshot_required_mip(float projected_height_px, float full_height_px, int max_mip) {
+  if (projected_height_px >= full_height_px) {
+    return 0;
+  }
+  if (projected_height_px <= 0.0f) {
+    return max_mip;
+  }
+  const int mip = static_cast<int>(std::floor(std::log2(full_height_px / projected_height_px)));
+  return std::min(mip, max_mip);
+}
+
+void residency_request_visible(SnapshotResidency& r,
+                               const InstanceData* instances,
+                               int count,
+                               const Vec3& camera_pos,
+                               float proj_y_scale,
+                               float viewport_height_px,
+                               float full_height_px) {
+  for (int i = 0; i < count; ++i) {
+    const InstanceData& inst = instances[i];
+    const int layer = static_cast<int>(inst.params[0]);
+    if (layer < 0 || layer >= r.layer_count) {
+      continue;
+    }
+    // model = T * Ry * S(s, s, 1): translation in column 3, Y scale in m[5].
+    const Vec3 pos{inst.model[12], inst.model[13], inst.model[14]};
+    const float px = photo_projected_height_px(camera_pos, pos, inst.model[5], proj_y_scale, viewport_height_px);
+    const int mip = snapshot_required_mip(px, full_height_px, r.detail_mip_count);
+    if (mip < r.layer_wanted_mip[layer]) {
+      r.layer_wanted_mip[layer] = mip;
+    }
+  }
+}
+
+void residency_update(SnapshotResidency& r, uint64_t frame) {
+  r.uploads.clear();
+
+  for (int layer = 0; layer < r.layer_count; ++layer) {
+    const int slot = r.layer_slot[layer];
+    if (slot >= 0 && r.layer_wanted_mip[layer] != kNoRequest) {
+      r.slot_last_visible[slot] = frame;
+    }
+  }
+
+  // Finest requests first, so the frames closest to the camera sharpen first
+  // when more layers want detail than the per-frame upload cap allows.
+  for (int pass_mip = 0; pass_mip < r.detail_mip_count; ++pass_mip) {
+    for (int layer = 0; layer < r.layer_count; ++layer) {
+      if (static_cast<int>(r.uploads.size()) >= r.max_uploads_per_frame) {
+        break;
+      }
+      if (r.layer_wanted_mip[layer] != pass_mip || r.layer_slot[layer] >= 0 || !r.layer_source_ready[layer]) {
+        continue;
+      }
+      const int slot = find_slot_for_upload(r, frame);
+      if (slot < 0) {
+        break;
+      }
+      r.slot_layer[slot] = layer;
+      r.slot_last_visible[slot] = frame;
+      r.layer_slot[layer] = slot;
+      r.uploads.push_back(ResidencyUpload{layer, slot});
+      r.frame_stats.uploads += 1;
+      r.total_uploads += 1;
+    }
+  }
+
+  int used_slots = 0;
+  for (int slot = 0; slot < r.slot_count; ++slot) {
+    used_slots += r.slot_layer[slot] >= 0 ? 1 : 0;
+  }
+  r.frame_stats.bytes_resident = r.base_bytes + static_cast<uint64_t>(used_slots) * r.slot_bytes;
+
+  r.last_stats = r.frame_stats;
+  r.frame_stats = ResidencyStats{};
+  std::fill(r.layer_wanted_mip.begin(), r.layer_wanted_mip.end(), kNoRequest);
+}
+
+void residency_apply(const SnapshotResidency& r, InstanceData* instances, int count) {
+  for (int i = 0; i < count; ++i) {
+    const int layer = static_cast<int>(instances[i].params[0]);
+    instances[i].params[1] =
+        (layer >= 0 && layer < r.layer_count) ? static_cast<float>(r.layer_slot[layer]) : -1.0f;
+  }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "math3d.h"
+#include "scene.h"
+
+struct ResidencyStats {
+  uint64_t bytes_resident;
+  uint32_t uploads;
+  uint32_t evictions;
+};
+
+struct ResidencyUpload {
+  int layer;
+  int slot;
+};
+
+// Two-tier residency for snapshot textures. Every snapshot layer keeps a
+// small base-tier mip chain resident. Layers drawn large enough on screen to
+// need mips finer than the base tier borrow a full-resolution slot from a
+// detail pool sized by the byte budget; when the pool is full the least
+// recently visible slot is evicted.
+//
+// Mip levels are counted from the full-resolution image, so the base tier
+// starts at mip `detail_mip_count`.
+struct SnapshotResidency {
+  int layer_count;
+  int detail_mip_count;
+  int max_uploads_per_frame;
+  uint64_t base_bytes;
+  uint64_t slot_bytes;
+  uint64_t budget_bytes;
+  int slot_count;
+
+  std::vector<int> layer_slot;        // -1 when only the base tier is resident
+  std::vector<int> layer_wanted_mip;  // finest mip requested this frame
+  std::vector<uint8_t> layer_source_ready;
+  std::vector<int> slot_layer;        // -1 when free
+  std::vector<uint64_t> slot_last_visible;
+
+  std::vector<ResidencyUpload> uploads;  // filled by residency_update
+  ResidencyStats frame_stats;
+  ResidencyStats last_stats;
+  uint64_t total_uploads;
+  uint64_t total_evictions;
+};
+
+// Bytes of an RGBA8 image with its full mip chain.
+uint64_t mip_chain_bytes(uint32_t width, uint32_t height);
+int mip_count_for(uint32_t width, uint32_t height);
+
+void residency_init(SnapshotResidency& r,
+                    int layer_count,
+                    int detail_mip_count,
+                    uint64_t base_layer_bytes,
+                    uint64_t slot_bytes,
+                    uint64_t budget_bytes);
+// Evicts every detail slot and resizes the pool for the new budget.
+void residency_set_budget(SnapshotResidency& r, uint64_t budget_bytes);
+
+void residency_set_source_ready(SnapshotResidency& r, int layer, bool ready);
+// A new capture overwrote `layer`; any detail copy of the old shot is dropped.
+void residency_invalidate_layer(SnapshotResidency& r, int layer);
+
+// Screen-space height of a placed frame and the mip that covers it.
+float photo_projected_height_px(const Vec3& camera_pos,
+                                const Vec3& photo_pos,
+                                float scale,
+                                float proj_y_scale,
+                                float viewport_height_px);
+int snapshot_required_mip(float projected_height_px, float full_height_px, int max_mip);
+
+// Records the mip each visible instance needs. Instances carry their base
+// layer in params[0] (see scene_prepare_instances).
+void residency_request_visible(SnapshotResidency& r,
+                               const InstanceData* instances,
+                               int count,
+                               const Vec3& camera_pos,
+                               float proj_y_scale,
+                               float viewport_height_px,
+                               float full_height_px);
+void residency_update(SnapshotResidency& r, uint64_t frame);
+// Writes each instance's detail slot (or -1) into params[1].
+void residency_apply(const SnapshotResidency& r, InstanceData* instances, int count);
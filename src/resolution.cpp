@@ -0,0 +1,66 @@
+#include "resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+void resolution_init(ResolutionScaler& scaler, float budget_ms) {
+  scaler.budget_ms = budget_ms;
+  scaler.scale = 1.0f;
+  scaler.smoothed_ms = -1.0f;
+  scaler.over_frames = 0;
+  scaler.under_frames = 0;
+  scaler.cooldown = 0;
+  scaler.changes = 0;
+}
+
+bool resolution_update(ResolutionScaler& scaler, float frame_ms) {
+  if (scaler.smoothed_ms < 0.0f) {
+    scaler.smoothed_ms = frame_ms;
+  } else {
+    scaler.smoothed_ms += kResolutionSmoothing * (frame_ms - scaler.smoothed_ms);
+  }
+  if (scaler.cooldown > 0) {
+    scaler.cooldown -= 1;
+    return false;
+  }
+
+  const float up = std::min(1.0f, scaler.scale + kResolutionStep);
+  const float down = std::max(kResolutionMinScale, scaler.scale - kResolutionStep);
+  if (scaler.smoothed_ms > scaler.budget_ms) {
+    scaler.over_frames += 1;
+    scaler.under_frames = 0;
+  } else {
+    scaler.over_frames = 0;
+    const float growth = (up * up) / (scaler.scale * scaler.scale);
+    const bool fits = up > scaler.scale && scaler.smoothed_ms * growth < scaler.budget_ms * kResolutionHeadroom;
+    scaler.under_frames = fits ? scaler.under_frames + 1 : 0;
+  }
+
+  float next = scaler.scale;
+  if (scaler.over_frames >= kResolutionDownFrames) {
+    next = down;
+  } else if (scaler.under_frames >= kResolutionUpFrames) {
+    next = up;
+  }
+  if (next == scaler.scale) {
+    return false;
+  }
+  // Carry the estimate over to the new size so the next decision does not
+  // start from a cost measured at the old one.
+  scaler.smoothed_ms *= (next * next) / (scaler.scale * scaler.scale);
+  scaler.scale = next;
+  scaler.over_frames = 0;
+  scaler.under_frames = 0;
+  scaler.cooldown = kResolutionCooldownFrames;
+  scaler.changes += 1;
+  return true;
+}
+
+void resolution_target_size(const ResolutionScaler& scaler,
+                            int canvas_width,
+                            int canvas_height,
+                            int* width,
+                            int* height) {
+  *width = std::max(1, static_cast<int>(std::lround(static_cast<float>(canvas_width) * scaler.scale)));
+  *height = std::max(1, static_cast<int>(std::lround(static_cast<float>(canvas_height) * scaler.scale)));
+}
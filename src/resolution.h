@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Dynamic resolution: the fraction of the canvas size the scene is rendered
+// at, picked from measured frame cost against a budget. The scale moves in
+// fixed steps so render targets only ever take a handful of sizes, and a
+// step needs the cost to stay past a threshold for a run of frames:
+// - down after kResolutionDownFrames frames over budget;
+// - up after kResolutionUpFrames frames in which the cost, grown by the
+//   pixel ratio of the next step, would still fit kResolutionHeadroom of it.
+// Every step starts a cooldown, because GPU timings land a few frames late
+// and would still describe the old size.
+constexpr float kResolutionMinScale = 0.5f;
+constexpr float kResolutionStep = 0.125f;
+constexpr int kResolutionDownFrames = 15;
+constexpr int kResolutionUpFrames = 90;
+constexpr int kResolutionCooldownFrames = 30;
+constexpr float kResolutionHeadroom = 0.85f;
+constexpr float kResolutionSmoothing = 0.1f;  // weight of the newest frame
+
+struct ResolutionScaler {
+  float budget_ms;
+  float scale;
+  float smoothed_ms;  // negative until the first sample
+  int over_frames;
+  int under_frames;
+  int cooldown;
+  uint32_t changes;
+};
+
+// Starts at full resolution.
+void resolution_init(ResolutionScaler& scaler, float budget_ms);
+// Feeds the cost of one drawn frame. Returns true when the scale changed.
+bool resolution_update(ResolutionScaler& scaler, float frame_ms);
+// Render target size for the canvas at the current scale, at least 1x1.
+void resolution_target_size(const ResolutionScaler& scaler,
+                            int canvas_width,
+                            int canvas_height,
+                            int* width,
+                            int* height);
@@ -0,0 +1,430 @@
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t kNoFreeSlot = 0xffffffffu;
+
+PhotoHandle make_handle(uint32_t slot, uint16_t generation) {
+  return (static_cast<uint32_t>(generation) << kPhotoHandleIndexBits) | slot;
+}
+
+void bump_generation(PhotoScene& scene, uint32_t slot) {
+  uint32_t generation = scene.slot_generation[slot] + 1u;
+  if (generation >= (1u << (32 - kPhotoHandleIndexBits))) {
+    generation = 1;
+  }
+  scene.slot_generation[slot] = static_cast<uint16_t>(generation);
+}
+
+void reset_slots(PhotoScene& scene) {
+  const int capacity = scene_capacity(scene);
+  for (int i = 0; i < capacity; ++i) {
+    scene.slot_dense[i] = i + 1 < capacity ? static_cast<uint32_t>(i + 1) : kNoFreeSlot;
+    scene.slot_live[i] = 0;
+  }
+  scene.free_head = capacity > 0 ? 0 : kNoFreeSlot;
+  scene.count = 0;
+  scene.version += 1;
+}
+
+struct ParallelPrepare {
+  PhotoScene* scene;
+  const Frustum* frustum;
+  const SnapshotLayerTable* layers;
+  InstanceData* out;
+  int max_instances;
+};
+
+void fill_instance_tail(InstanceData& inst, uint32_t shot_id, const SnapshotLayerTable* layers) {
+  const Vec3 tint = shot_tint(shot_id);
+  inst.tint[0] = tint.x;
+  inst.tint[1] = tint.y;
+  inst.tint[2] = tint.z;
+  inst.tint[3] = 1.0f;
+  inst.params[0] = layers ? static_cast<float>(snapshot_layer_find(*layers, shot_id)) : -1.0f;
+  inst.params[1] = 0.0f;
+  inst.params[2] = 0.0f;
+  inst.params[3] = 0.0f;
+}
+
+// Batch b writes the dense indices of its visible photos to
+// visible_slots[begin, begin + n) and n to batch_visible[b].
+void cull_batch(void* ctx, int begin, int end) {
+  ParallelPrepare& pp = *static_cast<ParallelPrepare*>(ctx);
+  PhotoScene& scene = *pp.scene;
+  uint32_t* visible = scene.visible_slots.data() + begin;
+  int n = 0;
+  for (int i = begin; i < end; ++i) {
+    const Aabb& box = scene.bvh.nodes[scene.bvh_leaf[i]].box;
+    if (frustum_test_aabb(*pp.frustum, box) != FrustumTest::Outside) {
+      visible[n++] = static_cast<uint32_t>(i);
+    }
+  }
+  scene.batch_visible[begin / kScenePrepareBatch] = n;
+}
+
+void fill_batch(void* ctx, int begin, int) {
+  ParallelPrepare& pp = *static_cast<ParallelPrepare*>(ctx);
+  PhotoScene& scene = *pp.scene;
+  const int batch = begin / kScenePrepareBatch;
+  const int offset = scene.batch_offset[batch];
+  const int n = std::min(scene.batch_visible[batch], pp.max_instances - offset);
+  if (n <= 0) {
+    return;
+  }
+  const uint32_t* visible = scene.visible_slots.data() + begin;
+  for (int k = 0; k < n; ++k) {
+    const uint32_t dense = visible[k];
+    const int v = offset + k;
+    scene.gather_px[v] = scene.px[dense];
+    scene.gather_py[v] = scene.py[dense];
+    scene.gather_pz[v] = scene.pz[dense];
+    scene.gather_yaw[v] = scene.yaw[dense];
+    scene.gather_scale[v] = scene.scale[dense];
+    fill_instance_tail(pp.out[v], scene.shot_id[dense], pp.layers);
+  }
+  const TrsSoA trs{scene.gather_px.data() + offset,
+                   scene.gather_py.data() + offset,
+                   scene.gather_pz.data() + offset,
+                   scene.gather_yaw.data() + offset,
+                   scene.gather_scale.data() + offset};
+  mat4_compose_trs_y_batch(trs, pp.out[offset].model, sizeof(InstanceData) / sizeof(float), static_cast<size_t>(n));
+}
+
+struct PickRay {
+  const PhotoScene* scene;
+  Vec3 origin;
+  Vec3 dir;
+};
+
+// Ray against one frame quad, in the frame's local space (see photo_bounds
+// for the axes).
+float pick_ray_hit(void* ctx, uint32_t slot, float max_t) {
+  const PickRay& ray = *static_cast<const PickRay*>(ctx);
+  const PhotoScene& scene = *ray.scene;
+  const uint32_t dense = scene.slot_dense[slot];
+  const float c = std::cos(scene.yaw[dense]);
+  const float s = std::sin(scene.yaw[dense]);
+  const float ox = ray.origin.x - scene.px[dense];
+  const float oz = ray.origin.z - scene.pz[dense];
+  const float local_oz = s * ox + c * oz;
+  const float local_dz = s * ray.dir.x + c * ray.dir.z;
+  if (std::fabs(local_dz) < 1.0e-8f) {
+    return -1.0f;
+  }
+  const float t = -local_oz / local_dz;
+  if (t < 0.0f || t > max_t) {
+    return -1.0f;
+  }
+  const float x = c * (ox + t * ray.dir.x) - s * (oz + t * ray.dir.z);
+  const float y = ray.origin.y - scene.py[dense] + t * ray.dir.y;
+  const float scale = scene.scale[dense];
+  if (std::fabs(x) > kPhotoHalfWidth * scale || std::fabs(y) > kPhotoHalfHeight * scale) {
+    return -1.0f;
+  }
+  return t;
+}
+
+}  // namespace
+
+void scene_init(PhotoScene& scene, int capacity) {
+  capacity = std::clamp(capacity, 0, kMaxPhotoSceneCapacity);
+  const size_t n = static_cast<size_t>(capacity);
+  scene.version = 0;
+  scene.px.assign(n, 0.0f);
+  scene.py.assign(n, 0.0f);
+  scene.pz.assign(n, 0.0f);
+  scene.yaw.assign(n, 0.0f);
+  scene.scale.assign(n, 0.0f);
+  scene.shot_id.assign(n, 0);
+  scene.bvh_leaf.assign(n, kBvhNull);
+  scene.dense_slot.assign(n, 0);
+
+  scene.slot_dense.assign(n, 0);
+  // Generations start at 1 so that no live handle can equal kInvalidPhotoHandle.
+  scene.slot_generation.assign(n, 1);
+  scene.slot_live.assign(n, 0);
+  reset_slots(scene);
+
+  bvh_init(scene.bvh, capacity);
+  scene.visible_slots.assign(n, 0);
+  scene.last_cull = CullStats{};
+
+  scene.gather_px.assign(n, 0.0f);
+  scene.gather_py.assign(n, 0.0f);
+  scene.gather_pz.assign(n, 0.0f);
+  scene.gather_yaw.assign(n, 0.0f);
+  scene.gather_scale.assign(n, 0.0f);
+  scene.batch_visible.assign((n + kScenePrepareBatch - 1) / kScenePrepareBatch, 0);
+  scene.batch_offset.assign(scene.batch_visible.size(), 0);
+}
+
+int scene_capacity(const PhotoScene& scene) {
+  return static_cast<int>(scene.slot_dense.size());
+}
+
+PhotoHandle scene_place_photo(PhotoScene& scene, uint32_t shot_id, Vec3 position, float yaw, float scale) {
+  if (scene.free_head == kNoFreeSlot) {
+    return kInvalidPhotoHandle;
+  }
+
+  const uint32_t slot = scene.free_head;
+  scene.free_head = scene.slot_dense[slot];
+
+  const int dense = scene.count;
+  scene.count += 1;
+  scene.slot_dense[slot] = static_cast<uint32_t>(dense);
+  scene.slot_live[slot] = 1;
+
+  scene.px[dense] = position.x;
+  scene.py[dense] = position.y;
+  scene.pz[dense] = position.z;
+  scene.yaw[dense] = yaw;
+  scene.scale[dense] = scale;
+  scene.shot_id[dense] = shot_id;
+  scene.dense_slot[dense] = slot;
+  scene.bvh_leaf[dense] = bvh_insert(scene.bvh, photo_bounds(position, yaw, scale), slot);
+  scene.version += 1;
+
+  return make_handle(slot, scene.slot_generation[slot]);
+}
+
+bool scene_remove_photo(PhotoScene& scene, PhotoHandle handle) {
+  const int dense = scene_find_photo(scene, handle);
+  if (dense < 0) {
+    return false;
+  }
+
+  const uint32_t slot = handle & kPhotoHandleIndexMask;
+  bvh_remove(scene.bvh, scene.bvh_leaf[dense]);
+
+  const int last = scene.count - 1;
+  if (dense != last) {
+    scene.px[dense] = scene.px[last];
+    scene.py[dense] = scene.py[last];
+    scene.pz[dense] = scene.pz[last];
+    scene.yaw[dense] = scene.yaw[last];
+    scene.scale[dense] = scene.scale[last];
+    scene.shot_id[dense] = scene.shot_id[last];
+    scene.bvh_leaf[dense] = scene.bvh_leaf[last];
+    scene.dense_slot[dense] = scene.dense_slot[last];
+    scene.slot_dense[scene.dense_slot[dense]] = static_cast<uint32_t>(dense);
+  }
+  scene.count = last;
+  scene.version += 1;
+
+  scene.slot_live[slot] = 0;
+  bump_generation(scene, slot);
+  scene.slot_dense[slot] = scene.free_head;
+  scene.free_head = slot;
+  return true;
+}
+
+void scene_clear(PhotoScene& scene) {
+  for (int i = 0; i < scene.count; ++i) {
+    bump_generation(scene, scene.dense_slot[i]);
+  }
+  reset_slots(scene);
+  bvh_clear(scene.bvh);
+}
+
+bool scene_assign_photos(PhotoScene& scene,
+                         int count,
+                         const float* px,
+                         const float* py,
+                         const float* pz,
+                         const float* yaw,
+                         const float* scale,
+                         const uint32_t* shot_id) {
+  if (count < 0 || count > scene_capacity(scene)) {
+    return false;
+  }
+  scene_clear(scene);
+
+  const size_t n = static_cast<size_t>(count);
+  std::copy(px, px + n, scene.px.begin());
+  std::copy(py, py + n, scene.py.begin());
+  std::copy(pz, pz + n, scene.pz.begin());
+  std::copy(yaw, yaw + n, scene.yaw.begin());
+  std::copy(scale, scale + n, scene.scale.begin());
+  std::copy(shot_id, shot_id + n, scene.shot_id.begin());
+
+  // Slots [0, count) become live in order; the free list continues after them.
+  std::vector<Aabb> boxes(n);
+  for (int i = 0; i < count; ++i) {
+    scene.dense_slot[i] = static_cast<uint32_t>(i);
+    scene.slot_dense[i] = static_cast<uint32_t>(i);
+    scene.slot_live[i] = 1;
+    boxes[i] = photo_bounds(Vec3{px[i], py[i], pz[i]}, yaw[i], scale[i]);
+  }
+  scene.free_head = count < scene_capacity(scene) ? static_cast<uint32_t>(count) : kNoFreeSlot;
+  scene.count = count;
+  scene.version += 1;
+
+  bvh_build(scene.bvh, boxes.data(), scene.dense_slot.data(), count, scene.bvh_leaf.data());
+  return true;
+}
+
+int scene_find_photo(const PhotoScene& scene, PhotoHandle handle) {
+  const uint32_t slot = handle & kPhotoHandleIndexMask;
+  const uint32_t generation = handle >> kPhotoHandleIndexBits;
+  if (slot >= static_cast<uint32_t>(scene_capacity(scene)) || !scene.slot_live[slot] ||
+      scene.slot_generation[slot] != generation) {
+    return -1;
+  }
+  return static_cast<int>(scene.slot_dense[slot]);
+}
+
+bool scene_get_photo(const PhotoScene& scene, PhotoHandle handle, PlacedPhoto* out) {
+  const int dense = scene_find_photo(scene, handle);
+  if (dense < 0) {
+    return false;
+  }
+  out->shot_id = scene.shot_id[dense];
+  out->position = Vec3{scene.px[dense], scene.py[dense], scene.pz[dense]};
+  out->yaw = scene.yaw[dense];
+  out->scale = scene.scale[dense];
+  return true;
+}
+
+PhotoHandle scene_handle_at(const PhotoScene& scene, int dense_index) {
+  if (dense_index < 0 || dense_index >= scene.count) {
+    return kInvalidPhotoHandle;
+  }
+  const uint32_t slot = scene.dense_slot[dense_index];
+  return make_handle(slot, scene.slot_generation[slot]);
+}
+
+bool scene_move_photo(PhotoScene& scene, PhotoHandle handle, Vec3 position, float yaw, float scale) {
+  const int dense = scene_find_photo(scene, handle);
+  if (dense < 0) {
+    return false;
+  }
+  scene.px[dense] = position.x;
+  scene.py[dense] = position.y;
+  scene.pz[dense] = position.z;
+  scene.yaw[dense] = yaw;
+  scene.scale[dense] = scale;
+  bvh_move(scene.bvh, scene.bvh_leaf[dense], photo_bounds(position, yaw, scale));
+  scene.version += 1;
+  return true;
+}
+
+bool scene_pick_photo(const PhotoScene& scene, Vec3 origin, Vec3 dir, float max_distance, PhotoPick* out) {
+  PickRay ray{&scene, origin, vec3_normalize(dir)};
+  BvhRayHit hit{};
+  if (!bvh_raycast(scene.bvh, origin, ray.dir, max_distance, pick_ray_hit, &ray, &hit, nullptr)) {
+    return false;
+  }
+  if (out) {
+    out->handle = make_handle(hit.user, scene.slot_generation[hit.user]);
+    out->distance = hit.t;
+  }
+  return true;
+}
+
+Aabb photo_bounds(Vec3 position, float yaw, float scale) {
+  // The frame is a flat quad in local XY, rotated about Y.
+  const float hx = std::fabs(std::cos(yaw)) * kPhotoHalfWidth * scale;
+  const float hy = kPhotoHalfHeight * scale;
+  const float hz = std::fabs(std::sin(yaw)) * kPhotoHalfWidth * scale;
+  return {
+      {position.x - hx, position.y - hy, position.z - hz},
+      {position.x + hx, position.y + hy, position.z + hz},
+  };
+}
+
+int scene_prepare_instances(PhotoScene& scene,
+                            const Frustum& frustum,
+                            const SnapshotLayerTable* layers,
+                            InstanceData* out,
+                            int max_instances) {
+  BvhQueryStats query{};
+  const int max_visible = std::min(max_instances, static_cast<int>(scene.visible_slots.size()));
+  const int visible = bvh_query_frustum(scene.bvh, frustum, scene.visible_slots.data(), max_visible, &query);
+  scene.last_cull.visible = visible;
+  scene.last_cull.culled = scene.count - visible;
+  scene.last_cull.nodes_visited = query.nodes_visited;
+
+  for (int v = 0; v < visible; ++v) {
+    const uint32_t dense = scene.slot_dense[scene.visible_slots[v]];
+    scene.gather_px[v] = scene.px[dense];
+    scene.gather_py[v] = scene.py[dense];
+    scene.gather_pz[v] = scene.pz[dense];
+    scene.gather_yaw[v] = scene.yaw[dense];
+    scene.gather_scale[v] = scene.scale[dense];
+
+    fill_instance_tail(out[v], scene.shot_id[dense], layers);
+  }
+
+  const TrsSoA trs{scene.gather_px.data(),
+                   scene.gather_py.data(),
+                   scene.gather_pz.data(),
+                   scene.gather_yaw.data(),
+                   scene.gather_scale.data()};
+  mat4_compose_trs_y_batch(trs, out[0].model, sizeof(InstanceData) / sizeof(float), static_cast<size_t>(visible));
+  return visible;
+}
+
+int scene_prepare_instances_parallel(PhotoScene& scene,
+                                     const Frustum& frustum,
+                                     const SnapshotLayerTable* layers,
+                                     InstanceData* out,
+                                     int max_instances,
+                                     JobSystem& jobs) {
+  const int batches = (scene.count + kScenePrepareBatch - 1) / kScenePrepareBatch;
+  ParallelPrepare pp{&scene, &frustum, layers, out, std::min(max_instances, scene.count)};
+  jobs_parallel_for(jobs, scene.count, kScenePrepareBatch, cull_batch, &pp);
+
+  int visible = 0;
+  for (int b = 0; b < batches; ++b) {
+    scene.batch_offset[b] = visible;
+    visible += scene.batch_visible[b];
+  }
+  jobs_parallel_for(jobs, scene.count, kScenePrepareBatch, fill_batch, &pp);
+
+  visible = std::min(visible, pp.max_instances);
+  scene.last_cull.visible = visible;
+  scene.last_cull.culled = scene.count - visible;
+  scene.last_cull.nodes_visited = scene.count;
+  return visible;
+}
+
+Vec3 shot_tint(uint32_t shot_id) {
+  const float t = static_cast<float>(shot_id) * 0.37f;
+  return {
+      0.55f + 0.45f * std::sin(t + 0.0f),
+      0.55f + 0.45f * std::sin(t + 2.1f),
+      0.55f + 0.45f * std::sin(t + 4.2f),
+  };
+}
+
+float photo_yaw_facing_camera(float camera_yaw) {
+  // The camera looks along (cos yaw, 0, sin yaw) and mat4_rotation_y maps the
+  // frame normal (+Z) to (sin a, 0, cos a); solve for a normal of -forward.
+  return -camera_yaw - 1.5707963f;
+}
+
+void snapshot_layers_init(SnapshotLayerTable& table, int layer_count) {
+  table.layer_shot.assign(static_cast<size_t>(layer_count), 0);
+}
+
+int snapshot_layer_assign(SnapshotLayerTable& table, uint32_t shot_id) {
+  if (table.layer_shot.empty() || shot_id == 0) {
+    return -1;
+  }
+  const int layer = static_cast<int>((shot_id - 1) % table.layer_shot.size());
+  table.layer_shot[layer] = shot_id;
+  return layer;
+}
+
+int snapshot_layer_find(const SnapshotLayerTable& table, uint32_t shot_id) {
+  if (table.layer_shot.empty() || shot_id == 0) {
+    return -1;
+  }
+  const int layer = static_cast<int>((shot_id - 1) % table.layer_shot.size());
+  return table.layer_shot[layer] == shot_id ? layer : -1;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bvh.h"
+#include "jobs.h"
+#include "math3d.h"
+
+struct PhotoSnapshot {
+  uint32_t id;
+  Vec3 position;
+  float yaw;
+  float pitch;
+  double timestamp_ms;
+};
+
+struct PlacedPhoto {
+  uint32_t shot_id;
+  Vec3 position;
+  float yaw;
+  float scale;
+};
+
+// Stable reference to a placed photo: slot index in the low bits, slot
+// generation in the high bits. Removing a photo bumps its slot generation,
+// so stale handles are rejected. 0 is never a valid handle.
+using PhotoHandle = uint32_t;
+
+constexpr PhotoHandle kInvalidPhotoHandle = 0;
+constexpr int kPhotoHandleIndexBits = 20;
+constexpr uint32_t kPhotoHandleIndexMask = (1u << kPhotoHandleIndexBits) - 1u;
+constexpr int kMaxPhotoSceneCapacity = 1 << kPhotoHandleIndexBits;
+
+// Photos per job in scene_prepare_instances_parallel. A multiple of 16, so
+// every batch covers whole cache lines of each float column and of the
+// 96-byte InstanceData output.
+constexpr int kScenePrepareBatch = 1024;
+
+// Half extents of the unit photo frame quad in its local XY plane.
+constexpr float kPhotoHalfWidth = 0.75f;
+constexpr float kPhotoHalfHeight = 0.50f;
+
+// Per-instance vertex data consumed by the instanced pipeline.
+struct InstanceData {
+  float model[16];
+  float tint[4];
+  float params[4];  // x: snapshot texture layer, or -1 for untextured
+};
+
+// Which shot currently occupies each layer of the GPU snapshot texture array.
+// Shots are assigned round-robin by id, matching the inventory which drops
+// the oldest shot once it is full.
+struct SnapshotLayerTable {
+  std::vector<uint32_t> layer_shot;
+};
+
+struct CullStats {
+  int visible;
+  int culled;
+  int nodes_visited;
+};
+
+// Placed photos as a generational handle pool. Live photos are packed into
+// dense structure-of-arrays storage [0, count); removal swaps the last photo
+// into the hole. Slots map handles to dense indices and free slots form an
+// intrusive list, so place/remove are O(1) (plus the BVH update) and
+// iteration is O(count). All storage is sized by scene_init; placing,
+// removing and preparing never allocate.
+struct PhotoScene {
+  int count;
+  // Bumped by every change to the placed photos, so copies of the columns
+  // (the GPU cull input) know when to refresh.
+  uint32_t version;
+  std::vector<float> px;
+  std::vector<float> py;
+  std::vector<float> pz;
+  std::vector<float> yaw;
+  std::vector<float> scale;
+  std::vector<uint32_t> shot_id;
+  std::vector<int> bvh_leaf;
+  std::vector<uint32_t> dense_slot;
+
+  // Per slot: the dense index while live, the next free slot while free.
+  std::vector<uint32_t> slot_dense;
+  std::vector<uint16_t> slot_generation;
+  std::vector<uint8_t> slot_live;
+  uint32_t free_head;
+
+  Bvh bvh;
+  std::vector<uint32_t> visible_slots;
+  CullStats last_cull;
+
+  // Gather buffers for the visible subset fed to the batch transform kernel.
+  std::vector<float> gather_px;
+  std::vector<float> gather_py;
+  std::vector<float> gather_pz;
+  std::vector<float> gather_yaw;
+  std::vector<float> gather_scale;
+
+  // Visible photos found by each batch of the parallel path, and where each
+  // batch's instances start in the output.
+  std::vector<int> batch_visible;
+  std::vector<int> batch_offset;
+};
+
+void scene_init(PhotoScene& scene, int capacity);
+int scene_capacity(const PhotoScene& scene);
+
+// Returns kInvalidPhotoHandle when every slot is taken.
+PhotoHandle scene_place_photo(PhotoScene& scene, uint32_t shot_id, Vec3 position, float yaw, float scale);
+bool scene_remove_photo(PhotoScene& scene, PhotoHandle handle);
+void scene_clear(PhotoScene& scene);
+
+// Bulk replacement of every placed photo from column arrays, e.g. a loaded
+// scene file. Photo i gets slot i; the BVH is built in one pass. Returns
+// false without touching the scene when count exceeds the capacity.
+bool scene_assign_photos(PhotoScene& scene,
+                         int count,
+                         const float* px,
+                         const float* py,
+                         const float* pz,
+                         const float* yaw,
+                         const float* scale,
+                         const uint32_t* shot_id);
+
+// Dense index of a live photo, or -1 for a stale/invalid handle.
+int scene_find_photo(const PhotoScene& scene, PhotoHandle handle);
+bool scene_get_photo(const PhotoScene& scene, PhotoHandle handle, PlacedPhoto* out);
+PhotoHandle scene_handle_at(const PhotoScene& scene, int dense_index);
+// Moves a live photo and refits its BVH leaf. Returns false for a stale or
+// invalid handle.
+bool scene_move_photo(PhotoScene& scene, PhotoHandle handle, Vec3 position, float yaw, float scale);
+
+struct PhotoPick {
+  PhotoHandle handle;
+  float distance;  // along the normalized ray direction
+};
+
+// Closest placed photo whose frame quad (either face) the ray from `origin`
+// along `dir` hits within max_distance. Walks the same BVH the culling keeps
+// up to date, so placing, moving and removing need no extra bookkeeping.
+bool scene_pick_photo(const PhotoScene& scene, Vec3 origin, Vec3 dir, float max_distance, PhotoPick* out);
+
+Aabb photo_bounds(Vec3 position, float yaw, float scale);
+
+// Writes one InstanceData per live photo inside the frustum and returns how
+// many were written. Visible/culled counts are kept in scene.last_cull.
+// `layers` may be null, in which case every frame is drawn untextured.
+int scene_prepare_instances(PhotoScene& scene,
+                            const Frustum& frustum,
+                            const SnapshotLayerTable* layers,
+                            InstanceData* out,
+                            int max_instances);
+
+// Same output as scene_prepare_instances, but culls every photo's BVH leaf
+// box directly and fills the instances in kScenePrepareBatch ranges across
+// the job system, so instances come out in dense order instead of BVH order.
+// last_cull.nodes_visited counts the boxes tested.
+int scene_prepare_instances_parallel(PhotoScene& scene,
+                                     const Frustum& frustum,
+                                     const SnapshotLayerTable* layers,
+                                     InstanceData* out,
+                                     int max_instances,
+                                     JobSystem& jobs);
+
+Vec3 shot_tint(uint32_t shot_id);
+
+// Yaw for a frame placed in front of a camera so that it faces the camera
+// with its local +X along the camera's right vector.
+float photo_yaw_facing_camera(float camera_yaw);
+
+void snapshot_layers_init(SnapshotLayerTable& table, int layer_count);
+int snapshot_layer_assign(SnapshotLayerTable& table, uint32_t shot_id);
+// Layer holding `shot_id`, or -1 if it was never captured or has been overwritten.
+int snapshot_layer_find(const SnapshotLayerTable& table, uint32_t shot_id);
@@ -0,0 +1,177 @@
+#include "scene_file.h"
+
+#include <cstring>
+
+#if !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "file_layout.h"
+
+namespace {
+
+template <typename T>
+void write_column(std::vector<uint8_t>& out, uint64_t offset, const T* values, uint32_t count) {
+  std::memcpy(out.data() + offset, values, static_cast<size_t>(count) * sizeof(T));
+}
+
+}  // namespace
+
+uint64_t scene_file_photo_column_bytes(uint32_t photo_count) {
+  return file_align_up(static_cast<uint64_t>(photo_count) * 4, kSceneFileAlign);
+}
+
+void scene_file_write(const PhotoScene& scene,
+                      const SceneFileSnapshotSource* snapshots,
+                      int snapshot_count,
+                      uint32_t next_shot_id,
+                      std::vector<uint8_t>& out) {
+  const uint32_t photo_count = static_cast<uint32_t>(scene.count);
+  const uint64_t column_bytes = scene_file_photo_column_bytes(photo_count);
+
+  SceneFileHeader header{};
+  header.magic = kSceneFileMagic;
+  header.version = kSceneFileVersion;
+  header.header_bytes = sizeof(SceneFileHeader);
+  header.photo_count = photo_count;
+  header.snapshot_count = static_cast<uint32_t>(snapshot_count);
+  header.photo_offset = file_align_up(sizeof(SceneFileHeader), kSceneFileAlign);
+  header.snapshot_offset = header.photo_offset + column_bytes * kSceneFilePhotoColumns;
+  header.blob_offset = file_align_up(
+      header.snapshot_offset + sizeof(SceneFileSnapshot) * static_cast<uint64_t>(snapshot_count), kSceneFileAlign);
+  for (int i = 0; i < snapshot_count; ++i) {
+    header.blob_bytes = file_align_up(header.blob_bytes + snapshots[i].blob_bytes, kSceneFileAlign);
+  }
+  header.file_bytes = header.blob_offset + header.blob_bytes;
+  header.next_shot_id = next_shot_id;
+
+  out.assign(static_cast<size_t>(header.file_bytes), 0);
+  std::memcpy(out.data(), &header, sizeof(header));
+
+  write_column(out, header.photo_offset + column_bytes * 0, scene.px.data(), photo_count);
+  write_column(out, header.photo_offset + column_bytes * 1, scene.py.data(), photo_count);
+  write_column(out, header.photo_offset + column_bytes * 2, scene.pz.data(), photo_count);
+  write_column(out, header.photo_offset + column_bytes * 3, scene.yaw.data(), photo_count);
+  write_column(out, header.photo_offset + column_bytes * 4, scene.scale.data(), photo_count);
+  write_column(out, header.photo_offset + column_bytes * 5, scene.shot_id.data(), photo_count);
+
+  uint64_t blob_cursor = 0;
+  for (int i = 0; i < snapshot_count; ++i) {
+    const SceneFileSnapshotSource& src = snapshots[i];
+    SceneFileSnapshot record{};
+    record.id = src.info.id;
+    record.position[0] = src.info.position.x;
+    record.position[1] = src.info.position.y;
+    record.position[2] = src.info.position.z;
+    record.yaw = src.info.yaw;
+    record.pitch = src.info.pitch;
+    record.timestamp_ms = src.info.timestamp_ms;
+    record.blob_offset = blob_cursor;
+    record.blob_bytes = static_cast<uint32_t>(src.blob_bytes);
+    std::memcpy(out.data() + header.snapshot_offset + sizeof(SceneFileSnapshot) * static_cast<uint64_t>(i),
+                &record,
+                sizeof(record));
+    if (src.blob_bytes > 0) {
+      std::memcpy(out.data() + header.blob_offset + blob_cursor, src.blob, src.blob_bytes);
+    }
+    blob_cursor = file_align_up(blob_cursor + src.blob_bytes, kSceneFileAlign);
+  }
+}
+
+bool scene_file_peek_header(const uint8_t* data, size_t size, SceneFileHeader& out) {
+  if (size < sizeof(SceneFileHeader)) {
+    return false;
+  }
+  std::memcpy(&out, data, sizeof(SceneFileHeader));
+  return out.magic == kSceneFileMagic && out.version == kSceneFileVersion &&
+         out.header_bytes == sizeof(SceneFileHeader);
+}
+
+bool scene_file_open(const uint8_t* data, size_t size, SceneFileView& out) {
+  SceneFileHeader header{};
+  if (reinterpret_cast<uintptr_t>(data) % alignof(SceneFileHeader) != 0 || !scene_file_peek_header(data, size, header)) {
+    return false;
+  }
+  const uint64_t column_bytes = scene_file_photo_column_bytes(header.photo_count);
+  if (header.file_bytes > size ||
+      !file_section_fits(header.photo_offset, column_bytes * kSceneFilePhotoColumns, header.file_bytes,
+                         kSceneFileAlign) ||
+      !file_section_fits(header.snapshot_offset, sizeof(SceneFileSnapshot) * static_cast<uint64_t>(header.snapshot_count),
+                         header.file_bytes, kSceneFileAlign) ||
+      !file_section_fits(header.blob_offset, header.blob_bytes, header.file_bytes, kSceneFileAlign)) {
+    return false;
+  }
+
+  out.header = reinterpret_cast<const SceneFileHeader*>(data);
+  const uint8_t* photos = data + header.photo_offset;
+  out.px = reinterpret_cast<const float*>(photos + column_bytes * 0);
+  out.py = reinterpret_cast<const float*>(photos + column_bytes * 1);
+  out.pz = reinterpret_cast<const float*>(photos + column_bytes * 2);
+  out.yaw = reinterpret_cast<const float*>(photos + column_bytes * 3);
+  out.scale = reinterpret_cast<const float*>(photos + column_bytes * 4);
+  out.shot_id = reinterpret_cast<const uint32_t*>(photos + column_bytes * 5);
+  out.snapshots = reinterpret_cast<const SceneFileSnapshot*>(data + header.snapshot_offset);
+  out.blobs = data + header.blob_offset;
+
+  for (uint32_t i = 0; i < header.snapshot_count; ++i) {
+    const SceneFileSnapshot& s = out.snapshots[i];
+    if (s.blob_offset > header.blob_bytes || s.blob_bytes > header.blob_bytes - s.blob_offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+PhotoSnapshot scene_file_snapshot_info(const SceneFileSnapshot& record) {
+  return PhotoSnapshot{record.id,
+                       Vec3{record.position[0], record.position[1], record.position[2]},
+                       record.yaw,
+                       record.pitch,
+                       record.timestamp_ms};
+}
+
+bool scene_load_photos(PhotoScene& scene, const SceneFileView& view) {
+  return scene_assign_photos(scene,
+                             static_cast<int>(view.header->photo_count),
+                             view.px,
+                             view.py,
+                             view.pz,
+                             view.yaw,
+                             view.scale,
+                             view.shot_id);
+}
+
+#if !defined(__EMSCRIPTEN__)
+
+bool mapped_file_open(const char* path, MappedFile& out) {
+  out = MappedFile{nullptr, 0};
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+  void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  out.data = static_cast<const uint8_t*>(data);
+  out.size = static_cast<size_t>(st.st_size);
+  return true;
+}
+
+void mapped_file_close(MappedFile& file) {
+  if (file.data) {
+    munmap(const_cast<uint8_t*>(file.data), file.size);
+  }
+  file = MappedFile{nullptr, 0};
+}
+
+#endif
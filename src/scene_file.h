@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "scene.h"
+
+// Versioned binary scene file. Every section starts on a 64-byte boundary
+// and stores plain little-endian arrays, so a mapped file can be read in
+// place:
+//
+//   SceneFileHeader
+//   photo table      px, py, pz, yaw, scale (f32), shot_id (u32); one
+//                    column per field, each padded to 64 bytes
+//   snapshot table   SceneFileSnapshot[snapshot_count]
+//   blob section     encoded snapshot blobs (see snapshot_codec.h),
+//                    referenced by offset from the snapshot table
+//
+// Handles are not stored; placed photos get fresh handles in file order
+// when loaded.
+constexpr uint32_t kSceneFileMagic = 0x43535346;  // "FSSC"
+constexpr uint16_t kSceneFileVersion = 1;
+constexpr uint32_t kSceneFileAlign = 64;
+constexpr int kSceneFilePhotoColumns = 6;
+
+struct SceneFileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_bytes;
+  uint32_t photo_count;
+  uint32_t snapshot_count;
+  uint64_t photo_offset;
+  uint64_t snapshot_offset;
+  uint64_t blob_offset;
+  uint64_t blob_bytes;
+  uint64_t file_bytes;
+  uint32_t next_shot_id;  // first id a new capture should use
+  uint32_t reserved;
+};
+static_assert(sizeof(SceneFileHeader) == 64, "SceneFileHeader is part of the file format");
+
+struct SceneFileSnapshot {
+  uint32_t id;
+  float position[3];
+  float yaw;
+  float pitch;
+  double timestamp_ms;
+  uint64_t blob_offset;  // relative to the blob section
+  uint32_t blob_bytes;   // 0 when the shot was saved without image data
+  uint32_t reserved;
+};
+static_assert(sizeof(SceneFileSnapshot) == 48, "SceneFileSnapshot is part of the file format");
+
+// Validated pointers into a scene file. Nothing is copied; the view is only
+// as long-lived as the bytes it was opened on.
+struct SceneFileView {
+  const SceneFileHeader* header;
+  const float* px;
+  const float* py;
+  const float* pz;
+  const float* yaw;
+  const float* scale;
+  const uint32_t* shot_id;
+  const SceneFileSnapshot* snapshots;
+  const uint8_t* blobs;
+};
+
+struct SceneFileSnapshotSource {
+  PhotoSnapshot info;
+  const uint8_t* blob;
+  size_t blob_bytes;
+};
+
+uint64_t scene_file_photo_column_bytes(uint32_t photo_count);
+
+void scene_file_write(const PhotoScene& scene,
+                      const SceneFileSnapshotSource* snapshots,
+                      int snapshot_count,
+                      uint32_t next_shot_id,
+                      std::vector<uint8_t>& out);
+
+// `data` must be at least 8-byte aligned (mmap and malloc both are). Checks
+// the magic, version and that every section lies inside `size`.
+bool scene_file_open(const uint8_t* data, size_t size, SceneFileView& out);
+
+// Only the fixed header is needed; lets a streaming reader reject a file
+// and learn its total size from the first chunk.
+bool scene_file_peek_header(const uint8_t* data, size_t size, SceneFileHeader& out);
+
+PhotoSnapshot scene_file_snapshot_info(const SceneFileSnapshot& record);
+
+// Replaces the scene's photos with the file's photo table. Fails without
+// touching the scene when the table does not fit its capacity.
+bool scene_load_photos(PhotoScene& scene, const SceneFileView& view);
+
+// Read-only whole-file mapping for the native build.
+struct MappedFile {
+  const uint8_t* data;
+  size_t size;
+};
+
+bool mapped_file_open(const char* path, MappedFile& out);
+void mapped_file_close(MappedFile& file);
@@ -0,0 +1,155 @@
+#include "scene_gen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr float kHalfPi = 1.5707963f;
+constexpr float kPi = 3.14159265f;
+constexpr int kCorridorRows = 4;
+constexpr float kCorridorHalfWidth = 3.0f;
+constexpr float kCorridorRowHeight = 1.2f;
+constexpr float kCorridorColumnStep = 1.6f;  // frames are 1.5 wide
+constexpr int kSnapshotBoxes = 4;
+
+// Colour channel already in 0..255, clamped and truncated to a byte.
+uint8_t clamp_byte(float v) {
+  return static_cast<uint8_t>(std::clamp(v, 0.0f, 255.0f));
+}
+
+}  // namespace
+
+const char* scene_layout_name(SceneLayout layout) {
+  switch (layout) {
+    case SceneLayout::Grid: return "grid";
+    case SceneLayout::Corridor: return "corridor";
+    case SceneLayout::Cloud: return "cloud";
+    default: return "unknown";
+  }
+}
+
+bool scene_generate(PhotoScene& scene, const SceneGenParams& params) {
+  const int n = params.photo_count;
+  if (n < 0 || n > scene_capacity(scene) || params.layout < SceneLayout::Grid ||
+      params.layout >= SceneLayout::Count) {
+    return false;
+  }
+
+  const size_t count = static_cast<size_t>(n);
+  std::vector<float> px(count), py(count), pz(count), yaw(count), scale(count, 1.0f);
+  std::vector<uint32_t> shot_id(count, 0);
+  uint32_t state = params.seed * 2654435761u + 1u;
+
+  switch (params.layout) {
+    case SceneLayout::Grid: {
+      const int cols = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n)))));
+      for (int i = 0; i < n; ++i) {
+        px[i] = (static_cast<float>(i % cols) - 0.5f * static_cast<float>(cols - 1)) * kSceneGenSpacing;
+        py[i] = 1.5f;
+        pz[i] = -static_cast<float>(i / cols) * kSceneGenSpacing;
+        yaw[i] = 0.0f;
+      }
+      break;
+    }
+    case SceneLayout::Corridor:
+      for (int i = 0; i < n; ++i) {
+        const int row = i % kCorridorRows;
+        const bool right = (i / kCorridorRows) % 2 != 0;
+        const int column = i / (2 * kCorridorRows);
+        px[i] = right ? kCorridorHalfWidth : -kCorridorHalfWidth;
+        py[i] = 0.7f + static_cast<float>(row) * kCorridorRowHeight;
+        pz[i] = -static_cast<float>(column) * kCorridorColumnStep;
+        yaw[i] = right ? -kHalfPi : kHalfPi;
+      }
+      break;
+    case SceneLayout::Cloud: {
+      const float side = kSceneGenSpacing * std::cbrt(static_cast<float>(std::max(n, 1)));
+      for (int i = 0; i < n; ++i) {
+        px[i] = (rng_unit(state) - 0.5f) * side;
+        py[i] = 1.5f + (rng_unit(state) - 0.5f) * side;
+        pz[i] = -rng_unit(state) * side;
+        yaw[i] = (rng_unit(state) * 2.0f - 1.0f) * kPi;
+        scale[i] = 0.5f + rng_unit(state);
+      }
+      break;
+    }
+    default: break;
+  }
+  if (params.shot_count > 0) {
+    for (int i = 0; i < n; ++i) {
+      shot_id[i] = 1u + static_cast<uint32_t>(i % params.shot_count);
+    }
+  }
+
+  return scene_assign_photos(scene, n, px.data(), py.data(), pz.data(), yaw.data(), scale.data(), shot_id.data());
+}
+
+void snapshot_generate(SnapshotPayload& out,
+                       uint32_t shot_id,
+                       uint32_t width,
+                       uint32_t height,
+                       float z_near,
+                       float z_far) {
+  out.info = PhotoSnapshot{};
+  out.info.id = shot_id;
+  out.info.position = Vec3{static_cast<float>(shot_id % 16) * kSceneGenSpacing, 1.2f,
+                           -static_cast<float>(shot_id / 16) * kSceneGenSpacing};
+  out.info.yaw = -kHalfPi;
+  out.width = width;
+  out.height = height;
+  out.z_near = z_near;
+  out.z_far = z_far;
+  out.color.assign(static_cast<size_t>(width) * height * 4, 255);
+  out.depth.assign(static_cast<size_t>(width) * height, z_far);
+
+  const Vec3 tint = shot_tint(shot_id);
+  const float horizon = 0.4f + 0.1f * std::sin(static_cast<float>(shot_id));
+  const float half_width = 0.5f * static_cast<float>(width);
+  for (uint32_t y = 0; y < height; ++y) {
+    const float v = static_cast<float>(y) / static_cast<float>(height);
+    for (uint32_t x = 0; x < width; ++x) {
+      const size_t i = static_cast<size_t>(y) * width + x;
+      uint8_t* c = &out.color[i * 4];
+      if (v < horizon) {
+        const float light = 120.0f + 100.0f * v / horizon;
+        c[0] = clamp_byte(light * tint.x);
+        c[1] = clamp_byte(light * tint.y);
+        c[2] = clamp_byte(light * tint.z);
+        continue;
+      }
+      const float d = 1.5f / (v - horizon + 0.01f);
+      const int checker = (static_cast<int>(d * 2.0f) +
+                           static_cast<int>((static_cast<float>(x) - half_width) * d * 0.01f)) & 1;
+      const float shade = 70.0f + 90.0f * (v - horizon) + static_cast<float>(checker) * 14.0f;
+      c[0] = clamp_byte(shade);
+      c[1] = clamp_byte(shade + 6.0f);
+      c[2] = clamp_byte(shade + 10.0f);
+      out.depth[i] = std::clamp(d, z_near, z_far);
+    }
+  }
+
+  uint32_t state = shot_id * 2654435761u + 7u;
+  for (int b = 0; b < kSnapshotBoxes; ++b) {
+    const uint32_t x0 = static_cast<uint32_t>(rng_unit(state) * 0.8f * static_cast<float>(width));
+    const uint32_t y0 = static_cast<uint32_t>((0.1f + rng_unit(state) * 0.6f) * static_cast<float>(height));
+    const uint32_t x1 = std::min(width, x0 + static_cast<uint32_t>((0.06f + 0.2f * rng_unit(state)) * static_cast<float>(width)));
+    const uint32_t y1 = std::min(height, y0 + static_cast<uint32_t>((0.06f + 0.2f * rng_unit(state)) * static_cast<float>(height)));
+    const float z = z_near + 1.0f + rng_unit(state) * 40.0f;
+    const float box_tint[3] = {0.3f + 0.7f * rng_unit(state), 0.3f + 0.7f * rng_unit(state), 0.3f + 0.7f * rng_unit(state)};
+    for (uint32_t y = y0; y < y1; ++y) {
+      for (uint32_t x = x0; x < x1; ++x) {
+        const size_t i = static_cast<size_t>(y) * width + x;
+        if (out.depth[i] < z) {
+          continue;
+        }
+        const float light = 0.6f + 0.4f * static_cast<float>(x - x0) / static_cast<float>(x1 - x0);
+        for (int ch = 0; ch < 3; ++ch) {
+          out.color[i * 4 + ch] = clamp_byte(230.0f * box_tint[ch] * light);
+        }
+        out.depth[i] = std::min(z_far, z + 0.01f * static_cast<float>(y - y0));
+      }
+    }
+  }
+}
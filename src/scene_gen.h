@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+#include "scene.h"
+#include "snapshot.h"
+
+// Procedural stress scenes: any number of placed photos in a few layouts,
+// plus generated snapshots for them to show, so the renderer and the
+// benchmarks can be loaded far past what anyone places by hand. The output
+// depends only on the parameters, so the web build and the native bench see
+// the same scene for the same parameters.
+//
+// Every layout starts in front of the camera_init pose and keeps its density
+// fixed as photo_count grows:
+//   Grid      rows of frames facing the camera, kSceneGenSpacing apart; the
+//             far plane bounds what the start view sees
+//   Corridor  two facing walls four frames high running down -Z; only the
+//             near end is ever in view
+//   Cloud     random positions, yaws and scales in a cube that grows with
+//             the count, so most of it stays in view (the unculled case)
+enum class SceneLayout : int32_t {
+  Grid,
+  Corridor,
+  Cloud,
+  Count,
+};
+
+constexpr float kSceneGenSpacing = 2.0f;
+
+struct SceneGenParams {
+  SceneLayout layout;
+  int photo_count;
+  int shot_count;  // photo i shows shot 1 + i % shot_count; 0 leaves them untextured
+  uint32_t seed;
+};
+
+const char* scene_layout_name(SceneLayout layout);
+
+// Replaces every placed photo in one bulk assignment. Returns false without
+// touching the scene for an unknown layout or when photo_count exceeds the
+// scene's capacity.
+bool scene_generate(PhotoScene& scene, const SceneGenParams& params);
+
+// A landscape-like image for `shot_id`: tinted sky over a receding checkered
+// floor with a few boxes, with matching linear depth. Compresses about as
+// well as a real capture.
+void snapshot_generate(SnapshotPayload& out,
+                       uint32_t shot_id,
+                       uint32_t width,
+                       uint32_t height,
+                       float z_near,
+                       float z_far);
@@ -0,0 +1,74 @@
+#include "snapshot.h"
+
+#include <cstring>
+
+void linearize_depth_rh_zo(const float* depth, float* out, size_t count, float z_near, float z_far) {
+  // ndc = far * (w - near) / (w * (far - near)), solved for w.
+  const float fn = z_far * z_near;
+  const float range = z_far - z_near;
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = fn / (z_far - depth[i] * range);
+  }
+}
+
+void snapshot_payload_assign(SnapshotPayload& payload,
+                             const PhotoSnapshot& info,
+                             uint32_t width,
+                             uint32_t height,
+                             const uint8_t* color_rows,
+                             size_t color_row_bytes,
+                             const uint8_t* depth_rows,
+                             size_t depth_row_bytes,
+                             float z_near,
+                             float z_far) {
+  payload.info = info;
+  payload.width = width;
+  payload.height = height;
+  payload.z_near = z_near;
+  payload.z_far = z_far;
+
+  const size_t color_bytes = static_cast<size_t>(width) * 4;
+  payload.color.resize(color_bytes * height);
+  payload.depth.resize(static_cast<size_t>(width) * height);
+  for (uint32_t y = 0; y < height; ++y) {
+    std::memcpy(payload.color.data() + y * color_bytes, color_rows + y * color_row_bytes, color_bytes);
+    float* depth_out = payload.depth.data() + static_cast<size_t>(y) * width;
+    std::memcpy(depth_out, depth_rows + y * depth_row_bytes, static_cast<size_t>(width) * sizeof(float));
+    linearize_depth_rh_zo(depth_out, depth_out, width, z_near, z_far);
+  }
+}
+
+void readback_ring_init(ReadbackRing& ring, int depth) {
+  ring.slots.assign(static_cast<size_t>(depth), ReadbackSlot{ReadbackState::Free, -1, 0, false, PhotoSnapshot{}});
+  ring.next = 0;
+  ring.stats = ReadbackStats{};
+}
+
+int readback_ring_acquire(ReadbackRing& ring) {
+  const int count = static_cast<int>(ring.slots.size());
+  for (int i = 0; i < count; ++i) {
+    const int slot = (ring.next + i) % count;
+    if (ring.slots[slot].state == ReadbackState::Free) {
+      ring.slots[slot].state = ReadbackState::Encoded;
+      ring.next = (slot + 1) % count;
+      ring.stats.in_flight += 1;
+      if (ring.stats.in_flight > ring.stats.peak_in_flight) {
+        ring.stats.peak_in_flight = ring.stats.in_flight;
+      }
+      return slot;
+    }
+  }
+  return -1;
+}
+
+void readback_ring_release(ReadbackRing& ring, int slot) {
+  ReadbackSlot& s = ring.slots[slot];
+  if (s.state == ReadbackState::Free) {
+    return;
+  }
+  s.state = ReadbackState::Free;
+  s.layer = -1;
+  s.pending_maps = 0;
+  s.map_failed = false;
+  ring.stats.in_flight -= 1;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "scene.h"
+
+// Full snapshot resolution, 3:2 to match the photo frame mesh. No stored or
+// decoded snapshot is larger.
+constexpr uint32_t kSnapshotWidth = 480;
+constexpr uint32_t kSnapshotHeight = 320;
+
+// CPU copy of a captured shot: RGBA8 color and linear view-space depth at
+// snapshot resolution, plus the camera state it was taken from.
+struct SnapshotPayload {
+  PhotoSnapshot info;
+  uint32_t width;
+  uint32_t height;
+  float z_near;
+  float z_far;
+  std::vector<uint8_t> color;  // tightly packed rows
+  std::vector<float> depth;    // distance along the view axis, world units
+};
+
+// Converts [0, 1] depth from mat4_perspective_rh_zo back to view distance.
+void linearize_depth_rh_zo(const float* depth, float* out, size_t count, float z_near, float z_far);
+
+// Copies row-padded readback data (rows aligned for buffer copies) into a
+// tightly packed payload and linearizes its depth.
+void snapshot_payload_assign(SnapshotPayload& payload,
+                             const PhotoSnapshot& info,
+                             uint32_t width,
+                             uint32_t height,
+                             const uint8_t* color_rows,
+                             size_t color_row_bytes,
+                             const uint8_t* depth_rows,
+                             size_t depth_row_bytes,
+                             float z_near,
+                             float z_far);
+
+// Bookkeeping for a fixed ring of staging buffers. A slot is acquired when a
+// capture is encoded and released once every buffer it owns has been mapped
+// and consumed; captures that find no free slot wait for a later frame
+// instead of stalling the render loop.
+enum class ReadbackState : uint8_t {
+  Free,
+  Encoded,
+  Mapping,
+};
+
+struct ReadbackSlot {
+  ReadbackState state;
+  int layer;
+  int pending_maps;
+  bool map_failed;
+  PhotoSnapshot info;
+};
+
+struct ReadbackStats {
+  uint32_t completed;
+  uint32_t deferred;  // capture-frames spent waiting for a free slot
+  int in_flight;
+  int peak_in_flight;
+};
+
+struct ReadbackRing {
+  std::vector<ReadbackSlot> slots;
+  int next;
+  ReadbackStats stats;
+};
+
+void readback_ring_init(ReadbackRing& ring, int depth);
+// Returns a free slot index, or -1 when every slot is in flight.
+int readback_ring_acquire(ReadbackRing& ring);
+void readback_ring_release(ReadbackRing& ring, int slot);
@@ -0,0 +1,658 @@
+#include "snapshot_codec.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if !defined(FRAMESPACE_MATH_SCALAR) && defined(__wasm_simd128__)
+
+#include <wasm_simd128.h>
+
+#define FRAMESPACE_CODEC_SIMD 1
+
+namespace {
+
+using simd_i = v128_t;
+
+inline simd_i simd_loadi(const void* p) { return wasm_v128_load(p); }
+inline void simd_storei(void* p, simd_i v) { wasm_v128_store(p, v); }
+inline simd_i simd_zero() { return wasm_i32x4_splat(0); }
+inline simd_i simd_splat32(int32_t v) { return wasm_i32x4_splat(v); }
+inline simd_i simd_add16(simd_i a, simd_i b) { return wasm_i16x8_add(a, b); }
+inline simd_i simd_sub16(simd_i a, simd_i b) { return wasm_i16x8_sub(a, b); }
+inline simd_i simd_sra16(simd_i a, int n) { return wasm_i16x8_shr(a, n); }
+inline simd_i simd_srl16(simd_i a, int n) { return wasm_u16x8_shr(a, n); }
+inline simd_i simd_sll16(simd_i a, int n) { return wasm_i16x8_shl(a, n); }
+inline simd_i simd_srl32(simd_i a, int n) { return wasm_u32x4_shr(a, n); }
+inline simd_i simd_sll32(simd_i a, int n) { return wasm_i32x4_shl(a, n); }
+inline simd_i simd_and(simd_i a, simd_i b) { return wasm_v128_and(a, b); }
+inline simd_i simd_or(simd_i a, simd_i b) { return wasm_v128_or(a, b); }
+inline simd_i simd_xor(simd_i a, simd_i b) { return wasm_v128_xor(a, b); }
+inline simd_i simd_pack32to16(simd_i a, simd_i b) { return wasm_i16x8_narrow_i32x4(a, b); }
+inline simd_i simd_widen_lo16(simd_i a) { return wasm_u32x4_extend_low_u16x8(a); }
+inline simd_i simd_widen_hi16(simd_i a) { return wasm_u32x4_extend_high_u16x8(a); }
+
+}  // namespace
+
+#elif !defined(FRAMESPACE_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+
+#include <emmintrin.h>
+
+#define FRAMESPACE_CODEC_SIMD 1
+
+namespace {
+
+using simd_i = __m128i;
+
+inline simd_i simd_loadi(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+inline void simd_storei(void* p, simd_i v) { _mm_storeu_si128(static_cast<__m128i*>(p), v); }
+inline simd_i simd_zero() { return _mm_setzero_si128(); }
+inline simd_i simd_splat32(int32_t v) { return _mm_set1_epi32(v); }
+inline simd_i simd_add16(simd_i a, simd_i b) { return _mm_add_epi16(a, b); }
+inline simd_i simd_sub16(simd_i a, simd_i b) { return _mm_sub_epi16(a, b); }
+inline simd_i simd_sra16(simd_i a, int n) { return _mm_sra_epi16(a, _mm_cvtsi32_si128(n)); }
+inline simd_i simd_srl16(simd_i a, int n) { return _mm_srl_epi16(a, _mm_cvtsi32_si128(n)); }
+inline simd_i simd_sll16(simd_i a, int n) { return _mm_sll_epi16(a, _mm_cvtsi32_si128(n)); }
+inline simd_i simd_srl32(simd_i a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+inline simd_i simd_sll32(simd_i a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+inline simd_i simd_and(simd_i a, simd_i b) { return _mm_and_si128(a, b); }
+inline simd_i simd_or(simd_i a, simd_i b) { return _mm_or_si128(a, b); }
+inline simd_i simd_xor(simd_i a, simd_i b) { return _mm_xor_si128(a, b); }
+inline simd_i simd_pack32to16(simd_i a, simd_i b) { return _mm_packs_epi32(a, b); }
+inline simd_i simd_widen_lo16(simd_i a) { return _mm_unpacklo_epi16(a, _mm_setzero_si128()); }
+inline simd_i simd_widen_hi16(simd_i a) { return _mm_unpackhi_epi16(a, _mm_setzero_si128()); }
+
+}  // namespace
+
+#endif
+
+namespace {
+
+constexpr int kRiceBlock = 64;
+constexpr int kRiceEscape = 16;
+constexpr int kRiceZeroBlock = 15;  // k value reserved for an all-zero block
+constexpr size_t kHeaderBytes = 64;
+
+// ---------------------------------------------------------------------------
+// Transform kernels. Every SIMD kernel has a scalar twin that handles the
+// tail and the use_simd == false path; both produce identical output.
+
+void rgba_to_ycocg_scalar(const uint8_t* rgba, int16_t* y, int16_t* co, int16_t* cg, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    const int r = rgba[i * 4 + 0];
+    const int g = rgba[i * 4 + 1];
+    const int b = rgba[i * 4 + 2];
+    const int o = r - b;
+    const int t = b + (o >> 1);
+    const int c = g - t;
+    co[i] = static_cast<int16_t>(o);
+    cg[i] = static_cast<int16_t>(c);
+    y[i] = static_cast<int16_t>(t + (c >> 1));
+  }
+}
+
+void ycocg_to_rgba_scalar(const int16_t* y, const int16_t* co, const int16_t* cg, uint8_t* rgba, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    const int t = y[i] - (cg[i] >> 1);
+    const int g = cg[i] + t;
+    const int b = t - (co[i] >> 1);
+    const int r = b + co[i];
+    rgba[i * 4 + 0] = static_cast<uint8_t>(r);
+    rgba[i * 4 + 1] = static_cast<uint8_t>(g);
+    rgba[i * 4 + 2] = static_cast<uint8_t>(b);
+    rgba[i * 4 + 3] = 255;
+  }
+}
+
+inline uint16_t zigzag16(int16_t v) {
+  return static_cast<uint16_t>((static_cast<uint16_t>(v) << 1) ^ static_cast<uint16_t>(v >> 15));
+}
+
+inline int16_t unzigzag16(uint16_t v) {
+  return static_cast<int16_t>((v >> 1) ^ static_cast<uint16_t>(-(v & 1)));
+}
+
+// Residual against the previous row (zero for the first row), wrapping in
+// 16 bits, then zigzagged.
+void up_residual_scalar(const int16_t* cur, const int16_t* prev, uint16_t* out, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    const int16_t p = prev ? prev[i] : 0;
+    out[i] = zigzag16(static_cast<int16_t>(cur[i] - p));
+  }
+}
+
+void up_restore_scalar(const uint16_t* sym, const int16_t* prev, int16_t* out, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    const int16_t p = prev ? prev[i] : 0;
+    out[i] = static_cast<int16_t>(unzigzag16(sym[i]) + p);
+  }
+}
+
+#if defined(FRAMESPACE_CODEC_SIMD)
+
+size_t rgba_to_ycocg_simd(const uint8_t* rgba, int16_t* y, int16_t* co, int16_t* cg, size_t count) {
+  const simd_i mask = simd_splat32(0xff);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const simd_i p0 = simd_loadi(rgba + i * 4);
+    const simd_i p1 = simd_loadi(rgba + i * 4 + 16);
+    const simd_i r = simd_pack32to16(simd_and(p0, mask), simd_and(p1, mask));
+    const simd_i g = simd_pack32to16(simd_and(simd_srl32(p0, 8), mask), simd_and(simd_srl32(p1, 8), mask));
+    const simd_i b = simd_pack32to16(simd_and(simd_srl32(p0, 16), mask), simd_and(simd_srl32(p1, 16), mask));
+    const simd_i o = simd_sub16(r, b);
+    const simd_i t = simd_add16(b, simd_sra16(o, 1));
+    const simd_i c = simd_sub16(g, t);
+    simd_storei(co + i, o);
+    simd_storei(cg + i, c);
+    simd_storei(y + i, simd_add16(t, simd_sra16(c, 1)));
+  }
+  return i;
+}
+
+size_t ycocg_to_rgba_simd(const int16_t* y, const int16_t* co, const int16_t* cg, uint8_t* rgba, size_t count) {
+  const simd_i alpha = simd_splat32(static_cast<int32_t>(0xff000000u));
+  const simd_i low_byte = simd_splat32(0x00ff00ff);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const simd_i yy = simd_loadi(y + i);
+    const simd_i oo = simd_loadi(co + i);
+    const simd_i cc = simd_loadi(cg + i);
+    const simd_i t = simd_sub16(yy, simd_sra16(cc, 1));
+    // Masked to the low byte so corrupt input truncates like the scalar path.
+    const simd_i g = simd_and(simd_add16(cc, t), low_byte);
+    const simd_i b0 = simd_sub16(t, simd_sra16(oo, 1));
+    const simd_i r = simd_and(simd_add16(b0, oo), low_byte);
+    const simd_i b = simd_and(b0, low_byte);
+    const simd_i lo = simd_or(simd_or(simd_widen_lo16(r), simd_sll32(simd_widen_lo16(g), 8)),
+                              simd_or(simd_sll32(simd_widen_lo16(b), 16), alpha));
+    const simd_i hi = simd_or(simd_or(simd_widen_hi16(r), simd_sll32(simd_widen_hi16(g), 8)),
+                              simd_or(simd_sll32(simd_widen_hi16(b), 16), alpha));
+    simd_storei(rgba + i * 4, lo);
+    simd_storei(rgba + i * 4 + 16, hi);
+  }
+  return i;
+}
+
+size_t up_residual_simd(const int16_t* cur, const int16_t* prev, uint16_t* out, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const simd_i p = prev ? simd_loadi(prev + i) : simd_zero();
+    const simd_i d = simd_sub16(simd_loadi(cur + i), p);
+    simd_storei(out + i, simd_xor(simd_sll16(d, 1), simd_sra16(d, 15)));
+  }
+  return i;
+}
+
+size_t up_restore_simd(const uint16_t* sym, const int16_t* prev, int16_t* out, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const simd_i s = simd_loadi(sym + i);
+    // (s >> 1) ^ -(s & 1): shifting the low bit up to the sign and back
+    // arithmetically yields the 0 / -1 mask.
+    const simd_i sign = simd_sra16(simd_sll16(s, 15), 15);
+    const simd_i d = simd_xor(simd_srl16(s, 1), sign);
+    const simd_i p = prev ? simd_loadi(prev + i) : simd_zero();
+    simd_storei(out + i, simd_add16(d, p));
+  }
+  return i;
+}
+
+#endif
+
+void rgba_to_ycocg(const uint8_t* rgba, int16_t* y, int16_t* co, int16_t* cg, size_t count, bool use_simd) {
+  size_t done = 0;
+#if defined(FRAMESPACE_CODEC_SIMD)
+  if (use_simd) done = rgba_to_ycocg_simd(rgba, y, co, cg, count);
+#else
+  (void)use_simd;
+#endif
+  rgba_to_ycocg_scalar(rgba, y, co, cg, done, count);
+}
+
+void ycocg_to_rgba(const int16_t* y, const int16_t* co, const int16_t* cg, uint8_t* rgba, size_t count, bool use_simd) {
+  size_t done = 0;
+#if defined(FRAMESPACE_CODEC_SIMD)
+  if (use_simd) done = ycocg_to_rgba_simd(y, co, cg, rgba, count);
+#else
+  (void)use_simd;
+#endif
+  ycocg_to_rgba_scalar(y, co, cg, rgba, done, count);
+}
+
+void up_residual(const int16_t* cur, const int16_t* prev, uint16_t* out, size_t count, bool use_simd) {
+  size_t done = 0;
+#if defined(FRAMESPACE_CODEC_SIMD)
+  if (use_simd) done = up_residual_simd(cur, prev, out, count);
+#else
+  (void)use_simd;
+#endif
+  up_residual_scalar(cur, prev, out, done, count);
+}
+
+void up_restore(const uint16_t* sym, const int16_t* prev, int16_t* out, size_t count, bool use_simd) {
+  size_t done = 0;
+#if defined(FRAMESPACE_CODEC_SIMD)
+  if (use_simd) done = up_restore_simd(sym, prev, out, count);
+#else
+  (void)use_simd;
+#endif
+  up_restore_scalar(sym, prev, out, done, count);
+}
+
+// ---------------------------------------------------------------------------
+// Rice coding, MSB-first.
+
+struct BitWriter {
+  std::vector<uint8_t>* out;
+  uint64_t acc;
+  int bits;
+};
+
+inline void bits_put(BitWriter& w, uint32_t value, int count) {
+  w.acc = (w.acc << count) | value;
+  w.bits += count;
+  while (w.bits >= 8) {
+    w.bits -= 8;
+    w.out->push_back(static_cast<uint8_t>(w.acc >> w.bits));
+  }
+}
+
+inline void bits_flush(BitWriter& w) {
+  if (w.bits > 0) {
+    w.out->push_back(static_cast<uint8_t>(w.acc << (8 - w.bits)));
+    w.bits = 0;
+  }
+}
+
+struct BitReader {
+  const uint8_t* data;
+  size_t size;
+  size_t pos;
+  uint64_t acc;
+  int bits;
+};
+
+inline void bits_refill(BitReader& r) {
+  while (r.bits <= 56) {
+    const uint8_t byte = r.pos < r.size ? r.data[r.pos] : 0;
+    r.pos += 1;
+    r.acc = (r.acc << 8) | byte;
+    r.bits += 8;
+  }
+}
+
+inline uint32_t bits_get(BitReader& r, int count) {
+  if (count == 0) {
+    return 0;
+  }
+  bits_refill(r);
+  r.bits -= count;
+  return static_cast<uint32_t>(r.acc >> r.bits) & ((1u << count) - 1u);
+}
+
+// Leading zeros of the unread window, capped at kRiceEscape; does not consume.
+inline int bits_peek_zeros(BitReader& r) {
+  bits_refill(r);
+  const uint64_t window = r.acc << (64 - r.bits);
+  if (window == 0) {
+    return kRiceEscape;
+  }
+  return std::min(std::countl_zero(window), kRiceEscape);
+}
+
+void rice_encode(const uint16_t* symbols, size_t count, std::vector<uint8_t>& out) {
+  BitWriter w{&out, 0, 0};
+  for (size_t block = 0; block < count; block += kRiceBlock) {
+    const size_t end = std::min(count, block + kRiceBlock);
+    uint32_t sum = 0;
+    for (size_t i = block; i < end; ++i) {
+      sum += symbols[i];
+    }
+    const uint32_t mean = sum / static_cast<uint32_t>(end - block);
+    if (sum == 0) {
+      bits_put(w, kRiceZeroBlock, 4);
+      continue;
+    }
+    const int k = mean > 0 ? std::min(kRiceZeroBlock - 1, static_cast<int>(std::bit_width(mean)) - 1) : 0;
+    bits_put(w, static_cast<uint32_t>(k), 4);
+    for (size_t i = block; i < end; ++i) {
+      const uint32_t v = symbols[i];
+      const uint32_t q = v >> k;
+      if (q < kRiceEscape) {
+        bits_put(w, 1, static_cast<int>(q) + 1);
+        if (k > 0) bits_put(w, v & ((1u << k) - 1u), k);
+      } else {
+        bits_put(w, 0, kRiceEscape);
+        bits_put(w, v, 16);
+      }
+    }
+  }
+  bits_flush(w);
+}
+
+bool rice_decode(const uint8_t* data, size_t size, uint16_t* symbols, size_t count) {
+  BitReader r{data, size, 0, 0, 0};
+  for (size_t block = 0; block < count; block += kRiceBlock) {
+    const size_t end = std::min(count, block + kRiceBlock);
+    const int k = static_cast<int>(bits_get(r, 4));
+    if (k == kRiceZeroBlock) {
+      std::fill(symbols + block, symbols + end, 0);
+      continue;
+    }
+    for (size_t i = block; i < end; ++i) {
+      const int zeros = bits_peek_zeros(r);
+      if (zeros < kRiceEscape) {
+        r.bits -= zeros + 1;
+        symbols[i] = static_cast<uint16_t>((static_cast<uint32_t>(zeros) << k) | bits_get(r, k));
+      } else {
+        r.bits -= kRiceEscape;
+        symbols[i] = static_cast<uint16_t>(bits_get(r, 16));
+      }
+    }
+  }
+  // Reading past the end only yields zero padding; anything beyond one
+  // refill's worth means the stream was truncated.
+  return r.pos <= size + 8;
+}
+
+// Row prediction for a plane. Color uses the row above; depth, which is
+// mostly planar surfaces, extrapolates linearly from the two rows above.
+// Either way the prediction for a row depends only on earlier rows, so both
+// directions stay vectorizable.
+enum class RowPredictor : uint8_t {
+  Up,
+  Linear,
+};
+
+const int16_t* predict_row(const int16_t* plane, uint32_t width, uint32_t y, RowPredictor predictor,
+                           std::vector<int16_t>& row) {
+  if (y == 0) {
+    return nullptr;
+  }
+  const int16_t* prev = plane + static_cast<size_t>(y - 1) * width;
+  if (predictor == RowPredictor::Up || y == 1) {
+    return prev;
+  }
+  const int16_t* prev2 = prev - width;
+  row.resize(width);
+  for (uint32_t x = 0; x < width; ++x) {
+    row[x] = static_cast<int16_t>(2 * prev[x] - prev2[x]);
+  }
+  return row.data();
+}
+
+void encode_plane(const int16_t* plane, uint32_t width, uint32_t height, RowPredictor predictor,
+                  std::vector<uint16_t>& scratch, std::vector<uint8_t>& out, bool use_simd) {
+  const size_t count = static_cast<size_t>(width) * height;
+  scratch.resize(count);
+  std::vector<int16_t> row;
+  for (uint32_t y = 0; y < height; ++y) {
+    const int16_t* cur = plane + static_cast<size_t>(y) * width;
+    const int16_t* pred = predict_row(plane, width, y, predictor, row);
+    up_residual(cur, pred, scratch.data() + static_cast<size_t>(y) * width, width, use_simd);
+  }
+  rice_encode(scratch.data(), count, out);
+}
+
+bool decode_plane(const uint8_t* data, size_t size, uint32_t width, uint32_t height, RowPredictor predictor,
+                  std::vector<uint16_t>& scratch, int16_t* plane, bool use_simd) {
+  const size_t count = static_cast<size_t>(width) * height;
+  scratch.resize(count);
+  if (!rice_decode(data, size, scratch.data(), count)) {
+    return false;
+  }
+  std::vector<int16_t> row;
+  for (uint32_t y = 0; y < height; ++y) {
+    int16_t* cur = plane + static_cast<size_t>(y) * width;
+    const int16_t* pred = predict_row(plane, width, y, predictor, row);
+    up_restore(scratch.data() + static_cast<size_t>(y) * width, pred, cur, width, use_simd);
+  }
+  return true;
+}
+
+// Smallest encoded plane of `count` pixels: its length prefix plus four bits
+// per block, which is what an all-zero block costs. A section shorter than
+// this cannot hold the pixels the header claims.
+size_t min_plane_bytes(size_t count) {
+  const size_t blocks = (count + kRiceBlock - 1) / kRiceBlock;
+  return 4 + (blocks + 1) / 2;
+}
+
+template <typename T>
+void put_raw(std::vector<uint8_t>& out, size_t offset, T value) {
+  std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T get_raw(const uint8_t* data, size_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+void append_u32(std::vector<uint8_t>& out, uint32_t v) {
+  const size_t at = out.size();
+  out.resize(at + 4);
+  put_raw(out, at, v);
+}
+
+}  // namespace
+
+uint16_t depth_quantize_log(float depth, float z_near, float z_far) {
+  const float t = std::log(std::max(depth, z_near) / z_near) / std::log(z_far / z_near);
+  return static_cast<uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f));
+}
+
+float depth_dequantize_log(uint16_t q, float z_near, float z_far) {
+  return z_near * std::exp(static_cast<float>(q) * (1.0f / 65535.0f) * std::log(z_far / z_near));
+}
+
+// Layout (little-endian): 64-byte header, then the color section (three
+// length-prefixed planes Y, Co, Cg) and the depth section (one
+// length-prefixed plane).
+void snapshot_encode(const SnapshotPayload& payload, std::vector<uint8_t>& out, bool use_simd) {
+  const uint32_t w = payload.width;
+  const uint32_t h = payload.height;
+  const size_t count = static_cast<size_t>(w) * h;
+
+  out.clear();
+  out.resize(kHeaderBytes, 0);
+  put_raw(out, 0, kSnapshotBlobMagic);
+  put_raw(out, 4, kSnapshotBlobVersion);
+  put_raw<uint16_t>(out, 6, 0);
+  put_raw(out, 8, w);
+  put_raw(out, 12, h);
+  put_raw(out, 16, payload.info.id);
+  put_raw(out, 20, payload.info.position.x);
+  put_raw(out, 24, payload.info.position.y);
+  put_raw(out, 28, payload.info.position.z);
+  put_raw(out, 32, payload.info.yaw);
+  put_raw(out, 36, payload.info.pitch);
+  put_raw(out, 40, payload.info.timestamp_ms);
+  put_raw(out, 48, payload.z_near);
+  put_raw(out, 52, payload.z_far);
+
+  std::vector<int16_t> planes(count * 3);
+  std::vector<uint16_t> scratch;
+  int16_t* y = planes.data();
+  int16_t* co = y + count;
+  int16_t* cg = co + count;
+
+  const size_t color_begin = out.size();
+  if (payload.color.size() >= count * 4) {
+    rgba_to_ycocg(payload.color.data(), y, co, cg, count, use_simd);
+    for (const int16_t* plane : {y, co, cg}) {
+      const size_t len_at = out.size();
+      append_u32(out, 0);
+      encode_plane(plane, w, h, RowPredictor::Up, scratch, out, use_simd);
+      put_raw(out, len_at, static_cast<uint32_t>(out.size() - len_at - 4));
+    }
+  }
+  const size_t depth_begin = out.size();
+  if (payload.depth.size() >= count) {
+    uint16_t* q = reinterpret_cast<uint16_t*>(y);
+    for (size_t i = 0; i < count; ++i) {
+      q[i] = depth_quantize_log(payload.depth[i], payload.z_near, payload.z_far);
+    }
+    const size_t len_at = out.size();
+    append_u32(out, 0);
+    encode_plane(y, w, h, RowPredictor::Linear, scratch, out, use_simd);
+    put_raw(out, len_at, static_cast<uint32_t>(out.size() - len_at - 4));
+  }
+
+  put_raw(out, 56, static_cast<uint32_t>(depth_begin - color_begin));
+  put_raw(out, 60, static_cast<uint32_t>(out.size() - depth_begin));
+}
+
+bool snapshot_blob_peek(const uint8_t* data, size_t size, SnapshotBlobInfo& out) {
+  if (size < kHeaderBytes || get_raw<uint32_t>(data, 0) != kSnapshotBlobMagic ||
+      get_raw<uint16_t>(data, 4) != kSnapshotBlobVersion) {
+    return false;
+  }
+  out.width = get_raw<uint32_t>(data, 8);
+  out.height = get_raw<uint32_t>(data, 12);
+  out.info.id = get_raw<uint32_t>(data, 16);
+  out.info.position = Vec3{get_raw<float>(data, 20), get_raw<float>(data, 24), get_raw<float>(data, 28)};
+  out.info.yaw = get_raw<float>(data, 32);
+  out.info.pitch = get_raw<float>(data, 36);
+  out.info.timestamp_ms = get_raw<double>(data, 40);
+  out.z_near = get_raw<float>(data, 48);
+  out.z_far = get_raw<float>(data, 52);
+  out.color_bytes = get_raw<uint32_t>(data, 56);
+  out.depth_bytes = get_raw<uint32_t>(data, 60);
+  // Dimensions are checked before anyone sizes a buffer from them.
+  const size_t count = static_cast<size_t>(out.width) * out.height;
+  if (out.width > kSnapshotWidth || out.height > kSnapshotHeight ||
+      (out.color_bytes > 0 && out.color_bytes < 3 * min_plane_bytes(count)) ||
+      (out.depth_bytes > 0 && out.depth_bytes < min_plane_bytes(count))) {
+    return false;
+  }
+  return kHeaderBytes + static_cast<size_t>(out.color_bytes) + out.depth_bytes <= size;
+}
+
+bool snapshot_decode(const uint8_t* data, size_t size, SnapshotPayload& out, bool use_simd) {
+  SnapshotBlobInfo info{};
+  if (!snapshot_blob_peek(data, size, info)) {
+    return false;
+  }
+  const uint32_t w = info.width;
+  const uint32_t h = info.height;
+  const size_t count = static_cast<size_t>(w) * h;
+
+  out.info = info.info;
+  out.width = w;
+  out.height = h;
+  out.z_near = info.z_near;
+  out.z_far = info.z_far;
+
+  std::vector<int16_t> planes(count * 3);
+  std::vector<uint16_t> scratch;
+  int16_t* y = planes.data();
+  int16_t* co = y + count;
+  int16_t* cg = co + count;
+
+  // Walks one length-prefixed plane inside [cursor, section_end).
+  size_t cursor = kHeaderBytes;
+  auto next_plane = [&](size_t section_end, RowPredictor predictor, int16_t* plane) {
+    if (cursor + 4 > section_end) return false;
+    const uint32_t len = get_raw<uint32_t>(data, cursor);
+    cursor += 4;
+    if (cursor + len > section_end || 4 + static_cast<size_t>(len) < min_plane_bytes(count)) return false;
+    const bool ok = decode_plane(data + cursor, len, w, h, predictor, scratch, plane, use_simd);
+    cursor += len;
+    return ok;
+  };
+
+  const size_t color_end = kHeaderBytes + info.color_bytes;
+  out.color.clear();
+  if (info.color_bytes > 0) {
+    if (!next_plane(color_end, RowPredictor::Up, y) || !next_plane(color_end, RowPredictor::Up, co) ||
+        !next_plane(color_end, RowPredictor::Up, cg)) {
+      return false;
+    }
+    out.color.resize(count * 4);
+    ycocg_to_rgba(y, co, cg, out.color.data(), count, use_simd);
+  }
+
+  cursor = color_end;
+  out.depth.clear();
+  if (info.depth_bytes > 0) {
+    if (!next_plane(color_end + info.depth_bytes, RowPredictor::Linear, y)) {
+      return false;
+    }
+    out.depth.resize(count);
+    const uint16_t* q = reinterpret_cast<const uint16_t*>(y);
+    for (size_t i = 0; i < count; ++i) {
+      out.depth[i] = depth_dequantize_log(q[i], info.z_near, info.z_far);
+    }
+  }
+  return true;
+}
+
+namespace {
+
+void codec_worker_run(SnapshotCodecWorker* worker) {
+  for (;;) {
+    SnapshotCodecJob job;
+    {
+      std::unique_lock<std::mutex> lock(worker->mutex);
+      worker->wake.wait(lock, [worker] { return !worker->running || !worker->pending.empty(); });
+      if (!worker->running && worker->pending.empty()) {
+        return;
+      }
+      job = std::move(worker->pending.front());
+      worker->pending.pop_front();
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    if (job.kind == CodecJobKind::Encode) {
+      snapshot_encode(job.payload, job.blob);
+      job.ok = true;
+    } else {
+      job.ok = snapshot_decode(job.blob.data(), job.blob.size(), job.payload);
+    }
+    job.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->finished.push_back(std::move(job));
+  }
+}
+
+}  // namespace
+
+void codec_worker_start(SnapshotCodecWorker& worker) {
+  worker.running = true;
+  worker.thread = std::thread(codec_worker_run, &worker);
+}
+
+void codec_worker_stop(SnapshotCodecWorker& worker) {
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.running = false;
+  }
+  worker.wake.notify_one();
+  if (worker.thread.joinable()) {
+    worker.thread.join();
+  }
+}
+
+void codec_worker_submit(SnapshotCodecWorker& worker, SnapshotCodecJob&& job) {
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.pending.push_back(std::move(job));
+  }
+  worker.wake.notify_one();
+}
+
+void codec_worker_collect(SnapshotCodecWorker& worker, std::vector<SnapshotCodecJob>& out) {
+  std::unique_lock<std::mutex> lock(worker.mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return;
+  }
+  for (SnapshotCodecJob& job : worker.finished) {
+    out.push_back(std::move(job));
+  }
+  worker.finished.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "snapshot.h"
+
+// Compact binary container for a SnapshotPayload.
+//
+// Color is stored losslessly (alpha is dropped, snapshots are opaque): RGB is
+// turned into reversible YCoCg-R planes, each row is predicted from the row
+// above (PNG's "up" filter, which vectorizes in both directions), residuals
+// are zigzagged and Rice-coded in blocks of 64 with a per-block parameter
+// (all-zero blocks cost four bits).
+//
+// Depth is quantized to 16 bits on a log scale between the capture's near and
+// far planes, giving a constant ~0.012% relative error, then each row is
+// extrapolated from the two above it and coded the same way.
+//
+// The capture pose from PhotoSnapshot travels in the header.
+constexpr uint32_t kSnapshotBlobMagic = 0x434e5346;  // "FSNC"
+constexpr uint16_t kSnapshotBlobVersion = 1;
+
+struct SnapshotBlobInfo {
+  PhotoSnapshot info;
+  uint32_t width;
+  uint32_t height;
+  float z_near;
+  float z_far;
+  uint32_t color_bytes;
+  uint32_t depth_bytes;
+};
+
+// `use_simd` selects the SIMD transform kernels when the build has them;
+// the output is identical either way.
+void snapshot_encode(const SnapshotPayload& payload, std::vector<uint8_t>& out, bool use_simd = true);
+bool snapshot_decode(const uint8_t* data, size_t size, SnapshotPayload& out, bool use_simd = true);
+bool snapshot_blob_peek(const uint8_t* data, size_t size, SnapshotBlobInfo& out);
+
+uint16_t depth_quantize_log(float depth, float z_near, float z_far);
+float depth_dequantize_log(uint16_t q, float z_near, float z_far);
+
+// Encodes and decodes on a dedicated thread so the frame loop only pays for
+// handing payloads over. Finished jobs are collected by the owner, usually
+// once per frame.
+enum class CodecJobKind : uint8_t {
+  Encode,
+  Decode,
+};
+
+struct SnapshotCodecJob {
+  CodecJobKind kind;
+  uint32_t tag;  // caller-defined, returned untouched
+  bool ok;
+  double elapsed_ms;
+  SnapshotPayload payload;
+  std::vector<uint8_t> blob;
+};
+
+struct SnapshotCodecWorker {
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<SnapshotCodecJob> pending;
+  std::vector<SnapshotCodecJob> finished;
+  bool running;
+};
+
+void codec_worker_start(SnapshotCodecWorker& worker);
+void codec_worker_stop(SnapshotCodecWorker& worker);
+void codec_worker_submit(SnapshotCodecWorker& worker, SnapshotCodecJob&& job);
+// Moves every finished job into `out` (appending). Never blocks on a job.
+void codec_worker_collect(SnapshotCodecWorker& worker, std::vector<SnapshotCodecJob>& out);
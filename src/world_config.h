@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+// Capacities and placement rules of the app's world. The web build and the
+// native tools that reproduce its sessions (tools/replay.cpp) both size their
+// world from here, so a trace replays against the same limits it was
+// recorded with.
+constexpr int kMaxPlacedPhotos = 100000;
+constexpr float kPlaceDistance = 2.8f;  // placed and moved photos land this far in front of the camera
+
+// The layer count matches the inventory size in web/shell.html.
+constexpr uint32_t kSnapshotLayers = 48;
+
+// Every placed photo gets a box of bouncing spheres in front of it; the
+// volume count is rounded up so the world holds kPhysicsBodyCapacity bodies.
+constexpr int kPhysicsBodyCapacity = 100000;
+constexpr int kPhysicsBodiesPerFrame = 48;
+constexpr int kMaxPhysicsVolumes = (kPhysicsBodyCapacity + kPhysicsBodiesPerFrame - 1) / kPhysicsBodiesPerFrame;
+constexpr float kPhysicsBodyRadius = 0.03f;
+constexpr int kMaxPhysicsInstances = 16384;  // bodies drawn per frame
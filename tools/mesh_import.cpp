@@ -0,0 +1,49 @@
+// Converts an OBJ file into the packed mesh blob the web build loads (see
+// src/mesh.h):
+//
+//   framespace_mesh_import input.obj output.fsmesh
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "mesh.h"
+#include "scene_file.h"
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::fprintf(stderr, "usage: %s input.obj output.fsmesh\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  MappedFile input{};
+  if (!mapped_file_open(argv[1], input)) {
+    std::fprintf(stderr, "could not read %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  std::vector<uint8_t> blob;
+  MeshImportStats stats{};
+  const bool ok = mesh_import_obj(reinterpret_cast<const char*>(input.data), input.size, blob, &stats);
+  mapped_file_close(input);
+  if (!ok) {
+    std::fprintf(stderr, "%s: no triangles, or a face references a missing vertex\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  FILE* f = std::fopen(argv[2], "wb");
+  if (!f || std::fwrite(blob.data(), 1, blob.size(), f) != blob.size()) {
+    std::fprintf(stderr, "could not write %s\n", argv[2]);
+    if (f) std::fclose(f);
+    return EXIT_FAILURE;
+  }
+  std::fclose(f);
+
+  std::printf("%s: %d vertices, %d triangles, ACMR %.3f -> %.3f, %zu bytes (%.0f%% of float attributes)\n",
+              argv[2],
+              stats.vertex_count,
+              stats.triangle_count,
+              stats.acmr_before,
+              stats.acmr_after,
+              stats.packed_bytes,
+              100.0 * static_cast<double>(stats.packed_bytes) / static_cast<double>(stats.float_bytes));
+  return EXIT_SUCCESS;
+}
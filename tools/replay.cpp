@@ -0,0 +1,288 @@
+// Replays an input trace recorded in the browser (see src/input_trace.h)
+// without a GPU: the camera, captures, placements, photo moves and deletes,
+// stress scenes, physics and photo culling run exactly as the web build runs
+// them, one fixed step per frame, with the profiler on. Prints frame-time
+// percentiles and the final state, so two builds can be compared on the same
+// session.
+//
+//   framespace_replay trace.fsit [--scene scene.fsscene] [--size WxH] [--chrome-trace out.json]
+//
+// GPU stages do not exist here; Encode covers the CPU side of encoding (the
+// instance buffers the web build uploads).
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera.h"
+#include "input_trace.h"
+#include "jobs.h"
+#include "physics.h"
+#include "profiler.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "scene_gen.h"
+#include "world_config.h"
+
+namespace {
+
+struct ReplayWorld {
+  FlyCamera camera;
+  PhotoScene scene;
+  SnapshotLayerTable layers;
+  PhysicsWorld physics;
+  JobSystem jobs;
+  uint32_t capture_count;
+  int64_t shot_offset;  // added to recorded shot ids at or above first_shot_id
+  InputTracePhotos photos;
+  std::vector<InstanceData> photo_instances;
+  std::vector<InstanceData> body_instances;
+};
+
+bool load_scene(ReplayWorld& world, const char* path) {
+  MappedFile file{};
+  if (!mapped_file_open(path, file)) {
+    std::fprintf(stderr, "could not read %s\n", path);
+    return false;
+  }
+  SceneFileView view{};
+  const bool ok = scene_file_open(file.data, file.size, view) && scene_load_photos(world.scene, view);
+  if (ok) {
+    for (int i = 0; i < world.scene.count; ++i) {
+      const PhotoHandle handle = scene_handle_at(world.scene, i);
+      physics_add_volume(world.physics, handle, kPhysicsBodiesPerFrame, handle);
+    }
+    for (uint32_t i = 0; i < view.header->snapshot_count; ++i) {
+      snapshot_layer_assign(world.layers, view.snapshots[i].id);
+    }
+    const uint32_t next_id = view.header->next_shot_id;
+    world.capture_count = next_id > 0 ? next_id - 1 : 0;
+  } else {
+    std::fprintf(stderr, "%s: not a scene file, or more than %d photos\n", path, kMaxPlacedPhotos);
+  }
+  mapped_file_close(file);
+  return ok;
+}
+
+// Same effect on the scene as the capture, place, move, delete and stress
+// scene paths in src/main.cpp, minus the pixels.
+void apply_command(ReplayWorld& world, const InputTrace& trace, const InputEvent& e) {
+  switch (static_cast<InputCommand>(e.a)) {
+    case InputCommand::Capture:
+      world.capture_count += 1;
+      snapshot_layer_assign(world.layers, world.capture_count);
+      break;
+    case InputCommand::Place: {
+      if (e.b <= 0) {
+        break;
+      }
+      const int64_t shot = e.b >= static_cast<int32_t>(trace.first_shot_id) ? e.b + world.shot_offset : e.b;
+      const Vec3 pos = vec3_add(world.camera.position, vec3_scale(camera_forward(world.camera), kPlaceDistance));
+      const PhotoHandle handle = scene_place_photo(
+          world.scene, static_cast<uint32_t>(shot), pos, photo_yaw_facing_camera(world.camera.yaw), 1.0f);
+      input_trace_photos_add(world.photos, handle);
+      if (handle != kInvalidPhotoHandle) {
+        physics_add_volume(world.physics, handle, kPhysicsBodiesPerFrame, handle);
+      }
+      break;
+    }
+    case InputCommand::MovePhoto: {
+      const uint32_t* args = input_trace_args(trace, e);
+      if (args == nullptr) {
+        break;
+      }
+      float pose[kInputTraceMoveArgs];
+      std::memcpy(pose, args, sizeof(pose));
+      scene_move_photo(world.scene, input_trace_photos_handle(world.photos, static_cast<uint32_t>(e.b)),
+                       Vec3{pose[0], pose[1], pose[2]}, pose[3], pose[4]);
+      break;
+    }
+    case InputCommand::DeletePhoto: {
+      const PhotoHandle handle = input_trace_photos_handle(world.photos, static_cast<uint32_t>(e.b));
+      physics_remove_volume(world.physics, handle);
+      if (scene_remove_photo(world.scene, handle)) {
+        input_trace_photos_remove(world.photos, handle);
+      }
+      break;
+    }
+    case InputCommand::GenerateScene: {
+      const uint32_t* args = input_trace_args(trace, e);
+      if (args == nullptr) {
+        break;
+      }
+      SceneGenParams params{static_cast<SceneLayout>(args[0]), e.b, static_cast<int>(args[1]), args[2]};
+      params.shot_count = std::clamp(params.shot_count, 0, static_cast<int>(kSnapshotLayers));
+      if (!scene_generate(world.scene, params)) {
+        break;
+      }
+      physics_clear(world.physics);
+      for (int i = 0; i < world.scene.count; ++i) {
+        const PhotoHandle handle = scene_handle_at(world.scene, i);
+        physics_add_volume(world.physics, handle, kPhysicsBodiesPerFrame, handle);
+      }
+      snapshot_layers_init(world.layers, kSnapshotLayers);
+      for (int id = 1; id <= params.shot_count; ++id) {
+        snapshot_layer_assign(world.layers, static_cast<uint32_t>(id));
+      }
+      world.capture_count = static_cast<uint32_t>(params.shot_count);
+      world.shot_offset = 0;
+      camera_init(world.camera);
+      input_trace_photos_reset(world.photos, world.scene);
+      break;
+    }
+    default: break;
+  }
+}
+
+void apply_event(ReplayWorld& world, const InputTrace& trace, const InputEvent& e) {
+  switch (static_cast<InputEventType>(e.type)) {
+    case InputEventType::KeyDown: camera_set_key(world.camera, static_cast<InputKey>(e.a), true); break;
+    case InputEventType::KeyUp: camera_set_key(world.camera, static_cast<InputKey>(e.a), false); break;
+    case InputEventType::MouseMove:
+      camera_mouse_look(world.camera, static_cast<float>(e.a), static_cast<float>(e.b));
+      break;
+    case InputEventType::Command: apply_command(world, trace, e); break;
+    default: break;
+  }
+}
+
+void print_stage(const std::vector<ProfileSample>& samples, ProfileStage stage) {
+  const ProfileSummary s = profiler_summarize(samples, stage);
+  std::printf("  %-24s p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f ms\n",
+              profile_stage_name(stage), s.p50, s.p95, s.p99, s.max);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* trace_path = nullptr;
+  const char* scene_path = nullptr;
+  const char* chrome_path = nullptr;
+  int width = 1280;
+  int height = 720;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+      scene_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--chrome-trace") == 0 && i + 1 < argc) {
+      chrome_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        std::fprintf(stderr, "--size expects WxH\n");
+        return EXIT_FAILURE;
+      }
+    } else if (!trace_path && argv[i][0] != '-') {
+      trace_path = argv[i];
+    } else {
+      trace_path = nullptr;
+      break;
+    }
+  }
+  if (!trace_path) {
+    std::fprintf(stderr, "usage: %s trace.fsit [--scene scene.fsscene] [--size WxH] [--chrome-trace out.json]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  MappedFile file{};
+  InputTrace trace{};
+  if (!mapped_file_open(trace_path, file)) {
+    std::fprintf(stderr, "could not read %s\n", trace_path);
+    return EXIT_FAILURE;
+  }
+  const bool trace_ok = input_trace_read(file.data, file.size, trace);
+  mapped_file_close(file);
+  if (!trace_ok) {
+    std::fprintf(stderr, "%s: not a valid input trace\n", trace_path);
+    return EXIT_FAILURE;
+  }
+
+  static ReplayWorld world;
+  camera_init(world.camera);
+  scene_init(world.scene, kMaxPlacedPhotos);
+  snapshot_layers_init(world.layers, kSnapshotLayers);
+  physics_init(world.physics, kMaxPhysicsVolumes, kPhysicsBodiesPerFrame, kPhysicsBodyRadius);
+  jobs_init(world.jobs, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  world.capture_count = 0;
+  world.photo_instances.resize(kMaxPlacedPhotos);
+  world.body_instances.resize(kMaxPhysicsInstances);
+  if (scene_path && !load_scene(world, scene_path)) {
+    jobs_shutdown(world.jobs);
+    return EXIT_FAILURE;
+  }
+  input_trace_start_camera(trace, world.camera);
+  world.shot_offset = static_cast<int64_t>(world.capture_count) + 1 - trace.first_shot_id;
+  input_trace_photos_reset(world.photos, world.scene);
+
+  static Profiler profiler;
+  profiler_init(profiler);
+  std::vector<ProfileSample> samples;
+  samples.reserve(trace.frame_count);
+  InputReplay replay{};
+  input_replay_begin(replay);
+  std::vector<InputEvent> events;
+  const float aspect = static_cast<float>(width) / static_cast<float>(height);
+  const float dt = trace.step_seconds;
+  uint64_t visible_total = 0;
+  ProfileSample sample;
+  for (uint64_t frame = 0; input_replay_next_frame(replay, trace, events); ++frame) {
+    profiler_begin_frame(profiler, frame, profiler_now_ms());
+    for (const InputEvent& e : events) {
+      apply_event(world, trace, e);
+    }
+    {
+      ProfileScope scope(profiler, ProfileStage::UpdateCamera);
+      camera_update(world.camera, dt);
+    }
+    Mat4 vp;
+    {
+      ProfileScope scope(profiler, ProfileStage::UpdateViewProjection);
+      vp = camera_view_projection(world.camera, aspect, nullptr);
+    }
+    const Frustum frustum = frustum_from_view_projection(vp);
+    {
+      ProfileScope scope(profiler, ProfileStage::Physics);
+      physics_update_sleep(world.physics, world.scene, frustum);
+      physics_advance(world.physics, dt, world.jobs);
+    }
+    {
+      ProfileScope scope(profiler, ProfileStage::Encode);
+      visible_total += static_cast<uint64_t>(scene_prepare_instances_parallel(
+          world.scene, frustum, &world.layers, world.photo_instances.data(), kMaxPlacedPhotos, world.jobs));
+      physics_write_instances(world.physics, world.scene, world.body_instances.data(), kMaxPhysicsInstances);
+    }
+    profiler_end_frame(profiler, profiler_now_ms());
+    if (profiler_read_frame(profiler, frame, sample)) {
+      samples.push_back(sample);
+    }
+  }
+
+  std::printf("%s: %u frames at %.2f ms, %zu inputs, %d photos placed, %u captures\n",
+              trace_path, trace.frame_count, dt * 1000.0f, trace.records.size(), world.scene.count,
+              world.capture_count);
+  print_stage(samples, ProfileStage::Frame);
+  print_stage(samples, ProfileStage::UpdateCamera);
+  print_stage(samples, ProfileStage::Physics);
+  print_stage(samples, ProfileStage::Encode);
+  // The end state depends only on the trace, so it must match across builds.
+  std::printf("  final camera (%.4f, %.4f, %.4f) yaw %.4f pitch %.4f, %.1f visible photos per frame\n",
+              world.camera.position.x, world.camera.position.y, world.camera.position.z,
+              world.camera.yaw, world.camera.pitch,
+              trace.frame_count > 0 ? static_cast<double>(visible_total) / trace.frame_count : 0.0);
+
+  int status = EXIT_SUCCESS;
+  if (chrome_path) {
+    std::string json;
+    profiler_write_chrome_trace(samples, json);
+    FILE* f = std::fopen(chrome_path, "wb");
+    if (!f || std::fwrite(json.data(), 1, json.size(), f) != json.size()) {
+      std::fprintf(stderr, "could not write %s\n", chrome_path);
+      status = EXIT_FAILURE;
+    }
+    if (f) std::fclose(f);
+  }
+  jobs_shutdown(world.jobs);
+  return status;
+}